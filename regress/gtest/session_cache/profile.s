@@ -0,0 +1,34 @@
+#include <avr/io.h>
+
+; data cache profile, see unittest_profile.cpp
+; cache: 32 sets of 2 lines with 16 bytes, 0x0200, 0x0400 and 0x0600 are in set 0
+
+.global main
+main:
+
+; 3 lines evict each other in set 0: 8 misses, 6 evictions, 1 writeback
+.global conflict
+conflict:
+    lds r16, 0x0200                         ; miss
+    lds r16, 0x0400                         ; miss
+    lds r16, 0x0600                         ; miss, evicts 0x0200
+    lds r16, 0x0200                         ; miss, evicts 0x0400
+    lds r16, 0x0400                         ; miss, evicts 0x0600
+    sts 0x0600, r16                         ; miss, evicts 0x0200, line is dirty
+    lds r16, 0x0200                         ; miss, evicts 0x0400
+    lds r16, 0x0400                         ; miss, evicts dirty line 0x0600
+
+; sequential access in set 1: 1 miss
+.global stream
+stream:
+    lds r16, 0x0210                         ; miss
+    lds r16, 0x0211                         ; hit
+    lds r16, 0x0212                         ; hit
+
+.global stopsim
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
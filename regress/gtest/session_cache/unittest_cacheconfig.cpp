@@ -0,0 +1,157 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrerror.h"
+#include "hwcache.h"
+
+//! Returns true, if Apply fails by avr_error
+static bool ApplyFails(CacheConfig &cfg, const string &option) {
+    vector<string> options(1, option);
+    bool failed = false;
+    sysConHandler.SetUseExit(false);
+    try {
+        cfg.Apply("dcache", options);
+    } catch(char const *) {
+        failed = true;
+    }
+    sysConHandler.SetUseExit(true);
+    return failed;
+}
+
+TEST( SESSION_CACHE, CONFIG_SET )
+{
+    CacheConfig cfg;
+    EXPECT_EQ("", cfg.Check()) << "defaults are invalid" << endl;
+
+    EXPECT_EQ("", cfg.Set("lines", "128"));
+    EXPECT_EQ("", cfg.Set("linesize", "0x10"));
+    EXPECT_EQ("", cfg.Set("assoc", "8"));
+    EXPECT_EQ("", cfg.Set("miss", "7"));
+    EXPECT_EQ("", cfg.Set("policy", "fifo"));
+    EXPECT_EQ("", cfg.Set("mode", "wt"));
+    EXPECT_EQ("", cfg.Set("off", ""));
+    EXPECT_EQ(128u, cfg.lines);
+    EXPECT_EQ(16u, cfg.linesize);
+    EXPECT_EQ(8u, cfg.assoc);
+    EXPECT_EQ(7, cfg.missCycles);
+    EXPECT_EQ(HWCache::POLICY_FIFO, cfg.policy);
+    EXPECT_EQ(HWCache::OPMODE_WRITETHROUGH, cfg.mode);
+    EXPECT_FALSE(cfg.enabled);
+    EXPECT_EQ("", cfg.Check());
+
+    // errors don't change the config
+    EXPECT_NE("", cfg.Set("size", "1024")) << "unknown key" << endl;
+    EXPECT_NE("", cfg.Set("lines", "12x")) << "bad number" << endl;
+    EXPECT_NE("", cfg.Set("miss", "-1")) << "negative number" << endl;
+    EXPECT_NE("", cfg.Set("lines", "")) << "missing number" << endl;
+    EXPECT_NE("", cfg.Set("policy", "lfu")) << "unknown policy" << endl;
+    EXPECT_NE("", cfg.Set("trace", "maybe")) << "bad switch" << endl;
+    EXPECT_NE("", cfg.Set("on", "1")) << "value for on" << endl;
+    EXPECT_EQ(128u, cfg.lines);
+    EXPECT_EQ(7, cfg.missCycles);
+}
+
+TEST( SESSION_CACHE, CONFIG_CHECK )
+{
+    CacheConfig cfg;
+    cfg.linesize = 24;
+    EXPECT_NE("", cfg.Check()) << "line size isn't a power of two" << endl;
+    cfg.linesize = 2;
+    EXPECT_NE("", cfg.Check()) << "line size less than 4" << endl;
+
+    cfg = CacheConfig();
+    cfg.lines = 4;
+    cfg.assoc = 8;
+    EXPECT_NE("", cfg.Check()) << "assoc > lines" << endl;
+    cfg.lines = 12;
+    EXPECT_NE("", cfg.Check()) << "lines not a multiple of assoc" << endl;
+    cfg.assoc = 0;
+    EXPECT_NE("", cfg.Check()) << "assoc 0" << endl;
+
+    cfg = CacheConfig();
+    cfg.lines = 48;
+    cfg.assoc = 3;
+    EXPECT_EQ("", cfg.Check());
+    cfg.policy = HWCache::POLICY_PLRU;
+    EXPECT_NE("", cfg.Check()) << "PLRU with 3-way" << endl;
+}
+
+TEST( SESSION_CACHE, CONFIG_APPLY )
+{
+    CacheConfig cfg;
+    vector<string> options;
+    options.push_back("icache:lines=16");
+    options.push_back("dcache:lines=32,linesize=8,assoc=2,policy=plru");
+    options.push_back("dcache:hit=1,sweep=lru:1-4,plru:2");
+    cfg.Apply("dcache", options);
+    EXPECT_EQ(32u, cfg.lines);
+    EXPECT_EQ(8u, cfg.linesize);
+    EXPECT_EQ(2u, cfg.assoc);
+    EXPECT_EQ(1, cfg.hitCycles);
+    EXPECT_EQ(HWCache::POLICY_PLRU, cfg.policy);
+    ASSERT_EQ(1u, cfg.sweeps.size());
+    EXPECT_EQ("lru:1-4,plru:2", cfg.sweeps[0]) << "sweep takes the rest" << endl;
+
+    cfg = CacheConfig();
+    EXPECT_TRUE(ApplyFails(cfg, "dcache:lines=16,foo=1")) << "unknown key" << endl;
+    EXPECT_TRUE(ApplyFails(cfg, "dcache:miss=three")) << "bad number" << endl;
+    EXPECT_TRUE(ApplyFails(cfg, "dcache")) << "no colon" << endl;
+    EXPECT_FALSE(ApplyFails(cfg, "icache:foo=1")) << "other cache" << endl;
+}
+
+TEST( SESSION_CACHE, CONFIG_FILE )
+{
+    const char *name = "session_cache/caches.cfg";
+    {
+        ofstream f(name);
+        f << "# caches for the test" << endl
+          << "[icache]" << endl
+          << "  lines = 128   # 4KiB" << endl
+          << "linesize=32" << endl
+          << endl
+          << "[dcache]" << endl
+          << "assoc = 4" << endl
+          << "policy = random" << endl
+          << "# lines = 8" << endl
+          << "mode = writethrough" << endl;
+    }
+    vector<string> options;
+    CacheConfig::ReadFile(name, options);
+    ASSERT_EQ(5u, options.size());
+    EXPECT_EQ("icache:lines=128", options[0]);
+    EXPECT_EQ("dcache:mode=writethrough", options[4]);
+
+    CacheConfig icfg, dcfg;
+    icfg.Apply("icache", options);
+    dcfg.Apply("dcache", options);
+    EXPECT_EQ(128u, icfg.lines);
+    EXPECT_EQ(32u, icfg.linesize);
+    EXPECT_EQ(4u, icfg.assoc) << "default" << endl;
+    EXPECT_EQ(64u, dcfg.lines) << "commented out" << endl;
+    EXPECT_EQ(4u, dcfg.assoc);
+    EXPECT_EQ(HWCache::POLICY_RANDOM, dcfg.policy);
+    EXPECT_EQ(HWCache::OPMODE_WRITETHROUGH, dcfg.mode);
+    EXPECT_EQ(HWCache::POLICY_LRU, icfg.policy);
+
+    // setting outside of a section
+    {
+        ofstream f(name);
+        f << "lines = 8" << endl;
+    }
+    bool failed = false;
+    sysConHandler.SetUseExit(false);
+    try {
+        CacheConfig::ReadFile(name, options);
+    } catch(char const *) {
+        failed = true;
+    }
+    sysConHandler.SetUseExit(true);
+    EXPECT_TRUE(failed) << "no section" << endl;
+    remove(name);
+}
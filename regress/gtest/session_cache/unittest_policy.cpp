@@ -0,0 +1,91 @@
+#include <iostream>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "hwcache.h"
+
+//! One access of a stream, address is line * 16
+struct CacheAccess {
+    bool write;
+    unsigned int line;
+};
+
+// A is written, then read hits, all others are read, see PolicyStream
+static const CacheAccess stream[] = {
+    { true, 1 },    // A
+    { false, 2 },   // B
+    { false, 3 },   // C
+    { false, 4 },   // D
+    { false, 1 },   // A
+    { false, 5 },   // E
+    { false, 2 },   // B
+    { false, 6 },   // F
+    { false, 1 },   // A
+    { false, 3 },   // C
+    { false, 7 },   // G
+    { false, 8 },   // H
+    { false, 9 }    // I
+};
+
+static AvrDevice *dev1 = NULL;
+
+//! Runs stream through a fully associative cache with 4 lines of 16 bytes
+static HWCache::cache_stats_t PolicyStream(HWCache::repl_policy_e policy, const char *name) {
+    if(dev1 == NULL)
+        dev1 = new AvrDevice_atmega128;
+    CacheConfig cfg;
+    cfg.lines = 4;
+    cfg.linesize = 16;
+    cfg.assoc = 4;
+    cfg.policy = policy;
+    cfg.report = false;
+    HWCache cache(dev1, cfg, NULL, 0, name);
+    for(unsigned int i = 0; i < sizeof(stream) / sizeof(stream[0]); i++)
+        cache.access(stream[i].line * 16, 1, stream[i].write);
+    return cache.stats;
+}
+
+static void ExpectStats(const HWCache::cache_stats_t &s, unsigned long miss, unsigned long evict,
+                        unsigned long writeback, const char *policy) {
+    EXPECT_EQ(13ul, s.num_access) << policy << endl;
+    EXPECT_EQ(miss, s.num_miss) << policy << endl;
+    EXPECT_EQ(evict, s.num_evict) << policy << endl;
+    EXPECT_EQ(writeback, s.num_writeback) << policy << endl;
+    // miss 3 cycles, writeback 5 cycles
+    EXPECT_EQ(3 * miss + 5 * writeback, s.num_cycles) << policy << endl;
+}
+
+TEST( SESSION_CACHE, POLICIES )
+{
+    // oldest access: evicts B C D E B F, last miss evicts A, which is dirty
+    ExpectStats(PolicyStream(HWCache::POLICY_LRU, "LRU"), 11, 7, 1, "LRU");
+    // tree bits: evicts C D E B F A, A is dirty
+    ExpectStats(PolicyStream(HWCache::POLICY_PLRU, "PLRU"), 10, 6, 1, "PLRU");
+    // oldest load: E evicts A, which is dirty, A is loaded again clean
+    ExpectStats(PolicyStream(HWCache::POLICY_FIFO, "FIFO"), 11, 7, 1, "FIFO");
+    // xorshift32 with fixed seed: ways 2 3 0 2 3 3, evicts C D A E F H, A is dirty
+    ExpectStats(PolicyStream(HWCache::POLICY_RANDOM, "RANDOM"), 10, 6, 1, "RANDOM");
+    // loaded lines are evicted first: evicts D E F G H, A B C stay after hits
+    ExpectStats(PolicyStream(HWCache::POLICY_MRU, "MRU"), 9, 5, 0, "MRU");
+}
+
+TEST( SESSION_CACHE, DIRTY_READ_HIT )
+{
+    if(dev1 == NULL)
+        dev1 = new AvrDevice_atmega128;
+    CacheConfig cfg;
+    cfg.lines = 2;
+    cfg.linesize = 16;
+    cfg.assoc = 1;
+    cfg.report = false;
+    HWCache cache(dev1, cfg, NULL, 0, "DIRTY");
+
+    EXPECT_EQ(3, cache.access(0x00, 1, true));   // miss, line is dirty
+    EXPECT_EQ(0, cache.access(0x01, 1, false));  // read hit keeps line dirty
+    EXPECT_EQ(8, cache.access(0x20, 1, false));  // miss, writeback of dirty line
+    EXPECT_EQ(3, cache.access(0x00, 1, false));  // miss, line 0x20 is clean
+    EXPECT_EQ(1ul, cache.stats.num_writeback);
+}
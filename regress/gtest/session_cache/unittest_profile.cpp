@@ -0,0 +1,89 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128_c.h"
+#include "avrfactory.h"
+#include "cacheprofile.h"
+#include "flash.h"
+#include "hwcache.h"
+#include "systemclock.h"
+
+//! Runs profile.s with a profiled data cache
+static AvrDevice *RunProfile(void) {
+    AvrFactory &factory = AvrFactory::instance();
+    factory.cacheOptions.clear();
+    factory.AddCacheOption("icache:off");
+    factory.AddCacheOption("dcache:trace=0,profile=1");
+
+    SystemClock::Instance().ResetClock();   // don't run devices of other tests
+    AvrDevice *dev1 = new AvrDevice_atmega128_c;
+    factory.cacheOptions.clear();
+    dev1->Load("session_cache/profile.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    SystemClock::Instance().Add(dev1);
+    SystemClock::Instance().Endless(); // should break if stopsim is reached
+    return dev1;
+}
+
+//! Returns true, if text has line
+static bool HasLine(const string &text, const string &line) {
+    return ("\n" + text).find("\n" + line + "\n") != string::npos;
+}
+
+TEST( SESSION_CACHE, PROFILE_REPORT )
+{
+    AvrDevice *dev1 = RunProfile();
+    ASSERT_TRUE(dev1->cache_data != NULL);
+    ASSERT_TRUE(dev1->cache_data->profile != NULL);
+    ostringstream os;
+    dev1->cache_data->profile->Write(os, "DCACHE");
+    const string report = os.str();
+
+    // per function: function accesses misses evictions writebacks
+    EXPECT_TRUE(HasLine(report, "conflict 8 8 6 1")) << report;
+    EXPECT_TRUE(HasLine(report, "stream 3 1 0 0")) << report;
+    EXPECT_LT(report.find("\nconflict "), report.find("\nstream ")) << "not sorted by misses" << endl;
+
+    // per instruction: address function offset source accesses misses evictions writebacks
+    ostringstream insn;
+    const unsigned int conflict = dev1->Flash->GetAddressAtSymbol("conflict") * 2;
+    insn << "0x" << hex << conflict << " conflict 0x0 - 1 1 0 0";
+    EXPECT_TRUE(HasLine(report, insn.str())) << report;
+    insn.str("");
+    insn << "0x" << hex << conflict + 0x14 << " conflict 0x14 - 1 1 1 0";
+    EXPECT_TRUE(HasLine(report, insn.str())) << "sts" << endl << report;
+    insn.str("");
+    insn << "0x" << hex << conflict + 0x1c << " conflict 0x1c - 1 1 1 1";
+    EXPECT_TRUE(HasLine(report, insn.str())) << "writeback" << endl << report;
+    insn.str("");
+    const unsigned int stream = dev1->Flash->GetAddressAtSymbol("stream") * 2;
+    insn << "0x" << hex << stream << " stream 0x0 - 1 1 0 0";
+    EXPECT_TRUE(HasLine(report, insn.str())) << report;
+    insn.str("");
+    insn << "0x" << hex << stream + 4 << " stream";
+    EXPECT_EQ(string::npos, report.find(insn.str())) << "hit is listed" << endl;
+
+    // conflict sets: data memory is at 0x800000
+    EXPECT_TRUE(HasLine(report, "set 0 6")) << report;
+    EXPECT_TRUE(HasLine(report, "  2 0x800600 <- 0x800400")) << report;
+    EXPECT_TRUE(HasLine(report, "  2 0x800400 <- 0x800200")) << report;
+    EXPECT_TRUE(HasLine(report, "  2 0x800200 <- 0x800600")) << report;
+    EXPECT_EQ(string::npos, report.find("\nset 1 ")) << "set without eviction" << endl;
+}
+
+TEST( SESSION_CACHE, PROFILE_PC_RANGE )
+{
+    AvrDevice *dev1 = RunProfile();
+    CacheProfile *profile = dev1->cache_data->profile;
+    const size_t size = profile->counts.size();
+    EXPECT_EQ(dev1->Flash->GetSize() / 2, size);
+    profile->Access(size, 0, true, false, 0, false);
+    profile->Access(0xffffffff, 0, true, false, 0, false);
+    EXPECT_EQ(size, profile->counts.size()) << "pc behind flash" << endl;
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "hwcache.h"
+#include "cachesweep.h"
+
+//! One row of the sweep table
+struct SweepRow {
+    string kind;
+    unsigned int assoc;
+    unsigned long accesses;
+    unsigned long misses;
+    unsigned long evictions;
+    unsigned long writebacks;
+    unsigned long long cycles;
+};
+
+//! Parses the table written by CacheSweep::Write
+static vector<SweepRow> ParseSweep(const string &table) {
+    vector<SweepRow> rows;
+    istringstream in(table);
+    string line;
+    getline(in, line);  // name
+    getline(in, line);  // head
+    while (getline(in, line)) {
+        istringstream ls(line);
+        SweepRow r;
+        unsigned int bytes, lines, linesize;
+        string policy;
+        double missPercent;
+        ls >> r.kind >> bytes >> lines >> linesize >> r.assoc >> policy >> r.accesses >> r.misses
+           >> missPercent >> r.evictions >> r.writebacks >> r.cycles;
+        if (ls)
+            rows.push_back(r);
+    }
+    return rows;
+}
+
+TEST( SESSION_CACHE, SWEEP_LRU )
+{
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    const char *out = "session_cache/sweep.txt";
+
+    // primary: 4 sets of 2 lines with 16 bytes, stacks up to 8-way
+    CacheConfig cfg;
+    cfg.lines = 8;
+    cfg.linesize = 16;
+    cfg.assoc = 2;
+    cfg.hitCycles = 1;
+    cfg.report = false;
+    cfg.sweeps.push_back("lru:sets=4,assoc=8");
+    cfg.sweeps.push_back(string("out=") + out);
+    HWCache *primary = new HWCache(dev1, cfg, NULL, 0, "SWEEP");
+
+    // real LRU caches with same sets for each associativity
+    vector<HWCache *> models;
+    for(unsigned int a = 1; a <= 8; a++) {
+        CacheConfig m = cfg;
+        m.sweeps.clear();
+        m.lines = 4 * a;
+        m.assoc = a;
+        ostringstream name;
+        name << "SWEEP_LRU" << a;
+        models.push_back(new HWCache(dev1, m, NULL, 0, name.str()));
+    }
+
+    // 1 to 4 bytes on 32 lines, a third are writes, some accesses cross a line
+    unsigned int seed = 12345;
+    for(unsigned int i = 0; i < 5000; i++) {
+        seed = seed * 1103515245 + 12345;
+        const unsigned int r = seed >> 8;
+        const unsigned int addr = r % 512;
+        const unsigned char len = 1 + (r >> 9) % 4;
+        const bool write = (r >> 11) % 3 == 0;
+        primary->access(addr, len, write);
+        for(unsigned int a = 0; a < models.size(); a++)
+            models[a]->access(addr, len, write);
+    }
+    EXPECT_LT(100ul, primary->stats.num_unaligned) << "no line crossing accesses" << endl;
+
+    ostringstream table;
+    primary->sweep->Write(table);
+    vector<SweepRow> rows = ParseSweep(table.str());
+    ASSERT_EQ(1u + 8u, rows.size()) << table.str();
+
+    // primary row counts line crossing accesses like the stacks and the models
+    EXPECT_EQ("primary", rows[0].kind);
+    EXPECT_EQ(2u, rows[0].assoc);
+    EXPECT_EQ(rows[2].accesses, rows[0].accesses) << "primary";
+    EXPECT_EQ(rows[2].misses, rows[0].misses) << "primary";
+    EXPECT_EQ(rows[2].evictions, rows[0].evictions) << "primary";
+    EXPECT_EQ(rows[2].writebacks, rows[0].writebacks) << "primary";
+    EXPECT_EQ(rows[2].cycles, rows[0].cycles) << "primary";
+
+    for(unsigned int a = 1; a <= 8; a++) {
+        const SweepRow &r = rows[a];
+        const HWCache::cache_stats_t &s = models[a - 1]->stats;
+        EXPECT_EQ("lru", r.kind);
+        EXPECT_EQ(a, r.assoc);
+        EXPECT_EQ(s.num_access, r.accesses) << "assoc " << a << endl;
+        EXPECT_EQ(s.num_miss, r.misses) << "assoc " << a << endl;
+        EXPECT_EQ(s.num_evict, r.evictions) << "assoc " << a << endl;
+        EXPECT_EQ(s.num_writeback, r.writebacks) << "assoc " << a << endl;
+        EXPECT_EQ(s.num_cycles, r.cycles) << "assoc " << a << endl;
+    }
+    EXPECT_LT(0ul, rows[8].writebacks) << "no writeback in largest cache" << endl;
+    EXPECT_GT(rows[1].misses, rows[8].misses) << "associativity doesn't help" << endl;
+
+    for(unsigned int a = 0; a < models.size(); a++)
+        delete models[a];
+    delete primary;
+    remove(out);
+}
@@ -0,0 +1,20 @@
+#include <avr/io.h>
+
+; loop and skips with known counts, see unittest_coverage.cpp
+.global main
+main:
+    ldi r24, 10
+loop:
+    dec r24
+    brne loop           ; 9 times taken, 1 time not taken
+    ldi r25, 3
+    sbrs r25, 0         ; skips
+    nop
+    sbrc r25, 0         ; doesn't skip
+    nop
+
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
@@ -0,0 +1,56 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "coverage.h"
+#include "flash.h"
+#include "systemclock.h"
+
+TEST( SESSION_COVERAGE, BRANCH_COUNTS )
+{
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    dev1->Load("session_coverage/branches.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    dev1->EnableCoverage("session_coverage/branches.info");
+    SystemClock::Instance().Add(dev1);
+    SystemClock::Instance().Endless(); // should break if stopsim is reached
+
+    const CoverageCounter *c = dev1->coverage;
+    unsigned int main = dev1->Flash->GetAddressAtSymbol("main");
+    unsigned int loop = dev1->Flash->GetAddressAtSymbol("loop");
+    unsigned int stopsim = dev1->Flash->GetAddressAtSymbol("stopsim");
+
+    EXPECT_EQ(1u, c->GetExecCount(main));
+    EXPECT_EQ(10u, c->GetExecCount(loop));
+    EXPECT_EQ(10u, c->GetExecCount(loop + 1));
+    EXPECT_EQ(9u, c->GetTakenCount(loop + 1)) << "brne" << endl;
+    EXPECT_EQ(1u, c->GetNotTakenCount(loop + 1)) << "brne" << endl;
+    EXPECT_EQ(1u, c->GetTakenCount(loop + 3)) << "sbrs" << endl;
+    EXPECT_EQ(0u, c->GetExecCount(loop + 4)) << "skipped nop" << endl;
+    EXPECT_EQ(1u, c->GetNotTakenCount(loop + 5)) << "sbrc" << endl;
+    EXPECT_EQ(1u, c->GetExecCount(loop + 6)) << "not skipped nop" << endl;
+    EXPECT_EQ(0u, c->GetExecCount(stopsim)) << "simulation stops before" << endl;
+
+    // line info from DWARF
+    SourceLine l0 = dev1->Flash->GetSourceLine(main);
+    SourceLine l1 = dev1->Flash->GetSourceLine(loop);
+    ASSERT_LE(0, l0.file) << "no line info for main" << endl;
+    EXPECT_EQ(2u, l1.line - l0.line);
+
+    ostringstream os;
+    dev1->coverage->WriteLcov(os);
+    string lcov = os.str();
+    ostringstream da, brda;
+    da << "DA:" << l1.line + 1 << ",10\n";
+    brda << "BRDA:" << l1.line + 1 << ",0,0,9\n";
+    EXPECT_NE(string::npos, lcov.find(da.str())) << lcov;
+    EXPECT_NE(string::npos, lcov.find(brda.str())) << lcov;
+    EXPECT_NE(string::npos, lcov.find("FNDA:10,loop\n")) << lcov;
+    EXPECT_NE(string::npos, lcov.find("end_of_record\n")) << lcov;
+}
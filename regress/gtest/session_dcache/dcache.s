@@ -0,0 +1,115 @@
+#include <avr/io.h>
+
+; data cache wait states, see unittest_dcache.cpp
+; each test is measured by timer 1, the cycles are stored in r2:r3 ... r14:r15,
+; the test runs with and without data cache, the difference are the wait states
+; cache: 32 sets of 2 lines with 16 bytes, miss 3 cycles, writeback 5 cycles
+
+.macro start
+    in r24, _SFR_IO_ADDR(TCNT1L)
+    in r25, _SFR_IO_ADDR(TCNT1H)
+.endm
+
+.macro stop
+    in r26, _SFR_IO_ADDR(TCNT1L)
+    in r27, _SFR_IO_ADDR(TCNT1H)
+    sub r26, r24
+    sbc r27, r25
+.endm
+
+.global main
+main:
+    ldi r16, (1<<CS10)
+    out _SFR_IO_ADDR(TCCR1B), r16           ; timer 1 counts cpu cycles
+
+    ; 1: LDS miss, 3
+    start
+    lds r16, 0x0200                         ; set 0, miss
+    stop
+    movw r2, r26
+
+    ; 2: LD hit, ST miss, 3
+    ldi r26, 0x01
+    ldi r27, 0x02
+    ldi r28, 0x00
+    ldi r29, 0x03
+    start
+    ld r16, X                               ; set 0, hit
+    st Y, r16                               ; set 16, miss, line is dirty
+    stop
+    movw r4, r26
+
+    ; 3: eviction of a dirty line, 3 + 3 + 5
+    start
+    lds r16, 0x0500                         ; set 16, miss
+    lds r16, 0x0700                         ; set 16, miss, evicts dirty line 0x0300
+    stop
+    movw r6, r26
+
+    ; 4: PUSH miss, POP hit, 3
+    ldi r16, 0xff
+    out _SFR_IO_ADDR(SPL), r16
+    ldi r16, 0x08
+    out _SFR_IO_ADDR(SPH), r16
+    start
+    push r16                                ; 0x08ff, set 15, miss
+    pop r16                                 ; hit
+    stop
+    movw r8, r26
+
+    ; 5: RCALL crosses a line, RET hits, 3
+    ldi r16, 0x00
+    out _SFR_IO_ADDR(SPL), r16
+    ldi r16, 0x09
+    out _SFR_IO_ADDR(SPH), r16
+    start
+    rcall sub                               ; 0x08ff hit, 0x0900 set 16 miss, evicts clean line 0x0500
+    stop
+    movw r10, r26
+
+    ; 6: irq entry crosses a line with 2 misses, RETI hits, 3 + 3
+    ldi r16, 0x00
+    out _SFR_IO_ADDR(SPL), r16
+    ldi r16, 0x0a
+    out _SFR_IO_ADDR(SPH), r16
+    sbi _SFR_IO_ADDR(PORTD), 0
+    sbi _SFR_IO_ADDR(DDRD), 0
+    ldi r16, (1<<ISC01)
+    sts 0x6a, r16                           ; EICRA, irq on falling edge of INT0
+    ldi r16, (1<<INT0)
+    out _SFR_IO_ADDR(EIMSK), r16
+    cbi _SFR_IO_ADDR(PORTD), 0              ; INT0 irq is pending
+    nop
+    start
+    sei                                     ; 0x09ff set 31 miss, 0x0a00 set 0 miss
+    nop
+    stop
+    movw r12, r26
+    cli
+
+    ; 7: LDD behind data memory isn't cached, LD on last byte misses, 3
+    ldi r28, 0xf0
+    ldi r29, 0xff
+    ldi r30, 0xff
+    ldi r31, 0xff
+    start
+    ldd r16, Y+63                           ; 0x1002f, not cached
+    ld r16, Z                               ; 0xffff, set 31, miss
+    stop
+    movw r14, r26
+
+.global stopsim
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
+sub:
+    ret
+
+.global INT0_vect
+INT0_vect:
+    out _SFR_IO_ADDR(EIMSK), r1
+    reti
+
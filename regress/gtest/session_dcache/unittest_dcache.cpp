@@ -0,0 +1,51 @@
+#include <iostream>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128_c.h"
+#include "avrfactory.h"
+#include "systemclock.h"
+
+//! Runs dcache.s with the given data cache option, returns cycles of test 1 ... 7
+static void RunDcache(const char *dcacheOption, unsigned int *cycles) {
+    AvrFactory &factory = AvrFactory::instance();
+    factory.cacheOptions.clear();
+    factory.AddCacheOption("icache:off");
+    factory.AddCacheOption(dcacheOption);
+
+    SystemClock::Instance().ResetClock();   // don't run devices of other tests
+    AvrDevice *dev1 = new AvrDevice_atmega128_c;
+    factory.cacheOptions.clear();
+    dev1->Load("session_dcache/dcache.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    SystemClock::Instance().Add(dev1);
+    SystemClock::Instance().Endless(); // should break if stopsim is reached
+
+    for(unsigned int i = 0; i < 7; i++)
+        cycles[i] = dev1->GetCoreReg(2 + 2 * i) + 256 * dev1->GetCoreReg(3 + 2 * i);
+}
+
+TEST( SESSION_DCACHE, WAIT_STATES )
+{
+    unsigned int uncached[7], cached[7];
+    RunDcache("dcache:off", uncached);
+    RunDcache("dcache:trace=0", cached);
+
+    // see comments in dcache.s
+    const unsigned int waits[7] = {
+        3,          // LDS miss
+        3,          // LD hit, ST miss
+        3 + 3 + 5,  // 2 misses, dirty line written back
+        3,          // PUSH miss, POP hit
+        3,          // RCALL miss on second line, RET hit
+        3 + 3,      // irq entry misses 2 lines, RETI hit
+        3           // LDD behind data memory not cached, LD miss
+    };
+    for(unsigned int i = 0; i < 7; i++) {
+        EXPECT_LT(0u, uncached[i]) << "test " << i + 1 << " not run" << endl;
+        EXPECT_EQ(waits[i], cached[i] - uncached[i]) << "test " << i + 1 << endl;
+    }
+}
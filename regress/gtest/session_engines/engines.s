@@ -0,0 +1,114 @@
+#include <avr/io.h>
+
+; same program on all engines, see unittest_engines.cpp
+; r0 scratch, r1 zero, r2 count of timer irqs, r3 timer at end of phase 1,
+; r24:r25 loop counter, all other registers are changed by "body"
+
+; marker for a reset, ram is not cleared by a reset
+#define MARKER 0x0100
+
+.macro body
+    add r4, r5
+    adc r5, r6
+    eor r6, r4
+    sub r7, r4
+    sbc r8, r5
+    subi r16, 0x3b
+    sbci r17, 0x11
+    andi r18, 0xf7
+    ori r18, 0x21
+    com r9
+    neg r10
+    inc r11
+    asr r12
+    lsr r13
+    ror r14
+    swap r15
+    movw r20, r4
+    adiw r26, 7
+    sbiw r28, 3
+    mov r19, r7
+    and r19, r8
+    or r19, r9
+    ldi r22, 0x5a
+    ldi r23, 0xa5
+    cp r4, r16
+    cpc r5, r17
+    brcs 1f
+    add r30, r22
+1:
+    cpi r18, 0x40
+    brge 2f
+    sub r31, r23
+2:
+    in r0, _SFR_IO_ADDR(SREG)
+    add r15, r0
+    sts 0x0110, r19
+    lds r12, 0x0110
+.endm
+
+.global main
+main:
+    lds r16, MARKER
+    cpi r16, 0xa5
+    brne first_boot
+    rjmp stopsim                ; reset by watchdog
+
+first_boot:
+    ldi r16, 0xa5
+    sts MARKER, r16
+    ldi r16, 0x13
+    ldi r17, 0x57
+    ldi r18, 0x9b
+    mov r4, r16
+    mov r5, r17
+    mov r6, r18
+    clr r2
+    ldi r16, (1<<TOIE0)
+    out _SFR_IO_ADDR(TIMSK), r16
+    ldi r16, (1<<CS00)          ; timer 0 without prescaler, overflow every 256 cycles
+    out _SFR_IO_ADDR(TCCR0), r16
+
+    ; phase 1: irqs disabled, blocks are fused and compiled, overflows are pending
+    ldi r24, lo8(300)
+    ldi r25, hi8(300)
+loop1:
+    body
+    sbiw r24, 1
+    brne loop1
+    in r3, _SFR_IO_ADDR(TCNT0)
+    sei                         ; pending overflow is taken after the next instruction
+    nop
+
+    ; phase 2: irqs enabled, overflows interrupt the loop
+    ldi r24, lo8(300)
+    ldi r25, hi8(300)
+loop2:
+    body
+    sbiw r24, 1
+    brne loop2
+    cli
+
+    ; phase 3: watchdog resets the device while the loop runs
+    wdr
+    ldi r16, (1<<WDE)
+    out _SFR_IO_ADDR(WDTCR), r16
+loop3:
+    body
+    rjmp loop3
+
+.global stopsim
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
+.global TIMER0_OVF_vect
+TIMER0_OVF_vect:
+    push r0
+    in r0, _SFR_IO_ADDR(SREG)
+    inc r2
+    out _SFR_IO_ADDR(SREG), r0
+    pop r0
+    reti
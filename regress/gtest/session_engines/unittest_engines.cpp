@@ -0,0 +1,117 @@
+#include <iostream>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega16_32.h"
+#include "blockcache.h"
+#include "flash.h"
+#include "hwsreg.h"
+#include "hwstack.h"
+#include "jit.h"
+#include "systemclock.h"
+
+//! State of the device at stopsim
+struct EngineResult {
+    long cycles;
+    SystemClockOffset time;
+    unsigned int pc;
+    unsigned char sreg;
+    unsigned int sp;
+    unsigned char regs[32];
+    unsigned char marker;
+};
+
+static AvrDevice *RunEngine(AvrDevice::ExecutionEngine engine, EngineResult &r) {
+    SystemClock::Instance().ResetClock();   // don't run devices of other tests
+    AvrDevice *dev1 = new AvrDevice_atmega32;
+    dev1->SetExecutionEngine(engine);
+    dev1->Load("session_engines/engines.atmega32.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    SystemClock::Instance().Add(dev1);
+    r.cycles = SystemClock::Instance().Endless(); // should break if stopsim is reached
+
+    r.time = SystemClock::Instance().GetCurrentTime();
+    r.pc = dev1->PC;
+    r.sreg = (unsigned char)(int)*(dev1->status);
+    r.sp = dev1->stack->GetStackPointer();
+    for(unsigned int i = 0; i < 32; i++)
+        r.regs[i] = dev1->GetCoreReg(i);
+    r.marker = dev1->GetRWMem(0x100);
+    return dev1;
+}
+
+static void ExpectSameResult(const EngineResult &ref, const EngineResult &r, const char *engine) {
+    EXPECT_EQ(ref.cycles, r.cycles) << engine << endl;
+    EXPECT_EQ(ref.time, r.time) << engine << endl;
+    EXPECT_EQ(ref.pc, r.pc) << engine << endl;
+    EXPECT_EQ(ref.sreg, r.sreg) << engine << endl;
+    EXPECT_EQ(ref.sp, r.sp) << engine << endl;
+    for(unsigned int i = 0; i < 32; i++)
+        EXPECT_EQ(ref.regs[i], r.regs[i]) << engine << " r" << i << endl;
+    EXPECT_EQ(ref.marker, r.marker) << engine << endl;
+}
+
+TEST( SESSION_ENGINES, SAME_STATE )
+{
+    EngineResult classic, direct, block, jit;
+
+    AvrDevice *dev1 = RunEngine(AvrDevice::ENGINE_CLASSIC, classic);
+    EXPECT_EQ(dev1->Flash->GetAddressAtSymbol("stopsim"), classic.pc) << "program didn't stop at stopsim" << endl;
+    EXPECT_EQ(0xa5, classic.marker) << "program didn't run" << endl;
+    EXPECT_LT(0, classic.regs[2]) << "no timer irq" << endl;
+    // watchdog resets after 47ms
+    EXPECT_LT(47000000LL, classic.time) << "no watchdog reset" << endl;
+
+    RunEngine(AvrDevice::ENGINE_DIRECT, direct);
+    ExpectSameResult(classic, direct, "direct");
+
+    dev1 = RunEngine(AvrDevice::ENGINE_BLOCK, block);
+    ExpectSameResult(classic, block, "block");
+    // the loop has to be executed as superinstructions
+    TranslatedBlock *b = dev1->Flash->GetBlockCache()->Lookup(dev1->Flash->GetAddressAtSymbol("loop1"));
+    unsigned int fused = 0;
+    for(unsigned int i = 0; i < b->entries.size(); i++)
+        if(b->entries[i].fuse > 1)
+            fused++;
+    EXPECT_LT(0u, fused) << "no superinstruction in loop1" << endl;
+
+    dev1 = RunEngine(AvrDevice::ENGINE_JIT, jit);
+    ExpectSameResult(classic, jit, "jit");
+    if(JitCompiler::IsSupported())
+        EXPECT_LT(0u, dev1->jit->GetCompiledCount()) << "no native code" << endl;
+}
+
+// firmware, which rewrites flash, must not grow jit code memory
+TEST( SESSION_ENGINES, JIT_CODE_MEMORY )
+{
+    if(!JitCompiler::IsSupported())
+        return;
+    SystemClock::Instance().ResetClock();   // don't run devices of other tests
+    AvrDevice *dev1 = new AvrDevice_atmega32;
+    dev1->SetExecutionEngine(AvrDevice::ENGINE_JIT);
+    dev1->Load("session_engines/engines.atmega32.o");
+    const unsigned int loop1 = dev1->Flash->GetAddressAtSymbol("loop1");
+    BlockCache *cache = dev1->Flash->GetBlockCache();
+
+    // compile block, then invalidate it, like a rewrite of flash
+    for(unsigned int i = 0; i < 5000; i++) {
+        dev1->jit->Compile(cache->Lookup(loop1));
+        dev1->Flash->Decode(loop1 * 2);
+    }
+    EXPECT_LE(5000u, dev1->jit->GetCompiledCount()) << "block not compiled" << endl;
+    EXPECT_GE(2 * 64 * 1024ul, dev1->jit->GetCodeMemorySize()) << "code of invalidated blocks not reused" << endl;
+
+    // blocks with dropped native code are executed by the interpreter or compiled again
+    EngineResult classic, jit;
+    RunEngine(AvrDevice::ENGINE_CLASSIC, classic);
+    SystemClock::Instance().ResetClock();
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    SystemClock::Instance().Add(dev1);
+    jit.cycles = SystemClock::Instance().Endless();
+    EXPECT_EQ(classic.cycles, jit.cycles) << "jit after flush" << endl;
+    EXPECT_EQ(0xa5, dev1->GetRWMem(0x100)) << "jit after flush" << endl;
+}
@@ -42,6 +42,6 @@ TEST( SESSION_IO_PIN, OPEN_DRAIN1 )
 
     SystemClock::Instance().Endless(); 
 
-    EXPECT_EQ(0x08, (unsigned char)(*(dev1->rw[17]))) << "wrong value read back from PORTB R17" << endl;
-    EXPECT_EQ(0x04, (unsigned char)(*(dev1->rw[18]))) << "wrong value read back from PORTB R18" << endl;
+    EXPECT_EQ(0x08, (unsigned char)(dev1->GetCoreReg(17))) << "wrong value read back from PORTB R17" << endl;
+    EXPECT_EQ(0x04, (unsigned char)(dev1->GetCoreReg(18))) << "wrong value read back from PORTB R18" << endl;
 }
@@ -0,0 +1,47 @@
+#include <avr/io.h>
+
+; loops with known iteration counts, see unittest_loops.cpp
+.global main
+main:
+    ldi r20, 3
+outer:                  ; 1 entry, 2 back-edges
+    rcall inner
+    dec r20
+    brne outer
+    ldi r21, 4
+    rjmp wtest
+wbody:                  ; loop with test at the end, 1 entry, 3 back-edges
+    nop
+wtest:
+    dec r21
+    brne wbody
+    ldi r22, 3
+again:
+    rcall early
+    dec r22
+    brne again
+
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
+.global inner
+inner:
+    ldi r24, 5
+iloop:                  ; 3 entries, 4 back-edges each
+    dec r24
+    brne iloop
+    ret
+
+.global early
+early:
+    ldi r24, 10
+eloop:                  ; left by return, 3 entries, 3 back-edges each
+    cpi r24, 7
+    breq eret
+    dec r24
+    rjmp eloop
+eret:
+    ret
@@ -0,0 +1,47 @@
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "flash.h"
+#include "loopcounter.h"
+#include "systemclock.h"
+
+static void ExpectLoop(const map<unsigned int, LoopStats> &stats, AvrDevice *dev, const char *header,
+                       unsigned long long entries, unsigned long long count) {
+    unsigned int pc = dev->Flash->GetAddressAtSymbol(header);
+    map<unsigned int, LoopStats>::const_iterator i = stats.find(pc);
+    ASSERT_TRUE(i != stats.end()) << header << " not found as loop" << endl;
+    EXPECT_EQ(entries, i->second.entries) << header << endl;
+    EXPECT_EQ(count, i->second.min) << header << endl;
+    EXPECT_EQ(count, i->second.max) << header << endl;
+    EXPECT_EQ(entries * count, i->second.total) << header << endl;
+}
+
+TEST( SESSION_LOOPS, BACK_EDGES )
+{
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    dev1->Load("session_loops/loops.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    dev1->EnableLoopCounter("session_loops/loops.txt");
+    SystemClock::Instance().Add(dev1);
+    SystemClock::Instance().Endless(); // should break if stopsim is reached
+
+    const map<unsigned int, LoopStats> &stats = dev1->loops->GetStats();
+    EXPECT_EQ(5u, stats.size());
+    ExpectLoop(stats, dev1, "outer", 1, 2);
+    ExpectLoop(stats, dev1, "wbody", 1, 3);
+    ExpectLoop(stats, dev1, "again", 1, 2);
+    ExpectLoop(stats, dev1, "iloop", 3, 4);
+    ExpectLoop(stats, dev1, "eloop", 3, 3);
+
+    ostringstream os;
+    dev1->loops->Write(os);
+    EXPECT_NE(string::npos, os.str().find("\niloop 0x0 ")) << os.str();
+}
@@ -0,0 +1,27 @@
+#include <avr/io.h>
+
+; nested calls with known cycle counts, see unittest_profiler.cpp
+.global main
+main:
+    rcall func_a
+    rcall func_a
+    rcall .+0           ; not a call, pushs return address only
+    pop r0
+    pop r0
+
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
+.global func_b
+func_b:
+    nop                 ; 1 cycle
+    ret                 ; 4 cycles
+
+.global func_a
+func_a:
+    rcall func_b        ; 3 cycles
+    nop                 ; 1 cycle
+    ret                 ; 4 cycles
@@ -0,0 +1,34 @@
+#include <avr/io.h>
+
+#undef _SFR_IO8
+#define _SFR_IO8(x) (x)
+
+; timer 0 overflow every 256 cycles preempts busy, see unittest_profiler.cpp
+.global main
+main:
+    ldi r16, (1<<TOIE0)
+    out TIMSK, r16
+    ldi r16, (1<<CS00)      ; no prescaler
+    out TCCR0, r16
+    sei
+    rcall busy
+    cli
+
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
+.global busy
+busy:
+    ldi r24, 200            ; 1 cycle
+loop:
+    dec r24                 ; 200 * 1 cycle
+    brne loop               ; 199 * 2 + 1 cycle
+    ret                     ; 4 cycles
+
+.global TIMER0_OVF_vect
+TIMER0_OVF_vect:
+    nop
+    reti
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <map>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "flash.h"
+#include "profiler.h"
+#include "systemclock.h"
+
+TEST( SESSION_PROFILER, CALL_TIMES )
+{
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    dev1->Load("session_profiler/calls.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    dev1->EnableProfiler();
+    SystemClock::Instance().Add(dev1);
+    SystemClock::Instance().Endless(); // should break if stopsim is reached
+
+    const map<unsigned int, FunctionStats> &stats = dev1->profiler->GetStats();
+    unsigned int a = dev1->Flash->GetAddressAtSymbol("func_a");
+    unsigned int b = dev1->Flash->GetAddressAtSymbol("func_b");
+    ASSERT_TRUE(stats.find(a) != stats.end()) << "func_a not profiled" << endl;
+    ASSERT_TRUE(stats.find(b) != stats.end()) << "func_b not profiled" << endl;
+
+    // func_b: nop + ret
+    const FunctionStats &sb = stats.find(b)->second;
+    EXPECT_EQ(2u, sb.count);
+    EXPECT_EQ(5u, sb.inclMin);
+    EXPECT_EQ(5u, sb.inclMax);
+    EXPECT_EQ(10u, sb.inclSum);
+    EXPECT_EQ(5u, sb.exclMax);
+
+    // func_a: rcall + func_b + nop + ret
+    const FunctionStats &sa = stats.find(a)->second;
+    EXPECT_EQ(2u, sa.count);
+    EXPECT_EQ(13u, sa.inclMin);
+    EXPECT_EQ(13u, sa.inclMax);
+    EXPECT_EQ(8u, sa.exclMin);
+    EXPECT_EQ(16u, sa.exclSum);
+    EXPECT_TRUE(sa.valid);
+
+    // rcall .+0 isn't counted as call, main itself is still running
+    unsigned int n = 0;
+    for(map<unsigned int, FunctionStats>::const_iterator i = stats.begin(); i != stats.end(); i++)
+        n += i->second.count;
+    EXPECT_EQ(4u, n) << "unexpected calls" << endl;
+}
+
+TEST( SESSION_PROFILER, IRQ_PREEMPTION )
+{
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    dev1->Load("session_profiler/irq.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    dev1->EnableProfiler(true);
+    SystemClock::Instance().Add(dev1);
+    SystemClock::Instance().Endless(); // should break if stopsim is reached
+
+    const map<unsigned int, FunctionStats> &stats = dev1->profiler->GetStats();
+    unsigned int busy = dev1->Flash->GetAddressAtSymbol("busy");
+    ASSERT_TRUE(stats.find(busy) != stats.end()) << "busy not profiled" << endl;
+
+    // find handler of timer 0 overflow, vector 16 on atmega128
+    const FunctionStats *handler = NULL;
+    for(map<unsigned int, FunctionStats>::const_iterator i = stats.begin(); i != stats.end(); i++)
+        if(i->second.vector == 16)
+            handler = &i->second;
+    ASSERT_TRUE(handler != NULL) << "interrupt handler not profiled" << endl;
+    // push return address + jmp + nop + reti
+    EXPECT_EQ(12u, handler->inclMax);
+    EXPECT_TRUE(handler->valid);
+
+    // busy: ldi + 200 * (dec + brne) - 1 + ret, without interrupts
+    const FunctionStats &sb = stats.find(busy)->second;
+    EXPECT_EQ(1u, sb.count);
+    EXPECT_EQ(604u, sb.netMax);
+    EXPECT_EQ(604u, sb.exclMax);
+    EXPECT_EQ(1u, sb.preempted);
+    EXPECT_TRUE(sb.valid);
+
+    // each interrupt in busy adds the handler time
+    const map<unsigned int, map<unsigned int, unsigned long long> > &p = dev1->profiler->GetPreemptions();
+    ASSERT_TRUE(p.find(16) != p.end()) << "no preemption by timer 0" << endl;
+    const map<unsigned int, unsigned long long> &pv = p.find(16)->second;
+    ASSERT_TRUE(pv.find(busy) != pv.end()) << "busy wasn't preempted" << endl;
+    unsigned long long n = pv.find(busy)->second;
+    EXPECT_LE(2u, n);
+    EXPECT_EQ(604u + n * 12, sb.inclMax);
+}
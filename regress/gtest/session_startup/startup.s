@@ -0,0 +1,15 @@
+#include <avr/io.h>
+
+; small program, which uses only a few words of flash, the rest stays 0xffff
+.global main
+main:
+    ldi r16, 0x10
+loop:
+    dec r16
+    brne loop
+
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
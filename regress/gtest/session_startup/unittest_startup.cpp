@@ -0,0 +1,76 @@
+#include <iostream>
+#include <sys/time.h>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "flash.h"
+#include "systemclock.h"
+
+static const char *program = "session_startup/startup.atmega128.o";
+
+static double Now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static unsigned int CountDecoded(AvrFlash *f) {
+    unsigned int n = 0;
+    for(unsigned int i = 0; i < f->DecodedMem.size(); i++)
+        if(f->DecodedMem[i] != NULL)
+            n++;
+    return n;
+}
+
+TEST( SESSION_STARTUP, LAZY_DECODE )
+{
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    dev1->Load(program);
+    EXPECT_EQ(0u, CountDecoded(dev1->Flash)) << "flash decoded before first fetch" << endl;
+
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    SystemClock::Instance().Add(dev1);
+    SystemClock::Instance().Endless(); // should break if stopsim is reached
+
+    EXPECT_EQ(0, dev1->GetCoreReg(16)) << "program not executed" << endl;
+    unsigned int decoded = CountDecoded(dev1->Flash);
+    EXPECT_GT(decoded, 0u) << "no instruction decoded" << endl;
+    EXPECT_LT(decoded, 64u) << "too much instructions decoded" << endl;
+
+    // rewriting a word drops the instruction, next fetch decodes the new one
+    dev1->Flash->WriteMemByte(0x00, 0);
+    dev1->Flash->WriteMemByte(0x00, 1);
+    dev1->Flash->Decode(0);
+    EXPECT_TRUE(dev1->Flash->DecodedMem[0] == NULL) << "instruction not invalidated" << endl;
+    EXPECT_TRUE(dynamic_cast<avr_op_NOP *>(dev1->Flash->GetInstruction(0)) != NULL) << "new instruction not decoded" << endl;
+    EXPECT_TRUE(dev1->Flash->GetDispatchRecord(0).insn == dev1->Flash->DecodedMem[0]) << "dispatch table out of sync" << endl;
+}
+
+// Startup benchmark: device construction with Load() and, timed apart, the
+// decoding of the whole flash, which was done on Load() before lazy decoding.
+// Not part of the unit suite, run it with --gtest_also_run_disabled_tests
+TEST( SESSION_STARTUP, DISABLED_BENCHMARK )
+{
+    const int runs = 20;
+    double load = 0, decode = 0;
+
+    for(int i = 0; i < runs; i++) {
+        double t0 = Now();
+        AvrDevice *dev1 = new AvrDevice_atmega128;
+        dev1->Load(program);
+        double t1 = Now();
+        for(unsigned int pc = 0; pc < dev1->Flash->GetSize() / 2; pc++)
+            dev1->Flash->GetInstruction(pc);
+        double t2 = Now();
+        load += t1 - t0;
+        decode += t2 - t1;
+        delete dev1;
+    }
+
+    cout << "atmega128 construction + Load(): " << load * 1000 / runs << "ms, "
+         << "decoding whole flash: " << decode * 1000 / runs << "ms" << endl;
+}
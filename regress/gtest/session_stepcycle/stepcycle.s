@@ -0,0 +1,54 @@
+#include <avr/io.h>
+
+; same program with and without switching trace, dumpers and cache, see unittest_stepcycle.cpp
+; r2 count of timer irqs, r20 count of calls, r24:r25 loop counter
+
+.global main
+main:
+    clr r2
+    clr r20
+    ldi r16, (1<<TOIE0)
+    out _SFR_IO_ADDR(TIMSK), r16
+    ldi r16, (1<<CS00)          ; timer 0 without prescaler, overflow every 256 cycles
+    out _SFR_IO_ADDR(TCCR0), r16
+    sei
+    ldi r16, 0x13
+    ldi r17, 0x57
+    ldi r26, lo8(0x0100)
+    ldi r27, hi8(0x0100)
+    ldi r24, lo8(500)
+    ldi r25, hi8(500)
+loop:
+    add r16, r17
+    eor r17, r16
+    st X+, r16
+    andi r26, 0x3f              ; X stays in 0x0100..0x013f
+    ld r18, X
+    add r19, r18
+    sts 0x0140, r16
+    sts 0x0140, r17
+    rcall count
+    sbiw r24, 1
+    brne loop
+    cli
+
+.global stopsim
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
+.global count
+count:
+    inc r20
+    ret
+
+.global TIMER0_OVF_vect
+TIMER0_OVF_vect:
+    push r16
+    in r16, _SFR_IO_ADDR(SREG)
+    inc r2
+    out _SFR_IO_ADDR(SREG), r16
+    pop r16
+    reti
@@ -0,0 +1,156 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "atmega128_c.h"
+#include "avrerror.h"
+#include "avrfactory.h"
+#include "flash.h"
+#include "hwsreg.h"
+#include "systemclock.h"
+#include "traceval.h"
+
+//! State of the device at stopsim
+struct StepResult {
+    long cycles;
+    SystemClockOffset time;
+    unsigned char sreg;
+    unsigned char regs[32];
+    unsigned char ram[0x41];
+};
+
+static AvrDevice *NewDevice(bool icache) {
+    SystemClock::Instance().ResetClock();   // don't run devices of other tests
+    AvrDevice *dev1;
+    if(icache) {
+        AvrFactory &factory = AvrFactory::instance();
+        factory.cacheOptions.clear();
+        factory.AddCacheOption("icache:trace=0");
+        factory.AddCacheOption("dcache:off");
+        dev1 = new AvrDevice_atmega128_c;
+        factory.cacheOptions.clear();
+    } else
+        dev1 = new AvrDevice_atmega128;
+    dev1->Load("session_stepcycle/stepcycle.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    SystemClock::Instance().Add(dev1);
+    return dev1;
+}
+
+static void GetResult(AvrDevice *dev1, StepResult &r) {
+    r.time = SystemClock::Instance().GetCurrentTime();
+    r.sreg = (unsigned char)(int)*(dev1->status);
+    for(unsigned int i = 0; i < 32; i++)
+        r.regs[i] = dev1->GetCoreReg(i);
+    for(unsigned int i = 0; i < sizeof(r.ram); i++)
+        r.ram[i] = dev1->GetRWMem(0x100 + i);
+}
+
+//! Runs without switching a StepCycle variant
+static void RunPlain(bool icache, StepResult &r) {
+    AvrDevice *dev1 = NewDevice(icache);
+    long cycles = SystemClock::Instance().Endless(); // should break if stopsim is reached
+    EXPECT_EQ(dev1->Flash->GetAddressAtSymbol("stopsim"), dev1->PC) << "program didn't stop at stopsim" << endl;
+    GetResult(dev1, r);
+    r.cycles = cycles;
+}
+
+//! Runs in slices, which end inside instructions, and switches trace and a dumper on and off between them
+static void RunToggled(bool icache, StepResult &r, string &trace, string &vcd) {
+    AvrDevice *dev1 = NewDevice(icache);
+    const unsigned int stopsim = dev1->Flash->GetAddressAtSymbol("stopsim");
+    ostringstream traceStream;
+    sysConHandler.SetTraceStream(&traceStream);
+    DumpManager *dm = DumpManager::Instance();
+    const long start = SystemClock::Instance().GetClockCycles(); // RunTimeRange doesn't reset the count
+
+    for(unsigned int slice = 0; dev1->PC != stopsim; slice++) {
+        ASSERT_GT(1000u, slice) << "program didn't reach stopsim" << endl;
+        switch(slice % 4) {
+            case 0:
+                dev1->SetTraceOn(1);
+                break;
+            case 2:
+                dev1->SetTraceOn(0);
+                break;
+        }
+        if(slice == 3) {
+            // dumper added mid-run
+            TraceSet vals;
+            vals.push_back(dev1->FindTraceValueByName("CORE.PC"));
+            vals.push_back(dev1->FindTraceValueByName("CORE.r16"));
+            vals.push_back(dev1->FindTraceValueByName("CORE.IRAM64"));
+            Dumper *d = new DumpVCD("session_stepcycle/toggle.vcd");
+            dm->addDumper(d, vals);
+            d->start();
+        }
+        // 37 cycles and a half, trace and dumper change inside an instruction
+        SystemClock::Instance().RunTimeRange(37 * 136 + 68);
+    }
+    GetResult(dev1, r);
+    r.cycles = SystemClock::Instance().GetClockCycles() - start;
+    dev1->SetTraceOn(0);
+    trace = traceStream.str();
+    dm->stopApplication(); // writes and deletes dumper
+    sysConHandler.StopTrace();
+    ifstream is("session_stepcycle/toggle.vcd");
+    vcd.assign(istreambuf_iterator<char>(is), istreambuf_iterator<char>());
+    remove("session_stepcycle/toggle.vcd");
+}
+
+static void ExpectSameResult(const StepResult &ref, const StepResult &r) {
+    EXPECT_EQ(ref.cycles, r.cycles);
+    EXPECT_EQ(ref.time, r.time);
+    EXPECT_EQ(ref.sreg, r.sreg);
+    for(unsigned int i = 0; i < 32; i++)
+        EXPECT_EQ(ref.regs[i], r.regs[i]) << "r" << i << endl;
+    for(unsigned int i = 0; i < sizeof(ref.ram); i++)
+        EXPECT_EQ(ref.ram[i], r.ram[i]) << "ram 0x" << hex << 0x100 + i << endl;
+}
+
+static void ExpectSameRun(bool icache) {
+    StepResult plain, toggled;
+    string trace, vcd;
+    RunPlain(icache, plain);
+    EXPECT_LT(0, plain.regs[2]) << "no timer irq" << endl;
+    EXPECT_EQ(500 & 0xff, plain.regs[20]) << "loop not completed" << endl;
+
+    RunToggled(icache, toggled, trace, vcd);
+    ExpectSameResult(plain, toggled);
+
+    // trace was switched on and off
+    unsigned int lines = 0;
+    for(size_t p = trace.find('\n'); p != string::npos; p = trace.find('\n', p + 1))
+        lines++;
+    EXPECT_LT(100u, lines) << "trace not switched on" << endl;
+    EXPECT_GT((unsigned long)plain.cycles, lines) << "trace not switched off" << endl;
+
+    // dumper added mid-run gets the writes of the traced RAM byte, 2 per loop
+    unsigned int writes = 0;
+    istringstream is(vcd);
+    string line;
+    while(getline(is, line))
+        if((line[0] == 'b') && (line.find('x') == string::npos) && (line.substr(line.size() - 2) == " #"))
+            writes++;
+    EXPECT_LT(900u, writes) << "traced RAM byte not dumped" << endl;
+    EXPECT_GE(1000u, writes) << "traced RAM byte not dumped" << endl;
+}
+
+TEST( SESSION_STEPCYCLE, TOGGLE )
+{
+    ExpectSameRun(false);
+}
+
+TEST( SESSION_STEPCYCLE, TOGGLE_ICACHE )
+{
+    ExpectSameRun(true);
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <string>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "flash.h"
+
+//! Compares symbol index lookup with the multimap lookup of Memory for all words in [first, last]
+static void ExpectSameSymbols(AvrFlash *flash, unsigned int first, unsigned int last) {
+    for(unsigned int a = first; a <= last; a++)
+        EXPECT_EQ(flash->Memory::GetSymbolAtAddress(a), flash->GetSymbolAtAddress(a)) << "address 0x" << hex << a << endl;
+}
+
+TEST( SESSION_SYMBOLS, LOADED_PROGRAM )
+{
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    dev1->Load("session_profiler/calls.atmega128.o");
+    AvrFlash *flash = dev1->Flash;
+    const unsigned int end = flash->GetAddressAtSymbol("func_a") + 16;
+    ExpectSameSymbols(flash, 0, end);
+    // behind flash, symbol index isn't used
+    ExpectSameSymbols(flash, flash->GetSize() / 2 - 2, flash->GetSize() / 2 + 2);
+    EXPECT_EQ("func_a+0x2", flash->GetSymbolAtAddress(flash->GetAddressAtSymbol("func_a") + 2));
+}
+
+TEST( SESSION_SYMBOLS, ADD_SYMBOL )
+{
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    AvrFlash *flash = dev1->Flash;
+    EXPECT_EQ("", flash->GetSymbolAtAddress(0x10)) << "no symbols" << endl;
+
+    flash->AddSymbol(make_pair(0x10u, string("first")));
+    flash->AddSymbol(make_pair(0x10u, string("alias")));
+    flash->AddSymbol(make_pair(0x40u, string("second")));
+    // addresses below the first symbol, offsets and both names
+    ExpectSameSymbols(flash, 0, 0x50);
+    EXPECT_EQ("first,alias+0x3", flash->GetSymbolAtAddress(0x13));
+
+    // index is built, AddSymbol has to invalidate it
+    flash->AddSymbol(make_pair(0x20u, string("third")));
+    EXPECT_EQ("third+0x1", flash->GetSymbolAtAddress(0x21));
+    EXPECT_EQ(flash->GetSymbolId(0x20), flash->GetSymbolId(0x3f));
+    ExpectSameSymbols(flash, 0, 0x50);
+
+    // through the base class, like the scripting bindings
+    Memory *m = flash;
+    m->AddSymbol(make_pair(0x30u, string("fourth")));
+    EXPECT_EQ("fourth", flash->GetSymbolAtAddress(0x30));
+    ExpectSameSymbols(flash, 0, 0x50);
+}
@@ -0,0 +1,44 @@
+#include <avr/io.h>
+
+; program for the binary trace, see unittest_tracebin.cpp
+; reads the running timer 0 by IN, LD, LDD and LDS, so values of a replay
+; would differ from the simulation
+
+.global main
+main:
+    ldi r16, (1<<CS00)          ; timer 0 without prescaler, no irqs
+    out _SFR_IO_ADDR(TCCR0), r16
+    ldi r26, lo8(_SFR_MEM_ADDR(TCNT0))
+    ldi r27, hi8(_SFR_MEM_ADDR(TCNT0))
+    ldi r28, lo8(_SFR_MEM_ADDR(TCNT0) - 1)
+    ldi r29, hi8(_SFR_MEM_ADDR(TCNT0) - 1)
+    ldi r18, 100
+loop:
+    in r16, _SFR_IO_ADDR(TCNT0)
+    ld r17, X
+    ldd r19, Y+1
+    lds r20, _SFR_MEM_ADDR(TCNT0)
+    cpi r17, 0x80               ; SREG depends on read value
+    sts 0x140, r20
+    ldi r30, lo8(func)          ; instructions, which show Z
+    ldi r31, hi8(func)
+    out _SFR_IO_ADDR(RAMPZ), r1
+    elpm r21, Z+
+    lpm r21, Z
+    call func
+    dec r18
+    brne loop
+
+.global stopsim
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
+func:
+    push r16
+    in r16, _SFR_IO_ADDR(SPL)   ; stack pointer changed by OUT
+    out _SFR_IO_ADDR(SPL), r16
+    pop r16
+    ret
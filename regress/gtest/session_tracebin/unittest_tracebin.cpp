@@ -0,0 +1,83 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "avrerror.h"
+#include "flash.h"
+#include "systemclock.h"
+#include "tracebin.h"
+
+static AvrDevice *NewDevice(void) {
+    SystemClock::Instance().ResetClock();   // don't run devices of other tests
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    dev1->Load("session_tracebin/tracebin.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    return dev1;
+}
+
+//! Runs the program to stopsim with binary trace into file name or, if empty, with trace into os
+static void RunTrace(const string &name, ostream &os) {
+    AvrDevice *dev1 = NewDevice();
+    if(name.empty()) {
+        sysConHandler.SetTraceStream(&os);
+        dev1->SetTraceOn(1);
+    } else
+        dev1->StartBinaryTrace(name);
+    SystemClock::Instance().Add(dev1);
+    SystemClock::Instance().Endless(); // should break if stopsim is reached
+    EXPECT_EQ(dev1->Flash->GetAddressAtSymbol("stopsim"), dev1->PC) << "program didn't stop at stopsim" << endl;
+    EXPECT_EQ(0, dev1->GetCoreReg(18)) << "loop didn't finish" << endl;
+    if(name.empty()) {
+        dev1->SetTraceOn(0);
+        sysConHandler.StopTrace();
+    } else
+        dev1->StopBinaryTrace();
+    SystemClock::Instance().ResetClock();
+    delete dev1;
+}
+
+// values read from IO are taken from the binary trace, not from a replay
+TEST( SESSION_TRACEBIN, CONVERT )
+{
+    ostringstream text;
+    RunTrace("", text);
+    ostringstream dummy;
+    RunTrace("session_tracebin/trace.bin", dummy);
+
+    BinaryTraceReader reader("session_tracebin/trace.bin");
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    ostringstream converted;
+    ConvertBinaryTrace(reader, dev1, converted);
+    delete dev1;
+    remove("session_tracebin/trace.bin");
+
+    // the line of stopsim is begun, when the simulation breaks
+    string expected = text.str();
+    expected.erase(expected.rfind('\n') + 1);
+    EXPECT_NE(string::npos, expected.find("ELPM R21, Z+")) << "no instruction with Z in trace" << endl;
+    EXPECT_NE(string::npos, expected.find("SP=0x10fe 0x")) << "no stack access in trace" << endl;
+    istringstream es(expected), cs(converted.str());
+    string el, cl;
+    unsigned int line = 0;
+    for(;;) {
+        bool eok = (bool)getline(es, el);
+        bool cok = (bool)getline(cs, cl);
+        line++;
+        if(!eok || !cok) {
+            EXPECT_EQ(eok, cok) << "line " << line << ": different count of lines" << endl;
+            break;
+        }
+        if(el != cl) {
+            EXPECT_EQ(el, cl) << "line " << line << endl;
+            break;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#include <avr/io.h>
+
+; program for the trace filters, see unittest_tracefilter.cpp
+; r18 count of timer irqs, r20 depth of recursion of func
+
+.global main
+main:
+    clr r18
+    ldi r16, (1<<TOIE0)
+    out _SFR_IO_ADDR(TIMSK), r16
+    ldi r16, (1<<CS01)          ; timer 0 with prescaler 8, overflow every 2048 cycles
+    out _SFR_IO_ADDR(TCCR0), r16
+    ldi r20, 2
+    rcall func                  ; calls itself once
+    ldi r20, 1
+    rcall func                  ; returns at once
+
+.global range_start
+range_start:
+    ldi r17, 3
+range_loop:
+    dec r17
+    brne range_loop
+
+.global range_end
+range_end:
+    sei
+wait:
+    cpi r18, 2
+    brlo wait
+    cli
+
+.global stopsim
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
+.global func
+func:
+    nop
+    dec r20
+    breq func_ret
+    rcall func                  ; entry at func again, while filter is on
+func_ret:
+    ret
+
+.global TIMER0_OVF_vect
+TIMER0_OVF_vect:
+    push r16
+    in r16, _SFR_IO_ADDR(SREG)
+    inc r18
+    out _SFR_IO_ADDR(SREG), r16
+    pop r16
+    reti
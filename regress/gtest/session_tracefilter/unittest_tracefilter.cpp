@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "avrerror.h"
+#include "flash.h"
+#include "systemclock.h"
+
+//! Lines of a trace, instructions and waitstates
+struct Trace {
+    set<unsigned int> pcs;      //!< word addresses of all lines
+    set<long> starts;           //!< clock cycles of the lines, which start a instruction
+};
+
+static AvrDevice *NewDevice(AvrDevice::ExecutionEngine engine) {
+    SystemClock::Instance().ResetClock();   // don't run devices of other tests
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    dev1->SetExecutionEngine(engine);
+    dev1->Load("session_tracefilter/tracefilter.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    SystemClock::Instance().Add(dev1);
+    return dev1;
+}
+
+//! Runs the program to stopsim with trace on, restricted by filter, if given
+static Trace RunTrace(AvrDevice::ExecutionEngine engine, const char *filter) {
+    AvrDevice *dev1 = NewDevice(engine);
+    ostringstream traceStream;
+    sysConHandler.SetTraceStream(&traceStream);
+    if(filter != NULL)
+        dev1->AddTraceFilter(filter);
+    dev1->SetTraceOn(1);
+    SystemClock::Instance().Endless(); // should break if stopsim is reached, resets clock cycles
+    EXPECT_EQ(dev1->Flash->GetAddressAtSymbol("stopsim"), dev1->PC) << "program didn't stop at stopsim" << endl;
+    EXPECT_EQ(2, dev1->GetCoreReg(18)) << "no timer irqs" << endl;
+    dev1->SetTraceOn(0);
+    sysConHandler.StopTrace();
+
+    // <file> 0x<byte address>: <cycles>: <symbol> <instruction>
+    Trace t;
+    istringstream is(traceStream.str());
+    string line;
+    while(getline(is, line)) {
+        size_t p = line.find(" 0x");
+        unsigned int pc;
+        long cycles;
+        if((p == string::npos) || (sscanf(line.c_str() + p, " 0x%x: %ld:", &pc, &cycles) != 2))
+            continue;
+        t.pcs.insert(pc / 2);
+        if(line.find("CPU-waitstate") == string::npos)
+            t.starts.insert(cycles);
+    }
+    return t;
+}
+
+//! Word addresses from from to to (inclusive)
+static set<unsigned int> Range(unsigned int from, unsigned int to) {
+    set<unsigned int> s;
+    for(unsigned int pc = from; pc <= to; pc++)
+        s.insert(pc);
+    return s;
+}
+
+//! Instructions of the full trace, which start in the window of clock cycles
+static set<long> Window(const Trace &full, long start, long end) {
+    set<long> s;
+    long first = *full.starts.begin();
+    for(set<long>::const_iterator i = full.starts.begin(); i != full.starts.end(); i++)
+        if((*i - first >= start) && (*i - first < end))
+            s.insert(*i);
+    return s;
+}
+
+static void ExpectFilters(AvrDevice::ExecutionEngine engine) {
+    AvrDevice *dev1 = NewDevice(engine);
+    AvrFlash *flash = dev1->Flash;
+    const unsigned int func = flash->GetAddressAtSymbol("func");
+    const unsigned int isr = flash->GetAddressAtSymbol("TIMER0_OVF_vect");
+    const unsigned int rangeStart = flash->GetAddressAtSymbol("range_start");
+    const unsigned int rangeEnd = flash->GetAddressAtSymbol("range_end");
+    SystemClock::Instance().ResetClock();
+    delete dev1;
+
+    Trace full = RunTrace(engine, NULL);
+    ASSERT_LT(2000u, full.starts.size()) << "program too short for the windows" << endl;
+
+    // trace off, if SP is above SP at entry, the nested entry doesn't restart
+    // the filter and the instruction after the call isn't traced
+    EXPECT_EQ(Range(func, isr - 1), RunTrace(engine, "sym:func").pcs);
+
+    // irq filter with count 3 traces the jmp in the vector table and 2
+    // instructions of the handler, left is decremented before the instruction
+    set<unsigned int> irq;
+    irq.insert(16 * 2);
+    irq.insert(isr);
+    irq.insert(isr + 1);
+    EXPECT_EQ(irq, RunTrace(engine, "irq:16:3").pcs);
+
+    EXPECT_EQ(Range(rangeStart, rangeEnd - 1), RunTrace(engine, "pc:range_start-range_end").pcs);
+
+    // windows switch on the boundary of the first instruction in the window,
+    // so the edges are the cycle before
+    EXPECT_EQ(Window(full, 1000, 1100), RunTrace(engine, "cycles:1000-1100").starts);
+    EXPECT_EQ(Window(full, 1000, 1100), RunTrace(engine, "time:136000-149600").starts);
+    EXPECT_EQ(Window(full, 1001, 1101), RunTrace(engine, "time:136001-149601").starts);
+    EXPECT_EQ(Window(full, 1900, 1000000), RunTrace(engine, "cycles:1900").starts);
+}
+
+TEST( SESSION_TRACEFILTER, CLASSIC )
+{
+    ExpectFilters(AvrDevice::ENGINE_CLASSIC);
+}
+
+TEST( SESSION_TRACEFILTER, BLOCK )
+{
+    ExpectFilters(AvrDevice::ENGINE_BLOCK);
+}
+
+TEST( SESSION_TRACEFILTER, CYCLES_OVERFLOW )
+{
+    AvrDevice *dev1 = NewDevice(AvrDevice::ENGINE_CLASSIC);
+    bool failed = false;
+    sysConHandler.SetUseExit(false);
+    try {
+        dev1->AddTraceFilter("cycles:0x1000000000000000"); // * 136 doesn't fit
+    } catch(char const *) {
+        failed = true;
+    }
+    sysConHandler.SetUseExit(true);
+    EXPECT_TRUE(failed) << "start of window not rejected" << endl;
+    SystemClock::Instance().ResetClock();
+}
@@ -0,0 +1,49 @@
+#include <avr/io.h>
+
+; program for the asynchronous trace writer, see unittest_tracewriter.cpp
+; r18 count of timer irqs
+
+.global main
+main:
+    clr r18
+    ldi r16, (1<<TOIE0)
+    out _SFR_IO_ADDR(TIMSK), r16
+    ldi r16, (1<<CS00)          ; timer 0 without prescaler, overflow every 256 cycles
+    out _SFR_IO_ADDR(TCCR0), r16
+    ldi r16, 0x11               ; EEPROM registers write trace text
+    out _SFR_IO_ADDR(EEARL), r16
+    out _SFR_IO_ADDR(EEDR), r16
+    sei
+loop:
+    ldi r30, lo8(func)          ; instructions, which show Z
+    ldi r31, hi8(func)
+    lpm r16, Z+
+    out _SFR_IO_ADDR(RAMPZ), r1
+    elpm r17, Z
+    sts 0x140, r16              ; 2 word instructions
+    lds r17, 0x140
+    call func
+    cpi r18, 40
+    brlo loop
+    cli
+
+.global stopsim
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
+func:
+    push r16
+    pop r16
+    ret
+
+.global TIMER0_OVF_vect
+TIMER0_OVF_vect:
+    push r16
+    in r16, _SFR_IO_ADDR(SREG)
+    inc r18
+    out _SFR_IO_ADDR(SREG), r16
+    pop r16
+    reti
@@ -0,0 +1,252 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <vector>
+using namespace std;
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "avrerror.h"
+#include "flash.h"
+#include "systemclock.h"
+#include "tracewriter.h"
+
+static AvrDevice *NewDevice(void) {
+    SystemClock::Instance().ResetClock();   // don't run devices of other tests
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    dev1->Load("session_tracewriter/tracewriter.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    return dev1;
+}
+
+//! Reads file and removes it, returns false, if file doesn't exist
+static bool ReadFile(const string &name, string &text) {
+    ifstream is(name.c_str(), ios::in | ios::binary);
+    if(!is.good())
+        return false;
+    ostringstream os;
+    os << is.rdbuf();
+    is.close();
+    remove(name.c_str());
+    text = os.str();
+    return true;
+}
+
+//! Name of trace file number n, like SystemConsoleHandler::TraceNextLine
+static string TraceFileName(const string &name, int n) {
+    if(n == 1)
+        return name;
+    ostringstream os;
+    os << name.substr(0, name.rfind('.')) << "_" << n << name.substr(name.rfind('.'));
+    return os.str();
+}
+
+//! Compares text line by line, reports first different line
+static void ExpectSameLines(const string &expected, const string &text, const string &name) {
+    istringstream es(expected), ts(text);
+    string el, tl;
+    unsigned int line = 0;
+    for(;;) {
+        bool eok = (bool)getline(es, el);
+        bool tok = (bool)getline(ts, tl);
+        line++;
+        if(!eok || !tok) {
+            EXPECT_EQ(eok, tok) << name << ":" << line << ": different count of lines" << endl;
+            return;
+        }
+        if(el != tl) {
+            EXPECT_EQ(el, tl) << name << ":" << line << endl;
+            return;
+        }
+    }
+}
+
+//! Runs the program to stopsim with trace into file name, returns count of records, if async
+static size_t RunTrace(const string &name, bool async, unsigned long long maxlines) {
+    AvrDevice *dev1 = NewDevice();
+    sysConHandler.SetTraceAsync(async, false, 65536);
+    sysConHandler.SetTraceFile(name.c_str(), maxlines);
+    dev1->SetTraceOn(1);
+    SystemClock::Instance().Add(dev1);
+    SystemClock::Instance().Endless(); // should break if stopsim is reached
+    EXPECT_EQ(dev1->Flash->GetAddressAtSymbol("stopsim"), dev1->PC) << "program didn't stop at stopsim" << endl;
+    EXPECT_EQ(40, dev1->GetCoreReg(18)) << "no timer irqs" << endl;
+    dev1->SetTraceOn(0);
+    size_t records = 0;
+    if(async)
+        records = sysConHandler.GetTraceWriter()->produced;
+    // records refer to the device, they are written before it's deleted
+    SystemClock::Instance().ResetClock();
+    delete dev1;
+    sysConHandler.StopTrace();
+    sysConHandler.SetTraceAsync(false);
+    return records;
+}
+
+// the writer thread formats the records like the simulation does without it
+TEST( SESSION_TRACEWRITER, WRAP_AROUND )
+{
+    RunTrace("session_tracewriter/sync.trc", false, 0);
+    size_t records = RunTrace("session_tracewriter/async.trc", true, 0);
+    EXPECT_LT(65536 / sizeof(AsyncTraceRecord) * 8, records) << "ring didn't wrap around several times" << endl;
+
+    string sync, async;
+    ASSERT_TRUE(ReadFile("session_tracewriter/sync.trc", sync));
+    ASSERT_TRUE(ReadFile("session_tracewriter/async.trc", async));
+    EXPECT_NE(string::npos, sync.find("EEAR=0x11")) << "no trace text of IO hardware" << endl;
+    EXPECT_NE(string::npos, sync.find("IRQ DETECTED")) << "no irq in trace" << endl;
+    ExpectSameLines(sync, async, "session_tracewriter/async.trc");
+}
+
+//! Reads and removes all files of a trace with rotation
+static vector<string> ReadFiles(const string &name) {
+    vector<string> files;
+    string text;
+    while(ReadFile(TraceFileName(name, files.size() + 1), text))
+        files.push_back(text);
+    return files;
+}
+
+//! Count of trace lines, irq messages add line breaks within a trace line
+static size_t CountLines(const string &text) {
+    istringstream is(text);
+    string line;
+    size_t count = 0;
+    while(getline(is, line))
+        count += (line.compare(0, 46, "session_tracewriter/tracewriter.atmega128.o 0x") == 0);
+    return count;
+}
+
+TEST( SESSION_TRACEWRITER, ROTATION )
+{
+    RunTrace("session_tracewriter/rot_sync.trc", false, 1000);
+    RunTrace("session_tracewriter/rot_async.trc", true, 1000);
+    vector<string> sync = ReadFiles("session_tracewriter/rot_sync.trc");
+    vector<string> async = ReadFiles("session_tracewriter/rot_async.trc");
+    EXPECT_LT(10u, sync.size()) << "too less files" << endl;
+    ASSERT_EQ(sync.size(), async.size());
+    for(size_t i = 0; i < async.size(); i++) {
+        string name = TraceFileName("session_tracewriter/rot_async.trc", i + 1);
+        ExpectSameLines(sync[i], async[i], name);
+        if(i + 1 < async.size())
+            EXPECT_EQ(1000u, CountLines(async[i])) << name << endl;
+    }
+}
+
+// text longer than a record is split, all records but the last are marked as continued
+TEST( SESSION_TRACEWRITER, CONTINUED )
+{
+    AsyncTraceWriter *w = new AsyncTraceWriter("session_tracewriter/text.trc", 0, 0, false);
+    ostream os(w);
+    string text;
+    for(unsigned int i = 0; i < 1000; i++)
+        text += (char)('a' + i % 26);
+    os << text;
+    w->Finish();
+
+    size_t records = (text.size() + sizeof(AsyncTraceRecord().text) - 1) / sizeof(AsyncTraceRecord().text);
+    ASSERT_EQ(records, w->produced);
+    string joined;
+    for(size_t i = 0; i < records; i++) {
+        const AsyncTraceRecord &r = w->ring[i];
+        EXPECT_EQ(ATREC_TEXT, r.type);
+        EXPECT_EQ((i + 1 < records) ? ATREC_CONTINUED : 0, r.flags) << "record " << i << endl;
+        joined.append(r.text, r.len);
+    }
+    EXPECT_EQ(text, joined);
+    delete w;
+
+    string written;
+    ASSERT_TRUE(ReadFile("session_tracewriter/text.trc", written));
+    EXPECT_EQ(text, written);
+}
+
+//! Reads the FIFO after delay ms until writer closes it
+static void DrainFifo(int fd, int delay, string *data) {
+    this_thread::sleep_for(chrono::milliseconds(delay));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    char buf[4096];
+    ssize_t n;
+    while((n = read(fd, buf, sizeof(buf))) > 0)
+        data->append(buf, n);
+    close(fd);
+}
+
+//! Puts lines into a writer, which writes to a FIFO, lines have the cycles 0 to lines - 1
+/*! The FIFO isn't read, until all lines are put (dropOnFull set) or for 200ms.
+  Returns count of dropped lines. */
+static unsigned long long PutLines(bool dropOnFull, unsigned long long lines, string &data) {
+    const char *fifo = "session_tracewriter/trace.fifo";
+    remove(fifo);
+    EXPECT_EQ(0, mkfifo(fifo, 0600));
+    int fd = open(fifo, O_RDONLY | O_NONBLOCK); // writer can open FIFO
+    EXPECT_LE(0, fd);
+    AvrDevice *dev1 = NewDevice();
+    AsyncTraceWriter *w = new AsyncTraceWriter(fifo, 0, 0, dropOnFull);
+    thread reader;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if(!dropOnFull)
+        reader = thread(DrainFifo, fd, 200, &data);
+    for(unsigned long long i = 0; i < lines; i++) {
+        w->BeginLine(dev1, 0, i);
+        w->Event(ATREC_WAIT);
+        w->EndLine(0);
+    }
+    if(dropOnFull)
+        reader = thread(DrainFifo, fd, 0, &data);
+    else {
+        // lines don't fit into ring and FIFO, simulation had to wait for the reader
+        EXPECT_LE(200, chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count());
+    }
+    w->Finish();
+    reader.join();
+    unsigned long long dropped = w->GetDropped();
+    delete w;
+    delete dev1;
+    remove(fifo);
+    return dropped;
+}
+
+//! Checks, that lines are complete with increasing cycles, returns count of lines
+static unsigned long long CheckLines(const string &data) {
+    istringstream is(data);
+    string line;
+    unsigned long long count = 0;
+    long long last = -1;
+    while(getline(is, line)) {
+        size_t p = line.find(" 0x0000: ");
+        long long cycle;
+        EXPECT_TRUE((p != string::npos) && (sscanf(line.c_str() + p, " 0x0000: %lld:", &cycle) == 1)) << line << endl;
+        EXPECT_LT(last, cycle);
+        EXPECT_EQ("CPU-waitstate", line.substr(line.length() - 13)) << line << endl;
+        last = cycle;
+        count++;
+    }
+    return count;
+}
+
+TEST( SESSION_TRACEWRITER, DROP )
+{
+    string data;
+    unsigned long long dropped = PutLines(true, 20000, data);
+    EXPECT_LT(10000u, dropped) << "FIFO doesn't stall writer thread" << endl;
+    EXPECT_EQ(20000u, CheckLines(data) + dropped);
+}
+
+TEST( SESSION_TRACEWRITER, BLOCK )
+{
+    string data;
+    EXPECT_EQ(0u, PutLines(false, 20000, data));
+    EXPECT_EQ(20000u, CheckLines(data));
+}
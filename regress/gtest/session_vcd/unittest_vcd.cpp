@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "systemclock.h"
+#include "traceval.h"
+
+//! Creates the device like simulavr does, as single device application
+static AvrDevice *NewDevice(void) {
+    DumpManager::Reset();
+    DumpManager::Instance()->SetSingleDeviceApp();
+    SystemClock::Instance().ResetClock();   // don't run devices of other tests
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    dev1->Load("session_vcd/vcd.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+    return dev1;
+}
+
+//! Compares text line by line with golden file
+static void ExpectGolden(const string &text, const char *golden) {
+    ifstream gs(golden);
+    ASSERT_TRUE(gs.good()) << "can't open " << golden << endl;
+    istringstream ts(text);
+    string gl, tl;
+    unsigned int line = 0;
+    for(;;) {
+        bool gok = (bool)getline(gs, gl);
+        bool tok = (bool)getline(ts, tl);
+        line++;
+        if(!gok || !tok) {
+            EXPECT_EQ(gok, tok) << golden << ":" << line << ": different count of lines" << endl;
+            break;
+        }
+        EXPECT_EQ(gl, tl) << golden << ":" << line << endl;
+    }
+}
+
+//! Reads file and removes it
+static string ReadFile(const char *name) {
+    ifstream is(name);
+    ostringstream os;
+    os << is.rdbuf();
+    is.close();
+    remove(name);
+    return os.str();
+}
+
+//! Returns lines of text sorted
+static string SortLines(const string &text) {
+    istringstream is(text);
+    vector<string> lines;
+    string l;
+    while(getline(is, l))
+        lines.push_back(l);
+    sort(lines.begin(), lines.end());
+    ostringstream os;
+    for(size_t i = 0; i < lines.size(); i++)
+        os << lines[i] << endl;
+    return os.str();
+}
+
+// -o listing: values created on demand have the same names as the values,
+// which were created with the device before. Golden file is the listing from
+// then, values are created in a other order now.
+TEST( SESSION_VCD, LISTING )
+{
+    NewDevice();
+    ostringstream os;
+    DumpManager::Instance()->save(os);
+    ifstream gs("session_vcd/listing.golden");
+    ostringstream golden;
+    golden << gs.rdbuf();
+    EXPECT_EQ(SortLines(golden.str()), SortLines(os.str()));
+    DumpManager::Reset();
+}
+
+TEST( SESSION_VCD, DUMP )
+{
+    AvrDevice *dev1 = NewDevice();
+    DumpManager *dman = DumpManager::Instance();
+
+    // like -c vcd:<list>:session_vcd/dump.vcd:rw
+    TraceSet vals = dman->load("+ CORE.IRAM64\n"    // RAM byte 0x0140
+                               "+ CORE.r16\n"
+                               "+ CORE.SREG\n"
+                               "+ STACK.SPL\n"
+                               "+ CORE.PC\n");      // value with shadow pointer
+    ASSERT_EQ(5u, vals.size());
+    dman->addDumper(new DumpVCD("session_vcd/dump.vcd", "ns", true, true), vals);
+    dman->start();
+    SystemClock::Instance().Add(dev1);
+
+    // a RAM byte written several times in one cycle
+    SystemClock::Instance().RunTimeRange(10 * 136);
+    dev1->SetRWMem(0x140, 0x55);
+    dev1->SetRWMem(0x140, 0xaa);
+    dev1->SetRWMem(0x140, 0x33);
+    SystemClock::Instance().RunTimeRange(4 * 136);
+
+    // dumper added after start, gets the write strobes of IRAM64 like the first one
+    Dumper *late = new DumpVCD("session_vcd/late.vcd", "ns", false, true);
+    dman->addDumper(late, dman->load("+ CORE.IRAM64\n+ CORE.r17\n"));
+    late->start();
+    SystemClock::Instance().Endless(); // should break if stopsim is reached
+    EXPECT_EQ(0x77, dev1->GetRWMem(0x140)) << "program didn't run" << endl;
+
+    dman->stopApplication();
+    ExpectGolden(ReadFile("session_vcd/dump.vcd"), "session_vcd/dump.golden.vcd");
+    ExpectGolden(ReadFile("session_vcd/late.vcd"), "session_vcd/late.golden.vcd");
+    DumpManager::Reset();
+}
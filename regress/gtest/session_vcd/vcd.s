@@ -0,0 +1,37 @@
+#include <avr/io.h>
+
+; VCD output of RAM, register, stack pointer and PC, see unittest_vcd.cpp
+; traced RAM byte is 0x0140
+
+.global main
+main:
+    ldi r16, 0x11
+    sts 0x0140, r16
+    sts 0x0140, r16             ; same value again, write strobe only
+    inc r16
+    sts 0x0140, r16
+    lds r17, 0x0140             ; read strobe
+    push r16                    ; stack pointer changes
+    push r17
+    pop r18
+    pop r19
+    ldi r20, 4
+loop:
+    mov r16, r20
+    sts 0x0140, r16
+    dec r20
+    brne loop
+    rcall func
+
+.global stopsim
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
+.global func
+func:
+    ldi r17, 0x77
+    sts 0x0140, r17
+    ret
@@ -0,0 +1,239 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "gtest.h"
+
+#include "avrdevice.h"
+#include "atmega128.h"
+#include "systemclock.h"
+#include "traceval.h"
+#include "vcdz.h"
+
+//! Compresses and decompresses data, returns compressed size
+static size_t RoundTrip(const string &data) {
+    string packed;
+    VcdzCompress(data.data(), data.size(), packed);
+    vector<char> out(data.size() + 1);
+    EXPECT_TRUE(VcdzDecompress(packed.data(), packed.size(), &out[0], data.size())) << "size " << data.size() << endl;
+    EXPECT_EQ(data, string(&out[0], data.size()));
+    // wrong size or truncated data is corrupt
+    EXPECT_FALSE(VcdzDecompress(packed.data(), packed.size(), &out[0], data.size() + 1));
+    if(data.size() > 0) {
+        EXPECT_FALSE(VcdzDecompress(packed.data(), packed.size(), &out[0], data.size() - 1));
+        EXPECT_FALSE(VcdzDecompress(packed.data(), packed.size() - 1, &out[0], data.size()));
+    }
+    return packed.size();
+}
+
+TEST( SESSION_VCDZ, COMPRESS )
+{
+    // shorter than a match
+    EXPECT_EQ(1u, RoundTrip(""));
+    EXPECT_EQ(2u, RoundTrip("a"));
+    EXPECT_EQ(5u, RoundTrip("abcd"));
+    EXPECT_EQ(9u, RoundTrip("abcdabcd"));
+
+    // incompressible, literal count continued by some bytes
+    string noise;
+    unsigned int x = 1;
+    for(unsigned int i = 0; i < 70000; i++) {
+        x = x * 1103515245 + 12345;
+        noise += (char)(x >> 23);
+    }
+    EXPECT_GE(noise.size() + noise.size() / 255 + 16, RoundTrip(noise));
+
+    // long matches with a length continued by many bytes
+    string repeated;
+    for(unsigned int i = 0; i < 5000; i++)
+        repeated += "$dumpvars b0101 !\n";
+    EXPECT_GT(repeated.size() / 50, RoundTrip(repeated));
+
+    // matches, which overlap their source
+    EXPECT_GT(1000u, RoundTrip(string(100000, 'x')));
+    string pairs;
+    for(unsigned int i = 0; i < 1000; i++)
+        pairs += "01";
+    EXPECT_GT(100u, RoundTrip(pairs));
+
+    // match length 4 + 15 needs a continuation byte of 0
+    RoundTrip(noise.substr(0, 19) + "." + noise.substr(0, 19) + noise.substr(100, 10));
+}
+
+//! Reads file and removes it
+static string ReadFile(const char *name) {
+    ifstream is(name, ios::in | ios::binary);
+    ostringstream os;
+    os << is.rdbuf();
+    is.close();
+    remove(name);
+    return os.str();
+}
+
+//! Runs the program with a plain and a compressed VCD dumper on the same values, returns the plain VCD
+static string RunDump(void) {
+    DumpManager::Reset();
+    DumpManager::Instance()->SetSingleDeviceApp();
+    SystemClock::Instance().ResetClock();   // don't run devices of other tests
+    AvrDevice *dev1 = new AvrDevice_atmega128;
+    dev1->Load("session_vcdz/vcdz.atmega128.o");
+    dev1->SetClockFreq(136);    // 7.3728
+    dev1->RegisterTerminationSymbol("stopsim");
+
+    DumpManager *dman = DumpManager::Instance();
+    TraceSet vals = dman->load("+ CORE.IRAM64\n"    // RAM byte 0x0140
+                               "+ CORE.r16\n"
+                               "+ CORE.r17\n"
+                               "+ CORE.SREG\n");
+    dman->addDumper(new DumpVCD("session_vcdz/plain.vcd", "ns", true, true), vals);
+    DumpVCDZ *packed = new DumpVCDZ("session_vcdz/dump.vcdz", "ns", true, true);
+    packed->flushSize = 512;    // many blocks
+    dman->addDumper(packed, vals);
+    dman->start();
+    SystemClock::Instance().Add(dev1);
+    SystemClock::Instance().Endless(); // should break if stopsim is reached
+    EXPECT_EQ(300 & 0xff, dev1->GetRWMem(0x140)) << "program didn't run" << endl;
+    EXPECT_LT(0, dev1->GetCoreReg(18)) << "no timer irq" << endl;
+
+    dman->stopApplication(); // writes and deletes dumpers
+    DumpManager::Reset();
+    return ReadFile("session_vcdz/plain.vcd");
+}
+
+//! Reads the whole compressed file, expects the plain VCD and returns the block times
+static vector<SystemClockOffset> ExpectConverted(const char *name, const string &vcd) {
+    VcdzReader reader(name);
+    ostringstream os;
+    reader.Convert(os);
+    EXPECT_EQ(vcd, os.str());
+    vector<SystemClockOffset> times;
+    for(size_t i = 0; i < reader.GetBlockCount(); i++) {
+        times.push_back(reader.GetBlockTime(i));
+        EXPECT_EQ((int)i, reader.FindBlock(reader.GetBlockTime(i)));
+        if(i > 0)
+            EXPECT_LT(times[i - 1], times[i]);
+    }
+    return times;
+}
+
+TEST( SESSION_VCDZ, DUMP_READ )
+{
+    string vcd = RunDump();
+    vector<SystemClockOffset> times = ExpectConverted("session_vcdz/dump.vcdz", vcd);
+    EXPECT_LT(10u, times.size()) << "too less blocks" << endl;
+
+    // without index (and trailer), like after an aborted simulation
+    string data = ReadFile("session_vcdz/dump.vcdz");
+    ASSERT_LT(24u, data.size());
+    unsigned long long indexOffset = 0;
+    for(int i = 7; i >= 0; i--)
+        indexOffset = (indexOffset << 8) | (unsigned char)data[data.size() - 24 + i];
+    ASSERT_GT(data.size(), indexOffset);
+    {
+        ofstream os("session_vcdz/noindex.vcdz", ios::out | ios::binary | ios::trunc);
+        os.write(data.data(), indexOffset);
+    }
+    EXPECT_EQ(times, ExpectConverted("session_vcdz/noindex.vcdz", vcd));
+    remove("session_vcdz/noindex.vcdz");
+}
+
+//! Id of a value change line
+static string ChangeId(const string &line) {
+    if((line[0] == 'b') || (line[0] == 'r'))
+        return line.substr(line.find(' ') + 1);
+    return line.substr(1);
+}
+
+//! Writes values as $dumpvars at time
+static void WriteValues(ostream &os, SystemClockOffset time, const vector<string> &values) {
+    os << "#" << time << "\n$dumpvars\n";
+    for(size_t i = 0; i < values.size(); i++)
+        os << values[i] << "\n";
+    os << "$end\n";
+}
+
+//! Window of a plain VCD file like simulavr-vcd -s start -e end (-1 for none) makes it from the compressed file
+static string CutWindow(const string &vcd, SystemClockOffset start, SystemClockOffset end) {
+    static const char endDefs[] = "$enddefinitions $end\n";
+    size_t defsEnd = vcd.find(endDefs) + strlen(endDefs);
+    ostringstream os;
+    os << vcd.substr(0, defsEnd);
+
+    // values in order of $dumpvars, then the changes up to start
+    vector<string> values;
+    map<string, size_t> ids;
+    bool started = false;
+    istringstream is(vcd.substr(defsEnd));
+    string line;
+    while(getline(is, line)) {
+        if(line[0] == '#') {
+            SystemClockOffset t = atoll(line.c_str() + 1);
+            if((end >= 0) && (t > end)) {
+                if(!started)
+                    WriteValues(os, start, values);
+                os << "#" << end << "\n";
+                return os.str();
+            }
+            if(!started && (t > start)) {
+                WriteValues(os, start, values);
+                started = true;
+            }
+            if(started)
+                os << line << "\n";
+        } else if(started)
+            os << line << "\n";
+        else if(line[0] != '$') {
+            string id = ChangeId(line);
+            if(ids.find(id) == ids.end()) {
+                ids[id] = values.size();
+                values.push_back(line);
+            } else
+                values[ids[id]] = line;
+        }
+    }
+    if(!started)
+        WriteValues(os, start, values);
+    return os.str();
+}
+
+TEST( SESSION_VCDZ, WINDOW )
+{
+    string vcd = RunDump();
+    vector<SystemClockOffset> changes;
+    istringstream is(vcd);
+    string line;
+    while(getline(is, line))
+        if(line[0] == '#')
+            changes.push_back(atoll(line.c_str() + 1));
+    ASSERT_LT(100u, changes.size());
+
+    VcdzReader reader("session_vcdz/dump.vcdz");
+    ASSERT_LT(3u, reader.GetBlockCount());
+    const SystemClockOffset block = reader.GetBlockTime(2);
+    const SystemClockOffset windows[][2] = {
+        { 0, -1 },
+        { 0, 0 },
+        { changes[10], changes[50] },           // on a cycle with changes
+        { changes[10] + 1, changes[50] - 1 },   // between cycles
+        { changes[5], changes[5] },
+        { block, -1 },                          // first cycle of a block
+        { block - 1, reader.GetBlockTime(3) },
+        { block + 1, block + 1 },
+        { changes.back(), -1 },
+        { changes.back() + 1000, -1 },          // after end of dump
+    };
+    for(size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+        ostringstream os;
+        reader.ConvertWindow(os, windows[i][0], windows[i][1]);
+        EXPECT_EQ(CutWindow(vcd, windows[i][0], windows[i][1]), os.str())
+            << "window " << windows[i][0] << " to " << windows[i][1] << endl;
+    }
+    remove("session_vcdz/dump.vcdz");
+}
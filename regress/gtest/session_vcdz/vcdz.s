@@ -0,0 +1,39 @@
+#include <avr/io.h>
+
+; RAM byte and registers change every few cycles, see unittest_vcdz.cpp
+; r18 count of timer irqs, r24:r25 loop counter
+
+.global main
+main:
+    clr r18
+    ldi r16, (1<<TOIE0)
+    out _SFR_IO_ADDR(TIMSK), r16
+    ldi r16, (1<<CS00)          ; timer 0 without prescaler, overflow every 256 cycles
+    out _SFR_IO_ADDR(TCCR0), r16
+    sei
+    ldi r16, 0
+    ldi r24, lo8(300)
+    ldi r25, hi8(300)
+loop:
+    inc r16
+    sts 0x0140, r16
+    mov r17, r16
+    sbiw r24, 1
+    brne loop
+    cli
+
+.global stopsim
+stopsim:
+    nop
+
+endless:
+    rjmp  endless
+
+.global TIMER0_OVF_vect
+TIMER0_OVF_vect:
+    push r16
+    in r16, _SFR_IO_ADDR(SREG)
+    inc r18
+    out _SFR_IO_ADDR(SREG), r16
+    pop r16
+    reti
@@ -76,6 +76,7 @@ AvrDevice_atmega128_c::~AvrDevice_atmega128_c() {
     delete osccal_reg;
     delete xdiv_reg;
     delete stack;
+    delete cache_data;
     delete cache_insn;
     delete eeprom;
     delete irqSystem;
@@ -86,9 +87,20 @@ AvrDevice_atmega128_c::AvrDevice_atmega128_c():
 {
     flagELPMInstructions = true;
     fuses->SetFuseConfiguration(18, 0xfd99e1);
-    irqSystem = new HWIrqSystem(this, 4, 36); //4 bytes per vector, 35+1 vectors vvvv
+    irqSystem = new HWIrqSystem(this, 4, 37); //4 bytes per vector, 35+2 vectors vvvv
     eeprom = new HWEeprom( this, irqSystem, 4096, 22);
-    cache_insn = new HWCache(this, 64, 32, 4, irqSystem, 4096, 35, true);  // last IRQ is for i-cache
+    CacheConfig icfg;  // 64 lines with 32 bytes, 4-way
+    icfg.trace = true;
+    icfg.Apply("icache", AvrFactory::instance().GetCacheOptions("icache"));
+    if(icfg.enabled)
+        cache_insn = new HWCache(this, icfg, irqSystem, 35);  // IRQ 35 is for i-cache
+    CacheConfig dcfg;
+    dcfg.linesize = 16;
+    dcfg.assoc = 2;
+    dcfg.trace = true;
+    dcfg.Apply("dcache", AvrFactory::instance().GetCacheOptions("dcache"));
+    if(dcfg.enabled)
+        cache_data = new HWCache(this, dcfg, irqSystem, 36, "DCACHE");  // IRQ 36 is for d-cache
     stack = new HWStackSram(this, 16);
     xdiv_reg = new XDIVRegister(this, &coreTraceGroup);
     osccal_reg = new OSCCALRegister(this, &coreTraceGroup, OSCCALRegister::OSCCAL_V3);
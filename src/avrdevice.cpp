@@ -24,6 +24,7 @@
  */
 
 #include <limits>
+#include <string.h>
 
 #include "avrdevice.h"
 #include "traceval.h"
@@ -33,6 +34,15 @@
 #include "avrerror.h"
 #include "avrmalloc.h"
 #include "avrreadelf.h"
+#include "hwcache.h"
+#include "blockcache.h"
+#include "jit.h"
+#include "tracebin.h"
+#include "profiler.h"
+#include "coverage.h"
+#include "tracefilter.h"
+#include "loopcounter.h"
+#include "tracewriter.h"
 #include <assert.h>
 #include "avrdevice_impl.h"
 
@@ -47,24 +57,108 @@ void AvrDevice::AddToResetList(Hardware *hw) {
 }
 
 void AvrDevice::AddToCycleList(Hardware *hw) {
-    if(find(hwCycleList.begin(), hwCycleList.end(), hw) == hwCycleList.end())
+    vector<Hardware*>::iterator element;
+    element=find(hwCycleList.begin(), hwCycleList.end(), hw);
+    if(element == hwCycleList.end()) {
         hwCycleList.push_back(hw);
+        hwCycleWake.push_back(0);
+        hwAwake++;
+    } else if(hwCycleWake[element - hwCycleList.begin()] != 0) {
+        // wake up on its place in the list, hwWakeTime is updated by WakeHardware
+        hwCycleWake[element - hwCycleList.begin()] = 0;
+        hwAwake++;
+    }
 }
 
 void AvrDevice::RemoveFromCycleList(Hardware *hw) {
     vector<Hardware*>::iterator element;
     element=find(hwCycleList.begin(), hwCycleList.end(), hw);
-    if(element != hwCycleList.end())
-        hwCycleList.erase(element);
+    if(element != hwCycleList.end()) {
+        unsigned int i = element - hwCycleList.begin();
+        if(hwCycleWake[i] == 0)
+            hwAwake--;
+        if(hwCycleListBusy) {
+            // don't move the following entries while CycleHardware iterates
+            hwCycleList[i] = NULL;
+            hwCycleWake[i] = 0;
+            hwCycleListDirty = true;
+        } else {
+            hwCycleList.erase(element);
+            hwCycleWake.erase(hwCycleWake.begin() + i);
+        }
+    }
+}
+
+void AvrDevice::SleepHardwareUntil(Hardware *hw, SystemClockOffset t) {
+    AddToCycleList(hw);
+    if(t <= SystemClock::Instance().GetCurrentTime())
+        return; // nothing to wait for
+    unsigned int i = find(hwCycleList.begin(), hwCycleList.end(), hw) - hwCycleList.begin();
+    hwCycleWake[i] = t;
+    hwAwake--;
+    if(t < hwWakeTime)
+        hwWakeTime = t;
+}
+
+void AvrDevice::WakeHardware(SystemClockOffset t) {
+    hwWakeTime = numeric_limits<SystemClockOffset>::max();
+    for(unsigned i = 0; i < hwCycleWake.size(); i++) {
+        if(hwCycleWake[i] == 0)
+            continue;
+        if(hwCycleWake[i] <= t) {
+            hwCycleWake[i] = 0;
+            hwAwake++;
+        } else
+            hwWakeTime = min(hwWakeTime, hwCycleWake[i]);
+    }
+}
+
+void AvrDevice::WakeAllHardware(void) {
+    WakeHardware(numeric_limits<SystemClockOffset>::max());
+}
+
+bool AvrDevice::CycleHardware(void) {
+    hwCycles++;
+    if(hwWakeTime <= SystemClock::Instance().GetCurrentTime())
+        WakeHardware(SystemClock::Instance().GetCurrentTime());
+    if(hwAwake == 0)
+        return false; // all hardware sleeps, nothing to call
+
+    bool hwWait = false;
+    hwCycleListBusy = true;
+    for(unsigned i = 0; i < hwCycleList.size(); i++) {
+        Hardware * p = hwCycleList[i];
+        if((p != NULL) && (hwCycleWake[i] == 0) && (p->CpuCycle() > 0))
+            hwWait = true;
+    }
+    hwCycleListBusy = false;
+
+    if(hwCycleListDirty) {
+        unsigned int n = 0;
+        for(unsigned i = 0; i < hwCycleList.size(); i++) {
+            if(hwCycleList[i] == NULL)
+                continue;
+            hwCycleList[n] = hwCycleList[i];
+            hwCycleWake[n] = hwCycleWake[i];
+            n++;
+        }
+        hwCycleList.resize(n);
+        hwCycleWake.resize(n);
+        hwCycleListDirty = false;
+    }
+    return hwWait;
 }
 
 void AvrDevice::Load(const char* fname) {
     actualFilename = fname;
     ELFLoad(this);
+    Flash->BuildSymbolIndex();
 }
 
 void AvrDevice::SetClockFreq(SystemClockOffset nanosec) {
    clockFreq = nanosec;
+   // wake up times are calculated with the old clock period
+   WakeAllHardware();
 }
 
 SystemClockOffset AvrDevice::GetClockFreq() {
@@ -79,6 +173,10 @@ Pin *AvrDevice::GetPin(const char *name) {
 }
 
 AvrDevice::~AvrDevice() {
+    // trace records of writer thread refer to this device
+    if(sysConHandler.GetTraceWriter() != NULL)
+        sysConHandler.GetTraceWriter()->ReleaseDevice(this);
+
     if (dumpManager) {
         // unregister device on DumpManager
         dumpManager->unregisterAvrDevice(this);
@@ -90,15 +188,26 @@ AvrDevice::~AvrDevice() {
         delete invalidRW[idx];
     delete [] invalidRW;
 
-    // delete Ram cells and registers
-    for(unsigned idx = 0; idx < registerSpaceSize; idx++)
-        delete rw[idx];
-    size = registerSpaceSize + ioSpaceSize + iRamSize + eRamSize;
-    for(unsigned idx = (registerSpaceSize + ioSpaceSize); idx < size; idx++)
+    // delete hooks on Ram cells and registers and their trace values
+    for(unsigned idx = 0; idx < dataMemSize; idx++) {
+        if((idx >= registerSpaceSize) && (idx < registerSpaceSize + ioSpaceSize))
+            continue;
         delete rw[idx];
+        delete dataMemTrace[idx];
+    }
+    delete [] dataMem;
+    for(unsigned idx = 0; idx < dataMemSources.size(); idx++)
+        delete dataMemSources[idx];
+
+    delete binaryTrace;
+    delete profiler;
+    delete coverage;
+    delete loops;
+    delete traceFilter;
 
     // delete rw and other allocated objects
     delete Flash;
+    delete jit;
     delete statusRegister;
     delete status;
     delete [] rw;
@@ -107,6 +216,26 @@ AvrDevice::~AvrDevice() {
     delete lockbits;
 }
 
+//! Creates TraceValues for registers or RAM on demand
+class DataMemTraceSource: public TraceValueSource {
+
+    public:
+        DataMemTraceSource(TraceValueRegister *r, const std::string &n, std::vector<TraceValue *> *t, unsigned int b):
+            reg(r), name(n), table(t), base(b) {}
+
+        TraceValue *CreateTraceValue(int idx) {
+            TraceValue *tv = new TraceValue(8, reg->GetTraceValuePrefix() + name, idx);
+            (*table)[base + idx] = tv;
+            return tv;
+        }
+
+    private:
+        TraceValueRegister *reg;
+        std::string name;
+        std::vector<TraceValue *> *table; //!< AvrDevice::dataMemTrace
+        unsigned int base;  //!< data address of first value
+};
+
 /*! To ease debugging, also supply the option to have the PC*2 in the trace
  * output file. This is also the format the other normal tracing will output
  * addresses and the format avr-objdump produces disassemblies in. */
@@ -119,6 +248,8 @@ public:
         change(ref->value()*2);
         set_written();
     }
+    
+    virtual bool polled() const { return true; }
 private:
     TraceValue *ref; // Reference value that will be doubled
 };
@@ -133,6 +264,15 @@ AvrDevice::AvrDevice(unsigned int _ioSpaceSize,
     iRamSize(IRamSize),
     eRamSize(ERamSize),
     devSignature(numeric_limits<unsigned int>::max()),
+    hwAwake(0),
+    hwWakeTime(numeric_limits<SystemClockOffset>::max()),
+    hwCycles(0),
+    hwCycleListBusy(false),
+    hwCycleListDirty(false),
+    engine(ENGINE_CLASSIC),
+    jit(NULL),
+    BP(&pcFlags),
+    EP(&pcFlags),
     cache_insn(NULL),
     cache_data(NULL),
     abortOnInvalidAccess(false),
@@ -160,6 +300,14 @@ AvrDevice::AvrDevice(unsigned int _ioSpaceSize,
     TraceValue* pc_tracer=trace_direct(&coreTraceGroup, "PC", &cPC);
     coreTraceGroup.RegisterTraceValue(new TwiceTV(coreTraceGroup.GetTraceValuePrefix()+"PCb",  pc_tracer));
     trace_on = 0;
+    trace_request = 0;
+    binaryTrace = NULL;
+    profiler = NULL;
+    coverage = NULL;
+    loops = NULL;
+    traceFilter = NULL;
+    stepCycle = &AvrDevice::StepCycleSwitch; // select variant on first step
+    activeStepCycle = &AvrDevice::StepCycle<false, false, false, false>;
 
     fuses = new AvrFuses;
     lockbits = new AvrLockBits;
@@ -189,15 +337,28 @@ AvrDevice::AvrDevice(unsigned int _ioSpaceSize,
     Flash = new AvrFlash(this, flashSize);
     if(Flash == NULL)
         avr_error("Not enough memory for Flash in AvrDevice::AvrDevice");
+    pcFlags.resize(Flash->GetSize() / 2, 0);
+
+    // registers and RAM are stored in a flat array without hooks
+    dataMemSize = registerSpaceSize + ioSpaceSize + IRamSize + ERamSize;
+    dataMem = new unsigned char [dataMemSize];
+    memset(dataMem, 0xaa, dataMemSize);
+    dataMemTrace.resize(dataMemSize, NULL);
 
     // create all registers
     unsigned currentOffset = 0;
     unsigned invalidRWOffset = 0;
 
+    // trace values for registers and RAM are created on demand
+    dataMemSources.push_back(new DataMemTraceSource(&coreTraceGroup, "r", &dataMemTrace, 0));
+    coreTraceGroup.RegisterTraceSetSource("r", registerSpaceSize, dataMemSources.back());
+    dataMemSources.push_back(new DataMemTraceSource(&coreTraceGroup, "IRAM", &dataMemTrace, registerSpaceSize + ioSpaceSize));
+    coreTraceGroup.RegisterTraceSetSource("IRAM", IRamSize, dataMemSources.back());
+    dataMemSources.push_back(new DataMemTraceSource(&coreTraceGroup, "ERAM", &dataMemTrace, registerSpaceSize + ioSpaceSize + IRamSize));
+    coreTraceGroup.RegisterTraceSetSource("ERAM", ERamSize, dataMemSources.back());
+
     for(unsigned ii = 0; ii < registerSpaceSize; ii++) {
-        rw[currentOffset] = new RAM(&coreTraceGroup, "r", ii, registerSpaceSize);
-        if(rw[currentOffset] == NULL)
-            avr_error("Not enough memory for registers in AvrDevice::AvrDevice");
+        rw[currentOffset] = NULL;
         currentOffset++;
     }
 
@@ -217,18 +378,14 @@ AvrDevice::AvrDevice(unsigned int _ioSpaceSize,
 
     // create the internal ram handlers
     for(unsigned ii = 0; ii < IRamSize; ii++ ) {
-        rw[currentOffset] = new RAM(&coreTraceGroup, "IRAM", ii, IRamSize);
-        if(rw[currentOffset] == NULL)
-            avr_error("Not enough memory for IRAM in AvrDevice::AvrDevice");
+        rw[currentOffset] = NULL;
         currentOffset++;
     }
 
     // create the external ram handlers, TODO: make the configuration from
     // mcucr available here
     for(unsigned ii = 0; ii < ERamSize; ii++ ) {
-        rw[currentOffset] = new RAM(&coreTraceGroup, "ERAM", ii, ERamSize);
-        if(rw[currentOffset] == NULL)
-            avr_error("Not enough memory for io space in AvrDevice::AvrDevice");
+        rw[currentOffset] = NULL;
         currentOffset++;
     }
 
@@ -242,53 +399,91 @@ AvrDevice::AvrDevice(unsigned int _ioSpaceSize,
     }
 }
 
-// do a single core step, (0)->a real hardware step, (1) until the uC finish the opcode!
 int AvrDevice::Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_ns) {
-    if (cpuCycles<=0) // "countdown" before next instruction is executed
+    int rc = (this->*stepCycle)(untilCoreStepFinished, nextStepIn_ns);
+    if(nextStepIn_ns == NULL)
+        return rc;
+
+    // process following cycles without time table of SystemClock, as long
+    // as no other simulation member is scheduled
+    SystemClock &clock = SystemClock::Instance();
+    while((rc == 0) && (*nextStepIn_ns == clockFreq)) {
+        SystemClockOffset nextTime = clock.GetCurrentTime() + clockFreq;
+        if(!clock.CanRunAhead(this, nextTime, clockFreq))
+            break;
+        clock.RunAheadCycle(nextTime);
+        *nextStepIn_ns = -1; // like SystemClock::Step
+        rc = (this->*stepCycle)(untilCoreStepFinished, nextStepIn_ns);
+    }
+    return rc;
+}
+
+// do a single core step, (0)->a real hardware step, (1) until the uC finish the opcode!
+template<bool TRACE, bool BTRACE, bool ICACHE, bool DUMP>
+int AvrDevice::StepCycle(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_ns) {
+    if (cpuCycles<=0) { // "countdown" before next instruction is executed
         cPC=PC;
-    if(trace_on == 1) {
+        if((traceFilter != NULL) && trace_request && (traceFilter->OnBoundary(PC) != TRACE)) {
+            // trace output starts or stops with this instruction
+            trace_on = TRACE ? 0 : trace_request;
+            activeStepCycle = SelectStepCycle();
+            stepCycle = activeStepCycle;
+            return (this->*activeStepCycle)(untilCoreStepFinished, nextStepIn_ns);
+        }
+    }
+    // lines are formatted by writer thread, if trace file is written asynchronous
+    AsyncTraceWriter *traceWriter = TRACE ? sysConHandler.GetTraceWriter() : NULL;
+    if(TRACE && (traceWriter != NULL))
+        traceWriter->BeginLine(this, cPC, SystemClock::Instance().GetClockCycles());
+    else if(TRACE) {
         traceOut << actualFilename << " ";
         traceOut << HexShort(cPC << 1) << dec << ": ";
 
         // MBe: show CPU cycle num in trace
         traceOut << SystemClock::Instance().GetClockCycles() << ": ";
 
-        string sym(Flash->GetSymbolAtAddress(cPC));
-        traceOut << sym << " ";
-        for (int len = sym.length(); len < 30;len++)
-            traceOut << " " ;
+        Flash->WriteSymbolAtAddress(traceOut, cPC, 30);
+        traceOut << " ";
     }
 
-    bool hwWait = false;
-    for(unsigned i = 0; i < hwCycleList.size(); i++) {
-        Hardware * p = hwCycleList[i];
-        if (p->CpuCycle() > 0)
-            hwWait = true;
-    }
+    bool blockExecuted = false;
+    bool hwWait = CycleHardware();
 
     if(hwWait) {
-        if(trace_on)
+        if(TRACE && (traceWriter != NULL))
+            traceWriter->Event(ATREC_HOLD);
+        else if(TRACE)
             traceOut << "CPU-Hold by IO-Hardware ";
+        if(BTRACE)
+            binaryTrace->Hold(cPC);
     } else if(cpuCycles <= 0) {
 
             //check for enabled breakpoints here
-            if(BP.end() != find(BP.begin(), BP.end(), PC)) {
-                if(trace_on)
+            unsigned char pcFlag = GetPCFlags(PC);
+            if(pcFlag & PCFLAG_BREAKPOINT) {
+                if(TRACE)
                     traceOut << "Breakpoint found at 0x" << hex << PC << dec << endl;
                 if(nextStepIn_ns != 0)
                     *nextStepIn_ns=clockFreq;
                 untilCoreStepFinished = !(cpuCycles > 0);
-                dumpManager->cycle();
+                if(DUMP)
+                    dumpManager->cycle();
                 return BREAK_POINT;
             }
 
-            if(EP.end() != find(EP.begin(), EP.end(), PC)) {
+            if(pcFlag & PCFLAG_EXITPOINT) {
                 avr_message("Simulation finished!");
                 SystemClock::Instance().Stop();
-                dumpManager->cycle();
+                if(DUMP)
+                    dumpManager->cycle();
                 return 0;
             }
 
+            if((pcFlag & PCFLAG_PROFILE) && (profiler != NULL))
+                profiler->OnBoundary(PC);
+            if((pcFlag & PCFLAG_LOOPEXIT) && (loops != NULL))
+                loops->OnExit(PC);
+
             /*******
              * IRQs
              *******/
@@ -304,23 +499,34 @@ int AvrDevice::Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_n
                  */
                 deferIrq = false;
 
-                if(trace_on)
+                if(TRACE && (traceWriter != NULL))
+                    traceWriter->Event(ATREC_IRQ, newIrqPc);
+                else if(TRACE)
                     traceOut << "IRQ DETECTED: VectorAddr: " << newIrqPc ;
+                if(BTRACE)
+                    binaryTrace->IrqEntry(this, PC, actualIrqVector, newIrqPc);
 
+                if(traceFilter != NULL)
+                    traceFilter->OnIrq(actualIrqVector);
                 irqSystem->IrqHandlerStarted(actualIrqVector);    //what vector we raise?
                 Funktor* fkt = new IrqFunktor(irqSystem, &HWIrqSystem::IrqHandlerFinished, actualIrqVector);
                 stack->SetReturnPoint(stack->GetStackPointer(), fkt);
                 stack->PushAddr(PC);
                 cpuCycles = 4; //push needs 4 cycles! (on external RAM +2, this is handled from HWExtRam!)
+                cpuCycles += StackCacheAccess(PC_size, true);
                 status->I = 0; //irq started so remove I-Flag from SREG
                 PC = newIrqPc - 1;   //we add a few lines later 1 so we sub here 1 :-)
+                if(BTRACE)
+                    binaryTrace->EndInstruction(this);
 
             } else if(status->I == 1) {
                 newIrqPc = irqSystem->GetNewPc(actualIrqVector);
 
                 if(newIrqPc != 0xffffffff) {
                    deferIrq = true; // do always one instruction before entering irq vect
-                   if(trace_on)
+                   if(TRACE && (traceWriter != NULL))
+                      traceWriter->Event(ATREC_IRQ_PREPARED, newIrqPc);
+                   else if(TRACE)
                       traceOut << "IRQ prepared for addr " << hex << newIrqPc << dec << endl;
                 }
             }
@@ -334,22 +540,48 @@ int AvrDevice::Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_n
                     ostringstream os;
                     os << actualFilename << " Simulation runs out of Flash Space at " << hex << (PC << 1);
                     string s = os.str();
-                    if(trace_on)
+                    if(TRACE)
                         traceOut << s << endl;
                     avr_error("%s", s.c_str());
                 }
 
-                DecodedInstruction *de = Flash->GetInstruction(PC);
-                cpuCycles = de->Execute(PC, trace_on);
+                if(BTRACE)
+                    binaryTrace->BeginInstruction(this, PC);
+
+                if(!TRACE && !BTRACE && !DUMP && (engine == ENGINE_BLOCK || engine == ENGINE_JIT))
+                    blockExecuted = RunBlocks<ICACHE>(hwWait);
+                if(!blockExecuted && (coverage != NULL))
+                    coverage->Executed(PC);
+
+                if(blockExecuted) {
+                    // PC and cpuCycles are already processed
+                } else if(TRACE || engine == ENGINE_CLASSIC) {
+                    DecodedInstruction *de = Flash->GetInstruction(PC);
+                    cpuCycles = de->Execute<TRACE, ICACHE>(PC);
+                } else {
+                    const DispatchRecord &rec = Flash->GetDispatchRecord(PC);
+                    cpuCycles = 0;
+                    if(ICACHE)
+                        cpuCycles += cache_insn->access(PC * 2, rec.len);
+                    cpuCycles += rec.handler(rec.insn);
+                }
 
                 // report changes on status
-                statusRegister->trigger_change();
+                if(!blockExecuted)
+                    statusRegister->trigger_change();
+
+                if(BTRACE)
+                    binaryTrace->EndInstruction(this);
             }
 
-            PC++;
-            cpuCycles--;
+            if(!blockExecuted) {
+                PC++;
+                cpuCycles--;
+            }
     } else { //cpuCycles>0
-        if(trace_on == 1)
+        if(TRACE && (traceWriter != NULL))
+            traceWriter->Event(ATREC_WAIT);
+        else if(TRACE)
             traceOut << "CPU-waitstate";
         cpuCycles--;
     }
@@ -357,20 +589,279 @@ int AvrDevice::Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_n
     if(nextStepIn_ns != NULL)
         *nextStepIn_ns = clockFreq;
 
-    if(trace_on == 1) {
+    if(TRACE && (traceWriter != NULL))
+        traceWriter->EndLine((int)*status);
+    else if(TRACE) {
         traceOut << endl;
         sysConHandler.TraceNextLine();
     }
 
     untilCoreStepFinished = !((cpuCycles > 0) || hwWait);
-    dumpManager->cycle();
+    if(DUMP)
+        dumpManager->cycle();
     return (cpuCycles < 0) ? cpuCycles : 0;
 }
 
+void AvrDevice::StartBinaryTrace(const string &filename) {
+    StopBinaryTrace();
+    binaryTrace = new BinaryTraceWriter(filename);
+    binaryTrace->WriteHeader(this);
+    UpdateStepCycle();
+}
+
+void AvrDevice::EnableProfiler(bool irqAware) {
+    if(profiler == NULL)
+        profiler = new FunctionProfiler(this, irqAware);
+}
+
+void AvrDevice::EnableCoverage(const string &lcovFilename) {
+    if(coverage == NULL)
+        coverage = new CoverageCounter(this, lcovFilename);
+}
+
+void AvrDevice::StopCoverage(void) {
+    if(coverage != NULL) {
+        coverage->WriteLcov();
+        delete coverage;
+        coverage = NULL;
+    }
+}
+
+void AvrDevice::EnableLoopCounter(const string &filename) {
+    if(loops == NULL)
+        loops = new LoopCounter(this, filename);
+}
+
+void AvrDevice::StopLoopCounter(void) {
+    if(loops != NULL) {
+        loops->Write();
+        delete loops;
+        loops = NULL;
+    }
+}
+
+void AvrDevice::AddTraceFilter(const string &spec) {
+    if(traceFilter == NULL)
+        traceFilter = new TraceFilter(this);
+    traceFilter->Add(spec);
+    SetTraceOn(trace_request);
+}
+
+void AvrDevice::SetTraceOn(int on) {
+    trace_request = on;
+    trace_on = ((traceFilter == NULL) || traceFilter->IsActive()) ? on : 0;
+    UpdateStepCycle();
+}
+
+void AvrDevice::StopBinaryTrace(void) {
+    delete binaryTrace;
+    binaryTrace = NULL;
+    UpdateStepCycle();
+}
+
+AvrDevice::StepCycleFunc AvrDevice::SelectStepCycle(void) {
+    static const StepCycleFunc variants[16] = {
+        &AvrDevice::StepCycle<false, false, false, false>,
+        &AvrDevice::StepCycle<false, false, false, true>,
+        &AvrDevice::StepCycle<false, false, true, false>,
+        &AvrDevice::StepCycle<false, false, true, true>,
+        &AvrDevice::StepCycle<false, true, false, false>,
+        &AvrDevice::StepCycle<false, true, false, true>,
+        &AvrDevice::StepCycle<false, true, true, false>,
+        &AvrDevice::StepCycle<false, true, true, true>,
+        &AvrDevice::StepCycle<true, false, false, false>,
+        &AvrDevice::StepCycle<true, false, false, true>,
+        &AvrDevice::StepCycle<true, false, true, false>,
+        &AvrDevice::StepCycle<true, false, true, true>,
+        &AvrDevice::StepCycle<true, true, false, false>,
+        &AvrDevice::StepCycle<true, true, false, true>,
+        &AvrDevice::StepCycle<true, true, true, false>,
+        &AvrDevice::StepCycle<true, true, true, true>
+    };
+    bool dump = (dumpManager != NULL) && dumpManager->HasDumpers();
+    return variants[((trace_on != 0) << 3) | ((binaryTrace != NULL) << 2) | ((cache_insn != NULL) << 1) | dump];
+}
+
+int AvrDevice::StepCycleSwitch(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_ns) {
+    if(cpuCycles <= 0) {
+        // next instruction starts with this cycle, change variant now
+        activeStepCycle = SelectStepCycle();
+        stepCycle = activeStepCycle;
+    }
+    return (this->*activeStepCycle)(untilCoreStepFinished, nextStepIn_ns);
+}
+
+unsigned int AvrDevice::FindBreakInBlock(const TranslatedBlock *b, unsigned int first) {
+    unsigned int stop = b->entries.size();
+    for(unsigned int j = first; j < stop; j++) {
+        if(GetPCFlags(b->entries[j].pc) & (PCFLAG_BREAKPOINT | PCFLAG_EXITPOINT | PCFLAG_PROFILE | PCFLAG_LOOPEXIT | PCFLAG_TRACE))
+            return j;
+    }
+    return stop;
+}
+
+template<bool ICACHE>
+bool AvrDevice::RunBlocks(bool &hwWait) {
+    BlockCache *cache = Flash->GetBlockCache();
+    if(Flash->IsRWWLock(PC * 2))
+        return false; // let Step abort on locked flash
+
+    SystemClock &clock = SystemClock::Instance();
+    unsigned long generation = cache->GetGeneration();
+    TranslatedBlock *blk = cache->Lookup(PC);
+    if((engine == ENGINE_JIT) && (++blk->hits == JitCompiler::hotThreshold))
+        jit->Compile(blk);
+    unsigned int stop = FindBreakInBlock(blk, 1); // first entry is checked by Step
+    unsigned int i = 0;
+
+    for(;;) {
+        // we are on a instruction boundary, hardware cycle, breakpoint and
+        // irq are processed. Execute a superinstruction only, if no irq can
+        // be raised inside, because irqs are checked on each boundary, and
+        // if all cycles up to its last instruction would be simulated. The
+        // instruction and data cache can add wait states to each instruction
+        // and must not change their state by time. Sleeping hardware, like the
+        // watchdog, must not wake up inside.
+        unsigned int n = blk->entries[i].fuse;
+        if(n > 1) {
+            unsigned int span = blk->entries[i].span;
+            if(ICACHE)
+                span += (n - 1) * cache_insn->GetMaxAccessCycles();
+            if(cache_data != NULL)
+                span += (n - 1) * cache_data->GetMaxAccessCycles();
+            if((i + n > stop) || deferIrq || (ICACHE && cache_insn->IsClearing()) ||
+               ((cache_data != NULL) && cache_data->IsClearing()) ||
+               ((status->I == 1) && (hwAwake != 0)) ||
+               (hwWakeTime <= clock.GetCurrentTime() + span * clockFreq) ||
+               !clock.CanRunAhead(this, clock.GetCurrentTime() + span * clockFreq, clockFreq))
+                n = 1;
+        }
+
+        cpuCycles = 0;
+        unsigned int k = 0;
+        // profiling caches need PC of each instruction, native code doesn't update it
+        const bool profiling = (ICACHE && cache_insn->IsProfiling()) ||
+                               ((cache_data != NULL) && cache_data->IsProfiling());
+        if((n > 1) && (blk->entries[i].jit != NULL) && (engine == ENGINE_JIT) && !profiling) {
+            // cache accesses don't depend on the execution of this instructions
+            const BlockEntry &e = blk->entries[i];
+            if(ICACHE)
+                for(unsigned int j = 0; j < e.jitLen; j++)
+                    cpuCycles += cache_insn->access(blk->entries[i + j].pc * 2, blk->entries[i + j].rec.len);
+            if(coverage != NULL)
+                for(unsigned int j = 0; j < e.jitLen; j++)
+                    coverage->Executed(blk->entries[i + j].pc);
+            e.jit();
+            cpuCycles += e.jitCycles;
+            k = e.jitLen;
+            i += k;
+            PC = blk->entries[i - 1].pc;
+        }
+        for(; k < n; k++, i++) {
+            const DispatchRecord &rec = blk->entries[i].rec;
+            if(k > 0)
+                PC++;
+            if(coverage != NULL)
+                coverage->Executed(PC);
+            if(ICACHE)
+                cpuCycles += cache_insn->access(PC * 2, rec.len);
+            cpuCycles += rec.handler(rec.insn);
+        }
+
+        // report changes on status
+        statusRegister->trigger_change();
+
+        PC++;
+        cpuCycles--;
+        if(cpuCycles < 0)
+            return true; // BREAK or invalid opcode, Step returns this
+
+        // process following cycles like Step does
+        for(;;) {
+            if(cpuCycles <= 0) {
+                // next cycle is a instruction boundary
+                if(deferIrq || (cache->GetGeneration() != generation) || (stepCycle != activeStepCycle))
+                    return true; // irq entry, flash was written or StepCycle variant changes
+                if((i >= blk->entries.size()) || (blk->entries[i].pc != PC)) {
+                    if(((unsigned int)(PC << 1) >= (unsigned int)Flash->GetSize()) || Flash->IsRWWLock(PC * 2))
+                        return true;
+                    blk = cache->Lookup(PC);
+                    if((engine == ENGINE_JIT) && (++blk->hits == JitCompiler::hotThreshold))
+                        jit->Compile(blk);
+                    stop = FindBreakInBlock(blk, 0);
+                    i = 0;
+                }
+                if(i >= stop)
+                    return true; // breakpoint or exitpoint, Step handles it
+            }
+
+            SystemClockOffset nextTime = clock.GetCurrentTime() + clockFreq;
+            if(!clock.CanRunAhead(this, nextTime, clockFreq))
+                return true;
+            clock.RunAheadCycle(nextTime);
+
+            if(cpuCycles <= 0)
+                cPC = PC;
+            word boundaryPC = PC;
+            hwWait = CycleHardware();
+            if(hwWait)
+                continue;
+            if(cpuCycles > 0) {
+                cpuCycles--;
+                continue;
+            }
+
+            if(PC != boundaryPC) {
+                // core was reset by hardware (watchdog), check new PC like Step
+                blk = cache->Lookup(PC);
+                stop = FindBreakInBlock(blk, 0);
+                i = 0;
+                if(stop == 0) {
+                    unsigned char pcFlag = GetPCFlags(PC);
+                    if(pcFlag & PCFLAG_BREAKPOINT) {
+                        cpuCycles = BREAK_POINT; // Step returns this
+                        return true;
+                    }
+                    if(pcFlag & PCFLAG_EXITPOINT) {
+                        avr_message("Simulation finished!");
+                        clock.Stop();
+                        return true;
+                    }
+                    if((pcFlag & PCFLAG_PROFILE) && (profiler != NULL))
+                        profiler->OnBoundary(PC);
+                    if((pcFlag & PCFLAG_LOOPEXIT) && (loops != NULL))
+                        loops->OnExit(PC);
+                    stop = FindBreakInBlock(blk, 1);
+                }
+            }
+
+            if(status->I == 1) {
+                newIrqPc = irqSystem->GetNewPc(actualIrqVector);
+                if(newIrqPc != 0xffffffff)
+                    deferIrq = true; // do always one instruction before entering irq vect
+            }
+            break;
+        }
+    }
+}
+
+void AvrDevice::SetExecutionEngine(ExecutionEngine e) {
+    if((e == ENGINE_JIT) && !JitCompiler::IsSupported()) {
+        avr_warning("JIT engine isn't supported on this host, use block engine");
+        e = ENGINE_BLOCK;
+    }
+    if((e == ENGINE_JIT) && (jit == NULL))
+        jit = new JitCompiler(this);
+    engine = e;
+}
+
 void AvrDevice::Reset() {
     PC_size = 2;
     PC = 0;
 
+    // sleeping hardware has to check its state after reset
+    WakeAllHardware();
+
     vector<Hardware *>::iterator ii;
     for(ii= hwResetList.begin(); ii != hwResetList.end(); ii++)
         (*ii)->Reset();
@@ -383,7 +874,39 @@ void AvrDevice::Reset() {
 }
 
 void AvrDevice::DeleteAllBreakpoints() {
-    BP.erase(BP.begin(), BP.end());
+    BP.RemoveAll();
+}
+
+void AvrDevice::SetPCFlag(unsigned int pc, unsigned char flag) {
+    if(pc < pcFlags.size())
+        pcFlags[pc] |= flag;
+}
+
+void AvrDevice::ClearPCFlag(unsigned int pc, unsigned char flag) {
+    if(pc < pcFlags.size())
+        pcFlags[pc] &= ~flag;
+}
+
+void PCFlagList::Add(unsigned int pc) {
+    pcs.push_back(pc);
+    if(HasFlag(pc))
+        (*flags)[pc] |= mask;
+}
+
+void PCFlagList::Remove(unsigned int pc) {
+    std::vector<unsigned int>::iterator ii = find(pcs.begin(), pcs.end(), pc);
+    if(ii == pcs.end())
+        return;
+    pcs.erase(ii);
+    if(HasFlag(pc) && (find(pcs.begin(), pcs.end(), pc) == pcs.end()))
+        (*flags)[pc] &= ~mask;
+}
+
+void PCFlagList::RemoveAll(void) {
+    for(const_iterator ii = pcs.begin(); ii != pcs.end(); ii++)
+        if(HasFlag(*ii))
+            (*flags)[*ii] &= ~mask;
+    pcs.clear();
 }
 
 void AvrDevice::SetDeviceNameAndSignature(const std::string &name, unsigned int signature) {
@@ -418,7 +941,7 @@ void AvrDevice::RegisterTerminationSymbol(const char *symbol) {
 #endif
     unsigned int epa = Flash->GetAddressAtSymbol(symbol);
     avr_message("Termination at: 0x%X\n", epa);
-    EP.push_back(epa);
+    EP.Add(epa);
 }
 
 void AvrDevice::DebugOnJump()
@@ -430,28 +953,74 @@ void AvrDevice::DebugOnJump()
     DebugRecentJumps[next] = -1;
 }
 
-unsigned char AvrDevice::GetRWMem(unsigned addr) {
+unsigned char AvrDevice::GetRWMemHooked(unsigned addr) {
     if(addr >= GetMemTotalSize())
         return 0;
     return *(rw[addr]);
 }
 
-bool AvrDevice::SetRWMem(unsigned addr, unsigned char val) {
+bool AvrDevice::SetRWMemHooked(unsigned addr, unsigned char val) {
     if(addr >= GetMemTotalSize())
         return false;
     *(rw[addr]) = val;
     return true;
 }
 
-unsigned char AvrDevice::GetCoreReg(unsigned addr) {
-    assert(addr < registerSpaceSize);
-    return *(rw[addr]);
+int AvrDevice::DataCacheAccessHooked(unsigned addr, unsigned char len, bool write) {
+    // clamp to RAM, a stack access can start below or end behind it and
+    // LDD/STD can address behind data memory
+    unsigned first = registerSpaceSize + ioSpaceSize;
+    unsigned end = addr + len;
+    if(addr < first)
+        addr = first;
+    if(end > dataMemSize)
+        end = dataMemSize;
+    if(addr >= end)
+        return 0;
+    return cache_data->access(0x800000 + addr, end - addr, write);
 }
 
-bool AvrDevice::SetCoreReg(unsigned addr, unsigned char val) {
-    assert(addr < registerSpaceSize);
-    *(rw[addr]) = val;
-    return true;
+int AvrDevice::FlashCacheAccessHooked(unsigned addr) {
+    return cache_data->access(addr, 1, false);
+}
+
+int AvrDevice::StackCacheAccessHooked(unsigned char len, bool write) {
+    // stack grows down: a push has written SP + 1 ..., a pop has read ... SP
+    unsigned addr = stack->GetStackPointer() + 1;
+    if(!write)
+        addr -= len;
+    return DataCacheAccessHooked(addr, len, write);
+}
+
+void AvrDevice::EnableDataMemHooks(unsigned first, unsigned last) {
+    for(unsigned addr = first; (addr <= last) && (addr < dataMemSize); addr++) {
+        if((rw[addr] != NULL) || (dataMemTrace[addr] == NULL))
+            continue; // IO space or already hooked
+        rw[addr] = new RAM(dataMemTrace[addr], &dataMem[addr]);
+    }
+}
+
+void AvrDevice::HookTracedDataMem(void) {
+    for(unsigned addr = 0; addr < dataMemSize; addr++) {
+        if((dataMemTrace[addr] != NULL) && dataMemTrace[addr]->enabled())
+            EnableDataMemHooks(addr, addr);
+    }
+}
+
+TraceValue *AvrDevice::GetDataMemTraceValue(unsigned addr) {
+    if(addr >= dataMemSize)
+        return NULL;
+    if(dataMemTrace[addr] == NULL) {
+        // create it by name, if it's a register or RAM byte
+        unsigned iram = registerSpaceSize + ioSpaceSize;
+        if(addr < registerSpaceSize)
+            coreTraceGroup.GetTraceValueByName("r" + int2str(addr));
+        else if(addr >= iram + iRamSize)
+            coreTraceGroup.GetTraceValueByName("ERAM" + int2str(addr - iram - iRamSize));
+        else if(addr >= iram)
+            coreTraceGroup.GetTraceValueByName("IRAM" + int2str(addr - iram));
+    }
+    return dataMemTrace[addr];
 }
 
 unsigned char AvrDevice::GetIOReg(unsigned addr) {
@@ -476,19 +1045,4 @@ bool AvrDevice::SetIORegBit(unsigned addr, unsigned bitaddr, bool bval) {
     return true;
 }
 
-unsigned AvrDevice::GetRegX(void) {
-    // R27:R26
-    return (*(rw[27]) << 8) + *(rw[26]);
-}
-
-unsigned AvrDevice::GetRegY(void) {
-    // R29:R28
-    return (*(rw[29]) << 8) + *(rw[28]);
-}
-
-unsigned AvrDevice::GetRegZ(void) {
-    // R31:R30
-    return (*(rw[31]) << 8) + *(rw[30]);
-}
-
 // EOF
@@ -37,15 +37,66 @@
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <assert.h>
 #include "types.h" // for dword
 
 // transfered from global.h
 #define BREAK_POINT    -2
 #define INVALID_OPCODE -1
 
+//! Flags for each flash word, see AvrDevice::GetPCFlags
+enum {
+    PCFLAG_BREAKPOINT = 0x01, //!< breakpoint is set on this word, see Breakpoints
+    PCFLAG_EXITPOINT  = 0x02, //!< exitpoint is set on this word, see Exitpoints
+    PCFLAG_WATCH      = 0x04, //!< watch hook is set on this word
+    PCFLAG_PROFILE    = 0x08, //!< profiling hook is set on this word
+    PCFLAG_LOOPEXIT   = 0x10, //!< loop exit hook is set on this word, see LoopCounter
+    PCFLAG_TRACE      = 0x20  //!< trace filter starts on this word, see TraceFilter
+};
+
+//! List of word addresses, which keeps one flag in the per word flag table in sync
+class PCFlagList {
+
+    public:
+        typedef std::vector<unsigned int>::const_iterator const_iterator;
+
+        PCFlagList(std::vector<unsigned char> *f, unsigned char m): flags(f), mask(m) {}
+
+        //! Adds word address pc to list and sets flag
+        void Add(unsigned int pc);
+        //! Removes one entry with word address pc, clears flag if it was the last one
+        void Remove(unsigned int pc);
+        //! Removes all entries and clears flag on all words
+        void RemoveAll(void);
+
+        size_t size(void) const { return pcs.size(); }
+        const_iterator begin(void) const { return pcs.begin(); }
+        const_iterator end(void) const { return pcs.end(); }
+
+    private:
+        std::vector<unsigned int> pcs;  //!< word addresses, can contain a address more than once
+        std::vector<unsigned char> *flags;
+        unsigned char mask;
+
+        //! Returns true, if pc has an entry in the flag table
+        bool HasFlag(unsigned int pc) const { return pc < flags->size(); }
+};
+
 // transfered from breakpoint.h
-class Breakpoints: public std::vector<dword> { };
-class Exitpoints: public std::vector<dword> { };
+class Breakpoints: public PCFlagList {
+
+    public:
+        Breakpoints(std::vector<unsigned char> *f): PCFlagList(f, PCFLAG_BREAKPOINT) {}
+
+        void AddBreakpoint(unsigned int bp) { Add(bp); }
+        void RemoveBreakpoint(unsigned int bp) { Remove(bp); }
+};
+
+class Exitpoints: public PCFlagList {
+
+    public:
+        Exitpoints(std::vector<unsigned char> *f): PCFlagList(f, PCFLAG_EXITPOINT) {}
+};
 
 // from hwsreg.h, but not included, because of circular include with this header
 class HWSreg;
@@ -62,6 +113,13 @@ class RWMemoryMember;
 class Hardware;
 class DumpManager;
 class AddressExtensionRegister;
+class TranslatedBlock;
+class JitCompiler;
+class TraceFilter;
+class BinaryTraceWriter;
+class FunctionProfiler;
+class CoverageCounter;
+class LoopCounter;
 
 //! Basic AVR device, contains the core functionality
 class AvrDevice: public SimulationMember, public TraceValueRegister {
@@ -77,7 +135,44 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         std::string devName; //!< hold the device name, which this core simulate
 
         friend class DumpManager;
-        void detachDumpManager() { dumpManager = NULL; }
+        friend class BlockCache;  // gives native code of invalidated blocks back to jit
+        void detachDumpManager() { dumpManager = NULL; UpdateStepCycle(); }
+
+        //! Registers, IO space (unused) and RAM as flat array, indexed by data address
+        unsigned char *dataMem;
+        unsigned int dataMemSize; //!< size of dataMem, end of external RAM
+        //! TraceValue for each register and RAM byte, NULL for IO space or not yet created
+        std::vector<TraceValue *> dataMemTrace;
+        //! Sources, which create TraceValues in dataMemTrace on demand
+        std::vector<TraceValueSource *> dataMemSources;
+
+        //! Access on a data address, which is handled by a RWMemoryMember
+        unsigned char GetRWMemHooked(unsigned addr);
+        //! Access on a data address, which is handled by a RWMemoryMember
+        bool SetRWMemHooked(unsigned addr, unsigned char val);
+        //! Data cache access on a data address, see DataCacheAccess
+        int DataCacheAccessHooked(unsigned addr, unsigned char len, bool write);
+        //! Data cache access on a flash byte address, see FlashCacheAccess
+        int FlashCacheAccessHooked(unsigned addr);
+        //! Data cache access on the stack, see StackCacheAccess
+        int StackCacheAccessHooked(unsigned char len, bool write);
+        //! Creates RAM hooks for all registers and RAM bytes with enabled TraceValue
+        /*! Called by DumpManager::addDumper */
+        void HookTracedDataMem(void);
+
+        //! Wake up time for each entry in hwCycleList, 0 if the entry is awake
+        std::vector<SystemClockOffset> hwCycleWake;
+        unsigned int hwAwake;         //!< count of awake entries in hwCycleList
+        SystemClockOffset hwWakeTime; //!< earliest wake up time in hwCycleWake
+        unsigned long long hwCycles;  //!< count of cycles, processed by hardware
+        bool hwCycleListBusy;   //!< true, while CycleHardware iterates over hwCycleList
+        bool hwCycleListDirty;  //!< hwCycleList contains removed (NULL) entries
+
+        //! PCFLAG_* for each flash word, BP and EP keep their flags in sync
+        std::vector<unsigned char> pcFlags;
+
+        //! Wakes up all entries in hwCycleList with wake up time <= t
+        void WakeHardware(SystemClockOffset t);
 
     protected:
         SystemClockOffset clockFreq;  ///< Period of a tick (1/F_OSC) in [ns]
@@ -88,7 +183,53 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         int cpuCycles;
 
     public:
-        int trace_on;
+        //! Engines, which can execute instructions
+        enum ExecutionEngine {
+            ENGINE_CLASSIC, //!< virtual call on DecodedInstruction, reference implementation
+            ENGINE_DIRECT,  //!< direct dispatch over the flat DispatchRecord table in AvrFlash
+            ENGINE_BLOCK,   //!< translated blocks with superinstructions, see BlockCache
+            ENGINE_JIT      //!< like ENGINE_BLOCK, hot blocks are compiled to native code, see JitCompiler
+        };
+
+    protected:
+        ExecutionEngine engine; //!< selected engine, tracing uses always ENGINE_CLASSIC
+        JitCompiler *jit;       //!< native code generator for ENGINE_JIT or NULL
+
+        //! Executes translated blocks from PC on, called by Step on a instruction boundary
+        /*! Runs ahead as long as SystemClock allows it and no breakpoint,
+          exitpoint or irq entry needs Step. ICACHE must be true, if cache_insn is set.
+          \return false, if nothing was executed, otherwise PC and cpuCycles are updated */
+        template<bool ICACHE> bool RunBlocks(bool &hwWait);
+        //! Returns index of first entry in block from index first on with breakpoint, exitpoint, profiling, loop exit or trace filter hook
+        unsigned int FindBreakInBlock(const TranslatedBlock *b, unsigned int first);
+
+        //! Processes one clock cycle of the core, see Step
+        /*! There is a variant for each combination of trace output (trace_on),
+          binary trace, instruction cache (cache_insn) and active dumpers in
+          DumpManager, so that the common case without all of them doesn't
+          check for them. */
+        template<bool TRACE, bool BTRACE, bool ICACHE, bool DUMP>
+        int StepCycle(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_ns);
+        typedef int (AvrDevice::*StepCycleFunc)(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_ns);
+        StepCycleFunc stepCycle;       //!< variant called by Step, StepCycleSwitch after UpdateStepCycle
+        StepCycleFunc activeStepCycle; //!< variant selected on last switch
+        //! Returns the StepCycle variant for trace_on, binaryTrace, cache_insn and dumpers
+        StepCycleFunc SelectStepCycle(void);
+        //! Selects a new StepCycle variant on the next instruction boundary
+        int StepCycleSwitch(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_ns);
+        //! Calls CpuCycle on all awake hardware in hwCycleList for one clock cycle
+        /*! If all hardware sleeps, it costs only the compare with hwWakeTime.
+          \return true, if a hardware holds the cpu */
+        bool CycleHardware(void);
+
+    public:
+        int trace_on; //!< trace output of core is enabled, use SetTraceOn to change it while simulation is running
+        int trace_request; //!< trace output is requested by SetTraceOn, trace_on is off outside of traceFilter
+        BinaryTraceWriter *binaryTrace; //!< binary trace of core or NULL, see StartBinaryTrace
+        FunctionProfiler *profiler; //!< function profiler or NULL, see EnableProfiler
+        CoverageCounter *coverage; //!< execution counters or NULL, see EnableCoverage
+        LoopCounter *loops; //!< loop bound measurement or NULL, see EnableLoopCounter
+        TraceFilter *traceFilter; //!< restricts trace output or NULL, see AddTraceFilter
         Breakpoints BP;
         Exitpoints EP;
         word PC;  ///< Next/current instruction index. Multiply by 2 to get an address. This will not be enough for ATmega2560
@@ -128,7 +269,10 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         int DebugRecentJumps[20];  ///< Addresses of last few 'call' and 'jump' executed. For debugging.
         int DebugRecentJumpsIndex;  ///< Index to address of the most recent jump
 
-        RWMemoryMember **rw;  ///< The whole memory: R0-R31, IO, Internal RAM.
+        /*! The whole memory: R0-R31, IO, Internal RAM. Registers and RAM are
+          stored in a flat byte array, the entry is NULL for such a address,
+          if there is no hook on it, see EnableDataMemHooks. */
+        RWMemoryMember **rw;
 
         HWStack *stack;
         HWSreg *status;           //!< the status register itself
@@ -152,21 +296,69 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         void AddToCycleList(Hardware *hw);
 
         //! Removes from the cycle list, if possible.
-        /*! Does nothing if the part is not in the cycle list. */
+        /*! Does nothing if the part is not in the cycle list. It's safe to
+          call this from CpuCycle. */
         void RemoveFromCycleList(Hardware *hw);
 
+        //! Stops calling hw->CpuCycle until simulation time reaches t
+        /*! Use this, if it's known, that nothing will happen on the next
+          cycles, for example while waiting for a timeout. The hardware keeps
+          its place in the cycle list. AddToCycleList wakes up earlier, so all
+          events, which change the time of the next action, have to call it,
+          RemoveFromCycleList cancels the sleep. CpuCycle must handle an early
+          wake up, SetClockFreq for example wakes up all sleeping hardware. */
+        void SleepHardwareUntil(Hardware *hw, SystemClockOffset t);
+
+        //! Wakes up all sleeping hardware, see SleepHardwareUntil
+        void WakeAllHardware(void);
+
+        //! Count of clock cycles, which are processed by hardware since start
+        unsigned long long GetHardwareCycles(void) const { return hwCycles; }
+
         void Load(const char* n); //!< Load flash, eeprom, signature, fuses from elf file, wrapper for LoadBFD or LoadSimpleELF
         void ReplaceIoRegister(unsigned int offset, RWMemoryMember *);
         bool ReplaceMemRegister(unsigned int offset, RWMemoryMember *);
+        //! Get memory member on offset, NULL for registers and RAM without hook
         RWMemoryMember *GetMemRegisterInstance(unsigned int offset);
         void RegisterTerminationSymbol(const char *symbol);
 
         Pin *GetPin(const char *name);
         /*! Steps the AVR core.
+          Called by SystemClock inside Endless, Run or RunTimeRange, it
+          processes also the following cycles up to the next event of a other
+          simulation member, see SystemClock::CanRunAhead. The result is the
+          same as if called for each cycle.
           \param untilCoreStepFinished iff true, steps a core step and not a
           single clock cycle. */
         int Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_ns =0);
         void Reset();
+        //! Switches trace output of core on or off, takes effect on next instruction boundary
+        void SetTraceOn(int on);
+        //! Writes a binary trace of this core to filename, see BinaryTraceWriter
+        /*! Header is written immediately with the current core state, records
+          start on next instruction boundary. */
+        void StartBinaryTrace(const std::string &filename);
+        //! Stops and closes binary trace, if one is running
+        void StopBinaryTrace(void);
+        //! Measures execution times of all called functions, printed at end of simulation
+        /*! With irqAware the report contains also times without interrupts
+          and the preemptions by each interrupt, see FunctionProfiler */
+        void EnableProfiler(bool irqAware = false);
+        //! Counts executions of each instruction and branch, see CoverageCounter
+        void EnableCoverage(const std::string &lcovFilename);
+        //! Writes lcov file and stops counting, if coverage is enabled
+        void StopCoverage(void);
+        //! Measures iterations of all loops, see LoopCounter
+        void EnableLoopCounter(const std::string &filename);
+        //! Writes loop bounds and stops measurement, if it's enabled
+        void StopLoopCounter(void);
+        //! Restricts trace output to the parts of the run selected by filter spec
+        /*! Several filters enable trace output, if one of them is on, see TraceFilter */
+        void AddTraceFilter(const std::string &spec);
+        //! Has to be called after a change of trace_on, cache_insn or the dumpers in DumpManager
+        /*! The StepCycle variant for the new configuration is selected on
+          next instruction boundary. */
+        void UpdateStepCycle(void) { stepCycle = &AvrDevice::StepCycleSwitch; }
         void SetClockFreq(SystemClockOffset f);
         SystemClockOffset GetClockFreq();
 
@@ -177,8 +369,24 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         //! Clear all breakpoints in device
         void DeleteAllBreakpoints(void);
 
+        //! Returns PCFLAG_* set on flash word address pc, 0 if pc is outside of flash
+        unsigned char GetPCFlags(unsigned int pc) const { return (pc < pcFlags.size()) ? pcFlags[pc] : 0; }
+        //! Sets PCFLAG_WATCH or PCFLAG_PROFILE on flash word address pc
+        /*! Breakpoints and exitpoints are set by BP and EP. */
+        void SetPCFlag(unsigned int pc, unsigned char flag);
+        //! Clears PCFLAG_WATCH or PCFLAG_PROFILE on flash word address pc
+        void ClearPCFlag(unsigned int pc, unsigned char flag);
+
+        //! Select engine to execute instructions, cycle counts are the same on all engines
+        /*! If ENGINE_JIT isn't supported on this host, ENGINE_BLOCK is used */
+        void SetExecutionEngine(ExecutionEngine e);
+        //! Get selected engine to execute instructions
+        ExecutionEngine GetExecutionEngine(void) { return engine; }
+
         //! Return filename from loaded program
         const std::string &GetFname(void) { return actualFilename; }
+        //! Set filename of program for trace output, if it isn't loaded by Load
+        void SetFname(const std::string &fname) { actualFilename = fname; }
         //! Return device name
         const std::string &GetDeviceName(void) { return devName; }
         //! Return device signature
@@ -197,14 +405,69 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         //! Get configured external RAM size
         unsigned int GetMemERamSize(void) { return eRamSize; }
 
+        //! Route accesses on registers and RAM from first to last over hooks
+        /*! Registers and RAM are stored in a flat byte array and accessed
+          directly. For tracing and read-before-write checks (WarnUnknown) a
+          access has to go over a RAM hook, which informs the TraceValue of
+          this byte. DumpManager::addDumper does this for all traced values,
+          this method is for all other cases. Addresses in IO space and
+          addresses, which have already a hook, are skipped. Own hooks, for
+          example as watchpoint, can be set by ReplaceMemRegister.
+
+          Set hooks on registers before simulation starts, JitCompiler
+          checks them only on compiling a block. */
+        void EnableDataMemHooks(unsigned first, unsigned last);
+        //! Get TraceValue of a register or RAM byte, NULL for all other addresses
+        /*! The TraceValue is created, if it doesn't exist yet */
+        TraceValue *GetDataMemTraceValue(unsigned addr);
+        //! Get flat array with registers and RAM, indexed by data address
+        unsigned char *GetDataMem(void) { return dataMem; }
+
         //! Get a value of RW memory cell
-        unsigned char GetRWMem(unsigned addr);
+        unsigned char GetRWMem(unsigned addr) {
+            if((addr < dataMemSize) && (rw[addr] == NULL))
+                return dataMem[addr];
+            return GetRWMemHooked(addr);
+        }
         //! Set a value to RW memory cell
-        bool SetRWMem(unsigned addr, unsigned char val);
+        bool SetRWMem(unsigned addr, unsigned char val) {
+            if((addr < dataMemSize) && (rw[addr] == NULL)) {
+                dataMem[addr] = val;
+                return true;
+            }
+            return SetRWMemHooked(addr, val);
+        }
         //! Get a value from core register
-        unsigned char GetCoreReg(unsigned addr);
+        unsigned char GetCoreReg(unsigned addr) {
+            assert(addr < registerSpaceSize);
+            if(rw[addr] == NULL)
+                return dataMem[addr];
+            return GetRWMemHooked(addr);
+        }
         //! Set a value to core register
-        bool SetCoreReg(unsigned addr, unsigned char val);
+        bool SetCoreReg(unsigned addr, unsigned char val) {
+            assert(addr < registerSpaceSize);
+            if(rw[addr] == NULL) {
+                dataMem[addr] = val;
+                return true;
+            }
+            return SetRWMemHooked(addr, val);
+        }
+        //! Wait states of the data cache for a access on a data address
+        /*! Returns 0, if there is no cache_data. Registers, IO space and
+            addresses behind data memory are not cached, RAM is mapped to
+            0x800000 + addr in the cache like avr-gcc does. */
+        int DataCacheAccess(unsigned addr, unsigned char len, bool write) {
+            return (cache_data == NULL) ? 0 : DataCacheAccessHooked(addr, len, write);
+        }
+        //! Wait states of the data cache for a flash byte read by LPM or ELPM
+        int FlashCacheAccess(unsigned addr) {
+            return (cache_data == NULL) ? 0 : FlashCacheAccessHooked(addr);
+        }
+        //! Wait states of the data cache for len bytes, which was pushed or popped just before
+        int StackCacheAccess(unsigned char len, bool write) {
+            return (cache_data == NULL) ? 0 : StackCacheAccessHooked(len, write);
+        }
         //! Get a value from IO register (without offset of 0x20!)
         unsigned char GetIOReg(unsigned addr);
         //! Set a value to IO register (without offset of 0x20!)
@@ -216,11 +479,11 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
             bit will be set to 1 */
         bool SetIORegBit(unsigned addr, unsigned bitaddr, bool val);
         //! Get value of X register (16bit)
-        unsigned GetRegX(void);
+        unsigned GetRegX(void) { return (GetCoreReg(27) << 8) + GetCoreReg(26); }
         //! Get value of Y register (16bit)
-        unsigned GetRegY(void);
+        unsigned GetRegY(void) { return (GetCoreReg(29) << 8) + GetCoreReg(28); }
         //! Get value of Z register (16bit)
-        unsigned GetRegZ(void);
+        unsigned GetRegZ(void) { return (GetCoreReg(31) << 8) + GetCoreReg(30); }
 
         //! When a call/jump/cond-jump instruction was executed. For debugging.
         void DebugOnJump();
@@ -42,6 +42,7 @@
 
 #include "avrerror.h"
 #include "helper.h"
+#include "tracewriter.h"
 
 /* for preprocessor symbol HAVE_SYS_MINGW */
 #include "config.h"
@@ -57,6 +58,11 @@ SystemConsoleHandler::SystemConsoleHandler() {
     wrnStream = &std::cerr;
     traceStream = nullStream;
     traceEnabled = false;
+    traceToFile = false;
+    traceAsync = false;
+    traceDropOnFull = false;
+    traceRingSize = 1 << 20;
+    traceWriter = NULL;
 }
 
 SystemConsoleHandler::~SystemConsoleHandler() {
@@ -86,12 +92,23 @@ void SystemConsoleHandler::SetTraceFileOrStream(const char *name, unsigned long
     }
 }
 
+void SystemConsoleHandler::SetTraceAsync(bool async, bool dropOnFull, unsigned int ringSize) {
+    traceAsync = async;
+    traceDropOnFull = dropOnFull;
+    traceRingSize = ringSize;
+}
+
 void SystemConsoleHandler::SetTraceFile(const char *name, unsigned long long maxlines) {
     StopTrace();
-    std::ofstream* os = new std::ofstream();
-    os->open(name);
+    if(traceAsync) {
+        traceWriter = new AsyncTraceWriter(name, maxlines, traceRingSize, traceDropOnFull);
+        traceStream = new std::ostream(traceWriter);
+    } else {
+        std::ofstream* os = new std::ofstream();
+        os->open(name);
+        traceStream = os;
+    }
     traceFilename = name;
-    traceStream = os;
     traceFileCount = 1;
     traceLinesOnFile = maxlines;
     traceLines = 0;
@@ -109,6 +126,22 @@ void SystemConsoleHandler::SetTraceStream(std::ostream *s) {
 void SystemConsoleHandler::StopTrace(void) {
     if(!traceEnabled)
         return;
+    if(traceToFile && (traceWriter != NULL)) {
+        delete traceStream;
+        AsyncTraceWriter *w = traceWriter;
+        traceWriter = NULL;
+        traceStream = nullStream;
+        traceEnabled = false;
+        w->Finish();
+        unsigned long long dropped = w->GetDropped();
+        std::string failed = w->GetFailedFile();
+        delete w;
+        if(dropped)
+            avr_warning("%llu trace lines dropped, writer thread couldn't follow", dropped);
+        if(!failed.empty())
+            avr_warning("can't open trace file '%s'", failed.c_str());
+        return;
+    }
     if(traceToFile)
         ((std::ofstream *)traceStream)->close();
     traceStream = nullStream;
@@ -116,8 +149,8 @@ void SystemConsoleHandler::StopTrace(void) {
 }
 
 void SystemConsoleHandler::TraceNextLine(void) {
-    if(!traceEnabled || !traceToFile)
-        return;
+    if(!traceEnabled || !traceToFile || (traceWriter != NULL))
+        return; // lines and file rotation are done by writer thread
 
     traceLines++;
     if( ( traceLinesOnFile ) && ( traceLines >= traceLinesOnFile)) {
@@ -28,6 +28,8 @@
 
 #include <iostream>
 
+class AsyncTraceWriter;
+
 #if defined(_MSC_VER) && !defined(SWIG)
 #define ATTRIBUTE_NORETURN __declspec(noreturn)
 #define ATTRIBUTE_PRINTF(string_arg, first_arg)
@@ -61,6 +63,10 @@ class SystemConsoleHandler {
         void SetWarningStream(std::ostream *s);
 
         void SetTraceFileOrStream(const char *name, unsigned long long maxlines = 0);
+        //! Selects, if following SetTraceFile calls write from a background thread
+        /*! See AsyncTraceWriter. If dropOnFull is set, trace lines are dropped,
+          if the writer thread can't follow, otherwise simulation waits. */
+        void SetTraceAsync(bool async, bool dropOnFull = false, unsigned int ringSize = 1 << 20);
         //! Sets the trace to file stream and enables tracing global
         void SetTraceFile(const char *name, unsigned long long maxlines = 0);
         std::string GetTraceFileName(void) const { return traceFilename; }
@@ -74,6 +80,8 @@ class SystemConsoleHandler {
         std::ostream &traceOutStream(void) { return *traceStream; }
         //! Ends a trace line, performs reopen new filestream, if necessary
         void TraceNextLine(void);
+        //! Writer for trace file or NULL, if trace output is formatted by the simulation
+        AsyncTraceWriter *GetTraceWriter(void) { return traceWriter; }
 
         //! Format and send a message to message stream (default stdout)
         void vfmessage(const char *fmt, ...)
@@ -110,6 +118,10 @@ class SystemConsoleHandler {
         unsigned long long traceLinesOnFile; //!< how much lines will be written on one trace file 0->means endless
         unsigned long long traceLines; //!< how much lines are written on current trace file
         int traceFileCount; //!< Counter for trace files
+        bool traceAsync; //!< flag, true if trace files are written by a AsyncTraceWriter
+        bool traceDropOnFull; //!< flag for AsyncTraceWriter, drop lines on full ring buffer
+        unsigned int traceRingSize; //!< size of ring buffer for AsyncTraceWriter
+        AsyncTraceWriter *traceWriter; //!< writer for trace file or NULL, if written synchronously
 
         //! Creates the format string for formatting a message
         char *getFormatString(const char *prefix, const char *file, int line, const char *fmtstr);
@@ -57,7 +57,20 @@ AvrDevice* AvrFactory::makeDevice(const char *in) {
     if(i == devmap.end())
         avr_error("Invalid device specification: %s", in);
 
-    return devmap[devname]();
+    cachesConfigured.clear();
+    AvrDevice *dev = devmap[devname]();
+    for(unsigned int k = 0; k < cacheOptions.size(); k++) {
+        string cache = cacheOptions[k].substr(0, cacheOptions[k].find(':'));
+        if(cachesConfigured.find(cache) == cachesConfigured.end())
+            avr_error("cache option '%s': device %s has no cache '%s'",
+                      cacheOptions[k].c_str(), in, cache.c_str());
+    }
+    return dev;
+}
+
+const std::vector<std::string> &AvrFactory::GetCacheOptions(const std::string &cache) {
+    cachesConfigured.insert(cache);
+    return cacheOptions;
 }
 
 std::string AvrFactory::supportedDevices() {
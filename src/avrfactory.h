@@ -28,6 +28,8 @@
 #define AVRFACTORY
 
 #include <string>
+#include <vector>
+#include <set>
 
 class AvrDevice;
 
@@ -57,11 +59,20 @@ class AvrFactory {
         //! Register a creation static method with the factory
         static void reg(const std::string name,
                         AvrDeviceCreator create);
+
+        //! Adds a cache option "<cache>:<key>=<value>[,...]" for the next devices
+        /*! Options are applied in the given order, see CacheConfig::Apply */
+        void AddCacheOption(const std::string &option) { cacheOptions.push_back(option); }
+        //! Gets the cache options, called by a device for each cache it creates
+        const std::vector<std::string> &GetCacheOptions(const std::string &cache);
         
     private:
         AvrFactory() {}
         //! map of registered AVR devices
         std::map<std::string, AvrFactory::AvrDeviceCreator> devmap;
+        std::vector<std::string> cacheOptions;
+        //! caches, for which the device in construction got the options
+        std::set<std::string> cachesConfigured;
 };
 
 /*! Macro to be used to register an AVR device with the AvrFactory.
@@ -31,8 +31,11 @@
 #include "elfio/elfio.hpp"
 
 #include <string>
+#include <sstream>
+#include <vector>
 #include <map>
 #include <limits>
+#include <stdlib.h>
 
 #include "avrdevice_impl.h"
 
@@ -135,6 +138,303 @@ unsigned int ELFGetSignature(const char *filename) {
 
 #ifndef _MSC_VER
 
+//! Reads DWARF data from a section, all reads are checked against end of section
+class DwarfReader {
+
+    public:
+        DwarfReader(const unsigned char *d, size_t s): pos(0), error(false), data(d), size(s) {}
+
+        size_t pos;   //!< read position
+        bool error;   //!< true, if a read was beyond end of data
+
+        bool AtEnd(void) const { return error || (pos >= size); }
+
+        unsigned long long Fixed(unsigned int bytes) {
+            unsigned long long v = 0;
+            if(pos + bytes > size) {
+                error = true;
+                pos = size;
+                return 0;
+            }
+            for(unsigned int i = 0; i < bytes; i++)
+                v |= (unsigned long long)data[pos++] << (8 * i); // AVR is little endian
+            return v;
+        }
+
+        unsigned long long ULEB128(void) {
+            unsigned long long v = 0;
+            unsigned int shift = 0;
+            unsigned char b;
+            do {
+                b = (unsigned char)Fixed(1);
+                if(shift < 64)
+                    v |= (unsigned long long)(b & 0x7f) << shift;
+                shift += 7;
+            } while((b & 0x80) && !error);
+            return v;
+        }
+
+        long long SLEB128(void) {
+            long long v = 0;
+            unsigned int shift = 0;
+            unsigned char b;
+            do {
+                b = (unsigned char)Fixed(1);
+                if(shift < 64)
+                    v |= (long long)(b & 0x7f) << shift;
+                shift += 7;
+            } while((b & 0x80) && !error);
+            if((shift < 64) && (b & 0x40))
+                v |= -(1LL << shift);
+            return v;
+        }
+
+        std::string String(void) {
+            std::string s;
+            while(!AtEnd() && (data[pos] != 0))
+                s += (char)data[pos++];
+            Fixed(1);
+            return s;
+        }
+
+        //! Returns string at offset in this section
+        std::string StringAt(unsigned long long offset) const {
+            std::string s;
+            for(size_t i = offset; (i < size) && (data[i] != 0); i++)
+                s += (char)data[i];
+            return s;
+        }
+
+    private:
+        const unsigned char *data;
+        size_t size;
+};
+
+//! Returns a reader for a section, which reads nothing, if the section doesn't exist
+static DwarfReader ELFSectionReader(ELFIO::elfio &reader, const std::string &name) {
+    ELFIO::section *sec = reader.sections[name];
+    if((sec == NULL) || (sec->get_data() == NULL))
+        return DwarfReader(NULL, 0);
+    return DwarfReader((const unsigned char *)sec->get_data(), sec->get_size());
+}
+
+//! Reads a attribute of a DWARF 5 directory or file entry, returns a string or the number as string
+static std::string DwarfLineAttribute(DwarfReader &r, unsigned long long form, bool dwarf64,
+                                      const DwarfReader &str, const DwarfReader &lineStr) {
+    std::ostringstream os;
+    switch(form) {
+        case 0x08: // DW_FORM_string
+            return r.String();
+        case 0x0e: // DW_FORM_strp
+            return str.StringAt(r.Fixed(dwarf64 ? 8 : 4));
+        case 0x1f: // DW_FORM_line_strp
+            return lineStr.StringAt(r.Fixed(dwarf64 ? 8 : 4));
+        case 0x0b: // DW_FORM_data1
+            os << r.Fixed(1);
+            break;
+        case 0x05: // DW_FORM_data2
+            os << r.Fixed(2);
+            break;
+        case 0x06: // DW_FORM_data4
+            os << r.Fixed(4);
+            break;
+        case 0x07: // DW_FORM_data8
+            os << r.Fixed(8);
+            break;
+        case 0x0f: // DW_FORM_udata
+            os << r.ULEB128();
+            break;
+        case 0x1e: // DW_FORM_data16, MD5
+            r.Fixed(8);
+            r.Fixed(8);
+            break;
+        case 0x09: { // DW_FORM_block
+                unsigned long long n = r.ULEB128();
+                for(unsigned long long i = 0; (i < n) && !r.AtEnd(); i++)
+                    r.Fixed(1);
+            }
+            break;
+        default:
+            r.error = true; // unknown form, can't skip it
+            break;
+    }
+    return os.str();
+}
+
+//! Joins directory and file name of a DWARF line table
+static std::string DwarfPath(const std::string &dir, const std::string &file) {
+    if(dir.empty() || file.empty() || (file[0] == '/'))
+        return file;
+    if(dir[dir.size() - 1] == '/')
+        return dir + file;
+    return dir + "/" + file;
+}
+
+/*! Reads .debug_line (DWARF version 2 to 5) and adds source lines of code in
+  flash to core->Flash. Only the file name and line of each row is used.
+  \return false, if line info is truncated or invalid */
+static bool ELFLoadLineInfo(ELFIO::elfio &reader, const AvrDevice *core) {
+    DwarfReader r = ELFSectionReader(reader, ".debug_line");
+    DwarfReader str = ELFSectionReader(reader, ".debug_str");
+    DwarfReader lineStr = ELFSectionReader(reader, ".debug_line_str");
+
+    while(!r.AtEnd()) {
+        // header of line number program
+        bool dwarf64 = false;
+        unsigned long long length = r.Fixed(4);
+        if(length == 0xffffffff) {
+            dwarf64 = true;
+            length = r.Fixed(8);
+        }
+        size_t end = r.pos + length;
+        unsigned int version = r.Fixed(2);
+        if((version < 2) || (version > 5)) {
+            avr_warning("DWARF line info version %u isn't supported", version);
+            return true;
+        }
+        if(version >= 5)
+            r.Fixed(2); // address_size, segment_selector_size
+        unsigned long long headerLength = r.Fixed(dwarf64 ? 8 : 4);
+        size_t program = r.pos + headerLength;
+        unsigned int minInsnLength = r.Fixed(1);
+        if(version >= 4)
+            r.Fixed(1); // maximum_operations_per_instruction, always 1 for AVR
+        bool defaultIsStmt = r.Fixed(1) != 0;
+        int lineBase = (signed char)r.Fixed(1);
+        unsigned int lineRange = r.Fixed(1);
+        unsigned int opcodeBase = r.Fixed(1);
+        std::vector<unsigned int> opcodeLengths(opcodeBase, 0);
+        for(unsigned int i = 1; i < opcodeBase; i++)
+            opcodeLengths[i] = r.Fixed(1);
+        if(lineRange == 0)
+            r.error = true;
+
+        // directories and files, file index 1 is first file before version 5
+        std::vector<std::string> dirs;
+        std::vector<std::string> files;
+        if(version < 5) {
+            dirs.push_back("");
+            files.push_back("");
+            for(std::string d = r.String(); !d.empty() && !r.AtEnd(); d = r.String())
+                dirs.push_back(d);
+            for(std::string f = r.String(); !f.empty() && !r.AtEnd(); f = r.String()) {
+                unsigned long long dir = r.ULEB128();
+                r.ULEB128(); // modification time
+                r.ULEB128(); // length
+                files.push_back(DwarfPath((dir < dirs.size()) ? dirs[dir] : "", f));
+            }
+        } else {
+            for(int table = 0; table < 2; table++) {
+                std::vector<std::pair<unsigned long long, unsigned long long> > format(r.Fixed(1));
+                for(size_t i = 0; i < format.size(); i++) {
+                    format[i].first = r.ULEB128();  // content type
+                    format[i].second = r.ULEB128(); // form
+                }
+                unsigned long long count = r.ULEB128();
+                for(unsigned long long n = 0; (n < count) && !r.AtEnd(); n++) {
+                    std::string path;
+                    unsigned long long dir = 0;
+                    for(size_t i = 0; i < format.size(); i++) {
+                        std::string v = DwarfLineAttribute(r, format[i].second, dwarf64, str, lineStr);
+                        if(format[i].first == 1) // DW_LNCT_path
+                            path = v;
+                        else if(format[i].first == 2) // DW_LNCT_directory_index
+                            dir = strtoull(v.c_str(), NULL, 10);
+                    }
+                    if(table == 0)
+                        dirs.push_back(path);
+                    else
+                        files.push_back(DwarfPath((dir < dirs.size()) ? dirs[dir] : "", path));
+                }
+            }
+        }
+        if(r.error)
+            break;
+
+        // line number program
+        r.pos = program;
+        std::vector<int> fileIndex(files.size(), -2); // index in Flash->sourceFiles, -2 if not added
+        unsigned long long address = 0;
+        unsigned int file = 1;
+        unsigned long long line = 1;
+        bool isStmt = defaultIsStmt;
+        while((r.pos < end) && !r.AtEnd()) {
+            unsigned int opcode = r.Fixed(1);
+            bool row = false, endSequence = false;
+            if(opcode >= opcodeBase) {
+                // special opcode
+                unsigned int adjusted = opcode - opcodeBase;
+                address += (adjusted / lineRange) * minInsnLength;
+                line += lineBase + (int)(adjusted % lineRange);
+                row = true;
+            } else if(opcode == 0) {
+                // extended opcode
+                unsigned long long len = r.ULEB128();
+                size_t next = r.pos + len;
+                unsigned int sub = (len > 0) ? r.Fixed(1) : 0;
+                if(sub == 1) { // DW_LNE_end_sequence
+                    row = true;
+                    endSequence = true;
+                } else if(sub == 2) // DW_LNE_set_address
+                    address = r.Fixed(len - 1);
+                else if(sub == 3) { // DW_LNE_define_file
+                    std::string f = r.String();
+                    unsigned long long dir = r.ULEB128();
+                    files.push_back(DwarfPath((dir < dirs.size()) ? dirs[dir] : "", f));
+                    fileIndex.push_back(-2);
+                }
+                r.pos = next;
+            } else {
+                switch(opcode) {
+                    case 1: // DW_LNS_copy
+                        row = true;
+                        break;
+                    case 2: // DW_LNS_advance_pc
+                        address += r.ULEB128() * minInsnLength;
+                        break;
+                    case 3: // DW_LNS_advance_line
+                        line += r.SLEB128();
+                        break;
+                    case 4: // DW_LNS_set_file
+                        file = r.ULEB128();
+                        break;
+                    case 6: // DW_LNS_negate_stmt
+                        isStmt = !isStmt;
+                        break;
+                    case 8: // DW_LNS_const_add_pc
+                        address += ((255 - opcodeBase) / lineRange) * minInsnLength;
+                        break;
+                    case 9: // DW_LNS_fixed_advance_pc
+                        address += r.Fixed(2);
+                        break;
+                    default: // DW_LNS_set_column and others without effect on address and line
+                        for(unsigned int i = 0; i < opcodeLengths[opcode]; i++)
+                            r.ULEB128();
+                        break;
+                }
+            }
+
+            if(row && (address < 0x800000) && (endSequence || isStmt)) {
+                if(endSequence)
+                    core->Flash->AddSourceLine(address >> 1, -1, 0);
+                else if(file < files.size()) {
+                    if(fileIndex[file] == -2)
+                        fileIndex[file] = core->Flash->AddSourceFile(files[file]);
+                    core->Flash->AddSourceLine(address >> 1, fileIndex[file], line);
+                }
+            }
+            if(endSequence) {
+                address = 0;
+                file = 1;
+                line = 1;
+                isStmt = defaultIsStmt;
+            }
+        }
+        r.pos = end;
+    }
+    return !r.error;
+}
+
 void ELFLoad(const AvrDevice * core) {
     ELFIO::elfio reader;
 
@@ -213,6 +513,10 @@ void ELFLoad(const AvrDevice * core) {
         }
     }
 
+    // source lines of code for coverage and profiling
+    if(!ELFLoadLineInfo(reader, core))
+        avr_warning("DWARF line info in '%s' is truncated or invalid", core->actualFilename.c_str());
+
     // load program, data and - if available - eeprom, fuses and signature
     ELFIO::Elf_Half seg_num = reader.segments.size();
 
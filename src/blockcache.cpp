@@ -0,0 +1,175 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include "blockcache.h"
+#include "avrdevice.h"
+#include "flash.h"
+
+using namespace std;
+
+/* opcode classification, see lookup_opcode in decoder.cpp for the encodings */
+
+static bool IsControlFlow(word op) {
+    if((op & 0xE000) == 0xC000)            // RJMP, RCALL
+        return true;
+    if((op & 0xF000) == 0xF000)            // BRBS, BRBC, SBRC, SBRS but not BLD, BST
+        return (op & 0x0C00) != 0x0800;
+    if((op & 0xFC00) == 0x1000)            // CPSE
+        return true;
+    if((op & 0xFD00) == 0x9900)            // SBIC, SBIS
+        return true;
+    if((op & 0xFE0C) == 0x940C)            // JMP, CALL
+        return true;
+    switch(op) {
+        case 0x9409:                       // IJMP
+        case 0x9419:                       // EIJMP
+        case 0x9509:                       // ICALL
+        case 0x9519:                       // EICALL
+        case 0x9508:                       // RET
+        case 0x9518:                       // RETI
+        case 0x9588:                       // SLEEP
+        case 0x9598:                       // BREAK
+        case 0x95E8:                       // SPM
+        case 0x95F8:                       // ESPM
+            return true;
+    }
+    return false;
+}
+
+static bool IsBranch(word op) { return (op & 0xF800) == 0xF000; }           // BRBS, BRBC
+static bool IsCompareLow(word op) {
+    return ((op & 0xFC00) == 0x1400) ||                                      // CP
+           ((op & 0xF000) == 0x3000) ||                                      // CPI
+           ((op & 0xF000) == 0x5000);                                        // SUBI
+}
+static bool IsCompareHigh(word op) {
+    return ((op & 0xFC00) == 0x0400) ||                                      // CPC
+           ((op & 0xF000) == 0x4000);                                        // SBCI
+}
+static bool IsLDI(word op) { return (op & 0xF000) == 0xE000; }
+static bool IsLoopCounter(word op) {
+    return ((op & 0xFE00) == 0x9600) ||                                      // ADIW, SBIW
+           ((op & 0xFE0F) == 0x940A);                                        // DEC
+}
+
+//! cpu cycles of a instruction, which can be fused and is not the last one
+static unsigned int FusedCycles(word op) {
+    return ((op & 0xFE00) == 0x9600) ? 2 : 1;                                // ADIW, SBIW or other
+}
+
+BlockCache::BlockCache(AvrFlash *f, unsigned int words):
+    flash(f),
+    blocks(words, (TranslatedBlock *)NULL),
+    count(0),
+    generation(0) {}
+
+BlockCache::~BlockCache() {
+    for(unsigned int i = 0; i < blocks.size(); i++)
+        delete blocks[i];
+}
+
+void BlockCache::Invalidate(unsigned int pc) {
+    if(count == 0)
+        return;
+    unsigned int s = (pc >= 2 * maxBlockSize) ? pc - 2 * maxBlockSize + 1 : 0;
+    for(; s <= pc && s < blocks.size(); s++) {
+        TranslatedBlock *b = blocks[s];
+        if((b != NULL) && b->Contains(pc)) {
+            if(b->jitBytes != 0)
+                flash->core->jit->Release(b);
+            delete b;
+            blocks[s] = NULL;
+            count--;
+            generation++;
+        }
+    }
+}
+
+void BlockCache::DropNativeCode(void) {
+    for(unsigned int s = 0; s < blocks.size(); s++) {
+        TranslatedBlock *b = blocks[s];
+        if((b == NULL) || (b->jitBytes == 0))
+            continue;
+        for(unsigned int i = 0; i < b->entries.size(); i++)
+            b->entries[i].jit = NULL;
+        b->jitBytes = 0;
+        b->hits = 0;
+    }
+}
+
+TranslatedBlock *BlockCache::Translate(unsigned int pc) {
+    TranslatedBlock *b = new TranslatedBlock(pc);
+    vector<word> opcodes;
+    unsigned int words = blocks.size();
+
+    while((b->entries.size() < maxBlockSize) && (b->end < words)) {
+        const DispatchRecord &rec = flash->DispatchAt(b->end);
+        unsigned int n = rec.insn->IsInstruction2Words() ? 2 : 1;
+        if(b->end + n > words)
+            break;
+        word op = flash->ReadMemRawWord(b->end * 2);
+
+        BlockEntry e;
+        e.rec = rec;
+        e.pc = b->end;
+        e.fuse = 1;
+        e.span = 0;
+        e.jit = NULL;
+        e.jitLen = 0;
+        e.jitCycles = 0;
+        b->entries.push_back(e);
+        opcodes.push_back(op);
+        b->end += n;
+
+        if(IsControlFlow(op))
+            break;
+    }
+
+    // find superinstructions
+    for(unsigned int i = 0; i < opcodes.size(); ) {
+        unsigned int n = 1;
+        if(IsCompareLow(opcodes[i])) {
+            while((i + n < opcodes.size()) && (n < 4) && IsCompareHigh(opcodes[i + n]))
+                n++;
+            if((i + n < opcodes.size()) && IsBranch(opcodes[i + n]))
+                n++;
+        } else if(IsLoopCounter(opcodes[i])) {
+            if((i + 1 < opcodes.size()) && IsBranch(opcodes[i + 1]))
+                n++;
+        } else if(IsLDI(opcodes[i])) {
+            while((i + n < opcodes.size()) && (n < 4) && IsLDI(opcodes[i + n]))
+                n++;
+        }
+        b->entries[i].fuse = n;
+        for(unsigned int k = 0; k < n - 1; k++)
+            b->entries[i].span += FusedCycles(opcodes[i + k]);
+        i += n;
+    }
+
+    blocks[pc] = b;
+    count++;
+    return b;
+}
+
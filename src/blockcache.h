@@ -0,0 +1,111 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef BLOCKCACHE
+#define BLOCKCACHE
+
+#include <vector>
+
+#include "decoder.h"
+#include "jit.h"
+
+class AvrFlash;
+
+//! One instruction inside a translated block
+struct BlockEntry {
+    DispatchRecord rec;  //!< copy of the dispatch record from flash
+    unsigned int pc;     //!< word address of this instruction
+    /*! Count of instructions of a superinstruction, which starts here, 1 if
+      this instruction isn't fused with the following ones */
+    unsigned char fuse;
+    //! Count of cpu cycles from start of superinstruction to its last instruction
+    unsigned char span;
+    //! Native code for the first jitLen instructions of the superinstruction or NULL
+    JitFunction jit;
+    unsigned char jitLen;     //!< count of instructions done by jit
+    unsigned char jitCycles;  //!< cpu cycles used by jit
+};
+
+//! Straight-line sequence of instructions, ends with the first control flow instruction
+class TranslatedBlock {
+
+    public:
+        unsigned int start;  //!< word address of first instruction
+        unsigned int end;    //!< word address behind last instruction
+        std::vector<BlockEntry> entries;  //!< instructions of this block
+        unsigned int hits;   //!< count of executions, used to find hot blocks for JitCompiler
+        unsigned int jitBytes;  //!< size of native code of all entries, see JitCompiler
+
+        TranslatedBlock(unsigned int s): start(s), end(s), hits(0), jitBytes(0) {}
+
+        //! Returns true, if word address pc is covered by this block
+        bool Contains(unsigned int pc) const { return (pc >= start) && (pc < end); }
+};
+
+//! Translation cache for basic blocks, keyed by flash word address
+/*! Blocks are translated on first use from the dispatch table in AvrFlash.
+  Short sequences like CP/CPC/BRxx, LDI/LDI or ADIW/SBIW/DEC with a following
+  branch are marked as superinstruction. The core can execute such a sequence
+  in one go, if no interrupt can be raised in between, see AvrDevice::RunBlocks.
+  AvrFlash::Decode(addr) invalidates all blocks, which contain addr. */
+class BlockCache {
+
+    public:
+        //! Maximum count of instructions in one block
+        static const unsigned int maxBlockSize = 32;
+
+        BlockCache(AvrFlash *f, unsigned int words);
+        ~BlockCache();
+
+        //! Returns block, which starts at word address pc, translates it on first use
+        TranslatedBlock *Lookup(unsigned int pc) {
+            TranslatedBlock *b = blocks[pc];
+            if(b == NULL)
+                b = Translate(pc);
+            return b;
+        }
+
+        //! Removes all blocks, which contain word address pc
+        /*! Native code of a removed block is given back to JitCompiler. */
+        void Invalidate(unsigned int pc);
+
+        //! Removes native code from all blocks, they can be compiled again, when they are hot
+        /*! Superinstructions stay as set by JitCompiler, they are executed by the interpreter. */
+        void DropNativeCode(void);
+
+        //! Changes on each invalidation of a block
+        /*! Used to detect, that flash was rewritten while executing a block */
+        unsigned long GetGeneration(void) const { return generation; }
+
+    private:
+        AvrFlash *flash;
+        std::vector<TranslatedBlock *> blocks;  //!< blocks by start address
+        unsigned int count;         //!< count of translated blocks
+        unsigned long generation;   //!< incremented on invalidation
+
+        TranslatedBlock *Translate(unsigned int pc);
+};
+
+#endif
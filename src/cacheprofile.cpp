@@ -0,0 +1,166 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <ctype.h>
+
+#include "cacheprofile.h"
+#include "avrdevice.h"
+#include "flash.h"
+#include "avrerror.h"
+
+using namespace std;
+
+//! data memory is mapped to this address in the data cache
+static const unsigned int DATA_SPACE = 0x800000;
+
+CacheProfile::CacheProfile(AvrDevice *c, unsigned int size, unsigned int sets):
+    core(c),
+    linesize(size),
+    nsets(sets)
+{
+    counts.resize(core->Flash->GetSize() / 2);
+}
+
+void CacheProfile::Counts::Add(const Counts &c) {
+    accesses += c.accesses;
+    misses += c.misses;
+    evictions += c.evictions;
+    writebacks += c.writebacks;
+}
+
+void CacheProfile::WriteLine(ostream &os, unsigned int line) {
+    const unsigned int addr = line * linesize;
+    os << "0x" << hex << addr << dec;
+    if (addr < DATA_SPACE) {
+        int id = core->Flash->GetSymbolId(addr / 2);
+        if (id >= 0) {
+            const FlashSymbol &f = core->Flash->GetSymbol(id);
+            os << " (" << f.last << "+0x" << hex << (addr - f.addr * 2) << dec << ")";
+        }
+    }
+}
+
+void CacheProfile::Write(ostream &os, const string &name) {
+    // sum up per symbol, id -1 for code without symbol
+    map<int, Counts> functions;
+    Counts total;
+    vector<pair<unsigned long, unsigned int> > pcs;
+    for (unsigned int pc = 0; pc < counts.size(); ++pc) {
+        const Counts &c = counts[pc];
+        if (c.accesses == 0)
+            continue;
+        functions[core->Flash->GetSymbolId(pc)].Add(c);
+        total.Add(c);
+        if (c.misses || c.evictions)
+            pcs.push_back(make_pair(c.misses, pc));
+    }
+
+    os << "# " << name << " profile of " << core->GetFname() << ", " << nsets << " sets of "
+       << linesize << " byte lines" << endl
+       << "# total: accesses " << total.accesses << ", misses " << total.misses
+       << ", evictions " << total.evictions << ", writebacks " << total.writebacks << endl;
+
+    vector<pair<unsigned long, int> > byMisses;
+    for (map<int, Counts>::const_iterator i = functions.begin(); i != functions.end(); ++i)
+        byMisses.push_back(make_pair(i->second.misses, i->first));
+    stable_sort(byMisses.begin(), byMisses.end(), greater<pair<unsigned long, int> >());
+    os << endl << "# per function: function accesses misses evictions writebacks" << endl;
+    for (size_t k = 0; k < byMisses.size(); ++k) {
+        const Counts &c = functions[byMisses[k].second];
+        os << (byMisses[k].second >= 0 ? core->Flash->GetSymbol(byMisses[k].second).last : string("-"))
+           << " " << c.accesses << " " << c.misses << " " << c.evictions << " " << c.writebacks << endl;
+    }
+
+    stable_sort(pcs.begin(), pcs.end(), greater<pair<unsigned long, unsigned int> >());
+    os << endl << "# per instruction with misses: address function offset source"
+       << " accesses misses evictions writebacks" << endl;
+    for (size_t k = 0; k < pcs.size(); ++k) {
+        const unsigned int pc = pcs[k].second;
+        const Counts &c = counts[pc];
+        string function = "-";
+        unsigned int offset = pc * 2;
+        int id = core->Flash->GetSymbolId(pc);
+        if (id >= 0) {
+            const FlashSymbol &f = core->Flash->GetSymbol(id);
+            function = f.last;
+            offset = (pc - f.addr) * 2;
+        }
+        SourceLine l = core->Flash->GetSourceLine(pc);
+        os << "0x" << hex << (pc * 2) << " " << function << " 0x" << offset << dec << " ";
+        if (l.file >= 0)
+            os << core->Flash->sourceFiles[l.file] << ":" << l.line;
+        else
+            os << "-";
+        os << " " << c.accesses << " " << c.misses << " " << c.evictions << " " << c.writebacks << endl;
+    }
+
+    // group pairs by set, lines of a pair are always in the same set
+    typedef pair<unsigned long, pair<unsigned int, unsigned int> > Conflict;
+    map<unsigned int, vector<Conflict> > setConflicts;
+    map<unsigned int, unsigned long> setEvictions;
+    for (map<pair<unsigned int, unsigned int>, unsigned long>::const_iterator i = conflicts.begin();
+         i != conflicts.end(); ++i) {
+        const unsigned int set = i->first.second % nsets;
+        setConflicts[set].push_back(make_pair(i->second, i->first));
+        setEvictions[set] += i->second;
+    }
+    vector<pair<unsigned long, unsigned int> > sets;
+    for (map<unsigned int, unsigned long>::const_iterator i = setEvictions.begin(); i != setEvictions.end(); ++i)
+        sets.push_back(make_pair(i->second, i->first));
+    stable_sort(sets.begin(), sets.end(), greater<pair<unsigned long, unsigned int> >());
+
+    os << endl << "# conflict sets: set evictions, then: count evicted-line <- loaded-line" << endl;
+    for (size_t k = 0; k < sets.size(); ++k) {
+        os << "set " << sets[k].second << " " << sets[k].first << endl;
+        vector<Conflict> &pairs = setConflicts[sets[k].second];
+        stable_sort(pairs.begin(), pairs.end(), greater<Conflict>());
+        for (size_t j = 0; j < pairs.size(); ++j) {
+            os << "  " << pairs[j].first << " ";
+            WriteLine(os, pairs[j].second.first);
+            os << " <- ";
+            WriteLine(os, pairs[j].second.second);
+            os << endl;
+        }
+    }
+}
+
+void CacheProfile::Report(const string &name) {
+    string fname = sysConHandler.GetTraceFileName();
+    if (fname.empty()) fname = "trace";
+    fname += ".";
+    for (size_t k = 0; k < name.size(); ++k)
+        fname += tolower(name[k]);
+    fname += "profile";
+    ofstream os(fname.c_str());
+    if (!os) {
+        avr_warning("can't write cache profile to '%s'", fname.c_str());
+        return;
+    }
+    Write(os, name);
+    avr_message("Wrote cache profile to '%s'", fname.c_str());
+}
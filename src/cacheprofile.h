@@ -0,0 +1,93 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef CACHEPROFILE
+#define CACHEPROFILE
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+class AvrDevice;
+
+//! Attributes misses, evictions and writebacks of a HWCache to code
+/*! Each access on a set is counted for the instruction, which caused it. Counts of an instruction are summed up per symbol (function) by
+  the symbol index of flash. Evictions are also recorded as pairs of evicted
+  and loaded line, this gives the conflict sets: lines which evict each other
+  in the same set. */
+class CacheProfile {
+
+    public:
+        CacheProfile(AvrDevice *core, unsigned int linesize, unsigned int nsets);
+
+        //! Counts access on a set, see HWCache::_access_set
+        /*! @param pc word address of the instruction
+          @param line loaded or accessed line (address / linesize)
+          @param evicted line which was evicted for line, only valid if evict is set
+          Accesses with a pc behind flash are ignored. */
+        void Access(unsigned int pc, unsigned int line, bool miss, bool evict,
+                    unsigned int evicted, bool writeback) {
+            if (pc >= counts.size())
+                return;  // not in flash, can't be attributed to a instruction
+            Counts &c = counts[pc];
+            c.accesses++;
+            if (miss)
+                c.misses++;
+            if (evict) {
+                c.evictions++;
+                conflicts[std::make_pair(evicted, line)]++;
+            }
+            if (writeback)
+                c.writebacks++;
+        }
+
+        //! Writes counts per symbol, per instruction and the conflict sets
+        void Write(std::ostream &os, const std::string &name);
+        //! Writes report to the trace file name with suffix ".<name>profile"
+        void Report(const std::string &name);
+
+    protected:
+        struct Counts {
+            unsigned long accesses;
+            unsigned long misses;
+            unsigned long evictions;
+            unsigned long writebacks;
+            Counts(): accesses(0), misses(0), evictions(0), writebacks(0) {}
+            void Add(const Counts &c);
+        };
+
+        AvrDevice *core;
+        unsigned int linesize;
+        unsigned int nsets;
+        std::vector<Counts> counts;  //!< counts by word address of instruction
+        //! count of evictions by pair of evicted and loaded line
+        std::map<std::pair<unsigned int, unsigned int>, unsigned long> conflicts;
+
+        //! Writes address of a line and the symbol for code
+        void WriteLine(std::ostream &os, unsigned int line);
+};
+
+#endif
@@ -0,0 +1,314 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "cachesweep.h"
+#include "avrdevice.h"
+#include "avrerror.h"
+
+using namespace std;
+
+//! line of a stack, which wasn't written since load in any cache
+static const unsigned int NOT_DIRTY = ~0U;
+
+//! parses "<n>[/<n>...]" of a lru sweep entry
+static vector<unsigned int> sweep_numbers(const string &spec, const string &value) {
+    vector<unsigned int> list;
+    size_t pos = 0;
+    while (pos <= value.size()) {
+        size_t slash = value.find('/', pos);
+        if (slash == string::npos)
+            slash = value.size();
+        string item = value.substr(pos, slash - pos);
+        char *end;
+        unsigned long n = strtoul(item.c_str(), &end, 0);
+        if (item.empty() || *end || n == 0 || n > 0x10000)
+            avr_error("cache sweep '%s': '%s' is no number between 1 and 65536", spec.c_str(), item.c_str());
+        list.push_back(n);
+        pos = slash + 1;
+    }
+    return list;
+}
+
+CacheSweep::CacheSweep(AvrDevice *core, HWCache *p, const CacheConfig &config, const string &n):
+    primary(p),
+    primaryConfig(config),
+    name(n)
+{
+    primaryConfig.sweeps.clear();
+    for (size_t k = 0; k < config.sweeps.size(); ++k) {
+        const string &spec = config.sweeps[k];
+        if (spec == "lru" || spec.compare(0, 4, "lru:") == 0) {
+            AddStacks(spec);
+        } else if (spec.compare(0, 4, "out=") == 0) {
+            filename = spec.substr(4);
+        } else {
+            CacheConfig c = primaryConfig;
+            c.trace = false;
+            c.profile = false;
+            c.report = false;
+            size_t pos = 0;
+            while (pos <= spec.size()) {
+                size_t comma = spec.find(',', pos);
+                if (comma == string::npos)
+                    comma = spec.size();
+                string setting = spec.substr(pos, comma - pos);
+                size_t eq = setting.find('=');
+                string key = setting.substr(0, eq);
+                string value = (eq == string::npos) ? "" : setting.substr(eq + 1);
+                string err;
+                if (key == "on" || key == "off" || key == "enable" || key == "trace" || key == "profile" ||
+                    key == "sweep")
+                    err = "'" + key + "' can't be used for a model";
+                else
+                    err = c.Set(key, value);
+                if (!err.empty())
+                    avr_error("cache sweep '%s': %s", spec.c_str(), err.c_str());
+                pos = comma + 1;
+            }
+            ostringstream mname;
+            mname << name << "_SWEEP" << models.size() + 1;
+            HWCache *m = new HWCache(core, c, NULL, 0, mname.str());
+            m->ccr_reg.releaseTraceValue();  // models are not visible for dumps
+            models.push_back(m);
+            modelConfigs.push_back(c);
+        }
+    }
+}
+
+CacheSweep::~CacheSweep() {
+    for (size_t k = 0; k < models.size(); ++k)
+        delete models[k];
+}
+
+void CacheSweep::AddStacks(const string &spec) {
+    vector<unsigned int> linesizes(1, primaryConfig.linesize);
+    vector<unsigned int> sets(1, primaryConfig.lines / primaryConfig.assoc);
+    unsigned int maxAssoc = primaryConfig.assoc;
+    size_t pos = 4;
+    while (pos < spec.size()) {
+        size_t comma = spec.find(',', pos);
+        if (comma == string::npos)
+            comma = spec.size();
+        string setting = spec.substr(pos, comma - pos);
+        size_t eq = setting.find('=');
+        string key = setting.substr(0, eq);
+        string value = (eq == string::npos) ? "" : setting.substr(eq + 1);
+        if (key == "linesize")
+            linesizes = sweep_numbers(spec, value);
+        else if (key == "sets")
+            sets = sweep_numbers(spec, value);
+        else if (key == "assoc") {
+            vector<unsigned int> a = sweep_numbers(spec, value);
+            if (a.size() != 1 || a[0] > 1024)
+                avr_error("cache sweep '%s': assoc is the maximal associativity up to 1024", spec.c_str());
+            maxAssoc = a[0];
+        } else
+            avr_error("cache sweep '%s': unknown key '%s', use linesize, sets or assoc", spec.c_str(), key.c_str());
+        pos = comma + 1;
+    }
+
+    for (size_t i = 0; i < linesizes.size(); ++i) {
+        for (size_t j = 0; j < sets.size(); ++j) {
+            // same checks as for a cache with this geometry
+            CacheConfig c = primaryConfig;
+            c.linesize = linesizes[i];
+            c.lines = sets[j] * maxAssoc;
+            c.assoc = maxAssoc;
+            c.policy = HWCache::POLICY_LRU;
+            string err = c.Check();
+            if (!err.empty())
+                avr_error("cache sweep '%s': %s", spec.c_str(), err.c_str());
+
+            LruStacks s;
+            s.linesize = linesizes[i];
+            s.offsetbits = 0;
+            while ((1U << s.offsetbits) < s.linesize)
+                s.offsetbits++;
+            s.nsets = sets[j];
+            s.maxAssoc = maxAssoc;
+            s.tags.resize(s.nsets * maxAssoc);
+            s.clean.resize(s.nsets * maxAssoc);
+            s.used.resize(s.nsets);
+            s.hits.resize(maxAssoc);
+            s.evictions.resize(maxAssoc);
+            s.writebacks.resize(maxAssoc);
+            s.accesses = 0;
+            s.writes = 0;
+            stacks.push_back(s);
+        }
+    }
+}
+
+/*! A cache with associativity a holds the first a lines of the stack. A hit
+  in depth d is a miss for all a <= d, each of them evicts its LRU line, which
+  is the line pushed from depth a-1 to a. A line is dirty in cache a, if it
+  was written since its last load into a, so "clean" keeps the largest depth of
+  a access since the last write: dirty for all a > clean. */
+void CacheSweep::AccessStacks(LruStacks &s, unsigned int block, bool write) {
+    const unsigned int set = block % s.nsets;
+    unsigned int *tags = &s.tags[set * s.maxAssoc];
+    unsigned int *clean = &s.clean[set * s.maxAssoc];
+    const unsigned int n = s.used[set];
+    const bool writeback = primaryConfig.mode == HWCache::OPMODE_WRITEBACK;
+
+    unsigned int depth = n;
+    for (unsigned int k = 0; k < n; ++k)
+        depth = (tags[k] == block) ? k : depth;
+
+    s.accesses++;
+    if (write)
+        s.writes++;
+
+    unsigned int cleanDepth;
+    unsigned int last;  // lines in depth 0 ... last-1 are pushed down
+    if (depth < n) {
+        s.hits[depth]++;
+        cleanDepth = (clean[depth] == NOT_DIRTY || clean[depth] > depth) ? clean[depth] : depth;
+        last = depth;
+    } else {
+        cleanDepth = NOT_DIRTY;
+        last = (n < s.maxAssoc) ? n : s.maxAssoc - 1;
+        if (n == s.maxAssoc) {
+            // line in last depth leaves the stack, evicted from the largest cache
+            s.evictions[n - 1]++;
+            if (writeback && clean[n - 1] < n)
+                s.writebacks[n - 1]++;
+        } else {
+            s.used[set]++;
+        }
+    }
+    for (unsigned int k = last; k > 0; --k) {
+        // line from depth k-1 is evicted from cache with associativity k
+        s.evictions[k - 1]++;
+        if (writeback && clean[k - 1] < k)
+            s.writebacks[k - 1]++;
+        tags[k] = tags[k - 1];
+        clean[k] = clean[k - 1];
+    }
+    tags[0] = block;
+    clean[0] = (write && writeback) ? 0 : cleanDepth;
+}
+
+void CacheSweep::Access(unsigned int addr, unsigned char len, bool write) {
+    for (size_t k = 0; k < stacks.size(); ++k) {
+        LruStacks &s = stacks[k];
+        // unaligned access touches two lines, like in HWCache
+        const unsigned int block = addr >> s.offsetbits;
+        AccessStacks(s, block, write);
+        if ((addr & (s.linesize - 1)) + len > s.linesize)
+            AccessStacks(s, block + 1, write);
+    }
+    for (size_t k = 0; k < models.size(); ++k)
+        models[k]->access(addr, len, write);
+}
+
+void CacheSweep::Clear(void) {
+    for (size_t k = 0; k < stacks.size(); ++k)
+        fill(stacks[k].used.begin(), stacks[k].used.end(), 0);
+    for (size_t k = 0; k < models.size(); ++k)
+        models[k]->_clear_cache();
+}
+
+//! writes one line of the table
+static void sweep_row(ostream &os, const char *kind, const CacheConfig &c,
+                      unsigned long accesses, unsigned long misses, unsigned long evictions,
+                      unsigned long writebacks, unsigned long long cycles) {
+    os << setw(8) << kind
+       << setw(9) << c.lines * c.linesize
+       << setw(7) << c.lines
+       << setw(9) << c.linesize
+       << setw(6) << c.assoc
+       << setw(8) << HWCache::GetPolicyName(c.policy)
+       << setw(12) << accesses
+       << setw(11) << misses
+       << setw(9) << fixed << setprecision(3) << (accesses ? 100.0 * misses / accesses : 0.0)
+       << setw(11) << evictions
+       << setw(11) << writebacks
+       << setw(13) << cycles << endl;
+}
+
+void CacheSweep::Write(ostream &os) {
+    os << name << " sweep:" << endl
+       << setw(8) << "kind" << setw(9) << "bytes" << setw(7) << "lines" << setw(9) << "linesize"
+       << setw(6) << "assoc" << setw(8) << "policy" << setw(12) << "accesses" << setw(11) << "misses"
+       << setw(9) << "miss%" << setw(11) << "evictions" << setw(11) << "writebacks"
+       << setw(13) << "cycles" << endl;
+
+    const HWCache::cache_stats_t &ps = primary->stats;
+    sweep_row(os, "primary", primaryConfig, ps.num_access, ps.num_miss, ps.num_evict,
+              ps.num_writeback, ps.num_cycles);
+
+    for (size_t k = 0; k < stacks.size(); ++k) {
+        const LruStacks &s = stacks[k];
+        CacheConfig c = primaryConfig;
+        c.linesize = s.linesize;
+        c.policy = HWCache::POLICY_LRU;
+        unsigned long hits = 0;
+        for (unsigned int a = 1; a <= s.maxAssoc; ++a) {
+            hits += s.hits[a - 1];
+            c.assoc = a;
+            c.lines = a * s.nsets;
+            const unsigned long misses = s.accesses - hits;
+            unsigned long long cycles = (unsigned long long)hits * c.hitCycles
+                                      + (unsigned long long)misses * c.missCycles
+                                      + (unsigned long long)s.writebacks[a - 1] * c.writebackCycles;
+            if (c.mode == HWCache::OPMODE_WRITETHROUGH)
+                cycles += (unsigned long long)s.writes * c.writethroughCycles;
+            sweep_row(os, "lru", c, s.accesses, misses, s.evictions[a - 1], s.writebacks[a - 1], cycles);
+        }
+    }
+
+    for (size_t k = 0; k < models.size(); ++k) {
+        const HWCache::cache_stats_t &ms = models[k]->stats;
+        sweep_row(os, "model", modelConfigs[k], ms.num_access, ms.num_miss, ms.num_evict,
+                  ms.num_writeback, ms.num_cycles);
+    }
+}
+
+void CacheSweep::Report(void) {
+    string fname = filename;
+    if (fname.empty()) {
+        // next to the trace of the cache
+        fname = sysConHandler.GetTraceFileName();
+        if (fname.empty()) fname = "trace";
+        fname += ".";
+        for (size_t k = 0; k < name.size(); ++k)
+            fname += tolower(name[k]);
+        fname += "sweep";
+    }
+    ofstream os(fname.c_str());
+    if (!os) {
+        avr_warning("can't write cache sweep to '%s'", fname.c_str());
+        return;
+    }
+    Write(os);
+    avr_message("Wrote cache sweep to '%s'", fname.c_str());
+}
@@ -0,0 +1,103 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef CACHESWEEP
+#define CACHESWEEP
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "hwcache.h"
+
+//! Simulates many cache configurations in one run, observing a primary HWCache
+/*! The primary cache forwards each access to its sweep, timing of the core
+  follows the primary only. Sweep entries are given by CacheConfig::sweeps:
+
+  "lru:linesize=<n>[/<n>...],sets=<n>[/<n>...],assoc=<max>" adds a stack
+  distance analyzer for each line size and set count. Each set keeps a LRU
+  stack of up to max lines, the depth of a hit gives hit or miss for all
+  associativities up to max at once (all-associativity simulation). Missing
+  keys default to the geometry of the primary.
+
+  "out=<file>" writes the table to file, default is the trace file name with
+  suffix ".<name>sweep".
+
+  Any other entry is a list of CacheConfig keys, like for -K, applied to the
+  primary configuration. Each of them runs as a additional HWCache model,
+  this covers all replacement policies.
+
+  Latencies and write mode of the primary are used for the LRU stacks. All
+  models see the same accesses, also while the primary is disabled or
+  locked, and are cleared with the primary. */
+class CacheSweep {
+
+    public:
+        CacheSweep(AvrDevice *core, HWCache *primary, const CacheConfig &config,
+                   const std::string &name);
+        ~CacheSweep();
+
+        //! Access by the primary, see HWCache::access
+        void Access(unsigned int addr, unsigned char len, bool write);
+        //! Clears all models, called on clear of the primary
+        void Clear(void);
+
+        //! Writes table of all configurations with misses and added cycles
+        void Write(std::ostream &os);
+        //! Writes table to the file given by "out=" or the default file
+        void Report(void);
+
+    protected:
+        //! LRU stacks for one line size and count of sets
+        struct LruStacks {
+            unsigned int linesize;
+            unsigned int offsetbits;
+            unsigned int nsets;
+            unsigned int maxAssoc;
+            std::vector<unsigned int> tags;  //!< maxAssoc entries per set, MRU first
+            std::vector<unsigned int> clean;  //!< line is dirty for assoc > clean
+            std::vector<unsigned int> used;  //!< valid entries per set
+            std::vector<unsigned long> hits;  //!< hits by stack depth
+            std::vector<unsigned long> evictions;  //!< by assoc - 1
+            std::vector<unsigned long> writebacks;  //!< by assoc - 1
+            unsigned long accesses;
+            unsigned long writes;
+        };
+
+        HWCache *primary;
+        CacheConfig primaryConfig;
+        std::string name;
+        std::string filename;
+        std::vector<LruStacks> stacks;
+        std::vector<HWCache *> models;
+        std::vector<CacheConfig> modelConfigs;
+
+        //! Parses a "lru:" entry
+        void AddStacks(const std::string &spec);
+        //! Access on one line by a LRU stack set
+        void AccessStacks(LruStacks &s, unsigned int block, bool write);
+};
+
+#endif
@@ -34,6 +34,7 @@
 #include "../avrerror.h"
 #include "../flash.h"
 #include "../hweeprom.h"
+#include "../vcdz.h"
 
 using namespace std;
  
@@ -48,14 +49,28 @@ void SetDumpTraceArgs(const vector<string> &traceopts, AvrDevice *dev) {
         cerr << "Enabling tracer: '";
         if(ls[0] == "warnread") {
             cerr << "warnread'." << endl;
-            if(ls.size() > 1)
+            if(ls.size() == 1)
+                ts = dman->all();
+            else if(ls.size() == 3) {
+                // check registers and RAM only in address range, all other
+                // values are checked, RAM values outside aren't created
+                unsigned int first = strtoul(ls[1].c_str(), NULL, 0);
+                unsigned int last = strtoul(ls[2].c_str(), NULL, 0);
+                TraceSet *other = dev->GetAllTraceValuesRecursive(false);
+                ts = *other;
+                delete other;
+                for(unsigned int a = first; (a <= last) && (a < dev->GetMemTotalSize()); a++) {
+                    TraceValue *t = dev->GetDataMemTraceValue(a);
+                    if(t != NULL)
+                        ts.push_back(t);
+                }
+            } else
                 avr_error("Invalid number of options for 'warnread'.");
-            ts = dman->all();
             d = new WarnUnknown(dev);
-        } else if (ls[0] == "vcd") {
-            cerr << "vcd'." << endl;
+        } else if (ls[0] == "vcd" || ls[0] == "vcdz") {
+            cerr << ls[0] << "'." << endl;
             if(ls.size() < 3 || ls.size() > 4)
-                avr_error("Invalid number of options for 'vcd'.");
+                avr_error("Invalid number of options for '%s'.", ls[0].c_str());
             cerr << "Reading values to trace from '" << ls[1] << "'." << endl;
         
             ifstream is(ls[1].c_str());
@@ -76,7 +91,10 @@ void SetDumpTraceArgs(const vector<string> &traceopts, AvrDevice *dev) {
                 } else
                     avr_error("Invalid read/write strobe specifier '%s'", ls[3].c_str());
             }
-            d = new DumpVCD(ls[2], "ns", rs, ws);
+            if(ls[0] == "vcdz")
+                d = new DumpVCDZ(ls[2], "ns", rs, ws);
+            else
+                d = new DumpVCD(ls[2], "ns", rs, ws);
         } else
             avr_error("Unknown tracer '%s'", ls[0].c_str());
         dman->addDumper(d, ts);
@@ -142,7 +160,7 @@ static void WriteCoreDumpRAM(ostream &outf, AvrDevice *dev, int offs, int size)
     string lastLine("");
 
     for(int i = 0; i < size; i++) {
-        buf << hex << setw(2) << setfill('0') << (int)((unsigned char)*(dev->rw[i + offs])) << " ";
+        buf << hex << setw(2) << setfill('0') << (int)dev->GetRWMem(i + offs) << " ";
         if(++j == maxLineByte) {
             if(buf.str() == lastLine) // check for duplicate line
               dup++;
@@ -249,7 +267,7 @@ void WriteCoreDump(const string &outname, AvrDevice *dev) {
     *outf << "General Purpose Register Dump:" << endl;
     for(unsigned int i = 0, j = 0; i < dev->GetMemRegisterSize(); i++) {
         *outf << dec << "r" << setw(2) << setfill('0') << i << "="
-              << hex << setw(2) << setfill('0') << (int)((unsigned char)*(dev->rw[i])) << "  ";
+              << hex << setw(2) << setfill('0') << (int)dev->GetCoreReg(i) << "  ";
         j++;
         if(j == 8) {
             *outf << endl;
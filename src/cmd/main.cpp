@@ -57,6 +57,7 @@ using namespace std;
 #include "helper.h"
 #include "specialmem.h"
 #include "irqsystem.h"
+#include "hwcache.h"
 
 #include "dumpargs.h"
 
@@ -106,10 +107,32 @@ const char Usage[] =
     "-l --linestotrace <number>\n"
     "                      maximum number of lines in each trace file.\n"
     "                      0 means endless. Attention: if you use gdb & trace, please use always 0!\n"
+    "-A --trace-async <mode>[,<kbytes>]\n"
+    "                      write trace file from a background thread with a ring\n"
+    "                      buffer of <kbytes> (default 1024). <mode> is 'block' (wait,\n"
+    "                      if buffer is full) or 'drop' (drop and count lines).\n"
+    "                      A trace file name ending with .gz is written in gzip format\n"
+    "-X --trace-filter <filter>\n"
+    "                      write trace output only while one of the filters is on:\n"
+    "                      'sym:<label>' (function and its callees), 'pc:<from>-<to>'\n"
+    "                      (PC range, end excluded), 'time:<start>[-<end>]' (ns),\n"
+    "                      'cycles:<start>[-<end>]' or 'irq:<vector>:<count>' (first\n"
+    "                      <count> instructions after irq entry), can be repeated\n"
+    "-b --binary-trace <file>\n"
+    "                      write a compact binary instruction trace to <file>,\n"
+    "                      convert it to trace output with simulavr-trace\n"
     "-n --nogdbwait        do not wait for gdb connection\n"
     "-F --cpufrequency     set the cpu frequency to <Hz> \n"
     "-s --irqstatistic     prints statistic informations about irq usage after simulation\n"
     "                      is stopped\n"
+    "-P --profile          prints execution times (BCET, WCET, total) of all called\n"
+    "                      functions after simulation is stopped\n"
+    "-I --profile-irq      like -P, but prints also execution times without\n"
+    "                      interrupts and preemption counts for each interrupt\n"
+    "-L --lcov <file>      write line, branch and function coverage as lcov\n"
+    "                      tracefile to <file>, needs debug info (-g) in elf file\n"
+    "-J --loops <file>     measure iterations of all loops and write min/max/total\n"
+    "                      count per loop entry to <file>\n"
     "-W --writetopipe <offset>,<file>\n"
     "                      add a special pipe register to device at\n"
     "                      IO-Offset and opens <file> for writing\n"
@@ -123,6 +146,26 @@ const char Usage[] =
     "                      add a special register at IO-offset\n"
     "                      which exits simulator run\n"
     "-C --core-dump <name> dump a core memory image <name> to file on exit\n"
+    "-E --engine <name>    select engine to execute instructions:\n"
+    "                      'classic' (default, virtual call per instruction),\n"
+    "                      'direct' (flat dispatch table), 'block' (translated\n"
+    "                      blocks with superinstructions) or 'jit' (like 'block', hot\n"
+    "                      blocks as native code, x86-64 Linux only). Tracing uses\n"
+    "                      always 'classic'. With interrupts enabled, superinstructions\n"
+    "                      and native code run only while all peripherals sleep\n"
+    "-K --cache <cache>:<key>=<value>[,<key>=<value>...]\n"
+    "                      configure cache <cache> ('icache' or 'dcache') of a\n"
+    "                      device with caches, keys are 'on', 'off', lines, linesize,\n"
+    "                      assoc, hit, miss, writethrough, writeback (cycles), clear\n"
+    "                      (ns), policy (lru, plru, fifo, random, mru), mode\n"
+    "                      (writeback, writethrough), trace (on, off), profile\n"
+    "                      (on, off, misses per instruction and function) and\n"
+    "                      sweep=<entry> (more configurations observing the cache,\n"
+    "                      'lru:linesize=8/16,sets=16/32,assoc=8' or '-K' keys\n"
+    "                      for a further model, takes rest of option)\n"
+    "-k --cache-config <file>\n"
+    "                      read cache settings from <file>, '[<cache>]' starts a\n"
+    "                      section with '<key> = <value>' lines, like -K\n"
     "-v --verbose          output some hints to console\n"
     "-T --terminate <label> or <address>\n"
     "                      stops simulation if PC runs on <label> or <address>\n"
@@ -144,6 +187,11 @@ int main(int argc, char *argv[]) {
     string filename("unknown");
     string devicename("unknown");
     string tracefilename("unknown");
+    string binarytracefilename("unknown");
+    string lcovfilename("unknown");
+    string loopsfilename("unknown");
+    bool profile = false;
+    bool profileIrq = false;
     long global_gdbserver_port = 1212;
     int global_gdb_debug = 0;
     bool globalWaitForGdbConnection = true; //please wait for gdb connection
@@ -151,6 +199,9 @@ int main(int argc, char *argv[]) {
     unsigned long long fcpu = 4000000;
     unsigned long long maxRunTime = 0;
     unsigned long long linestotrace = 10000000;
+    bool traceAsync = false;
+    bool traceDrop = false;
+    unsigned long traceRingKBytes = 1024;
     UserInterface *ui;
     
     unsigned long writeToPipeOffset = 0x20;
@@ -161,11 +212,14 @@ int main(int argc, char *argv[]) {
     string writeToPipeFileName = "";
     
     vector<string> terminationArgs;
+    vector<string> traceFilters;
     
     vector<string> tracer_opts;
     bool tracer_dump_avail = false;
     string tracer_avail_out;
     
+    AvrDevice::ExecutionEngine engine = AvrDevice::ENGINE_CLASSIC;
+    
     while (1) {
         //int this_option_optind = optind ? optind : 1;
         int option_index = 0;
@@ -179,6 +233,9 @@ int main(int argc, char *argv[]) {
             {"maxruntime", 1, 0, 'm'},
             {"nogdbwait", 0, 0, 'n'},
             {"trace", 1, 0, 't'},
+            {"binary-trace", 1, 0, 'b'},
+            {"trace-async", 1, 0, 'A'},
+            {"trace-filter", 1, 0, 'X'},
             {"version", 0, 0, 'V'},
             {"cpufrequency", 1, 0, 'F'},
             {"readfrompipe", 1, 0, 'R'},
@@ -190,11 +247,18 @@ int main(int argc, char *argv[]) {
             {"breakpoint", 1, 0, 'B'},
             {"core-dump", 1, 0, 'C'},
             {"irqstatistic", 0, 0, 's'},
+            {"profile", 0, 0, 'P'},
+            {"profile-irq", 0, 0, 'I'},
+            {"lcov", 1, 0, 'L'},
+            {"loops", 1, 0, 'J'},
+            {"engine", 1, 0, 'E'},
+            {"cache", 1, 0, 'K'},
+            {"cache-config", 1, 0, 'k'},
             {"help", 0, 0, 'h'},
             {0, 0, 0, 0}
         };
         
-        c = getopt_long(argc, argv, "a:e:f:d:gGm:p:t:uxyzhvnisF:R:W:VT:B:c:C:o:l:", long_options, &option_index);
+        c = getopt_long(argc, argv, "a:e:f:d:gGm:p:t:b:A:X:uxyzhvnisPIL:J:F:R:W:VT:B:c:C:o:l:E:K:k:", long_options, &option_index);
         if(c == -1)
             break;
         
@@ -302,9 +366,40 @@ int main(int argc, char *argv[]) {
                 break;
             
             case 't':
-                avr_message("Running in Trace Mode with maximum %lld lines per file",
-                            linestotrace);
-                sysConHandler.SetTraceFileOrStream(optarg, linestotrace);
+                tracefilename = optarg;
+                break;
+            
+            case 'A': {
+                char *end;
+                string mode(optarg);
+                size_t comma = mode.find(',');
+                if(comma != string::npos) {
+                    if(!StringToUnsignedLong(optarg + comma + 1, &traceRingKBytes, &end, 10) || *end ||
+                       (traceRingKBytes == 0) || (traceRingKBytes > 1024 * 1024)) {
+                        cerr << "trace-async: buffer size is not a number between 1 and 1048576" << endl;
+                        exit(1);
+                    }
+                    mode = mode.substr(0, comma);
+                }
+                if(mode == "block")
+                    traceDrop = false;
+                else if(mode == "drop")
+                    traceDrop = true;
+                else {
+                    cerr << "trace-async: unknown mode '" << mode << "', use 'block' or 'drop'" << endl;
+                    exit(1);
+                }
+                traceAsync = true;
+                break;
+            }
+            
+            case 'X':
+                traceFilters.push_back(optarg);
+                break;
+            
+            case 'b':
+                avr_message("Write binary trace to %s", optarg);
+                binarytracefilename = optarg;
                 break;
             
             case 'V':
@@ -333,11 +428,57 @@ int main(int argc, char *argv[]) {
                 enableIRQStatistic = true;
                 break;
             
+            case 'P':
+                profile = true;
+                break;
+            
+            case 'I':
+                profile = true;
+                profileIrq = true;
+                break;
+            
+            case 'L':
+                lcovfilename = optarg;
+                break;
+            
+            case 'J':
+                loopsfilename = optarg;
+                break;
+            
             case 'C':
                 avr_message("Write core dump on exit to file: %s", optarg);
                 coredumpfile = optarg;
                 break;
             
+            case 'E':
+                if(string(optarg) == "classic")
+                    engine = AvrDevice::ENGINE_CLASSIC;
+                else if(string(optarg) == "direct")
+                    engine = AvrDevice::ENGINE_DIRECT;
+                else if(string(optarg) == "block")
+                    engine = AvrDevice::ENGINE_BLOCK;
+                else if(string(optarg) == "jit")
+                    engine = AvrDevice::ENGINE_JIT;
+                else {
+                    cerr << "unknown execution engine '" << optarg << "'" << endl;
+                    exit(1);
+                }
+                avr_message("Execution engine: %s", optarg);
+                break;
+            
+            case 'K':
+                AvrFactory::instance().AddCacheOption(optarg);
+                break;
+            
+            case 'k': {
+                vector<string> cacheOpts;
+                CacheConfig::ReadFile(optarg, cacheOpts);
+                for(size_t i = 0; i < cacheOpts.size(); i++)
+                    AvrFactory::instance().AddCacheOption(cacheOpts[i]);
+                avr_message("Cache config file: %s", optarg);
+                break;
+            }
+            
             default:
                 cout << Usage
                      << "Supported devices:" << endl
@@ -346,6 +487,16 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    if(tracefilename != "unknown") {
+        avr_message("Running in Trace Mode with maximum %lld lines per file",
+                    linestotrace);
+        if(traceAsync)
+            avr_message("Trace is written by background thread, %s on full buffer",
+                        traceDrop ? "drop lines" : "wait");
+        sysConHandler.SetTraceAsync(traceAsync, traceDrop, traceRingKBytes * 1024);
+        sysConHandler.SetTraceFileOrStream(tracefilename.c_str(), linestotrace);
+    }
+    
     /* get dump manager and inform it, that we have a single device application */
     DumpManager *dman = DumpManager::Instance();
     dman->SetSingleDeviceApp();
@@ -381,6 +532,7 @@ int main(int argc, char *argv[]) {
         sig = -1;
     }
     dev1->SetDeviceNameAndSignature(devicename, sig);
+    dev1->SetExecutionEngine(engine);
     
     /* We had to wait with dumping the available tracing values
       until the device has been created! */
@@ -440,7 +592,17 @@ int main(int argc, char *argv[]) {
     dev1->SetClockFreq(1000000000 / fcpu); // time base is 1ns!
     
     if(sysConHandler.GetTraceState())
-        dev1->trace_on = 1;
+        dev1->SetTraceOn(1);
+    if(binarytracefilename != "unknown")
+        dev1->StartBinaryTrace(binarytracefilename);
+    if(profile)
+        dev1->EnableProfiler(profileIrq);
+    if(lcovfilename != "unknown")
+        dev1->EnableCoverage(lcovfilename);
+    if(loopsfilename != "unknown")
+        dev1->EnableLoopCounter(loopsfilename);
+    for(ii = traceFilters.begin(); ii != traceFilters.end(); ii++)
+        dev1->AddTraceFilter(*ii);
     
     dman->start(); // start dump session
     
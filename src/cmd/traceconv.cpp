@@ -0,0 +1,73 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+/* Converts a binary trace written by simulavr -b into the text format of
+   simulavr -t. The lines are printed from the recorded values, see
+   ConvertBinaryTrace, a device of the same type is only used to disassemble
+   the instructions. */
+
+#include <iostream>
+#include <string>
+using namespace std;
+
+#include <stdlib.h>
+
+#include "avrdevice.h"
+#include "avrfactory.h"
+#include "avrerror.h"
+#include "tracebin.h"
+
+static const char Usage[] =
+    "simulavr-trace - converts a binary trace of simulavr to trace output\n"
+    "Usage: simulavr-trace [-d <device>] <binary trace> [<trace file>]\n"
+    "-d <device>   disassemble for device <name>, if the trace doesn't contain it\n"
+    "<trace file>  output file, default is stdout, 'stderr' writes to stderr\n"
+    "\n";
+
+int main(int argc, char *argv[]) {
+    string devicename;
+    int i = 1;
+    if((i + 1 < argc) && (string(argv[i]) == "-d")) {
+        devicename = argv[i + 1];
+        i += 2;
+    }
+    if((i >= argc) || (i + 2 < argc) || (argv[i][0] == '-')) {
+        cerr << Usage;
+        exit(1);
+    }
+
+    BinaryTraceReader reader(argv[i]);
+    if(devicename.empty())
+        devicename = reader.GetDeviceName();
+    if(devicename.empty())
+        avr_error("binary trace doesn't contain a device name, use -d <device>");
+    AvrDevice *dev = AvrFactory::instance().makeDevice(devicename.c_str());
+
+    sysConHandler.SetTraceFileOrStream((i + 1 < argc) ? argv[i + 1] : "stdout", 0);
+    ConvertBinaryTrace(reader, dev, traceOut);
+    sysConHandler.StopTrace();
+    delete dev;
+    return 0;
+}
@@ -0,0 +1,85 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+/* Converts a compressed VCD file written by simulavr -c vcdz:... into a VCD
+   file for waveform viewers. With -s and -e only a time window is converted,
+   then the time index is used to read only the necessary blocks and the
+   values at window start are written as $dumpvars. */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+using namespace std;
+
+#include <stdlib.h>
+
+#include "avrerror.h"
+#include "vcdz.h"
+
+static const char Usage[] =
+    "simulavr-vcd - converts a compressed VCD file of simulavr to VCD\n"
+    "Usage: simulavr-vcd [-s <time>] [-e <time>] <compressed VCD> [<VCD file>]\n"
+    "-s <time>    start of time window, in time unit of the VCD file (ns)\n"
+    "-e <time>    end of time window\n"
+    "<VCD file>   output file, default is stdout\n"
+    "\n";
+
+int main(int argc, char *argv[]) {
+    SystemClockOffset start = 0, end = -1;
+    bool window = false;
+    int i = 1;
+    while((i + 1 < argc) && ((string(argv[i]) == "-s") || (string(argv[i]) == "-e"))) {
+        char *e;
+        SystemClockOffset t = strtoll(argv[i + 1], &e, 10);
+        if(*e || (t < 0)) {
+            cerr << Usage;
+            exit(1);
+        }
+        if(argv[i][1] == 's')
+            start = t;
+        else
+            end = t;
+        window = true;
+        i += 2;
+    }
+    if((i >= argc) || (i + 2 < argc) || (argv[i][0] == '-') || ((end >= 0) && (end < start))) {
+        cerr << Usage;
+        exit(1);
+    }
+
+    VcdzReader reader(argv[i]);
+    ofstream file;
+    if(i + 1 < argc) {
+        file.open(argv[i + 1], ios::out | ios::binary | ios::trunc);
+        if(!file.is_open())
+            avr_error("can't open VCD file '%s'", argv[i + 1]);
+    }
+    ostream &os = (i + 1 < argc) ? file : cout;
+    if(window)
+        reader.ConvertWindow(os, start, end);
+    else
+        reader.Convert(os);
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <fstream>
+#include <map>
+
+#include "coverage.h"
+#include "avrdevice.h"
+#include "avrerror.h"
+#include "flash.h"
+
+using namespace std;
+
+/* opcode classification, see lookup_opcode in decoder.cpp for the encodings */
+
+static bool IsConditional(word op) {
+    return ((op & 0xF800) == 0xF000) ||    // BRBS, BRBC
+           ((op & 0xFC08) == 0xFC00) ||    // SBRC, SBRS
+           ((op & 0xFC00) == 0x1000) ||    // CPSE
+           ((op & 0xFD00) == 0x9900);      // SBIC, SBIS
+}
+
+static bool Is2Words(word op) {
+    return ((op & 0xFE0C) == 0x940C) ||    // JMP, CALL
+           ((op & 0xFC0F) == 0x9000);      // LDS, STS
+}
+
+CoverageCounter::CoverageCounter(AvrDevice *c, const string &f):
+    core(c),
+    filename(f),
+    exec(c->Flash->GetSize() / 2, 0),
+    taken(c->Flash->GetSize() / 2, 0),
+    notTaken(c->Flash->GetSize() / 2, 0) {}
+
+void CoverageCounter::WriteLcov(void) {
+    ofstream os(filename.c_str());
+    if(!os.is_open())
+        avr_error("Can't open coverage file '%s'", filename.c_str());
+    WriteLcov(os);
+}
+
+//! Coverage of one source line
+struct LineCoverage {
+    unsigned long long count;          //!< executions of most executed instruction
+    std::vector<unsigned int> branches; //!< word addresses of conditional branches
+
+    LineCoverage(): count(0) {}
+};
+
+void CoverageCounter::WriteLcov(ostream &os) {
+    AvrFlash *flash = core->Flash;
+    const map<unsigned int, SourceLine> &lines = flash->lines;
+    if(lines.empty())
+        avr_warning("No DWARF line info in '%s', coverage file is empty (compile with -g)",
+                    core->GetFname().c_str());
+
+    // collect instructions of each line
+    vector<map<unsigned int, LineCoverage> > files(flash->sourceFiles.size());
+    unsigned int words = exec.size();
+    for(map<unsigned int, SourceLine>::const_iterator i = lines.begin(); i != lines.end(); ) {
+        map<unsigned int, SourceLine>::const_iterator next = i;
+        next++;
+        if(i->second.file >= 0) {
+            LineCoverage &l = files[i->second.file][i->second.line];
+            unsigned int end = (next == lines.end()) ? words : next->first;
+            for(unsigned int pc = i->first; (pc < end) && (pc < words); ) {
+                word op = flash->ReadMemRawWord(pc * 2);
+                if(exec[pc] > l.count)
+                    l.count = exec[pc];
+                if(IsConditional(op))
+                    l.branches.push_back(pc);
+                pc += Is2Words(op) ? 2 : 1;
+            }
+        }
+        i = next;
+    }
+
+    // functions by source file
+    typedef multimap<unsigned int, string>::const_iterator symiter;
+    vector<multimap<unsigned int, symiter> > functions(files.size()); // by line
+    for(symiter s = flash->sym.begin(); s != flash->sym.end(); s++) {
+        SourceLine l = flash->GetSourceLine(s->first);
+        if((l.file >= 0) && (s->first < words))
+            functions[l.file].insert(make_pair(l.line, s));
+    }
+
+    os << "TN:" << endl;
+    for(unsigned int f = 0; f < files.size(); f++) {
+        if(files[f].empty())
+            continue;
+        os << "SF:" << flash->sourceFiles[f] << endl;
+
+        unsigned int fnHit = 0;
+        multimap<unsigned int, symiter>::const_iterator fn;
+        for(fn = functions[f].begin(); fn != functions[f].end(); fn++)
+            os << "FN:" << fn->first << "," << fn->second->second << endl;
+        for(fn = functions[f].begin(); fn != functions[f].end(); fn++) {
+            unsigned long long n = exec[fn->second->first];
+            os << "FNDA:" << n << "," << fn->second->second << endl;
+            if(n > 0)
+                fnHit++;
+        }
+        os << "FNF:" << functions[f].size() << endl
+           << "FNH:" << fnHit << endl;
+
+        unsigned int brFound = 0, brHit = 0;
+        map<unsigned int, LineCoverage>::const_iterator l;
+        for(l = files[f].begin(); l != files[f].end(); l++) {
+            for(unsigned int b = 0; b < l->second.branches.size(); b++) {
+                unsigned int pc = l->second.branches[b];
+                bool executed = (taken[pc] + notTaken[pc]) > 0;
+                os << "BRDA:" << l->first << "," << b << ",0,";
+                if(executed)
+                    os << taken[pc] << endl;
+                else
+                    os << "-" << endl;
+                os << "BRDA:" << l->first << "," << b << ",1,";
+                if(executed)
+                    os << notTaken[pc] << endl;
+                else
+                    os << "-" << endl;
+                brFound += 2;
+                brHit += (taken[pc] > 0) + (notTaken[pc] > 0);
+            }
+        }
+        os << "BRF:" << brFound << endl
+           << "BRH:" << brHit << endl;
+
+        unsigned int lnHit = 0;
+        for(l = files[f].begin(); l != files[f].end(); l++) {
+            os << "DA:" << l->first << "," << l->second.count << endl;
+            if(l->second.count > 0)
+                lnHit++;
+        }
+        os << "LF:" << files[f].size() << endl
+           << "LH:" << lnHit << endl
+           << "end_of_record" << endl;
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef COVERAGE
+#define COVERAGE
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+class AvrDevice;
+
+//! Execution counters for each flash word and taken counters for conditional branches
+/*! Executed is called for each executed instruction by all execution
+  engines, Branch by the conditional branch and skip instructions (BRBS,
+  BRBC, CPSE, SBRC, SBRS, SBIC, SBIS). Both are simple array increments.
+
+  At the end of simulation WriteLcov writes a lcov tracefile with line,
+  branch and function coverage. Lines are taken from the DWARF line info of
+  the elf file, see AvrFlash::lines, so the program must be compiled with
+  -g. A line is counted as often as its most executed instruction. */
+class CoverageCounter {
+
+    public:
+        CoverageCounter(AvrDevice *c, const std::string &filename);
+
+        //! Instruction at word address pc is executed
+        void Executed(unsigned int pc) { exec[pc]++; }
+        //! Conditional branch or skip at word address pc is done, taken or not
+        void Branch(unsigned int pc, bool isTaken) {
+            if(isTaken)
+                taken[pc]++;
+            else
+                notTaken[pc]++;
+        }
+
+        //! Count of executions of instruction at word address pc
+        unsigned long long GetExecCount(unsigned int pc) const { return exec[pc]; }
+        //! Count of taken branches or skips at word address pc
+        unsigned long long GetTakenCount(unsigned int pc) const { return taken[pc]; }
+        //! Count of not taken branches or skips at word address pc
+        unsigned long long GetNotTakenCount(unsigned int pc) const { return notTaken[pc]; }
+
+        //! Writes lcov tracefile to file name given on construction
+        void WriteLcov(void);
+        //! Writes lcov tracefile to stream os
+        void WriteLcov(std::ostream &os);
+
+    protected:
+        AvrDevice *core;
+        std::string filename;
+        std::vector<unsigned long long> exec;      //!< execution count by word address
+        std::vector<unsigned long long> taken;     //!< taken branches by word address
+        std::vector<unsigned long long> notTaken;  //!< not taken branches by word address
+};
+
+#endif
@@ -31,6 +31,9 @@
 #include "hwsreg.h"
 #include "avrerror.h"
 #include "ioregs.h"
+#include "profiler.h"
+#include "coverage.h"
+#include "loopcounter.h"
 
 static int n_bit_unsigned_to_signed(unsigned int val, int n );
 
@@ -101,13 +104,26 @@ static int get_q( word opcode );
 static int get_A_5( word opcode );
 static int get_A_6( word opcode );
 
-int DecodedInstruction::Execute(unsigned int pc, bool trace) {
+//! Non virtual call of the instruction implementation, used by direct dispatch
+template<class T> static int dispatch_insn(DecodedInstruction *insn) {
+    return static_cast<T*>(insn)->T::operator()();
+}
+
+//! Creates a instruction instance and binds its direct dispatch handler
+template<class T> static DecodedInstruction *new_insn(word opcode, AvrDevice *core) {
+    T *insn = new T(opcode, core);
+    insn->SetDispatchHandler(&dispatch_insn<T>);
+    return insn;
+}
+
+template<bool TRACE, bool ICACHE>
+int DecodedInstruction::Execute(unsigned int pc) {
     int cycles = 0;
-    if (core->cache_insn) {
+    if (ICACHE) {
         cycles += core->cache_insn->access(pc*2, this->len());
     }
 
-    if (!trace) {
+    if (!TRACE) {
         cycles += (*this)();
     } else {
         cycles += this->Trace();
@@ -116,6 +132,17 @@ int DecodedInstruction::Execute(unsigned int pc, bool trace) {
     return cycles;
 }
 
+template int DecodedInstruction::Execute<false, false>(unsigned int pc);
+template int DecodedInstruction::Execute<false, true>(unsigned int pc);
+template int DecodedInstruction::Execute<true, false>(unsigned int pc);
+template int DecodedInstruction::Execute<true, true>(unsigned int pc);
+
+int DecodedInstruction::Execute(unsigned int pc, bool trace) {
+    if (core->cache_insn)
+        return trace ? Execute<true, true>(pc) : Execute<false, true>(pc);
+    return trace ? Execute<true, false>(pc) : Execute<false, false>(pc);
+}
+
 avr_op_ADC::avr_op_ADC(word opcode, AvrDevice *c):
     DecodedInstruction(c),
     R1(get_rd_5(opcode)),
@@ -300,9 +327,14 @@ avr_op_BRBC::avr_op_BRBC(word opcode, AvrDevice *c):
 
 int avr_op_BRBC::operator()() {
     int clks;
+    bool taken = (bitmask & (*(status))) == 0;
 
-    if((bitmask & (*(status))) == 0) {
+    if(core->coverage)
+        core->coverage->Branch(core->PC, taken);
+    if(taken) {
         core->DebugOnJump();
+        if(core->loops && (offset < 0))
+            core->loops->OnBackEdge(core->PC, core->PC + 1 + offset, true);
         core->PC += offset;
         clks = 2;
     } else {
@@ -320,9 +352,14 @@ avr_op_BRBS::avr_op_BRBS(word opcode, AvrDevice *c):
 
 int avr_op_BRBS::operator()() {
     int clks;
+    bool taken = (bitmask & (*(status))) != 0;
 
-    if((bitmask & (*(status))) != 0) {
+    if(core->coverage)
+        core->coverage->Branch(core->PC, taken);
+    if(taken) {
         core->DebugOnJump();
+        if(core->loops && (offset < 0))
+            core->loops->OnBackEdge(core->PC, core->PC + 1 + offset, true);
         core->PC += offset;
         clks = 2;
     } else {
@@ -367,10 +404,13 @@ int avr_op_CALL::operator()()
 
     core->stack->m_ThreadList.OnCall();
     core->stack->PushAddr(core->PC + 2);
+    int cycles = core->StackCacheAccess(core->PC_size, true);
     core->DebugOnJump();
+    if(core->profiler)
+        core->profiler->OnCall(k, core->PC + 2);
     core->PC = k - 1;
 
-    return core->PC_size + clkadd;
+    return cycles + core->PC_size + clkadd;
 }
 
 avr_op_CBI::avr_op_CBI(word opcode, AvrDevice *c):
@@ -485,11 +525,13 @@ int avr_op_CPSE::operator()() {
     byte rr = core->GetCoreReg(R2);
     int clks;
 
-    if(core->Flash->DecodedMem[core->PC + 1]->IsInstruction2Words())
+    if(core->Flash->DecodedAt(core->PC + 1)->IsInstruction2Words())
         skip = 3;
     else
         skip = 2;
 
+    if(core->coverage)
+        core->coverage->Branch(core->PC, rd == rr);
     if(rd == rr) {
         core->DebugOnJump();
         core->PC += skip - 1;
@@ -526,19 +568,25 @@ int avr_op_EICALL::operator()() {
 
     core->stack->m_ThreadList.OnCall();
     core->stack->PushAddr(core->PC + 1);
+    int cycles = core->StackCacheAccess(core->PC_size, true);
 
     core->DebugOnJump();
+    if(core->profiler)
+        core->profiler->OnCall(new_PC + 1, core->PC + 1);
     core->PC = new_PC;
 
-    return core->flagXMega ? 3 : 4;
+    return cycles + (core->flagXMega ? 3 : 4);
 }
 
 avr_op_EIJMP::avr_op_EIJMP(word opcode, AvrDevice *c):
     DecodedInstruction(c) {}
 
 int avr_op_EIJMP::operator()() {
+    unsigned int new_pc = (core->eind->GetRegVal() << 16) + core->GetRegZ();
     core->DebugOnJump();
-    core->PC = (core->eind->GetRegVal() << 16) + core->GetRegZ();
+    if(core->loops && (new_pc <= core->PC))
+        core->loops->OnBackEdge(core->PC, new_pc, false);
+    core->PC = new_pc;
 
     return 2;
 }
@@ -555,9 +603,10 @@ int avr_op_ELPM_Z::operator()() {
         rampz = core->rampz->GetRegVal();
     Z = (rampz << 16) + core->GetRegZ();
 
+    int cycles = core->FlashCacheAccess(Z);
     core->SetCoreReg(R1, core->Flash->ReadMem(Z ^ 0x1));
 
-    return 3;
+    return cycles + 3;
 }
 
 avr_op_ELPM_Z_incr::avr_op_ELPM_Z_incr(word opcode, AvrDevice *c):
@@ -572,6 +621,7 @@ int avr_op_ELPM_Z_incr::operator()() {
         rampz = core->rampz->GetRegVal();
     Z = (rampz << 16) + core->GetRegZ();
 
+    int cycles = core->FlashCacheAccess(Z);
     core->SetCoreReg(R1, core->Flash->ReadMem(Z ^ 0x1));
 
     /* post increment Z */
@@ -581,7 +631,7 @@ int avr_op_ELPM_Z_incr::operator()() {
     core->SetCoreReg(30, Z & 0xff);
     core->SetCoreReg(31, (Z >> 8) & 0xff);
 
-    return 3;
+    return cycles + 3;
 }
 
 avr_op_ELPM::avr_op_ELPM(word opcode, AvrDevice *c):
@@ -594,9 +644,10 @@ int avr_op_ELPM::operator()() {
         rampz = core->rampz->GetRegVal();
     unsigned Z = (rampz << 16) + core->GetRegZ();
 
+    int cycles = core->FlashCacheAccess(Z);
     core->SetCoreReg(0, core->Flash->ReadMem(Z ^ 0x1));
 
-    return 3;
+    return cycles + 3;
 }
 
 avr_op_EOR::avr_op_EOR(word opcode, AvrDevice *c):
@@ -722,11 +773,14 @@ int avr_op_ICALL::operator()() {
 
     core->stack->m_ThreadList.OnCall();
     core->stack->PushAddr(pc + 1);
+    int cycles = core->StackCacheAccess(core->PC_size, true);
 
     core->DebugOnJump();
+    if(core->profiler)
+        core->profiler->OnCall(new_pc, pc + 1);
     core->PC = new_pc - 1;
 
-    return core->PC_size + (core->flagXMega ? 0 : 1);
+    return cycles + core->PC_size + (core->flagXMega ? 0 : 1);
 }
 
 avr_op_IJMP::avr_op_IJMP(word opcode, AvrDevice *c):
@@ -736,6 +790,8 @@ int avr_op_IJMP::operator()() {
     int new_pc = core->GetRegZ();
 
     core->DebugOnJump();
+    if(core->loops && (new_pc <= core->PC))
+        core->loops->OnBackEdge(core->PC, new_pc, false);
     core->PC = new_pc - 1;
 
     return 2;
@@ -777,8 +833,11 @@ avr_op_JMP::avr_op_JMP(word opcode, AvrDevice *c):
 
 int avr_op_JMP::operator()() {
     word K_lsb = core->Flash->ReadMemWord((core->PC + 1) * 2);
+    unsigned int new_pc = (K << 16) + K_lsb;
     core->DebugOnJump();
-    core->PC = (K << 16) + K_lsb - 1;
+    if(core->loops && (new_pc <= core->PC))
+        core->loops->OnBackEdge(core->PC, new_pc, false);
+    core->PC = new_pc - 1;
     return 3;
 }
 
@@ -791,9 +850,10 @@ int avr_op_LDD_Y::operator()() {
     /* Y is R29:R28 */
     word Y = core->GetRegY();
 
+    int cycles = core->DataCacheAccess(Y + K, 1, false);
     core->SetCoreReg(Rd, core->GetRWMem(Y + K));
 
-    return ((core->flagXMega || core->flagTiny10) && K == 0) ? 1 : 2;
+    return cycles + (((core->flagXMega || core->flagTiny10) && K == 0) ? 1 : 2);
 }
 
 avr_op_LDD_Z::avr_op_LDD_Z(word opcode, AvrDevice *c):
@@ -805,9 +865,10 @@ int avr_op_LDD_Z::operator()() {
     /* Z is R31:R30 */
     word Z = core->GetRegZ();
 
+    int cycles = core->DataCacheAccess(Z + K, 1, false);
     core->SetCoreReg(Rd, core->GetRWMem(Z + K));
 
-    return ((core->flagXMega || core->flagTiny10) && K == 0) ? 1 : 2;
+    return cycles + (((core->flagXMega || core->flagTiny10) && K == 0) ? 1 : 2);
 }
 
 avr_op_LDI::avr_op_LDI(word opcode, AvrDevice *c):
@@ -832,10 +893,11 @@ int avr_op_LDS::operator()() {
     /* Get data at k in current data segment and put into Rd */
     word offset = core->Flash->ReadMemWord((core->PC + 1) * 2);
 
+    int cycles = core->DataCacheAccess(offset, 1, false);
     core->SetCoreReg(R1, core->GetRWMem(offset));
     core->PC++;
 
-    return 2;
+    return cycles + 2;
 }
 
 avr_op_LD_X::avr_op_LD_X(word opcode, AvrDevice *c):
@@ -846,9 +908,10 @@ int avr_op_LD_X::operator()() {
     /* X is R27:R26 */
     word X = core->GetRegX();
 
+    int cycles = core->DataCacheAccess(X, 1, false);
     core->SetCoreReg(Rd, core->GetRWMem(X));
 
-    return (core->flagXMega || core->flagTiny10) ? 1 : 2;
+    return cycles + ((core->flagXMega || core->flagTiny10) ? 1 : 2);
 }
 
 avr_op_LD_X_decr::avr_op_LD_X_decr(word opcode, AvrDevice *c):
@@ -863,11 +926,12 @@ int avr_op_LD_X_decr::operator()() {
 
     /* Perform pre-decrement */
     X--;
+    int cycles = core->DataCacheAccess(X, 1, false);
     core->SetCoreReg(Rd, core->GetRWMem(X));
     core->SetCoreReg(26, X & 0xff);
     core->SetCoreReg(27, (X >> 8) & 0xff);
 
-    return core->flagTiny10 ? 3 : 2;
+    return cycles + (core->flagTiny10 ? 3 : 2);
 }
 
 avr_op_LD_X_incr::avr_op_LD_X_incr(word opcode, AvrDevice *c):
@@ -881,12 +945,13 @@ int avr_op_LD_X_incr::operator()() {
        avr_error( "Result of operation is undefined" );
 
     /* Perform post-increment */
+    int cycles = core->DataCacheAccess(X, 1, false);
     core->SetCoreReg(Rd, core->GetRWMem(X));
     X++;
     core->SetCoreReg(26, X & 0xff);
     core->SetCoreReg(27, (X >> 8) & 0xff);
 
-    return core->flagXMega ? 1 : 2;
+    return cycles + (core->flagXMega ? 1 : 2);
 }
 
 avr_op_LD_Y_decr::avr_op_LD_Y_decr(word opcode, AvrDevice *c):
@@ -901,11 +966,12 @@ int avr_op_LD_Y_decr::operator()() {
 
     /* Perform pre-decrement */
     Y--;
+    int cycles = core->DataCacheAccess(Y, 1, false);
     core->SetCoreReg(Rd, core->GetRWMem(Y));
     core->SetCoreReg(28, Y & 0xff);
     core->SetCoreReg(29, (Y >> 8) & 0xff);
 
-    return core->flagTiny10 ? 3 : 2;
+    return cycles + (core->flagTiny10 ? 3 : 2);
 }
 
 avr_op_LD_Y_incr::avr_op_LD_Y_incr(word opcode, AvrDevice *c):
@@ -919,12 +985,13 @@ int avr_op_LD_Y_incr::operator()() {
         avr_error( "Result of operation is undefined" );
 
     /* Perform post-increment */
+    int cycles = core->DataCacheAccess(Y, 1, false);
     core->SetCoreReg(Rd, core->GetRWMem(Y));
     Y++;
     core->SetCoreReg(28, Y & 0xff);
     core->SetCoreReg(29, (Y >> 8) & 0xff);
 
-    return core->flagXMega ? 1 : 2;
+    return cycles + (core->flagXMega ? 1 : 2);
 }
 
 avr_op_LD_Z_incr::avr_op_LD_Z_incr(word opcode, AvrDevice *c):
@@ -938,12 +1005,13 @@ int avr_op_LD_Z_incr::operator()() {
         avr_error( "Result of operation is undefined" );
 
     /* Perform post-increment */
+    int cycles = core->DataCacheAccess(Z, 1, false);
     core->SetCoreReg(Rd, core->GetRWMem(Z));
     Z++;
     core->SetCoreReg(30, Z & 0xff);
     core->SetCoreReg(31, (Z >> 8) & 0xff);
 
-    return core->flagXMega ? 1 : 2;
+    return cycles + (core->flagXMega ? 1 : 2);
 }
 
 avr_op_LD_Z_decr::avr_op_LD_Z_decr(word opcode, AvrDevice *c):
@@ -958,11 +1026,12 @@ int avr_op_LD_Z_decr::operator()() {
 
     /* Perform pre-decrement */
     Z--;
+    int cycles = core->DataCacheAccess(Z, 1, false);
     core->SetCoreReg(Rd, core->GetRWMem(Z));
     core->SetCoreReg(30, Z & 0xff);
     core->SetCoreReg(31, (Z >> 8) & 0xff);
 
-    return core->flagTiny10 ? 3 : 2;
+    return cycles + (core->flagTiny10 ? 3 : 2);
 }
 
 avr_op_LPM_Z::avr_op_LPM_Z(word opcode, AvrDevice *c):
@@ -973,10 +1042,11 @@ int  avr_op_LPM_Z::operator()() {
     /* Z is R31:R30 */
     word Z = core->GetRegZ();
 
+    int cycles = core->FlashCacheAccess(Z);
     Z ^= 0x0001;
     core->SetCoreReg(Rd , core->Flash->ReadMem(Z));
 
-    return 3;
+    return cycles + 3;
 }
 
 avr_op_LPM::avr_op_LPM(word opcode, AvrDevice *c):
@@ -986,10 +1056,11 @@ int avr_op_LPM::operator()() {
     /* Z is R31:R30 */
     word Z = core->GetRegZ();
 
+    int cycles = core->FlashCacheAccess(Z);
     Z ^= 0x0001;
     core->SetCoreReg(0 , core->Flash->ReadMem(Z));
 
-    return 3;
+    return cycles + 3;
 }
 
 avr_op_LPM_Z_incr::avr_op_LPM_Z_incr(word opcode, AvrDevice *c):
@@ -1000,13 +1071,14 @@ int avr_op_LPM_Z_incr::operator()() {
     /* Z is R31:R30 */
     word Z = core->GetRegZ();
 
+    int cycles = core->FlashCacheAccess(Z);
     core->SetCoreReg(Rd , core->Flash->ReadMem(Z ^ 0x0001));
 
     Z++;
     core->SetCoreReg(30, Z & 0xff);
     core->SetCoreReg(31, (Z >> 8) & 0xff);
 
-    return 3;
+    return cycles + 3;
 }
 
 avr_op_LSR::avr_op_LSR(word opcode, AvrDevice *c):
@@ -1202,8 +1274,9 @@ avr_op_POP::avr_op_POP(word opcode, AvrDevice *c):
 
 int avr_op_POP::operator()() {
     core->SetCoreReg(R1, core->stack->Pop());
+    int cycles = core->StackCacheAccess(1, false);
 
-    return 2;
+    return cycles + 2;
 }
 
 avr_op_PUSH::avr_op_PUSH(word opcode, AvrDevice *c):
@@ -1212,8 +1285,9 @@ avr_op_PUSH::avr_op_PUSH(word opcode, AvrDevice *c):
 
 int avr_op_PUSH::operator()() {
     core->stack->Push(core->GetCoreReg(R1));
+    int cycles = core->StackCacheAccess(1, true);
 
-    return core->flagXMega ? 1 : 2;
+    return cycles + (core->flagXMega ? 1 : 2);
 }
 
 avr_op_RCALL::avr_op_RCALL(word opcode, AvrDevice *c):
@@ -1221,15 +1295,19 @@ avr_op_RCALL::avr_op_RCALL(word opcode, AvrDevice *c):
     K(n_bit_unsigned_to_signed(get_k_12(opcode), 12)) {}
 
 int avr_op_RCALL::operator()() {
-    core->stack->PushAddr(core->PC + 1);
+    unsigned int returnPc = core->PC + 1;
+    core->stack->PushAddr(returnPc);
+    int cycles = core->StackCacheAccess(core->PC_size, true);
     core->stack->m_ThreadList.OnCall();
     core->DebugOnJump();
     core->PC += K;
     core->PC &= (core->Flash->GetSize() - 1) >> 1;
+    if(core->profiler)
+        core->profiler->OnCall((core->PC + 1) & ((core->Flash->GetSize() - 1) >> 1), returnPc);
 
     if(core->flagTiny10)
-        return 4;
-    return core->PC_size + (core->flagXMega ? 0 : 1);
+        return cycles + 4;
+    return cycles + core->PC_size + (core->flagXMega ? 0 : 1);
 
 }
 
@@ -1237,9 +1315,13 @@ avr_op_RET::avr_op_RET(word opcode, AvrDevice *c):
     DecodedInstruction(c) {}
 
 int avr_op_RET::operator()() {
-    core->PC = core->stack->PopAddr() - 1;
+    unsigned long returnPc = core->stack->PopAddr();
+    int cycles = core->StackCacheAccess(core->PC_size, false);
+    core->PC = returnPc - 1;
+    if(core->profiler)
+        core->profiler->OnReturn(core->PC + 1);
 
-    return core->PC_size + 2;
+    return cycles + core->PC_size + 2;
 }
 
 avr_op_RETI::avr_op_RETI(word opcode, AvrDevice *c):
@@ -1247,10 +1329,14 @@ avr_op_RETI::avr_op_RETI(word opcode, AvrDevice *c):
     status(c->status) {}
 
 int avr_op_RETI::operator()() {
-    core->PC = core->stack->PopAddr() - 1;
+    unsigned long returnPc = core->stack->PopAddr();
+    int cycles = core->StackCacheAccess(core->PC_size, false);
+    core->PC = returnPc - 1;
+    if(core->profiler)
+        core->profiler->OnReturn(core->PC + 1);
     status->I = 1;
 
-    return core->PC_size + 2;
+    return cycles + core->PC_size + 2;
 }
 
 avr_op_RJMP::avr_op_RJMP(word opcode, AvrDevice *c):
@@ -1259,6 +1345,8 @@ avr_op_RJMP::avr_op_RJMP(word opcode, AvrDevice *c):
 
 int avr_op_RJMP::operator()() {
     core->DebugOnJump();
+    if(core->loops && (K < 0))
+        core->loops->OnBackEdge(core->PC, (core->PC + 1 + K) & ((core->Flash->GetSize() - 1) >> 1), false);
     core->PC += K;
     core->PC &= (core->Flash->GetSize() - 1) >> 1;
 
@@ -1365,12 +1453,15 @@ avr_op_SBIC::avr_op_SBIC(word opcode, AvrDevice *c):
 int avr_op_SBIC::operator()() {
     int skip, clks;
 
-    if(core->Flash->DecodedMem[core->PC + 1]->IsInstruction2Words())
+    if(core->Flash->DecodedAt(core->PC + 1)->IsInstruction2Words())
         skip = 3;
     else
         skip = 2;
 
-    if((core->GetIOReg(ioreg) & (1 << Kbit)) == 0) {
+    bool taken = (core->GetIOReg(ioreg) & (1 << Kbit)) == 0;
+    if(core->coverage)
+        core->coverage->Branch(core->PC, taken);
+    if(taken) {
         core->DebugOnJump();
         core->PC += skip - 1;
         clks = skip;
@@ -1391,12 +1482,15 @@ avr_op_SBIS::avr_op_SBIS(word opcode, AvrDevice *c):
 int avr_op_SBIS::operator()() {
     int skip, clks;
 
-    if(core->Flash->DecodedMem[core->PC + 1]->IsInstruction2Words())
+    if(core->Flash->DecodedAt(core->PC + 1)->IsInstruction2Words())
         skip = 3;
     else
         skip = 2;
 
-    if((core->GetIOReg(ioreg) & (1 << Kbit)) != 0) {
+    bool taken = (core->GetIOReg(ioreg) & (1 << Kbit)) != 0;
+    if(core->coverage)
+        core->coverage->Branch(core->PC, taken);
+    if(taken) {
         core->DebugOnJump();
         core->PC += skip - 1;
         clks = skip;
@@ -1449,12 +1543,15 @@ avr_op_SBRC::avr_op_SBRC(word opcode, AvrDevice *c):
 int avr_op_SBRC::operator()() {
     int skip, clks;
 
-    if(core->Flash->DecodedMem[core->PC + 1]->IsInstruction2Words())
+    if(core->Flash->DecodedAt(core->PC + 1)->IsInstruction2Words())
         skip = 3;
     else
         skip = 2;
 
-    if((core->GetCoreReg(R1) & (1 << Kbit)) == 0) {
+    bool taken = (core->GetCoreReg(R1) & (1 << Kbit)) == 0;
+    if(core->coverage)
+        core->coverage->Branch(core->PC, taken);
+    if(taken) {
         core->DebugOnJump();
         core->PC += skip - 1;
         clks = skip;
@@ -1472,12 +1569,15 @@ avr_op_SBRS::avr_op_SBRS(word opcode, AvrDevice *c):
 int avr_op_SBRS::operator()() {
     int skip, clks;
 
-    if(core->Flash->DecodedMem[core->PC + 1]->IsInstruction2Words())
+    if(core->Flash->DecodedAt(core->PC + 1)->IsInstruction2Words())
         skip = 3;
     else
         skip = 2;
 
-    if((core->GetCoreReg(R1) & (1 << Kbit)) != 0) {
+    bool taken = (core->GetCoreReg(R1) & (1 << Kbit)) != 0;
+    if(core->coverage)
+        core->coverage->Branch(core->PC, taken);
+    if(taken) {
         core->DebugOnJump();
         core->PC += skip - 1;
         clks = skip;
@@ -1540,9 +1640,10 @@ int avr_op_STD_Y::operator()() {
     /* Y is R29:R28 */
     unsigned int Y = core->GetRegY();
 
+    int cycles = core->DataCacheAccess(Y + K, 1, true);
     core->SetRWMem(Y + K, core->GetCoreReg(R1));
 
-    return (K == 0 && (core->flagXMega || core->flagTiny10)) ? 1 : 2;
+    return cycles + ((K == 0 && (core->flagXMega || core->flagTiny10)) ? 1 : 2);
 }
 
 avr_op_STD_Z::avr_op_STD_Z(word opcode, AvrDevice *c):
@@ -1554,9 +1655,10 @@ int avr_op_STD_Z::operator()() {
     /* Z is R31:R30 */
     int Z = core->GetRegZ();
 
+    int cycles = core->DataCacheAccess(Z + K, 1, true);
     core->SetRWMem(Z + K, core->GetCoreReg(R1));
 
-    return (K == 0 && (core->flagXMega || core->flagTiny10)) ? 1 : 2;
+    return cycles + ((K == 0 && (core->flagXMega || core->flagTiny10)) ? 1 : 2);
 }
 
 avr_op_STS::avr_op_STS(word opcode, AvrDevice *c):
@@ -1567,10 +1669,11 @@ int avr_op_STS::operator()() {
     /* Get data at k in current data segment and put into Rd */
     word k = core->Flash->ReadMemWord((core->PC + 1) * 2);
 
+    int cycles = core->DataCacheAccess(k, 1, true);
     core->SetRWMem(k, core->GetCoreReg(R1));
     core->PC++;
 
-    return 2;
+    return cycles + 2;
 }
 
 avr_op_ST_X::avr_op_ST_X(word opcode, AvrDevice *c):
@@ -1581,9 +1684,10 @@ int avr_op_ST_X::operator()() {
     /* X is R27:R26 */
     word X = core->GetRegX();
 
+    int cycles = core->DataCacheAccess(X, 1, true);
     core->SetRWMem(X, core->GetCoreReg(R1));
 
-    return (core->flagXMega || core->flagTiny10) ? 1 : 2;
+    return cycles + ((core->flagXMega || core->flagTiny10) ? 1 : 2);
 }
 
 avr_op_ST_X_decr::avr_op_ST_X_decr(word opcode, AvrDevice *c):
@@ -1600,9 +1704,10 @@ int avr_op_ST_X_decr::operator()() {
     X--;
     core->SetCoreReg(26, X & 0xff);
     core->SetCoreReg(27, (X >> 8) & 0xff);
+    int cycles = core->DataCacheAccess(X, 1, true);
     core->SetRWMem(X, core->GetCoreReg(R1));
 
-    return 2;
+    return cycles + 2;
 }
 
 avr_op_ST_X_incr::avr_op_ST_X_incr(word opcode, AvrDevice *c):
@@ -1615,6 +1720,7 @@ int avr_op_ST_X_incr::operator()() {
     if (R1 == 26 || R1 == 27)
         avr_error( "Result of operation is undefined" );
 
+    int cycles = core->DataCacheAccess(X, 1, true);
     core->SetRWMem(X, core->GetCoreReg(R1));
 
     /* Perform post-increment */
@@ -1622,7 +1728,7 @@ int avr_op_ST_X_incr::operator()() {
     core->SetCoreReg(26, X & 0xff);
     core->SetCoreReg(27, (X >> 8) & 0xff);
 
-    return (core->flagXMega || core->flagTiny10) ? 1 : 2;
+    return cycles + ((core->flagXMega || core->flagTiny10) ? 1 : 2);
 }
 
 avr_op_ST_Y_decr::avr_op_ST_Y_decr(word opcode, AvrDevice *c):
@@ -1639,9 +1745,10 @@ int avr_op_ST_Y_decr::operator()() {
     Y--;
     core->SetCoreReg(28, Y & 0xff);
     core->SetCoreReg(29, (Y >> 8) & 0xff);
+    int cycles = core->DataCacheAccess(Y, 1, true);
     core->SetRWMem(Y, core->GetCoreReg(R1));
 
-    return 2;
+    return cycles + 2;
 }
 
 avr_op_ST_Y_incr::avr_op_ST_Y_incr(word opcode, AvrDevice *c):
@@ -1654,6 +1761,7 @@ int avr_op_ST_Y_incr::operator()() {
     if (R1 == 28 || R1 == 29)
         avr_error( "Result of operation is undefined" );
 
+    int cycles = core->DataCacheAccess(Y, 1, true);
     core->SetRWMem(Y, core->GetCoreReg(R1));
 
     /* Perform post-increment */
@@ -1661,7 +1769,7 @@ int avr_op_ST_Y_incr::operator()() {
     core->SetCoreReg(28, Y & 0xff);
     core->SetCoreReg(29, (Y >> 8) & 0xff);
 
-    return (core->flagXMega || core->flagTiny10) ? 1 : 2;
+    return cycles + ((core->flagXMega || core->flagTiny10) ? 1 : 2);
 }
 
 avr_op_ST_Z_decr::avr_op_ST_Z_decr(word opcode, AvrDevice *c):
@@ -1678,9 +1786,10 @@ int avr_op_ST_Z_decr::operator()() {
     Z--;
     core->SetCoreReg(30, Z & 0xff);
     core->SetCoreReg(31, (Z >> 8) & 0xff);
+    int cycles = core->DataCacheAccess(Z, 1, true);
     core->SetRWMem(Z, core->GetCoreReg(R1));
 
-    return 2;
+    return cycles + 2;
 }
 
 avr_op_ST_Z_incr::avr_op_ST_Z_incr(word opcode, AvrDevice *c):
@@ -1693,6 +1802,7 @@ int avr_op_ST_Z_incr::operator()() {
     if (R1 == 30 || R1 == 31)
         avr_error( "Result of operation is undefined" );
 
+    int cycles = core->DataCacheAccess(Z, 1, true);
     core->SetRWMem(Z, core->GetCoreReg(R1));
 
     /* Perform post-increment */
@@ -1700,7 +1810,7 @@ int avr_op_ST_Z_incr::operator()() {
     core->SetCoreReg(30, Z & 0xff);
     core->SetCoreReg(31, (Z >> 8) & 0xff);
 
-    return (core->flagXMega || core->flagTiny10) ? 1 : 2;
+    return cycles + ((core->flagXMega || core->flagTiny10) ? 1 : 2);
 }
 
 avr_op_SUB::avr_op_SUB(word opcode, AvrDevice *c):
@@ -1970,234 +2080,234 @@ DecodedInstruction* lookup_opcode( word opcode, AvrDevice *core )
         /* opcodes with no operands */
         case 0x9519:
             if(core->flagEIJMPInstructions)
-                return new avr_op_EICALL(opcode, core);                    /* 1001 0101 0001 1001 | EICALL */
+                return new_insn<avr_op_EICALL>(opcode, core);              /* 1001 0101 0001 1001 | EICALL */
             else
-                return new avr_op_ILLEGAL(opcode, core);
+                return new_insn<avr_op_ILLEGAL>(opcode, core);
         case 0x9419:
             if(core->flagEIJMPInstructions)
-                return new avr_op_EIJMP(opcode, core);                     /* 1001 0100 0001 1001 | EIJMP */
+                return new_insn<avr_op_EIJMP>(opcode, core);               /* 1001 0100 0001 1001 | EIJMP */
             else
-                return new avr_op_ILLEGAL(opcode, core);
+                return new_insn<avr_op_ILLEGAL>(opcode, core);
         case 0x95D8:
             if(core->flagELPMInstructions)
-                return new avr_op_ELPM(opcode, core);                      /* 1001 0101 1101 1000 | ELPM */
+                return new_insn<avr_op_ELPM>(opcode, core);                /* 1001 0101 1101 1000 | ELPM */
             else
-                return new avr_op_ILLEGAL(opcode, core);
+                return new_insn<avr_op_ILLEGAL>(opcode, core);
         case 0x95F8:
             if(core->flagLPMInstructions)
-                return new avr_op_ESPM(opcode, core);                      /* 1001 0101 1111 1000 | ESPM */
+                return new_insn<avr_op_ESPM>(opcode, core);                /* 1001 0101 1111 1000 | ESPM */
             else
-                return new avr_op_ILLEGAL(opcode, core);
+                return new_insn<avr_op_ILLEGAL>(opcode, core);
         case 0x9509:
             if(core->flagIJMPInstructions)
-                return new avr_op_ICALL(opcode, core);                     /* 1001 0101 0000 1001 | ICALL */
+                return new_insn<avr_op_ICALL>(opcode, core);               /* 1001 0101 0000 1001 | ICALL */
             else
-                return new avr_op_ILLEGAL(opcode, core);
+                return new_insn<avr_op_ILLEGAL>(opcode, core);
         case 0x9409:
             if(core->flagIJMPInstructions)
-                return new avr_op_IJMP(opcode, core);                      /* 1001 0100 0000 1001 | IJMP */
+                return new_insn<avr_op_IJMP>(opcode, core);                /* 1001 0100 0000 1001 | IJMP */
             else
-                return new avr_op_ILLEGAL(opcode, core);
+                return new_insn<avr_op_ILLEGAL>(opcode, core);
         case 0x95C8:
             if(!core->flagTiny10)
                 /* except tiny10, all devices provide LPM instruction! */
-                return new avr_op_LPM(opcode, core);                       /* 1001 0101 1100 1000 | LPM */
+                return new_insn<avr_op_LPM>(opcode, core);                 /* 1001 0101 1100 1000 | LPM */
             else
-                return new avr_op_ILLEGAL(opcode, core);
-        case 0x0000: return new  avr_op_NOP(opcode, core);                 /* 0000 0000 0000 0000 | NOP */
-        case 0x9508: return new  avr_op_RET(opcode, core);                 /* 1001 0101 0000 1000 | RET */
-        case 0x9518: return new  avr_op_RETI(opcode, core);                /* 1001 0101 0001 1000 | RETI */
-        case 0x9588: return new  avr_op_SLEEP(opcode, core);               /* 1001 0101 1000 1000 | SLEEP */
+                return new_insn<avr_op_ILLEGAL>(opcode, core);
+        case 0x0000: return new_insn<avr_op_NOP>(opcode, core);            /* 0000 0000 0000 0000 | NOP */
+        case 0x9508: return new_insn<avr_op_RET>(opcode, core);            /* 1001 0101 0000 1000 | RET */
+        case 0x9518: return new_insn<avr_op_RETI>(opcode, core);           /* 1001 0101 0001 1000 | RETI */
+        case 0x9588: return new_insn<avr_op_SLEEP>(opcode, core);          /* 1001 0101 1000 1000 | SLEEP */
         case 0x95E8:
             if(core->flagLPMInstructions)
-                return new avr_op_SPM(opcode, core);                       /* 1001 0101 1110 1000 | SPM */
+                return new_insn<avr_op_SPM>(opcode, core);                 /* 1001 0101 1110 1000 | SPM */
             else
-                return new avr_op_ILLEGAL(opcode, core);
-        case 0x95A8: return new  avr_op_WDR(opcode, core);                 /* 1001 0101 1010 1000 | WDR */
-        case 0x9598: return new  avr_op_BREAK(opcode, core);               /* 1001 0101 1001 1000 | BREAK */
+                return new_insn<avr_op_ILLEGAL>(opcode, core);
+        case 0x95A8: return new_insn<avr_op_WDR>(opcode, core);            /* 1001 0101 1010 1000 | WDR */
+        case 0x9598: return new_insn<avr_op_BREAK>(opcode, core);          /* 1001 0101 1001 1000 | BREAK */
         default:
                      {
                          /* opcodes with two 5-bit register (Rd and Rr) operands */
                          decode = opcode & ~(mask_Rd_5 | mask_Rr_5);
                          switch ( decode ) {
-                             case 0x1C00: return new  avr_op_ADC(opcode, core);         /* 0001 11rd dddd rrrr | ADC or ROL */
-                             case 0x0C00: return new  avr_op_ADD(opcode, core);         /* 0000 11rd dddd rrrr | ADD or LSL */
-                             case 0x2000: return new  avr_op_AND(opcode, core);         /* 0010 00rd dddd rrrr | AND or TST */
-                             case 0x1400: return new  avr_op_CP(opcode, core);          /* 0001 01rd dddd rrrr | CP */
-                             case 0x0400: return new  avr_op_CPC(opcode, core);         /* 0000 01rd dddd rrrr | CPC */
-                             case 0x1000: return new  avr_op_CPSE(opcode, core);        /* 0001 00rd dddd rrrr | CPSE */
-                             case 0x2400: return new  avr_op_EOR(opcode, core);         /* 0010 01rd dddd rrrr | EOR or CLR */
-                             case 0x2C00: return new  avr_op_MOV(opcode, core);         /* 0010 11rd dddd rrrr | MOV */
+                             case 0x1C00: return new_insn<avr_op_ADC>(opcode, core);    /* 0001 11rd dddd rrrr | ADC or ROL */
+                             case 0x0C00: return new_insn<avr_op_ADD>(opcode, core);    /* 0000 11rd dddd rrrr | ADD or LSL */
+                             case 0x2000: return new_insn<avr_op_AND>(opcode, core);    /* 0010 00rd dddd rrrr | AND or TST */
+                             case 0x1400: return new_insn<avr_op_CP>(opcode, core);     /* 0001 01rd dddd rrrr | CP */
+                             case 0x0400: return new_insn<avr_op_CPC>(opcode, core);    /* 0000 01rd dddd rrrr | CPC */
+                             case 0x1000: return new_insn<avr_op_CPSE>(opcode, core);   /* 0001 00rd dddd rrrr | CPSE */
+                             case 0x2400: return new_insn<avr_op_EOR>(opcode, core);    /* 0010 01rd dddd rrrr | EOR or CLR */
+                             case 0x2C00: return new_insn<avr_op_MOV>(opcode, core);    /* 0010 11rd dddd rrrr | MOV */
                              case 0x9C00:
                                  if(core->flagMULInstructions)
-                                     return new avr_op_MUL(opcode, core);               /* 1001 11rd dddd rrrr | MUL */
+                                     return new_insn<avr_op_MUL>(opcode, core);         /* 1001 11rd dddd rrrr | MUL */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
-                             case 0x2800: return new  avr_op_OR(opcode, core);          /* 0010 10rd dddd rrrr | OR */
-                             case 0x0800: return new  avr_op_SBC(opcode, core);         /* 0000 10rd dddd rrrr | SBC */
-                             case 0x1800: return new  avr_op_SUB(opcode, core);         /* 0001 10rd dddd rrrr | SUB */
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
+                             case 0x2800: return new_insn<avr_op_OR>(opcode, core);     /* 0010 10rd dddd rrrr | OR */
+                             case 0x0800: return new_insn<avr_op_SBC>(opcode, core);    /* 0000 10rd dddd rrrr | SBC */
+                             case 0x1800: return new_insn<avr_op_SUB>(opcode, core);    /* 0001 10rd dddd rrrr | SUB */
                          }
 
                          /* opcode with a single register (Rd) as operand */
                          decode = opcode & ~(mask_Rd_5);
                          switch (decode) {
-                             case 0x9405: return new  avr_op_ASR(opcode, core);         /* 1001 010d dddd 0101 | ASR */
-                             case 0x9400: return new  avr_op_COM(opcode, core);         /* 1001 010d dddd 0000 | COM */
-                             case 0x940A: return new  avr_op_DEC(opcode, core);         /* 1001 010d dddd 1010 | DEC */
+                             case 0x9405: return new_insn<avr_op_ASR>(opcode, core);    /* 1001 010d dddd 0101 | ASR */
+                             case 0x9400: return new_insn<avr_op_COM>(opcode, core);    /* 1001 010d dddd 0000 | COM */
+                             case 0x940A: return new_insn<avr_op_DEC>(opcode, core);    /* 1001 010d dddd 1010 | DEC */
                              case 0x9006:
                                  if(core->flagELPMInstructions)
-                                     return new avr_op_ELPM_Z(opcode, core);            /* 1001 000d dddd 0110 | ELPM */
+                                     return new_insn<avr_op_ELPM_Z>(opcode, core);      /* 1001 000d dddd 0110 | ELPM */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x9007:
                                  if(core->flagELPMInstructions)
-                                     return new avr_op_ELPM_Z_incr(opcode, core);       /* 1001 000d dddd 0111 | ELPM */
+                                     return new_insn<avr_op_ELPM_Z_incr>(opcode, core); /* 1001 000d dddd 0111 | ELPM */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
-                             case 0x9403: return new  avr_op_INC(opcode, core);         /* 1001 010d dddd 0011 | INC */
-                             case 0x9000: return new  avr_op_LDS(opcode, core);         /* 1001 000d dddd 0000 | LDS */
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
+                             case 0x9403: return new_insn<avr_op_INC>(opcode, core);    /* 1001 010d dddd 0011 | INC */
+                             case 0x9000: return new_insn<avr_op_LDS>(opcode, core);    /* 1001 000d dddd 0000 | LDS */
                              case 0x900C:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_LD_X(opcode, core);              /* 1001 000d dddd 1100 | LD */
+                                     return new_insn<avr_op_LD_X>(opcode, core);        /* 1001 000d dddd 1100 | LD */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x900E:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_LD_X_decr(opcode, core);         /* 1001 000d dddd 1110 | LD */
+                                     return new_insn<avr_op_LD_X_decr>(opcode, core);   /* 1001 000d dddd 1110 | LD */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x900D:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_LD_X_incr(opcode, core);         /* 1001 000d dddd 1101 | LD */
+                                     return new_insn<avr_op_LD_X_incr>(opcode, core);   /* 1001 000d dddd 1101 | LD */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x8008:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_LDD_Y(opcode, core);             /* 1000 000d dddd 1000 | LD */
+                                     return new_insn<avr_op_LDD_Y>(opcode, core);       /* 1000 000d dddd 1000 | LD */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x900A:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_LD_Y_decr(opcode, core);         /* 1001 000d dddd 1010 | LD */
+                                     return new_insn<avr_op_LD_Y_decr>(opcode, core);   /* 1001 000d dddd 1010 | LD */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x9009:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_LD_Y_incr(opcode, core);         /* 1001 000d dddd 1001 | LD */
+                                     return new_insn<avr_op_LD_Y_incr>(opcode, core);   /* 1001 000d dddd 1001 | LD */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
-                             case 0x8000: return new avr_op_LDD_Z(opcode, core);        /* 1000 000d dddd 0000 | LD */
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
+                             case 0x8000: return new_insn<avr_op_LDD_Z>(opcode, core);  /* 1000 000d dddd 0000 | LD */
                              case 0x9002:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_LD_Z_decr(opcode, core);         /* 1001 000d dddd 0010 | LD */
+                                     return new_insn<avr_op_LD_Z_decr>(opcode, core);   /* 1001 000d dddd 0010 | LD */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x9001:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_LD_Z_incr(opcode, core);         /* 1001 000d dddd 0001 | LD */
+                                     return new_insn<avr_op_LD_Z_incr>(opcode, core);   /* 1001 000d dddd 0001 | LD */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x9004:
                                  if(core->flagLPMInstructions)
-                                     return new avr_op_LPM_Z(opcode, core);             /* 1001 000d dddd 0100 | LPM */
+                                     return new_insn<avr_op_LPM_Z>(opcode, core);       /* 1001 000d dddd 0100 | LPM */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x9005:
                                  if(core->flagLPMInstructions)
-                                     return new avr_op_LPM_Z_incr(opcode, core);        /* 1001 000d dddd 0101 | LPM */
+                                     return new_insn<avr_op_LPM_Z_incr>(opcode, core);  /* 1001 000d dddd 0101 | LPM */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
-                             case 0x9406: return new  avr_op_LSR(opcode, core);         /* 1001 010d dddd 0110 | LSR */
-                             case 0x9401: return new  avr_op_NEG(opcode, core);         /* 1001 010d dddd 0001 | NEG */
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
+                             case 0x9406: return new_insn<avr_op_LSR>(opcode, core);    /* 1001 010d dddd 0110 | LSR */
+                             case 0x9401: return new_insn<avr_op_NEG>(opcode, core);    /* 1001 010d dddd 0001 | NEG */
                              case 0x900F:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_POP(opcode, core);               /* 1001 000d dddd 1111 | POP */
+                                     return new_insn<avr_op_POP>(opcode, core);         /* 1001 000d dddd 1111 | POP */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x920F:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_PUSH(opcode, core);              /* 1001 001d dddd 1111 | PUSH */
+                                     return new_insn<avr_op_PUSH>(opcode, core);        /* 1001 001d dddd 1111 | PUSH */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
-                             case 0x9407: return new  avr_op_ROR(opcode, core);         /* 1001 010d dddd 0111 | ROR */
-                             case 0x9200: return new  avr_op_STS(opcode, core);         /* 1001 001d dddd 0000 | STS */
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
+                             case 0x9407: return new_insn<avr_op_ROR>(opcode, core);    /* 1001 010d dddd 0111 | ROR */
+                             case 0x9200: return new_insn<avr_op_STS>(opcode, core);    /* 1001 001d dddd 0000 | STS */
                              case 0x920C:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_ST_X(opcode, core);              /* 1001 001d dddd 1100 | ST */
+                                     return new_insn<avr_op_ST_X>(opcode, core);        /* 1001 001d dddd 1100 | ST */
                              case 0x920E:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_ST_X_decr(opcode, core);         /* 1001 001d dddd 1110 | ST */
+                                     return new_insn<avr_op_ST_X_decr>(opcode, core);   /* 1001 001d dddd 1110 | ST */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x920D:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_ST_X_incr(opcode, core);         /* 1001 001d dddd 1101 | ST */
+                                     return new_insn<avr_op_ST_X_incr>(opcode, core);   /* 1001 001d dddd 1101 | ST */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x8208:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_STD_Y(opcode, core);             /* 1000 001d dddd 1000 | ST */
+                                     return new_insn<avr_op_STD_Y>(opcode, core);       /* 1000 001d dddd 1000 | ST */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x920A:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_ST_Y_decr(opcode, core);         /* 1001 001d dddd 1010 | ST */
+                                     return new_insn<avr_op_ST_Y_decr>(opcode, core);   /* 1001 001d dddd 1010 | ST */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x9209:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_ST_Y_incr(opcode, core);         /* 1001 001d dddd 1001 | ST */
+                                     return new_insn<avr_op_ST_Y_incr>(opcode, core);   /* 1001 001d dddd 1001 | ST */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
-                             case 0x8200: return new  avr_op_STD_Z(opcode, core);       /* 1000 001d dddd 0000 | ST */
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
+                             case 0x8200: return new_insn<avr_op_STD_Z>(opcode, core);  /* 1000 001d dddd 0000 | ST */
                              case 0x9202:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_ST_Z_decr(opcode, core);         /* 1001 001d dddd 0010 | ST */
+                                     return new_insn<avr_op_ST_Z_decr>(opcode, core);   /* 1001 001d dddd 0010 | ST */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x9201:
                                  if(!core->flagTiny1x)
-                                     return new avr_op_ST_Z_incr(opcode, core);         /* 1001 001d dddd 0001 | ST */
+                                     return new_insn<avr_op_ST_Z_incr>(opcode, core);   /* 1001 001d dddd 0001 | ST */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
-                             case 0x9402: return new  avr_op_SWAP(opcode, core);        /* 1001 010d dddd 0010 | SWAP */
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
+                             case 0x9402: return new_insn<avr_op_SWAP>(opcode, core);   /* 1001 010d dddd 0010 | SWAP */
                          }
 
                          /* opcodes with a register (Rd) and a constant data (K) as operands */
                          decode = opcode & ~(mask_Rd_4 | mask_K_8);
                          switch ( decode ) {
-                             case 0x7000: return new  avr_op_ANDI(opcode, core);        /* 0111 KKKK dddd KKKK | CBR or ANDI */
-                             case 0x3000: return new  avr_op_CPI(opcode, core);         /* 0011 KKKK dddd KKKK | CPI */
-                             case 0xE000: return new  avr_op_LDI(opcode, core);         /* 1110 KKKK dddd KKKK | LDI or SER */
-                             case 0x6000: return new  avr_op_ORI(opcode, core);         /* 0110 KKKK dddd KKKK | SBR or ORI */
-                             case 0x4000: return new  avr_op_SBCI(opcode, core);        /* 0100 KKKK dddd KKKK | SBCI */
-                             case 0x5000: return new  avr_op_SUBI(opcode, core);        /* 0101 KKKK dddd KKKK | SUBI */
+                             case 0x7000: return new_insn<avr_op_ANDI>(opcode, core);   /* 0111 KKKK dddd KKKK | CBR or ANDI */
+                             case 0x3000: return new_insn<avr_op_CPI>(opcode, core);    /* 0011 KKKK dddd KKKK | CPI */
+                             case 0xE000: return new_insn<avr_op_LDI>(opcode, core);    /* 1110 KKKK dddd KKKK | LDI or SER */
+                             case 0x6000: return new_insn<avr_op_ORI>(opcode, core);    /* 0110 KKKK dddd KKKK | SBR or ORI */
+                             case 0x4000: return new_insn<avr_op_SBCI>(opcode, core);   /* 0100 KKKK dddd KKKK | SBCI */
+                             case 0x5000: return new_insn<avr_op_SUBI>(opcode, core);   /* 0101 KKKK dddd KKKK | SUBI */
                          }
 
                          /* opcodes with a register (Rd) and a register bit number (b) as operands */
                          decode = opcode & ~(mask_Rd_5 | mask_reg_bit);
                          switch ( decode ) {
-                             case 0xF800: return new  avr_op_BLD(opcode, core);         /* 1111 100d dddd 0bbb | BLD */
-                             case 0xFA00: return new  avr_op_BST(opcode, core);         /* 1111 101d dddd 0bbb | BST */
-                             case 0xFC00: return new  avr_op_SBRC(opcode, core);        /* 1111 110d dddd 0bbb | SBRC */
-                             case 0xFE00: return new  avr_op_SBRS(opcode, core);        /* 1111 111d dddd 0bbb | SBRS */
+                             case 0xF800: return new_insn<avr_op_BLD>(opcode, core);    /* 1111 100d dddd 0bbb | BLD */
+                             case 0xFA00: return new_insn<avr_op_BST>(opcode, core);    /* 1111 101d dddd 0bbb | BST */
+                             case 0xFC00: return new_insn<avr_op_SBRC>(opcode, core);   /* 1111 110d dddd 0bbb | SBRC */
+                             case 0xFE00: return new_insn<avr_op_SBRS>(opcode, core);   /* 1111 111d dddd 0bbb | SBRS */
                          }
 
                          /* opcodes with a relative 7-bit address (k) and a register bit number (b) as operands */
                          decode = opcode & ~(mask_k_7 | mask_reg_bit);
                          switch ( decode ) {
-                             case 0xF400: return new  avr_op_BRBC(opcode, core);        /* 1111 01kk kkkk kbbb | BRBC */
-                             case 0xF000: return new  avr_op_BRBS(opcode, core);        /* 1111 00kk kkkk kbbb | BRBS */
+                             case 0xF400: return new_insn<avr_op_BRBC>(opcode, core);   /* 1111 01kk kkkk kbbb | BRBC */
+                             case 0xF000: return new_insn<avr_op_BRBS>(opcode, core);   /* 1111 00kk kkkk kbbb | BRBS */
                          }
 
                          /* opcodes with a 6-bit address displacement (q) and a register (Rd) as operands */
                          if(!core->flagTiny10 && !core->flagTiny1x) {
                              decode = opcode & ~(mask_Rd_5 | mask_q_displ);
                              switch ( decode ) {
-                                 case 0x8008: return new  avr_op_LDD_Y(opcode, core);   /* 10q0 qq0d dddd 1qqq | LDD */
-                                 case 0x8000: return new  avr_op_LDD_Z(opcode, core);   /* 10q0 qq0d dddd 0qqq | LDD */
-                                 case 0x8208: return new  avr_op_STD_Y(opcode, core);   /* 10q0 qq1d dddd 1qqq | STD */
-                                 case 0x8200: return new  avr_op_STD_Z(opcode, core);   /* 10q0 qq1d dddd 0qqq | STD */
+                                 case 0x8008: return new_insn<avr_op_LDD_Y>(opcode, core); /* 10q0 qq0d dddd 1qqq | LDD */
+                                 case 0x8000: return new_insn<avr_op_LDD_Z>(opcode, core); /* 10q0 qq0d dddd 0qqq | LDD */
+                                 case 0x8208: return new_insn<avr_op_STD_Y>(opcode, core); /* 10q0 qq1d dddd 1qqq | STD */
+                                 case 0x8200: return new_insn<avr_op_STD_Z>(opcode, core); /* 10q0 qq1d dddd 0qqq | STD */
                              }
                          }
 
@@ -2206,14 +2316,14 @@ DecodedInstruction* lookup_opcode( word opcode, AvrDevice *core )
                          switch ( decode ) {
                              case 0x940E:
                                  if(core->flagJMPInstructions)
-                                     return new avr_op_CALL(opcode, core);              /* 1001 010k kkkk 111k | CALL */
+                                     return new_insn<avr_op_CALL>(opcode, core);        /* 1001 010k kkkk 111k | CALL */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x940C:
                                  if(core->flagJMPInstructions)
-                                     return new avr_op_JMP(opcode, core);               /* 1001 010k kkkk 110k | JMP */
+                                     return new_insn<avr_op_JMP>(opcode, core);         /* 1001 010k kkkk 110k | JMP */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                          }
 
                          /* opcode with a sreg bit select (s) operand */
@@ -2221,8 +2331,8 @@ DecodedInstruction* lookup_opcode( word opcode, AvrDevice *core )
                          switch ( decode ) {
                              /* BCLR takes place of CL{C,Z,N,V,S,H,T,I} */
                              /* BSET takes place of SE{C,Z,N,V,S,H,T,I} */
-                             case 0x9488: return new  avr_op_BCLR(opcode, core);        /* 1001 0100 1sss 1000 | BCLR */
-                             case 0x9408: return new  avr_op_BSET(opcode, core);        /* 1001 0100 0sss 1000 | BSET */
+                             case 0x9488: return new_insn<avr_op_BCLR>(opcode, core);   /* 1001 0100 1sss 1000 | BCLR */
+                             case 0x9408: return new_insn<avr_op_BSET>(opcode, core);   /* 1001 0100 0sss 1000 | BSET */
                          }
 
                          /* opcodes with a 6-bit constant (K) and a register (Rd) as operands */
@@ -2230,37 +2340,37 @@ DecodedInstruction* lookup_opcode( word opcode, AvrDevice *core )
                          switch ( decode ) {
                              case 0x9600:
                                  if(core->flagIWInstructions)
-                                     return new avr_op_ADIW(opcode, core);              /* 1001 0110 KKdd KKKK | ADIW */
+                                     return new_insn<avr_op_ADIW>(opcode, core);        /* 1001 0110 KKdd KKKK | ADIW */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x9700:
                                  if(core->flagIWInstructions)
-                                     return new avr_op_SBIW(opcode, core);              /* 1001 0111 KKdd KKKK | SBIW */
+                                     return new_insn<avr_op_SBIW>(opcode, core);        /* 1001 0111 KKdd KKKK | SBIW */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                          }
 
                          /* opcodes with a 5-bit IO Addr (A) and register bit number (b) as operands */
                          decode = opcode & ~(mask_A_5 | mask_reg_bit);
                          switch ( decode ) {
-                             case 0x9800: return new  avr_op_CBI(opcode, core);         /* 1001 1000 AAAA Abbb | CBI */
-                             case 0x9A00: return new  avr_op_SBI(opcode, core);         /* 1001 1010 AAAA Abbb | SBI */
-                             case 0x9900: return new  avr_op_SBIC(opcode, core);        /* 1001 1001 AAAA Abbb | SBIC */
-                             case 0x9B00: return new  avr_op_SBIS(opcode, core);        /* 1001 1011 AAAA Abbb | SBIS */
+                             case 0x9800: return new_insn<avr_op_CBI>(opcode, core);    /* 1001 1000 AAAA Abbb | CBI */
+                             case 0x9A00: return new_insn<avr_op_SBI>(opcode, core);    /* 1001 1010 AAAA Abbb | SBI */
+                             case 0x9900: return new_insn<avr_op_SBIC>(opcode, core);   /* 1001 1001 AAAA Abbb | SBIC */
+                             case 0x9B00: return new_insn<avr_op_SBIS>(opcode, core);   /* 1001 1011 AAAA Abbb | SBIS */
                          }
 
                          /* opcodes with a 6-bit IO Addr (A) and register (Rd) as operands */
                          decode = opcode & ~(mask_A_6 | mask_Rd_5);
                          switch ( decode ) {
-                             case 0xB000: return new  avr_op_IN(opcode, core);          /* 1011 0AAd dddd AAAA | IN */
-                             case 0xB800: return new  avr_op_OUT(opcode, core);         /* 1011 1AAd dddd AAAA | OUT */
+                             case 0xB000: return new_insn<avr_op_IN>(opcode, core);     /* 1011 0AAd dddd AAAA | IN */
+                             case 0xB800: return new_insn<avr_op_OUT>(opcode, core);    /* 1011 1AAd dddd AAAA | OUT */
                          }
 
                          /* opcodes with a relative 12-bit address (k) operand */
                          decode = opcode & ~(mask_k_12);
                          switch ( decode ) {
-                             case 0xD000: return new  avr_op_RCALL(opcode, core);       /* 1101 kkkk kkkk kkkk | RCALL */
-                             case 0xC000: return new  avr_op_RJMP(opcode, core);        /* 1100 kkkk kkkk kkkk | RJMP */
+                             case 0xD000: return new_insn<avr_op_RCALL>(opcode, core);  /* 1101 kkkk kkkk kkkk | RCALL */
+                             case 0xC000: return new_insn<avr_op_RJMP>(opcode, core);   /* 1100 kkkk kkkk kkkk | RJMP */
                          }
 
                          /* opcodes with two 4-bit register (Rd and Rr) operands */
@@ -2268,14 +2378,14 @@ DecodedInstruction* lookup_opcode( word opcode, AvrDevice *core )
                          switch ( decode ) {
                              case 0x0100:
                                  if(core->flagMOVWInstruction)
-                                     return new avr_op_MOVW(opcode, core);              /* 0000 0001 dddd rrrr | MOVW */
+                                     return new_insn<avr_op_MOVW>(opcode, core);        /* 0000 0001 dddd rrrr | MOVW */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x0200:
                                  if(core->flagMULInstructions)
-                                     return new avr_op_MULS(opcode, core);              /* 0000 0010 dddd rrrr | MULS */
+                                     return new_insn<avr_op_MULS>(opcode, core);        /* 0000 0010 dddd rrrr | MULS */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                          }
 
                          /* opcodes with two 3-bit register (Rd and Rr) operands */
@@ -2283,31 +2393,31 @@ DecodedInstruction* lookup_opcode( word opcode, AvrDevice *core )
                          switch ( decode ) {
                              case 0x0300:
                                  if(core->flagMULInstructions)
-                                     return new avr_op_MULSU(opcode, core);             /* 0000 0011 0ddd 0rrr | MULSU */
+                                     return new_insn<avr_op_MULSU>(opcode, core);       /* 0000 0011 0ddd 0rrr | MULSU */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x0308:
                                  if(core->flagMULInstructions)
-                                     return new avr_op_FMUL(opcode, core);              /* 0000 0011 0ddd 1rrr | FMUL */
+                                     return new_insn<avr_op_FMUL>(opcode, core);        /* 0000 0011 0ddd 1rrr | FMUL */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x0380:
                                  if(core->flagMULInstructions)
-                                     return new avr_op_FMULS(opcode, core);             /* 0000 0011 1ddd 0rrr | FMULS */
+                                     return new_insn<avr_op_FMULS>(opcode, core);       /* 0000 0011 1ddd 0rrr | FMULS */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                              case 0x0388:
                                  if(core->flagMULInstructions)
-                                     return new avr_op_FMULSU(opcode, core);            /* 0000 0011 1ddd 1rrr | FMULSU */
+                                     return new_insn<avr_op_FMULSU>(opcode, core);      /* 0000 0011 1ddd 1rrr | FMULSU */
                                  else
-                                     return new avr_op_ILLEGAL(opcode, core);
+                                     return new_insn<avr_op_ILLEGAL>(opcode, core);
                          }
 
                      } /* default */
     } /* first switch */
 
     //return NULL;
-    return new avr_op_ILLEGAL(opcode, core);
+    return new_insn<avr_op_ILLEGAL>(opcode, core);
 
 } /* decode opcode function */
 
@@ -33,6 +33,20 @@
 #include "avrdevice.h"
 
 class AvrFlash;
+class DecodedInstruction;
+
+//! Handler for direct dispatch, performs instruction without a virtual call
+/*! Returns number of clock cycles, like DecodedInstruction::operator()() */
+typedef int (*DispatchHandler)(DecodedInstruction *insn);
+
+//! Record of the direct dispatch table, one for each flash word
+/*! The operands are held by the instruction instance, the handler calls
+  the implementation of the concrete instruction class directly. */
+struct DispatchRecord {
+    DispatchHandler handler;   //!< non virtual entry into the instruction implementation
+    DecodedInstruction *insn;  //!< decoded instruction with operands
+    unsigned char len;         //!< length of opcode in byte (for instruction cache)
+};
 
 //! Base class of core instruction
 /*! All instruction are derived from this class */
@@ -41,9 +55,10 @@ class DecodedInstruction {
     protected:
         AvrDevice *core; //!< Link to device instance
         bool size2Word; //!< Flag: true, if instruction has 2 words
+        DispatchHandler handler; //!< direct dispatch handler, set by lookup_opcode
 
     public:
-        DecodedInstruction(AvrDevice *c, bool s2w = false): core(c), size2Word(s2w) {}
+        DecodedInstruction(AvrDevice *c, bool s2w = false): core(c), size2Word(s2w), handler(NULL) {}
         virtual ~DecodedInstruction() {}
 
         //! Returns true, if instruction need 2 words (4byte)
@@ -51,6 +66,13 @@ class DecodedInstruction {
 
         //! MBe: Performs instruction and returns number of clock cycles.
         int Execute(unsigned int pc, bool trace);
+        //! Like Execute, trace and instruction cache (core->cache_insn) are selected at compile time
+        template<bool TRACE, bool ICACHE> int Execute(unsigned int pc);
+
+        //! Returns handler for direct dispatch engine
+        DispatchHandler GetDispatchHandler() const { return handler; }
+        //! Set handler for direct dispatch engine
+        void SetDispatchHandler(DispatchHandler h) { handler = h; }
 
         //! If this instruction modifies a R0-R31 register then return its number, otherwise -1.
         virtual unsigned char GetModifiedR() const {return -1;}
@@ -59,12 +81,18 @@ class DecodedInstruction {
         //! length of opcode
         virtual unsigned char len() const {return 2;}
 
+        //! Writes mnemonic and operands of the instruction at pc, returns true, if SREG follows
+        /*! next is the second opcode word of a 2 word instruction, z is Z with RAMPZ in bits 16-23,
+          both as read before the instruction is performed. Has no side effects, so a trace
+          writer can format the instruction later from the recorded values. */
+        virtual bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const = 0;
+
     private:
         //! Performs instruction. Access only via Execute()
         virtual int operator()() = 0;
 
         //! performs instruction and traces mnemonic
-        virtual int Trace() = 0;
+        int Trace();
 };
 
 //! Translates an opcode to a instance of DecodedInstruction
@@ -89,7 +117,7 @@ class avr_op_ADC: public DecodedInstruction {
         avr_op_ADC(word opcode, AvrDevice *c);
         virtual unsigned char GetModifiedR() const;
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 }; //end of class
 
 class avr_op_ADD: public DecodedInstruction {
@@ -111,7 +139,7 @@ class avr_op_ADD: public DecodedInstruction {
         avr_op_ADD(word opcode, AvrDevice *c);
         virtual unsigned char GetModifiedR() const;
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 }; //end of class
 
 
@@ -140,7 +168,7 @@ class avr_op_ADIW: public DecodedInstruction
         virtual unsigned char GetModifiedR() const;
         virtual unsigned char GetModifiedRHi() const;
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_AND: public DecodedInstruction
@@ -163,7 +191,7 @@ class avr_op_AND: public DecodedInstruction
     public:
         avr_op_AND(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ANDI: public DecodedInstruction
@@ -186,7 +214,7 @@ class avr_op_ANDI: public DecodedInstruction
     public:
         avr_op_ANDI(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ASR:public DecodedInstruction
@@ -208,7 +236,7 @@ class avr_op_ASR:public DecodedInstruction
     public:
         avr_op_ASR(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_BCLR: public DecodedInstruction
@@ -230,7 +258,7 @@ class avr_op_BCLR: public DecodedInstruction
     public:
         avr_op_BCLR(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 
@@ -253,7 +281,7 @@ class avr_op_BLD: public DecodedInstruction
     public:
         avr_op_BLD(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_BRBC: public DecodedInstruction
@@ -281,7 +309,7 @@ class avr_op_BRBC: public DecodedInstruction
     public:
         avr_op_BRBC(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_BRBS: public DecodedInstruction
@@ -309,7 +337,7 @@ class avr_op_BRBS: public DecodedInstruction
     public:
         avr_op_BRBS(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_BSET: public DecodedInstruction
@@ -331,7 +359,7 @@ class avr_op_BSET: public DecodedInstruction
     public:
         avr_op_BSET(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_BST: public DecodedInstruction
@@ -354,7 +382,7 @@ class avr_op_BST: public DecodedInstruction
     public:
         avr_op_BST(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 
 };
 
@@ -376,7 +404,7 @@ class avr_op_CALL: public DecodedInstruction
     public:
         avr_op_CALL(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
         unsigned char len() const {return 4;}
 };
 
@@ -400,7 +428,7 @@ class avr_op_CBI: public DecodedInstruction
     public:
         avr_op_CBI(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_COM: public DecodedInstruction
@@ -422,7 +450,7 @@ class avr_op_COM: public DecodedInstruction
     public:
         avr_op_COM(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_CP: public DecodedInstruction
@@ -445,7 +473,7 @@ class avr_op_CP: public DecodedInstruction
     public:
         avr_op_CP(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_CPC: public DecodedInstruction
@@ -468,7 +496,7 @@ class avr_op_CPC: public DecodedInstruction
     public:
         avr_op_CPC(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_CPI: public DecodedInstruction
@@ -491,7 +519,7 @@ class avr_op_CPI: public DecodedInstruction
     public:
         avr_op_CPI(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 
 };
 
@@ -515,7 +543,7 @@ class avr_op_CPSE: public DecodedInstruction
     public:
         avr_op_CPSE(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_DEC: public DecodedInstruction
@@ -537,7 +565,7 @@ class avr_op_DEC: public DecodedInstruction
     public:
         avr_op_DEC(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_EICALL: public DecodedInstruction
@@ -555,7 +583,7 @@ class avr_op_EICALL: public DecodedInstruction
     public:
         avr_op_EICALL(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_EIJMP: public DecodedInstruction
@@ -573,7 +601,7 @@ class avr_op_EIJMP: public DecodedInstruction
     public:
         avr_op_EIJMP(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ELPM_Z: public DecodedInstruction
@@ -594,7 +622,7 @@ class avr_op_ELPM_Z: public DecodedInstruction
     public:
         avr_op_ELPM_Z(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ELPM_Z_incr: public DecodedInstruction
@@ -615,7 +643,7 @@ class avr_op_ELPM_Z_incr: public DecodedInstruction
     public:
         avr_op_ELPM_Z_incr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ELPM: public DecodedInstruction
@@ -634,7 +662,7 @@ class avr_op_ELPM: public DecodedInstruction
     public:
         avr_op_ELPM(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_EOR: public DecodedInstruction
@@ -657,7 +685,7 @@ class avr_op_EOR: public DecodedInstruction
     public:
         avr_op_EOR(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ESPM: public DecodedInstruction
@@ -676,7 +704,7 @@ class avr_op_ESPM: public DecodedInstruction
     public:
         avr_op_ESPM(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_FMUL:public DecodedInstruction
@@ -699,7 +727,7 @@ class avr_op_FMUL:public DecodedInstruction
     public:
         avr_op_FMUL(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_FMULS: public DecodedInstruction
@@ -722,7 +750,7 @@ class avr_op_FMULS: public DecodedInstruction
     public:
         avr_op_FMULS(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_FMULSU: public DecodedInstruction
@@ -745,7 +773,7 @@ class avr_op_FMULSU: public DecodedInstruction
     public:
         avr_op_FMULSU(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ICALL: public DecodedInstruction
@@ -763,7 +791,7 @@ class avr_op_ICALL: public DecodedInstruction
     public:
         avr_op_ICALL(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_IJMP: public DecodedInstruction
@@ -781,7 +809,7 @@ class avr_op_IJMP: public DecodedInstruction
     public:
         avr_op_IJMP (word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_IN: public DecodedInstruction
@@ -803,7 +831,7 @@ class avr_op_IN: public DecodedInstruction
     public:
         avr_op_IN(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_INC: public DecodedInstruction
@@ -825,7 +853,7 @@ class avr_op_INC: public DecodedInstruction
     public:
         avr_op_INC(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_JMP: public DecodedInstruction
@@ -846,7 +874,7 @@ class avr_op_JMP: public DecodedInstruction
     public:
         avr_op_JMP (word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
         unsigned char len() const {return 4;}
 };
 
@@ -869,7 +897,7 @@ class avr_op_LDD_Y: public DecodedInstruction
     public:
         avr_op_LDD_Y(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LDD_Z: public DecodedInstruction
@@ -891,7 +919,7 @@ class avr_op_LDD_Z: public DecodedInstruction
     public:
         avr_op_LDD_Z(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LDI: public DecodedInstruction
@@ -914,7 +942,7 @@ class avr_op_LDI: public DecodedInstruction
         avr_op_LDI(word opcode, AvrDevice *c);
         virtual unsigned char GetModifiedR() const;
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LDS: public DecodedInstruction
@@ -935,7 +963,7 @@ class avr_op_LDS: public DecodedInstruction
     public:
         avr_op_LDS(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
         unsigned char len() const {return 4;}
 };
 
@@ -957,7 +985,7 @@ class avr_op_LD_X: public DecodedInstruction
     public:
         avr_op_LD_X(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LD_X_decr: public DecodedInstruction
@@ -978,7 +1006,7 @@ class avr_op_LD_X_decr: public DecodedInstruction
     public:
         avr_op_LD_X_decr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LD_X_incr: public DecodedInstruction
@@ -999,7 +1027,7 @@ class avr_op_LD_X_incr: public DecodedInstruction
     public:
         avr_op_LD_X_incr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LD_Y_decr: public DecodedInstruction
@@ -1021,7 +1049,7 @@ class avr_op_LD_Y_decr: public DecodedInstruction
     public:
         avr_op_LD_Y_decr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LD_Y_incr: public DecodedInstruction
@@ -1042,7 +1070,7 @@ class avr_op_LD_Y_incr: public DecodedInstruction
     public:
         avr_op_LD_Y_incr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LD_Z_incr: public DecodedInstruction
@@ -1063,7 +1091,7 @@ class avr_op_LD_Z_incr: public DecodedInstruction
     public:
         avr_op_LD_Z_incr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LD_Z_decr: public DecodedInstruction
@@ -1084,7 +1112,7 @@ class avr_op_LD_Z_decr: public DecodedInstruction
     public:
         avr_op_LD_Z_decr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LPM_Z: public DecodedInstruction
@@ -1105,7 +1133,7 @@ class avr_op_LPM_Z: public DecodedInstruction
     public:
         avr_op_LPM_Z(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LPM: public DecodedInstruction
@@ -1125,7 +1153,7 @@ class avr_op_LPM: public DecodedInstruction
     public:
         avr_op_LPM(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LPM_Z_incr: public DecodedInstruction
@@ -1146,7 +1174,7 @@ class avr_op_LPM_Z_incr: public DecodedInstruction
     public:
         avr_op_LPM_Z_incr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_LSR: public DecodedInstruction
@@ -1168,7 +1196,7 @@ class avr_op_LSR: public DecodedInstruction
     public:
         avr_op_LSR(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_MOV: public DecodedInstruction
@@ -1189,7 +1217,7 @@ class avr_op_MOV: public DecodedInstruction
     public:
         avr_op_MOV(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_MOVW: public DecodedInstruction
@@ -1211,7 +1239,7 @@ class avr_op_MOVW: public DecodedInstruction
     public:
         avr_op_MOVW(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_MUL: public DecodedInstruction
@@ -1234,7 +1262,7 @@ class avr_op_MUL: public DecodedInstruction
     public:
         avr_op_MUL(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_MULS: public DecodedInstruction
@@ -1257,7 +1285,7 @@ class avr_op_MULS: public DecodedInstruction
     public:
         avr_op_MULS(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_MULSU: public DecodedInstruction
@@ -1283,7 +1311,7 @@ class avr_op_MULSU: public DecodedInstruction
     public:
         avr_op_MULSU(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_NEG: public DecodedInstruction
@@ -1305,7 +1333,7 @@ class avr_op_NEG: public DecodedInstruction
     public:
         avr_op_NEG(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_NOP: public DecodedInstruction
@@ -1324,7 +1352,7 @@ class avr_op_NOP: public DecodedInstruction
     public:
         avr_op_NOP(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_OR:public DecodedInstruction
@@ -1347,7 +1375,7 @@ class avr_op_OR:public DecodedInstruction
     public:
         avr_op_OR(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ORI: public DecodedInstruction
@@ -1370,7 +1398,7 @@ class avr_op_ORI: public DecodedInstruction
     public:
         avr_op_ORI(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_OUT: public DecodedInstruction
@@ -1392,7 +1420,7 @@ class avr_op_OUT: public DecodedInstruction
     public:
         avr_op_OUT(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 
     friend class AvrFlash;  // AvrFlash::LooksLikeContextSwitch() needs to read ioreg
 };
@@ -1415,7 +1443,7 @@ class avr_op_POP: public DecodedInstruction
     public:
         avr_op_POP(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_PUSH: public DecodedInstruction
@@ -1436,7 +1464,7 @@ class avr_op_PUSH: public DecodedInstruction
     public:
         avr_op_PUSH(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_RCALL: public DecodedInstruction
@@ -1457,7 +1485,7 @@ class avr_op_RCALL: public DecodedInstruction
     public:
         avr_op_RCALL(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_RET: public DecodedInstruction
@@ -1475,7 +1503,7 @@ class avr_op_RET: public DecodedInstruction
     public:
         avr_op_RET(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_RETI: public DecodedInstruction
@@ -1496,7 +1524,7 @@ class avr_op_RETI: public DecodedInstruction
     public:
         avr_op_RETI(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_RJMP: public DecodedInstruction
@@ -1517,7 +1545,7 @@ class avr_op_RJMP: public DecodedInstruction
     public:
         avr_op_RJMP(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ROR: public DecodedInstruction
@@ -1539,7 +1567,7 @@ class avr_op_ROR: public DecodedInstruction
     public:
         avr_op_ROR(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SBC: public DecodedInstruction
@@ -1563,7 +1591,7 @@ class avr_op_SBC: public DecodedInstruction
         avr_op_SBC(word opcode, AvrDevice *c);
         virtual unsigned char GetModifiedR() const;
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SBCI: public DecodedInstruction
@@ -1587,7 +1615,7 @@ class avr_op_SBCI: public DecodedInstruction
         avr_op_SBCI(word opcode, AvrDevice *c);
         virtual unsigned char GetModifiedR() const;
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SBI: public DecodedInstruction
@@ -1609,7 +1637,7 @@ class avr_op_SBI: public DecodedInstruction
     public:
         avr_op_SBI(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SBIC: public DecodedInstruction
@@ -1631,7 +1659,7 @@ class avr_op_SBIC: public DecodedInstruction
     public:
         avr_op_SBIC(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SBIS: public DecodedInstruction
@@ -1653,7 +1681,7 @@ class avr_op_SBIS: public DecodedInstruction
     public:
         avr_op_SBIS(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SBIW: public DecodedInstruction
@@ -1678,7 +1706,7 @@ class avr_op_SBIW: public DecodedInstruction
         virtual unsigned char GetModifiedR() const;
         virtual unsigned char GetModifiedRHi() const;
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SBRC: public DecodedInstruction
@@ -1700,7 +1728,7 @@ class avr_op_SBRC: public DecodedInstruction
     public:
         avr_op_SBRC(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SBRS: public DecodedInstruction
@@ -1722,7 +1750,7 @@ class avr_op_SBRS: public DecodedInstruction
     public:
         avr_op_SBRS(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 /*! \todo SLEEP instruction not implemented */
@@ -1744,7 +1772,7 @@ class avr_op_SLEEP: public DecodedInstruction
     public:
         avr_op_SLEEP(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SPM: public DecodedInstruction
@@ -1762,7 +1790,7 @@ class avr_op_SPM: public DecodedInstruction
     public:
         avr_op_SPM(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_STD_Y: public DecodedInstruction
@@ -1784,7 +1812,7 @@ class avr_op_STD_Y: public DecodedInstruction
     public:
         avr_op_STD_Y(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_STD_Z: public DecodedInstruction
@@ -1806,7 +1834,7 @@ class avr_op_STD_Z: public DecodedInstruction
     public:
         avr_op_STD_Z(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_STS: public DecodedInstruction
@@ -1827,7 +1855,7 @@ class avr_op_STS: public DecodedInstruction
     public:
         avr_op_STS(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
         unsigned char len() const {return 4;}
 };
 
@@ -1849,7 +1877,7 @@ class avr_op_ST_X: public DecodedInstruction
     public:
         avr_op_ST_X(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ST_X_decr: public DecodedInstruction
@@ -1870,7 +1898,7 @@ class avr_op_ST_X_decr: public DecodedInstruction
     public:
         avr_op_ST_X_decr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ST_X_incr: public DecodedInstruction
@@ -1891,7 +1919,7 @@ class avr_op_ST_X_incr: public DecodedInstruction
     public:
         avr_op_ST_X_incr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ST_Y_decr: public DecodedInstruction
@@ -1912,7 +1940,7 @@ class avr_op_ST_Y_decr: public DecodedInstruction
     public:
         avr_op_ST_Y_decr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ST_Y_incr: public DecodedInstruction
@@ -1933,7 +1961,7 @@ class avr_op_ST_Y_incr: public DecodedInstruction
     public:
         avr_op_ST_Y_incr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ST_Z_decr: public DecodedInstruction
@@ -1954,7 +1982,7 @@ class avr_op_ST_Z_decr: public DecodedInstruction
     public:
         avr_op_ST_Z_decr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ST_Z_incr: public DecodedInstruction
@@ -1975,7 +2003,7 @@ class avr_op_ST_Z_incr: public DecodedInstruction
     public:
         avr_op_ST_Z_incr(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SUB: public DecodedInstruction
@@ -1999,7 +2027,7 @@ class avr_op_SUB: public DecodedInstruction
         avr_op_SUB(word opcode, AvrDevice *c);
         virtual unsigned char GetModifiedR() const;
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SUBI: public DecodedInstruction
@@ -2023,7 +2051,7 @@ class avr_op_SUBI: public DecodedInstruction
         avr_op_SUBI(word opcode, AvrDevice *c);
         virtual unsigned char GetModifiedR() const;
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_SWAP: public DecodedInstruction
@@ -2044,7 +2072,7 @@ class avr_op_SWAP: public DecodedInstruction
     public:
         avr_op_SWAP(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_WDR: public DecodedInstruction
@@ -2064,7 +2092,7 @@ class avr_op_WDR: public DecodedInstruction
     public:
         avr_op_WDR(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_BREAK: public DecodedInstruction
@@ -2084,7 +2112,7 @@ class avr_op_BREAK: public DecodedInstruction
     public:
         avr_op_BREAK(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 class avr_op_ILLEGAL: public DecodedInstruction
@@ -2094,7 +2122,7 @@ class avr_op_ILLEGAL: public DecodedInstruction
     public:
         avr_op_ILLEGAL(word opcode, AvrDevice *c);
         int operator()();
-        int Trace();
+        bool Disassemble(std::ostream &os, unsigned int pc, word next, unsigned int z) const;
 };
 
 #endif
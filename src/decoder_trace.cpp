@@ -33,11 +33,29 @@
 #include "rwmem.h"
 #include "ioregs.h"
 #include "avrerror.h"
-
-#define MONSREG traceOut << (string)(*(core->status))  
+#include "tracewriter.h"
 
 using namespace std;
 
+int DecodedInstruction::Trace() {
+    unsigned char rampz = 0;
+    if(core->rampz != NULL)
+        rampz = core->rampz->GetRegVal();
+    unsigned int z = (rampz << 16) + core->GetRegZ();
+    word next = size2Word ? core->Flash->ReadMemWord((core->PC + 1) * 2) : 0;
+    AsyncTraceWriter *writer = sysConHandler.GetTraceWriter();
+    if(writer != NULL) {
+        // formatted by writer thread
+        writer->Instruction(core, core->PC, core->Flash->ReadMemWord(core->PC * 2), next, z);
+        return this->operator()();
+    }
+    bool sreg = Disassemble(traceOut, core->PC, next, z);
+    int ret = this->operator()();
+    if(sreg)
+        traceOut << (string)(*(core->status));
+    return ret;
+}
+
 /// Calculate index from mask so that (1<<index)==mask. Crash on incorrect values.
 #define INDEX_FROM_BITMASK(mask)  \
     ( (mask) == 0x01 ? 0          \
@@ -56,46 +74,34 @@ int abort_in_expression()
     return 0;
 }
 
-int avr_op_ADC::Trace()  {
-    traceOut << "ADC R" << (int)R1 << ", R" << (int)R2 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_ADC::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ADC R" << (int)R1 << ", R" << (int)R2 << " ";
+    return true;
 }
 
-int avr_op_ADD::Trace() {
-    traceOut << "ADD R" << (int)R1 << ", R" << (int)R2 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_ADD::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ADD R" << (int)R1 << ", R" << (int)R2 << " ";
+    return true;
 }
 
-int avr_op_ADIW::Trace() {
-    traceOut << "ADIW R" << (int)Rl << ", " << (int)K << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_ADIW::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ADIW R" << (int)Rl << ", " << (int)K << " ";
+    return true;
 }
 
-int avr_op_AND::Trace() {
-    traceOut << "AND R" << (int)R1 << ", R" << (int)R2 << " ";
-    int ret=this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_AND::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "AND R" << (int)R1 << ", R" << (int)R2 << " ";
+    return true;
 }
 
-int avr_op_ANDI::Trace() {
-    traceOut << "ANDI R" << (int)R1 << ", " << HexChar(K) << " ";
-    int ret=this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_ANDI::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ANDI R" << (int)R1 << ", " << HexChar(K) << " ";
+    return true;
 }
 
-int avr_op_ASR::Trace() {
-    traceOut << "ASR R" << (int)R1 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_ASR::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ASR R" << (int)R1 << " ";
+    return true;
 }
 
 const char *opcodes_bclr[8]= {
@@ -109,17 +115,14 @@ const char *opcodes_bclr[8]= {
     "CLI"
 };
 
-int avr_op_BCLR::Trace() {
-    traceOut << opcodes_bclr[Kbit] << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_BCLR::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << opcodes_bclr[Kbit] << " ";
+    return true;
 }
 
-int avr_op_BLD::Trace() {
-    traceOut << "BLD R" << (int)R1 << ", " << (int)Kbit << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_BLD::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "BLD R" << (int)R1 << ", " << (int)Kbit << " ";
+    return false;
 }
 
 const char *branch_opcodes_clear[8] = {
@@ -133,17 +136,14 @@ const char *branch_opcodes_clear[8] = {
     "BRID"
 };
 
-int avr_op_BRBC::Trace() {
-    traceOut << branch_opcodes_clear[INDEX_FROM_BITMASK(bitmask)]
+bool avr_op_BRBC::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << branch_opcodes_clear[INDEX_FROM_BITMASK(bitmask)]
              << " ->" << HexShort(offset * 2) << " ";
-    string sym(core->Flash->GetSymbolAtAddress(core->PC+1+offset));
-    int ret = this->operator()();
-    
-    traceOut << sym << " ";
-    for(int len = sym.length(); len < 30; len++)
-        traceOut << " ";
+    unsigned int target = pc + 1 + offset;
 
-    return ret;
+    core->Flash->WriteSymbolAtAddress(os, target, 30);
+    os << " ";
+    return false;
 }
 
 const char *branch_opcodes_set[8] = {
@@ -157,17 +157,14 @@ const char *branch_opcodes_set[8] = {
     "BRIE"
 };
 
-int avr_op_BRBS::Trace() {
-    traceOut << branch_opcodes_set[INDEX_FROM_BITMASK(bitmask)]
+bool avr_op_BRBS::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << branch_opcodes_set[INDEX_FROM_BITMASK(bitmask)]
              << " ->" << HexShort(offset * 2) << " ";
-    string sym(core->Flash->GetSymbolAtAddress(core->PC+1+offset));
-    int ret=this->operator()();
-
-    traceOut << sym << " ";
-    for(int len = sym.length(); len < 30; len++)
-        traceOut << " ";
+    unsigned int target = pc + 1 + offset;
 
-    return ret;
+    core->Flash->WriteSymbolAtAddress(os, target, 30);
+    os << " ";
+    return false;
 }
 
 const char *opcodes_bset[8]= {
@@ -181,579 +178,457 @@ const char *opcodes_bset[8]= {
     "SEI"
 };
 
-int avr_op_BSET::Trace() {
-    traceOut << opcodes_bset[Kbit] << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_BSET::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << opcodes_bset[Kbit] << " ";
+    return true;
 }
 
-int avr_op_BST::Trace() {
-    traceOut << "BST R" << (int)R1 << ", " << (int)Kbit << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_BST::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "BST R" << (int)R1 << ", " << (int)Kbit << " ";
+    return true;
 }
 
-int avr_op_CALL::Trace() {
-    word K_lsb = core->Flash->ReadMemWord((core->PC + 1) * 2);
+bool avr_op_CALL::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    word K_lsb = next;
     int k = (KH << 16) | K_lsb;
-    traceOut << "CALL 0x" << hex << k * 2 << dec << " ";
-    int ret = this->operator()();
-    return ret;
+    os << "CALL 0x" << hex << k * 2 << dec << " ";
+    return false;
 }
 
-int avr_op_CBI::Trace() {
-    traceOut << "CBI " << HexChar(ioreg) << ", " << (int)Kbit << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_CBI::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "CBI " << HexChar(ioreg) << ", " << (int)Kbit << " ";
+    return false;
 }
 
-int avr_op_COM::Trace() {
-    traceOut << "COM R" << (int)R1 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_COM::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "COM R" << (int)R1 << " ";
+    return true;
 }
 
-int avr_op_CP::Trace() {
-    traceOut << "CP R" << (int)R1 << ", R" << (int)R2 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_CP::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "CP R" << (int)R1 << ", R" << (int)R2 << " ";
+    return true;
 }
 
-int avr_op_CPC::Trace() {
-    traceOut << "CPC R" << (int)R1 << ", R" << (int)R2 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_CPC::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "CPC R" << (int)R1 << ", R" << (int)R2 << " ";
+    return true;
 }
 
-int avr_op_CPI::Trace() {
-    traceOut << "CPI R" << (int)R1 << ", " << HexChar(K) << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_CPI::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "CPI R" << (int)R1 << ", " << HexChar(K) << " ";
+    return true;
 }
 
-int avr_op_CPSE::Trace() {
-    traceOut << "CPSE R" << (int)R1 << ", R" << (int)R2 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_CPSE::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "CPSE R" << (int)R1 << ", R" << (int)R2 << " ";
+    return false;
 }
 
-int avr_op_DEC::Trace() {
-    traceOut << "DEC R" << (int)R1 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_DEC::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "DEC R" << (int)R1 << " ";
+    return true;
 }
 
-int avr_op_EICALL::Trace() {
-    traceOut << "EICALL ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_EICALL::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "EICALL ";
+    return false;
 }
 
-int avr_op_EIJMP::Trace() {
-    traceOut << "EIJMP ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_EIJMP::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "EIJMP ";
+    return false;
 }
 
-int avr_op_ELPM_Z::Trace() {
-    traceOut << "ELPM R" << (int)R1 << ", Z " ;
-    int ret = this->operator()();
-
-    unsigned char rampz = 0;
-    if(core->rampz != NULL)
-        rampz = core->rampz->GetRegVal();
-    unsigned int Z = (rampz << 16) + core->GetRegZ();
+bool avr_op_ELPM_Z::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ELPM R" << (int)R1 << ", Z " ;
 
-    traceOut << " Flash[0x" << hex << Z << dec << "] ";
+    unsigned int Z = z;
 
-    return ret;
+    os << " Flash[0x" << hex << Z << dec << "] ";
+    return false;
 }
 
-int avr_op_ELPM_Z_incr::Trace() {
-    traceOut << "ELPM R" << (int)R1 << ", Z+ ";
-    unsigned char rampz = 0;
-    if(core->rampz != NULL)
-        rampz = core->rampz->GetRegVal();
-    unsigned int Z = (rampz << 16) + core->GetRegZ();
-    int ret = this->operator()();
-
-    traceOut << " Flash[0x" << hex << Z << dec << "] ";
+bool avr_op_ELPM_Z_incr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ELPM R" << (int)R1 << ", Z+ ";
+    unsigned int Z = z;
 
-    return ret;
+    os << " Flash[0x" << hex << Z << dec << "] ";
+    return false;
 }
 
-int avr_op_ELPM::Trace() {
-    traceOut << "ELPM ";
-    int ret = this->operator()();
-
-    unsigned char rampz = 0;
-    if(core->rampz != NULL)
-        rampz = core->rampz->GetRegVal();
-    unsigned int Z = (rampz << 16) + core->GetRegZ();
+bool avr_op_ELPM::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ELPM ";
 
-    traceOut << " Flash[0x" << hex << Z << dec << "] ";
+    unsigned int Z = z;
 
-    return ret;
+    os << " Flash[0x" << hex << Z << dec << "] ";
+    return false;
 }
 
-int avr_op_EOR::Trace() {
-    traceOut << "EOR R" << (int)R1 << ", R" << (int)R2 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_EOR::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "EOR R" << (int)R1 << ", R" << (int)R2 << " ";
+    return true;
 }
 
-int avr_op_ESPM::Trace() {
-    traceOut << "SPM Z+ ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_ESPM::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SPM Z+ ";
+    return false;
 }
 
-int avr_op_FMUL::Trace() {
-    traceOut << "FMUL R" << (int)Rd << ", R" << (int)Rr << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_FMUL::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "FMUL R" << (int)Rd << ", R" << (int)Rr << " ";
+    return true;
 }
 
-int avr_op_FMULS::Trace() {
-    traceOut << "FMULS R" << (int)Rd << ", R" << (int)Rr << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_FMULS::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "FMULS R" << (int)Rd << ", R" << (int)Rr << " ";
+    return true;
 }
 
-int avr_op_FMULSU::Trace() {
-    traceOut << "FMULSU R" << (int)Rd << ", R" << (int)Rr << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_FMULSU::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "FMULSU R" << (int)Rd << ", R" << (int)Rr << " ";
+    return true;
 }
 
-int avr_op_ICALL::Trace() {
-    traceOut << "ICALL Z " ;
-    int ret = this->operator()();
-    return ret;
+bool avr_op_ICALL::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ICALL Z " ;
+    return false;
 }
 
-int avr_op_IJMP::Trace() {
-    traceOut << "IJMP Z " ;
-    int ret = this->operator()();
-    return ret;
+bool avr_op_IJMP::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "IJMP Z " ;
+    return false;
 }
 
-int avr_op_IN::Trace() {
-    traceOut << "IN R" << (int)R1 << ", " << HexChar(ioreg) << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_IN::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "IN R" << (int)R1 << ", " << HexChar(ioreg) << " ";
+    return false;
 }
 
-int avr_op_INC::Trace() {
-    traceOut << "INC R" << (int)R1 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_INC::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "INC R" << (int)R1 << " ";
+    return true;
 }
 
-int avr_op_JMP::Trace() {
-    traceOut << "JMP ";
-    word offset = core->Flash->ReadMemWord((core->PC + 1) * 2);  //this is k!
-    int ret = this->operator()();
-    traceOut << hex << 2 * offset << dec << " ";
-
-    string sym(core->Flash->GetSymbolAtAddress(offset));
-    traceOut << sym << " ";
-    for(int len = sym.length(); len < 30; len++)
-        traceOut << " " ;
+bool avr_op_JMP::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "JMP ";
+    word offset = next;  //this is k!
+    os << hex << 2 * offset << dec << " ";
 
-    return ret;
+    core->Flash->WriteSymbolAtAddress(os, offset, 30);
+    os << " ";
+    return false;
 }
 
-int avr_op_LDD_Y::Trace() {
-    traceOut << "LDD R" << (int)Rd << ", Y+" << (int)K << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_LDD_Y::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LDD R" << (int)Rd << ", Y+" << (int)K << " ";
+    return false;
 }
 
-int avr_op_LDD_Z::Trace() {
-    traceOut << "LDD R" << (int)Rd << ", Z+" << (int)K << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_LDD_Z::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LDD R" << (int)Rd << ", Z+" << (int)K << " ";
+    return false;
 }
 
-int avr_op_LDI::Trace() {
-    traceOut << "LDI R" << (int)R1 << ", " << HexChar(K) << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_LDI::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LDI R" << (int)R1 << ", " << HexChar(K) << " ";
+    return false;
 }
 
-int avr_op_LDS::Trace() {
-    word offset = core->Flash->ReadMemWord((core->PC + 1) * 2);  //this is k!
-    traceOut << "LDS R" << (int)R1 << ", " << hex << "0x" << offset << dec  << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_LDS::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    word offset = next;  //this is k!
+    os << "LDS R" << (int)R1 << ", " << hex << "0x" << offset << dec  << " ";
+    return false;
 }
 
-int avr_op_LD_X::Trace() {
-    traceOut << "LD R" << (int)Rd << ", X ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_LD_X::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LD R" << (int)Rd << ", X ";
+    return false;
 }
 
-int avr_op_LD_X_decr::Trace() {
-    traceOut << "LD R" << (int)Rd << ", -X ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_LD_X_decr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LD R" << (int)Rd << ", -X ";
+    return false;
 }
 
-int avr_op_LD_X_incr::Trace() {
-    traceOut << "LD R" << (int)Rd << ", X+ ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_LD_X_incr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LD R" << (int)Rd << ", X+ ";
+    return false;
 }
 
-int avr_op_LD_Y_decr::Trace() {
-    traceOut << "LD R" << (int)Rd << ", -Y ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_LD_Y_decr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LD R" << (int)Rd << ", -Y ";
+    return false;
 }
 
-int avr_op_LD_Y_incr::Trace() {
-    traceOut << "LD R" << (int)Rd << ", Y+ " ;
-    int ret = this->operator()();
-    return ret;
+bool avr_op_LD_Y_incr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LD R" << (int)Rd << ", Y+ " ;
+    return false;
 }
 
-int avr_op_LD_Z_incr::Trace() {
-    traceOut << "LD R" << (int)Rd << ", Z+ ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_LD_Z_incr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LD R" << (int)Rd << ", Z+ ";
+    return false;
 }
 
-int avr_op_LD_Z_decr::Trace() {
-    traceOut << "LD R" << (int)Rd << ", -Z";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_LD_Z_decr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LD R" << (int)Rd << ", -Z";
+    return false;
 }
 
-int avr_op_LPM_Z::Trace() {
-    traceOut << "LPM R" << (int)Rd << ", Z ";
-    int ret = this->operator()();
+bool avr_op_LPM_Z::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LPM R" << (int)Rd << ", Z ";
 
     /* Z is R31:R30 */
-    unsigned int Z = core->GetRegZ();
-    string sym(core->Flash->GetSymbolAtAddress(Z));
-    traceOut << "FLASH[" << hex << Z << dec << "," << sym << "] ";
-
-    return ret;
+    unsigned int Z = z & 0xffff;
+    os << "FLASH[" << hex << Z << dec << ",";
+    core->Flash->WriteSymbolAtAddress(os, Z);
+    os << "] ";
+    return false;
 }
 
-int avr_op_LPM::Trace() {
-    traceOut << "LPM R0, Z "; 
-    int ret = this->operator()();
+bool avr_op_LPM::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LPM R0, Z ";
 
     /* Z is R31:R30 */
-    unsigned int Z = core->GetRegZ();
-    string sym(core->Flash->GetSymbolAtAddress(Z));
-    traceOut << "FLASH[" << hex << Z << dec << "," << sym << "] ";
-
-    return ret;
+    unsigned int Z = z & 0xffff;
+    os << "FLASH[" << hex << Z << dec << ",";
+    core->Flash->WriteSymbolAtAddress(os, Z);
+    os << "] ";
+    return false;
 }
 
-int avr_op_LPM_Z_incr::Trace() {
-    traceOut << "LPM R" << (int)Rd << ", Z+ " ;
+bool avr_op_LPM_Z_incr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LPM R" << (int)Rd << ", Z+ " ;
     /* Z is R31:R30 */
-    unsigned int Z = core->GetRegZ();
-    int ret = this->operator()();
-    
-    string sym(core->Flash->GetSymbolAtAddress(Z));
-    traceOut << "FLASH[" << hex << Z << dec << "," << sym << "] ";
-    return ret;
+    unsigned int Z = z & 0xffff;
+
+    os << "FLASH[" << hex << Z << dec << ",";
+    core->Flash->WriteSymbolAtAddress(os, Z);
+    os << "] ";
+    return false;
 }
 
-int avr_op_LSR::Trace() {
-    traceOut << "LSR R" << (int)Rd << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_LSR::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "LSR R" << (int)Rd << " ";
+    return true;
 }
 
-int avr_op_MOV::Trace() {
-    traceOut << "MOV R" << (int)R1 << ", R" << (int)R2 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_MOV::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "MOV R" << (int)R1 << ", R" << (int)R2 << " ";
+    return false;
 }
 
-int avr_op_MOVW::Trace() {
-    traceOut << "MOVW R" << (int)Rd << ", R" << (int)Rs << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_MOVW::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "MOVW R" << (int)Rd << ", R" << (int)Rs << " ";
+    return false;
 }
 
-int avr_op_MUL::Trace() {
-    traceOut << "MUL R" << (int)Rd << ", R" << (int)Rr << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_MUL::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "MUL R" << (int)Rd << ", R" << (int)Rr << " ";
+    return true;
 }
 
-int avr_op_MULS::Trace() {
-    traceOut << "MULS R" << (int)Rd << ", R" << (int)Rr << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_MULS::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "MULS R" << (int)Rd << ", R" << (int)Rr << " ";
+    return true;
 }
 
-int avr_op_MULSU::Trace() {
-    traceOut << "MULSU R" << (int)Rd << ", R" << (int)Rr << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_MULSU::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "MULSU R" << (int)Rd << ", R" << (int)Rr << " ";
+    return true;
 }
 
-int avr_op_NEG::Trace() {
-    traceOut << "NEG R" << (int)Rd <<" ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_NEG::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "NEG R" << (int)Rd <<" ";
+    return true;
 }
 
-int avr_op_NOP::Trace() {
-    traceOut << "NOP ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_NOP::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "NOP ";
+    return false;
 }
 
-int avr_op_OR::Trace() {
-    traceOut << "OR R" << (int)Rd << ", R" << (int)Rr << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_OR::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "OR R" << (int)Rd << ", R" << (int)Rr << " ";
+    return true;
 }
 
-int avr_op_ORI::Trace() {
-    traceOut << "ORI R" << (int)R1 << ", " << HexChar(K) << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_ORI::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ORI R" << (int)R1 << ", " << HexChar(K) << " ";
+    return true;
 }
 
-int avr_op_OUT::Trace() {
-    traceOut << "OUT " << HexChar(ioreg) << ", R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_OUT::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "OUT " << HexChar(ioreg) << ", R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_POP::Trace() {
-    traceOut << "POP R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_POP::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "POP R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_PUSH::Trace() {
-    traceOut << "PUSH R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_PUSH::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "PUSH R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_RCALL::Trace() {
-    traceOut << "RCALL " << hex << ((core->PC + K + 1) << 1) << dec << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_RCALL::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "RCALL " << hex << ((pc + K + 1) << 1) << dec << " ";
+    return false;
 }
 
-int avr_op_RET::Trace() {
-    traceOut << "RET " ;
-    int ret = this->operator()();
-    return ret;
+bool avr_op_RET::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "RET " ;
+    return false;
 }
 
-int avr_op_RETI::Trace() {
-    traceOut << "RETI ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_RETI::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "RETI ";
+    return false;
 }
 
-int avr_op_RJMP::Trace() {
-    traceOut << "RJMP " << hex << ((core->PC + K + 1) << 1) << dec << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_RJMP::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "RJMP " << hex << ((pc + K + 1) << 1) << dec << " ";
+    return false;
 }
 
-int avr_op_ROR::Trace() {
-    traceOut << "ROR R" << (int)R1 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_ROR::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ROR R" << (int)R1 << " ";
+    return true;
 }
 
-int avr_op_SBC::Trace() {
-    traceOut << "SBC R" << (int)R1 << ", R" << (int)R2 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_SBC::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SBC R" << (int)R1 << ", R" << (int)R2 << " ";
+    return true;
 }
 
-int avr_op_SBCI::Trace() {
-    traceOut << "SBCI R" << (int)R1 << ", " << HexChar(K) << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_SBCI::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SBCI R" << (int)R1 << ", " << HexChar(K) << " ";
+    return true;
 }
 
-int avr_op_SBI::Trace() {
-    traceOut << "SBI " << HexChar(ioreg) << ", " << (int)Kbit << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_SBI::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SBI " << HexChar(ioreg) << ", " << (int)Kbit << " ";
+    return false;
 }
 
-int avr_op_SBIC::Trace() {
-    traceOut << "SBIC " << HexChar(ioreg) << ", " << (int)Kbit << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_SBIC::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SBIC " << HexChar(ioreg) << ", " << (int)Kbit << " ";
+    return false;
 }
 
-int avr_op_SBIS::Trace() {
-    traceOut << "SBIS " << HexChar(ioreg) << ", " << (int)Kbit << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_SBIS::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SBIS " << HexChar(ioreg) << ", " << (int)Kbit << " ";
+    return false;
 }
 
-int avr_op_SBIW::Trace( ) {
-    traceOut << "SBIW R" << (int)R1 << ", " << HexChar(K) << " ";
-    int ret=this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_SBIW::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SBIW R" << (int)R1 << ", " << HexChar(K) << " ";
+    return true;
 }
 
-int avr_op_SBRC::Trace() {
-    traceOut << "SBRC R" << (int)R1 << ", " << (int)Kbit << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_SBRC::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SBRC R" << (int)R1 << ", " << (int)Kbit << " ";
+    return false;
 }
 
-int avr_op_SBRS::Trace() {
-    traceOut << "SBRS R" << (int)R1 << ", " << (int)Kbit << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_SBRS::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SBRS R" << (int)R1 << ", " << (int)Kbit << " ";
+    return false;
 }
 
-int avr_op_SLEEP::Trace() {
-    traceOut << "SLEEP " ;
-    int ret = this->operator()();
-    return ret;
+bool avr_op_SLEEP::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SLEEP " ;
+    return false;
 }
 
-int avr_op_SPM::Trace() {
-    traceOut << "SPM " ;
-    int ret = this->operator()();
-    return ret;
+bool avr_op_SPM::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SPM " ;
+    return false;
 }
 
-int avr_op_STD_Y::Trace() {
-    traceOut << "STD Y+" << (int)K << ", R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_STD_Y::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "STD Y+" << (int)K << ", R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_STD_Z::Trace() {
-    traceOut << "STD Z+" << (int)K << ", R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_STD_Z::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "STD Z+" << (int)K << ", R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_STS::Trace() {
-    word offset = core->Flash->ReadMemWord((core->PC + 1) * 2);  //this is k!
-    traceOut << "STS " << "0x" << hex << offset << dec << ", R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_STS::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    word offset = next;  //this is k!
+    os << "STS " << "0x" << hex << offset << dec << ", R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_ST_X::Trace() {
-    traceOut << "ST X, R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_ST_X::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ST X, R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_ST_X_decr::Trace() {
-    traceOut << "ST -X, R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_ST_X_decr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ST -X, R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_ST_X_incr::Trace() {
-    traceOut << "ST X+, R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_ST_X_incr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ST X+, R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_ST_Y_decr::Trace() {
-    traceOut << "ST -Y, R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_ST_Y_decr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ST -Y, R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_ST_Y_incr::Trace() {
-    traceOut << "ST Y+, R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_ST_Y_incr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ST Y+, R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_ST_Z_decr::Trace() {
-    traceOut << "ST -Z, R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_ST_Z_decr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ST -Z, R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_ST_Z_incr::Trace() {
-    traceOut << "ST Z+, R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_ST_Z_incr::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "ST Z+, R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_SUB::Trace() {
-    traceOut << "SUB R" << (int)R1 << ", R" << (int)R2 << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_SUB::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SUB R" << (int)R1 << ", R" << (int)R2 << " ";
+    return true;
 }
 
-int avr_op_SUBI::Trace() {
-    traceOut << "SUBI R" << (int)R1 << ", " << HexChar(K) << " ";
-    int ret = this->operator()();
-    MONSREG;
-    return ret;
+bool avr_op_SUBI::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SUBI R" << (int)R1 << ", " << HexChar(K) << " ";
+    return true;
 }
 
-int avr_op_SWAP::Trace() {
-    traceOut << "SWAP R" << (int)R1 << " ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_SWAP::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "SWAP R" << (int)R1 << " ";
+    return false;
 }
 
-int avr_op_WDR::Trace() {
-    traceOut << "WDR ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_WDR::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "WDR ";
+    return false;
 }
 
-int avr_op_BREAK::Trace() {
-    traceOut << "BREAK ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_BREAK::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "BREAK ";
+    return false;
 }
 
-int avr_op_ILLEGAL::Trace() {
-    traceOut << "Invalid Instruction! ";
-    int ret = this->operator()();
-    return ret;
+bool avr_op_ILLEGAL::Disassemble(ostream &os, unsigned int pc, word next, unsigned int z) const {
+    os << "Invalid Instruction! ";
+    return false;
 }
 
 /* EOF */
@@ -31,6 +31,7 @@
 
 
 #include "flash.h"
+#include "blockcache.h"
 #include "helper.h"
 #include "memory.h"
 #include "avrerror.h"
@@ -43,17 +44,20 @@ void AvrFlash::Decode(){
 AvrFlash::AvrFlash(AvrDevice *c, int _size):
     Memory(_size),
     core(c),
-    DecodedMem(_size),
-    flashLoaded(false) {
+    DecodedMem(_size / 2, (DecodedInstruction *)NULL),
+    DispatchMem(_size / 2),
+    flashLoaded(false),
+    symbolIndexValid(false) {
+    blockCache = new BlockCache(this, size / 2);
     for(unsigned int tt = 0; tt < size; tt++)
         myMemory[tt] = 0xff;  // Safeguard, will be decoded as avr_op_ILLEGAL
     rww_lock = 0;
-    // initialize DecodedMem
-    Decode();
+    // DecodedMem and DispatchMem are filled on first fetch, see DecodeWord
 }
 
 AvrFlash::~AvrFlash() {
-    for(unsigned int i = 0; i < size; i++) {
+    delete blockCache;
+    for(unsigned int i = 0; i < DecodedMem.size(); i++) {
        if(DecodedMem[i] != NULL)
           delete DecodedMem[i]; // delete Instruction
     }
@@ -80,7 +84,7 @@ void AvrFlash::WriteMemByte(unsigned char val, unsigned int offset) {
 DecodedInstruction* AvrFlash::GetInstruction(unsigned int pc) {
     if(IsRWWLock(pc * 2))
         avr_error("flash is locked (RWW lock)");
-    return DecodedMem[pc];
+    return DecodedAt(pc);
 }
 
 unsigned char AvrFlash::ReadMem(unsigned int offset) {
@@ -109,11 +113,124 @@ void AvrFlash::Decode(unsigned int offset, int secSize) {
 void AvrFlash::Decode(unsigned int addr) {
     assert((unsigned)addr < size);
     assert((addr % 2) == 0);
-    word opcode = (myMemory[addr] << 8) + myMemory[addr + 1];
     unsigned int index = addr / 2;
-    if(DecodedMem[index] != NULL)
-        delete DecodedMem[index];                     //delete old Instruction here 
-    DecodedMem[index] = lookup_opcode(opcode, core);  //and set new one
+    blockCache->Invalidate(index);                    //translated blocks with old instruction
+    if(DecodedMem[index] != NULL) {
+        delete DecodedMem[index];                     //delete old Instruction here
+        DecodedMem[index] = NULL;                     //new one is created on next fetch
+        DispatchMem[index] = DispatchRecord();
+    }
+}
+
+void AvrFlash::DecodeWord(unsigned int index) {
+    assert(index < DecodedMem.size());
+    word opcode = (myMemory[index * 2] << 8) + myMemory[index * 2 + 1];
+    DecodedInstruction *insn = lookup_opcode(opcode, core);
+    DecodedMem[index] = insn;
+    DispatchRecord &rec = DispatchMem[index];         //and update dispatch table
+    rec.handler = insn->GetDispatchHandler();
+    rec.insn = insn;
+    rec.len = insn->len();
+}
+
+unsigned int AvrFlash::AddSourceFile(const std::string &name) {
+    for(unsigned int i = 0; i < sourceFiles.size(); i++)
+        if(sourceFiles[i] == name)
+            return i;
+    sourceFiles.push_back(name);
+    return sourceFiles.size() - 1;
+}
+
+void AvrFlash::AddSourceLine(unsigned int addr, int file, unsigned int line) {
+    SourceLine l;
+    l.file = file;
+    l.line = line;
+    std::map<unsigned int, SourceLine>::iterator i = lines.find(addr);
+    if(i == lines.end())
+        lines.insert(std::make_pair(addr, l));
+    else if(file >= 0)
+        i->second = l; // last line for a address wins, also if a sequence ended here
+}
+
+SourceLine AvrFlash::GetSourceLine(unsigned int addr) const {
+    std::map<unsigned int, SourceLine>::const_iterator i = lines.upper_bound(addr);
+    if(i == lines.begin()) {
+        SourceLine l;
+        l.file = -1;
+        l.line = 0;
+        return l;
+    }
+    return (--i)->second;
+}
+
+void AvrFlash::BuildSymbolIndex(void) {
+    symbols.clear();
+    for(std::multimap<unsigned int, std::string>::const_iterator i = sym.begin(); i != sym.end(); i++) {
+        if(symbols.empty() || (symbols.back().addr != i->first)) {
+            FlashSymbol s;
+            s.addr = i->first;
+            s.name = i->second;
+            symbols.push_back(s);
+        } else
+            symbols.back().name += "," + i->second;
+        symbols.back().last = i->second;
+    }
+
+    symbolAt.assign(size / 2, -1);
+    for(unsigned int id = 0; id < symbols.size(); id++) {
+        unsigned int end = (id + 1 < symbols.size()) ? symbols[id + 1].addr : symbolAt.size();
+        for(unsigned int a = symbols[id].addr; (a < end) && (a < symbolAt.size()); a++)
+            symbolAt[a] = id;
+    }
+    symbolIndexValid = true;
+}
+
+int AvrFlash::FindSymbolId(unsigned int addr) const {
+    // binary search for the last entry with entry.addr <= addr
+    int lo = 0, hi = symbols.size();
+    while(lo < hi) {
+        int mid = (lo + hi) / 2;
+        if(symbols[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo - 1;
+}
+
+std::string AvrFlash::GetSymbolAtAddress(unsigned int add) {
+    std::ostringstream os;
+    WriteSymbolAtAddress(os, add);
+    return os.str();
+}
+
+void AvrFlash::WriteSymbolAtAddress(std::ostream &os, unsigned int add, unsigned int width) {
+    unsigned int len = 0;
+    int id = GetSymbolId(add);
+    if((id < 0) && !symbols.empty())
+        id = 0;  // below first symbol, same as Memory::GetSymbolAtAddress
+    if(id >= 0) {
+        const FlashSymbol &s = symbols[id];
+        os.write(s.name.data(), s.name.length());
+        len = s.name.length();
+        unsigned int offset = add - s.addr;
+        if(offset != 0) {
+            static const char digits[] = "0123456789abcdef";
+            char buf[16];
+            char *p = buf + sizeof(buf);
+            do {
+                *--p = digits[offset & 0xf];
+                offset >>= 4;
+            } while(offset != 0);
+            *--p = 'x';
+            *--p = '0';
+            *--p = '+';
+            os.write(p, buf + sizeof(buf) - p);
+            len += buf + sizeof(buf) - p;
+        }
+    }
+    for(; len < width; len++)
+        os.put(' ');
 }
 
 /** Returns true if insn at address index*2 looks like switching thread stacks (heuristics).
@@ -128,11 +245,11 @@ void AvrFlash::Decode(unsigned int addr) {
 * We analyze few preceding instructions in hope to rule out these cases.
 * (GDB's weak prologue analysis is doctored elsewhere.)
 */
-bool AvrFlash::LooksLikeContextSwitch(unsigned int addr) const
+bool AvrFlash::LooksLikeContextSwitch(unsigned int addr)
 {
     assert(addr < size);
     word index = addr/2;
-    DecodedInstruction * instr = DecodedMem[index];
+    DecodedInstruction * instr = DecodedAt(index);
     avr_op_OUT * out_instr = dynamic_cast<avr_op_OUT*>(instr);
     if(out_instr == NULL)
         return false;
@@ -144,7 +261,7 @@ bool AvrFlash::LooksLikeContextSwitch(unsigned int addr) const
     unsigned char out_R = out_instr->R1;  // We have "OUT SP, R"
 
     for(int i = 1; i < 8 && i <= index; i++) {
-        instr = DecodedMem[index - i];
+        instr = DecodedAt(index - i);
         byte Rlo = instr->GetModifiedR();  // "sbiw r28:r29, 42" returns 28
         byte Rhi = instr->GetModifiedRHi();  // "sbiw r28:r29, 42" returns 29
         if(out_R == Rlo || (is_SPH && out_R == Rhi)) {
@@ -31,35 +31,79 @@
 
 #include "decoder.h"
 #include "memory.h"
+#include "avrerror.h"
 
 class DecodedInstruction;
+class BlockCache;
+
+//! Source line of a flash address, from DWARF line info of the elf file
+struct SourceLine {
+    int file;           //!< index in AvrFlash::sourceFiles, -1 for end of a code sequence
+    unsigned int line;  //!< line number, starts with 1
+};
+
+//! Entry of the flash symbol index, holds all symbols of one word address
+struct FlashSymbol {
+    unsigned int addr;  //!< word address
+    std::string name;   //!< all symbol names at addr, concatenated by ','
+    std::string last;   //!< last symbol name at addr, used as function name
+};
 
 //! Holds AVR flash content and symbol informations.
 class AvrFlash: public Memory {
   
     protected:
         AvrDevice *core;
-        std::vector <DecodedInstruction*> DecodedMem;
+        std::vector <DecodedInstruction*> DecodedMem; //!< instruction per flash word, NULL if not decoded yet
+        std::vector <DispatchRecord> DispatchMem; //!< flat dispatch table for direct dispatch engine, in sync with DecodedMem
         unsigned int rww_lock; //!< When Flash write is in progress then addresses below this are inaccesible, otherwise 0.
         bool flashLoaded; //!< Flag, true if there was a write to Flash after constructor call (program load)
+        BlockCache *blockCache; //!< translated blocks for block engine, invalidated by Decode
+        std::vector<FlashSymbol> symbols; //!< symbol index, position is the symbol id
+        std::vector<int> symbolAt; //!< symbol id per flash word, -1 if there is no symbol at or below
+        bool symbolIndexValid; //!< false, if symbol index has to be built from sym
         
+        friend class BlockCache;
         friend int avr_op_CPSE::operator()();
         friend int avr_op_SBIC::operator()();
         friend int avr_op_SBIS::operator()();
         friend int avr_op_SBRC::operator()();
         friend int avr_op_SBRS::operator()();
 
+        //! Decodes the instruction at word index, called on first fetch
+        void DecodeWord(unsigned int index);
+
+        //! Returns instruction at word index, decodes it on first use. No RWW lock check!
+        DecodedInstruction *DecodedAt(unsigned int index) {
+            if(DecodedMem[index] == NULL)
+                DecodeWord(index);
+            return DecodedMem[index];
+        }
+
+        //! Returns dispatch record at word index, decodes it on first use. No RWW lock check!
+        const DispatchRecord &DispatchAt(unsigned int index) {
+            if(DispatchMem[index].insn == NULL)
+                DecodeWord(index);
+            return DispatchMem[index];
+        }
+
     public:
       
         AvrFlash(AvrDevice *c, int size);
         ~AvrFlash();
         
-        void Decode(); /*!< Decode/create all instructions */
+        void Decode(); /*!< Invalidate all instructions, see Decode(unsigned int) */
         
-        /*! Decode/create instruction at address 'addr'. */
+        /*! Invalidate instruction at address 'addr'.
+
+          Instructions are decoded on first fetch (see GetInstruction and
+          GetDispatchRecord), so this only drops the old instruction and all
+          translated blocks, which contain it. It's decoded again from current
+          flash content, when it will be executed next time. */
         void Decode(unsigned int addr);
         
         /*! Decode memory block with offset and size
+          Like Decode(unsigned int), decoding itself is done on first fetch.
           @param offset data offset in memory block, beginning from start of THIS memory block!
           @param secSize count of available data (bytes) in src */
         void Decode(unsigned int addr, int secSize);
@@ -82,8 +126,15 @@ class AvrFlash: public Memory {
           @param addr address, below flash is locked, 0 to disable lock */
         void SetRWWLock(unsigned int addr) { rww_lock = addr;}
         
-        /*! Returns instruction at pointer PC. Aborts if Flash write is in progress. */
+        /*! Returns instruction at pointer PC, decodes it on first use. Aborts if Flash write is in progress. */
         DecodedInstruction* GetInstruction(unsigned int pc);
+
+        /*! Returns direct dispatch record at pointer PC, decodes it on first use. Aborts if Flash write is in progress. */
+        const DispatchRecord &GetDispatchRecord(unsigned int pc) {
+            if(IsRWWLock(pc * 2))
+                avr_error("flash is locked (RWW lock)");
+            return DispatchAt(pc);
+        }
         
         /*! Returns byte at flash address. Works even during flash writing. */
         unsigned char ReadMemRaw(unsigned int addr) { return myMemory[addr]; }
@@ -97,7 +148,63 @@ class AvrFlash: public Memory {
         /*! Returns 16bits at flash address. Aborts if Flash write is in progress. */
         unsigned int ReadMemWord(unsigned int addr);
 
-        bool LooksLikeContextSwitch(unsigned int addr) const;
+        bool LooksLikeContextSwitch(unsigned int addr);
+
+        /*! Returns translation cache for block engine */
+        BlockCache *GetBlockCache(void) { return blockCache; }
+
+        /*! source file names from DWARF line info */
+        std::vector<std::string> sourceFiles;
+
+        /*! source line by word address, valid up to the next entry */
+        std::map<unsigned int, SourceLine> lines;
+
+        /*! Returns index of a source file name in sourceFiles, adds it on first use */
+        unsigned int AddSourceFile(const std::string &name);
+
+        /*! Add source line for code, which starts at word address addr
+          @param file index in sourceFiles, -1 marks the end of a code sequence */
+        void AddSourceLine(unsigned int addr, int file, unsigned int line);
+
+        /*! Returns source line for word address addr, file is -1, if unknown */
+        SourceLine GetSourceLine(unsigned int addr) const;
+
+        /*! Add the (address, symbol) pair and invalidates the symbol index */
+        void AddSymbol(std::pair<unsigned int, std::string> p) {
+            sym.insert(p);
+            symbolIndexValid = false;
+        }
+
+        /*! Builds symbol index from sym, AddSymbol invalidates it, so it's
+          rebuilt on next use. Only a direct change of sym needs a call. */
+        void BuildSymbolIndex(void);
+
+        /*! Returns id of the symbol at or below word address addr, -1 if there is none */
+        int GetSymbolId(unsigned int addr) {
+            if(!symbolIndexValid)
+                BuildSymbolIndex();
+            if(addr < symbolAt.size())
+                return symbolAt[addr];
+            return FindSymbolId(addr);
+        }
+
+        /*! Returns symbol index entry for a id from GetSymbolId */
+        const FlashSymbol &GetSymbol(int id) const { return symbols[id]; }
+
+        /*! Like Memory::GetSymbolAtAddress, but uses symbol index
+          @param add word address
+          @return symbol names and offset or empty string, if there are no symbols. Below
+          the first symbol, the offset to the first symbol is given like by Memory. */
+        std::string GetSymbolAtAddress(unsigned int add);
+
+        /*! Writes the same as GetSymbolAtAddress to os without creating a string
+          @param add word address
+          @param width output is filled up with spaces to this width */
+        void WriteSymbolAtAddress(std::ostream &os, unsigned int add, unsigned int width = 0);
+
+    protected:
+        /*! Seeks symbol id for a address outside of flash */
+        int FindSymbolId(unsigned int addr) const;
 };
 
 #endif
@@ -360,6 +360,9 @@ void HWAd::SetAdcsrA(unsigned char val) {
         val |= ADSC;
     // store value
     adcsra = val;
+    // ADC is removed from cycle list, while it's disabled
+    if((adcsra & ADEN) == ADEN)
+        core->AddToCycleList(this);
 
     // set prescaler selection
     prescalerSelect = adcsra & ADPS;
@@ -587,6 +590,10 @@ unsigned int HWAd::CpuCycle() {
         } // end of switch state
     }
 
+    // nothing to do, until ADC is enabled again, see SetAdcsrA
+    if((adcsra & ADEN) == 0)
+        core->RemoveFromCycleList(this);
+
     return 0;
 }
 
@@ -25,6 +25,8 @@
 
 #include <stdarg.h>
 #include "hwcache.h"
+#include "cachesweep.h"
+#include "cacheprofile.h"
 #include "avrdevice.h"
 #include "systemclock.h"
 #include "irqsystem.h"
@@ -32,52 +34,74 @@
 #include "avrmalloc.h"
 #include <assert.h>
 #include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <ctype.h>
 #include <cmath>
 #include <sstream>
+#include <fstream>
+#include <limits>
 
 using namespace std;
 
 /**
- * Cache model (LRU):
+ * Cache model:
  *
- * we allocate a continuous chunk of memory for all lines
- * each line has: tag, dirty, valid, next*
- * lines within set are stored as NULL-terminated linked lists, using the next* pointer
- * each cache set is simply the ptr to the head of the list (=newest)
+ * each line has: tag, dirty and a stamp, stored in one array per item with
+ * assoc consecutive entries for each set. Ways are filled in order, so the
+ * first num_entries ways of a set are valid and a lookup is a plain loop over
+ * the tags. The stamp is the time of the last access (LRU, MRU) or of the
+ * load (FIFO), tree PLRU keeps assoc-1 direction bits per set instead. MRU
+ * gives a loaded line a stamp older than all others, so it's evicted next,
+ * if it isn't hit before: stamps of loads count down from the middle of the
+ * range, stamps of hits count up.
  */
 
+static const char *policyNames[HWCache::POLICY_COUNT] = {
+    "LRU", "PLRU", "FIFO", "RANDOM", "MRU"
+};
+
 static inline bool powerof_two(int n) {
     return n && !(n & (n - 1));
 }
 
 HWCache::HWCache(AvrDevice *_core,
-                 unsigned int lines,
-                 unsigned int linesize,
-                 unsigned int assoc,
+                 const CacheConfig &config,
                  HWIrqSystem *_irqSystem,
-                 unsigned int size,
                  unsigned int irqVec,
-                 bool trace_on):
+                 const std::string &name):
     Hardware(_core),
-    TraceValueRegister(_core, "CACHE"),
+    TraceValueRegister(_core, name),
     core(_core),
+    cacheName(name),
+    report(config.report),
+    sweep(NULL),
+    profile(NULL),
     irqSystem(_irqSystem),
     irqVectorNo(irqVec),
     ccr_reg(this, "CCR", this, &HWCache::GetCcr, &HWCache::SetCcr),
     opState(OPSTATE_ENABLED),
-    opMode(OPMODE_WRITEBACK),
-    cache_config_nlines(lines),
-    cache_config_linesize(linesize),
-    cache_config_assoc(assoc),
-    cacheHitCycles(0),
-    cacheMissCycles(3),
-    cacheWritethroughCycles(5),
-    cacheWritebackCycles(5)
+    opMode(config.mode),
+    resetMode(config.mode),
+    cache_config_nlines(config.lines),
+    cache_config_linesize(config.linesize),
+    cache_config_assoc(config.assoc),
+    cacheHitCycles(config.hitCycles),
+    cacheMissCycles(config.missCycles),
+    cacheWritethroughCycles(config.writethroughCycles),
+    cacheWritebackCycles(config.writebackCycles),
+    policy(config.policy)
 {
-    if (trace_on) {
+    std::string err = config.Check();
+    if (!err.empty())
+        avr_error("%s: %s", cacheName.c_str(), err.c_str());
+
+    if (config.trace) {
         std::string fname = sysConHandler.GetTraceFileName();
         if (fname.empty()) fname = "trace";
-        fname += ".cache";
+        fname += ".";
+        for (size_t k = 0; k < cacheName.size(); ++k)
+            fname += tolower(cacheName[k]);
         traceFile = fopen(fname.c_str(), "w");
         avr_warning("Writing cache trace to '%s'", fname.c_str());
     } else {
@@ -87,17 +111,24 @@ HWCache::HWCache(AvrDevice *_core,
     if(irqSystem)
         irqSystem->DebugVerifyInterruptVector(irqVectorNo, this);
 
-    if(opMode == OPMODE_WRITETHROUGH) {
+    if(config.clearTime > 0) {
+        cacheClearTime = config.clearTime;
+    } else if(opMode == OPMODE_WRITETHROUGH) {
         cacheClearTime = 1500000LL; // 1.5ms - just drops data
     } else {
         cacheClearTime = 8500000LL; // 8.5ms - writeback needs to store to backing memory
     }
+    ccr_mask = 0xff;
     if(NULL == irqSystem) {
         ccr_mask = ~CTRL_IRQ;  // ignore IRQ bit if system is not set up
     }
     ccr = CTRL_UNINITIALIZED;
     Reset();
     _init_cache_model();
+    if (config.profile)
+        profile = new CacheProfile(core, cache_config_linesize, cache_config_nsets);
+    if (!config.sweeps.empty())
+        sweep = new CacheSweep(core, this, config, cacheName);
 }
 
 void HWCache::Reset() {
@@ -108,11 +139,20 @@ void HWCache::Reset() {
     if (irqSystem)
         ccr |= CTRL_IRQ;
     opState = OPSTATE_ENABLED;
-    opMode = OPMODE_WRITEBACK;
+    opMode = resetMode;
 }
 
 HWCache::~HWCache() {
-    print_stats();
+    if (report)
+        print_stats();
+    if (profile) {
+        profile->Report(cacheName);
+        delete profile;
+    }
+    if (sweep) {
+        sweep->Report();
+        delete sweep;
+    }
     if (traceFile) {
         fprint_stats(traceFile);
         fclose(traceFile);
@@ -121,35 +161,39 @@ HWCache::~HWCache() {
 }
 
 void HWCache::_cleanup_cache_model(void) {
-    avr_free(cache_model_lines);
-    avr_free(cache_model_sets);
+    avr_free(cache_model_tags);
+    avr_free(cache_model_dirty);
+    avr_free(cache_model_stamps);
+    avr_free(cache_model_used);
+    avr_free(cache_model_plru);
 }
 
 void HWCache::_init_cache_model(void) {
-    assert(powerof_two(cache_config_linesize));
-    assert(powerof_two(cache_config_nlines));
+    // geometry is checked by CacheConfig::Check
     cache_offsetbits = (int)(log(cache_config_linesize) / log(2.));
     cache_config_nsets = cache_config_nlines / cache_config_assoc;
 
     memset((void*)&stats, 0, sizeof(stats));
 
-    // set up contiguous memory chunk to model cache; each set has one additional dummy entry
-    cache_model_sets = avr_new(cache_set_t, cache_config_nsets);
-    cache_model_lines = avr_new(cache_entry_t, cache_config_nsets * (cache_config_assoc + 1));
-    cache_entry_t* ce = cache_model_lines;
-    for (int k = 0; k < cache_config_nsets; ++k, ce += (cache_config_assoc + 1)) {
-        cache_model_sets[k].begin = ce;
-    }
+    // one array for each line item, lines of a set are consecutive
+    const unsigned int nlines = cache_config_nsets * cache_config_assoc;
+    cache_model_tags = avr_new(unsigned int, nlines);
+    cache_model_dirty = avr_new(unsigned char, nlines);
+    cache_model_stamps = avr_new(unsigned long, nlines);
+    cache_model_used = avr_new(unsigned int, cache_config_nsets);
+    cache_model_plru = avr_new(unsigned int, cache_config_nsets);
+    randomState = 0x2545f491;  // fixed seed, runs are reproducible
     _clear_cache();
 
     // verbose config
     stringstream ss;
-    ss << "Cache config: lines=" << cache_config_nlines << " each " << cache_config_linesize
+    ss << cacheName << " config: lines=" << cache_config_nlines << " each " << cache_config_linesize
        << "bytes (" << cache_offsetbits << "bits), assoc=" << cache_config_assoc
-       << ", sets=" << cache_config_nsets << ", policy=LRU";
-    const char* msg = ss.str().c_str();
-    trace(msg);
-    avr_warning(msg);
+       << ", sets=" << cache_config_nsets << ", policy=" << GetPolicyName(policy);
+    const std::string msg = ss.str();
+    trace("%s", msg.c_str());
+    if (report)
+        avr_warning("%s", msg.c_str());
 }
 
 std::string HWCache::get_stats(void)
@@ -157,10 +201,11 @@ std::string HWCache::get_stats(void)
     stringstream ss;
     unsigned lines_used = 0;
     for (int set = 0; set < cache_config_nsets; ++set) {
-        unsigned ne = cache_model_sets[set].num_entries;
+        unsigned ne = cache_model_used[set];
         lines_used += ne;
     }
-    ss << "CACHE statistics:" << endl
+    ss << cacheName << " statistics:" << endl
+       << "  policy:      " << GetPolicyName(policy) << endl
        << "  usage%:      " << 100.f*(((float)lines_used) / cache_config_nlines) << endl
        << "  accesses:    " << stats.num_access << endl
        << "  misses/%:    " << stats.num_miss << " / "
@@ -169,7 +214,8 @@ std::string HWCache::get_stats(void)
        << "  unaligned/%: " << stats.num_unaligned << " / "
                             << 100.f*(((float)stats.num_unaligned) / stats.num_access) << endl
        << "  writeback:   " << stats.num_writeback << endl
-       << "  clears:      " << stats.num_clears << endl;
+       << "  clears:      " << stats.num_clears << endl
+       << "  cycles:      " << stats.num_cycles << endl;
     return ss.str();
 }
 
@@ -180,81 +226,129 @@ void HWCache::fprint_stats(FILE* fp) {
 
 void HWCache::fprint_set(FILE* fp, unsigned set) const {
     assert(set < cache_config_nsets);
+    const unsigned int base = set * cache_config_assoc;
+    const unsigned int size = cache_model_used[set];
     fprintf(fp, "SET %d:", set);
-    cache_entry_t* checked_item = cache_model_sets[set].begin;  ///< begin is the dummy item
-    unsigned int size = 0;
-    for (int k = 0; k < cache_config_assoc; ++k) {
-        if (NULL == checked_item->next) break;
-        size++;
-        checked_item = checked_item->next;
-        fprintf(fp, " [t=0x%x, d=%d]", checked_item->tag, checked_item->dirty);
+    // ways sorted by their stamp, newest first, like the replacement order
+    unsigned int *order = avr_new(unsigned int, size);
+    for (unsigned int k = 0; k < size; ++k)
+        order[k] = k;
+    if (policy != POLICY_PLRU && policy != POLICY_RANDOM) {
+        for (unsigned int k = 1; k < size; ++k)
+            for (unsigned int j = k; j > 0; --j) {
+                if (cache_model_stamps[base + order[j]] <= cache_model_stamps[base + order[j - 1]])
+                    break;
+                unsigned int tmp = order[j];
+                order[j] = order[j - 1];
+                order[j - 1] = tmp;
+            }
+    }
+    for (unsigned int k = 0; k < size; ++k) {
+        const unsigned int way = order[k];
+        fprintf(fp, " [w=%u, t=0x%x, d=%d]", way, cache_model_tags[base + way], cache_model_dirty[base + way]);
     }
+    if (policy == POLICY_PLRU)
+        fprintf(fp, " plru=0x%x", cache_model_plru[set]);
     fprintf(fp, "\n");
-    assert(size == cache_model_sets[set].num_entries);
+    avr_free(order);
 }
 
 void HWCache::print_stats(void) {
     std::string strstat = get_stats();
-    avr_warning(strstat.c_str());
+    avr_warning("%s", strstat.c_str());
+}
+
+const char *HWCache::GetPolicyName(repl_policy_e policy) {
+    assert(policy < POLICY_COUNT);
+    return policyNames[policy];
+}
+
+bool HWCache::ParsePolicy(const std::string &name, repl_policy_e &policy) {
+    for (int k = 0; k < POLICY_COUNT; ++k) {
+        if (strcasecmp(name.c_str(), policyNames[k]) == 0) {
+            policy = (repl_policy_e)k;
+            return true;
+        }
+    }
+    return false;
 }
 
 /**
- * @brief update given set by loading tag, if not loaded. Possibly evict another one.
- * @param accessed_item pointer to item, in case tag is already in set. Otherwise NULL.
- * @param checked_item the last (=oldest) item in the set that was checked
- * @param prev_item the one previous to last
+ * @brief select the way of a full set, which has to be evicted
  **/
-inline int HWCache::_update_set_lru
-(unsigned set, cache_entry_t* prev_item, cache_entry_t* accessed_item, cache_entry_t* checked_item,
- unsigned tag, bool write)
+inline unsigned int HWCache::_select_victim(unsigned int set)
 {
-    int cycles = 0;
-    if (NULL == accessed_item) {
-        // not in cache
-        if (cache_model_sets[set].num_entries == cache_config_assoc) {
-            // eviction needed: throw out oldest (LRU)
-            assert(checked_item);
-            assert(NULL == checked_item->next);
-            trace("E s=%d, t=0x%x", set, checked_item->tag);
-            if (opMode == OPMODE_WRITEBACK && checked_item->dirty) {
-                cycles += cacheWritebackCycles;
-                stats.num_writeback++;
-                trace("WB s=%d, t=0x%x", set, checked_item->tag);
-            }
-            // take its line
-            accessed_item = checked_item;
-            // previously second-to-oldest is now oldest
-            if (cache_config_assoc > 1) {
-            assert(prev_item != cache_model_sets[set].begin);
-                prev_item->next = NULL;
-            }
-            stats.num_evict++;
-        } else {
-            // space left in set: take free line
-            cache_model_sets[set].num_entries++;
-            accessed_item = cache_model_sets[set].begin + cache_model_sets[set].num_entries;
-        }
-        accessed_item->tag = tag;
-        accessed_item->next = cache_model_sets[set].begin->next; // formerly youngest ages now
+    const unsigned int base = set * cache_config_assoc;
+    const unsigned long* stamps = cache_model_stamps + base;
+    unsigned int way = 0;
+    switch (policy) {
+        case POLICY_LRU:
+        case POLICY_FIFO:
+        case POLICY_MRU:
+            // oldest stamp
+            for (unsigned int k = 1; k < cache_config_assoc; ++k)
+                way = (stamps[k] < stamps[way]) ? k : way;
+            break;
 
-    } else {
-        // is in cache. just update LRU sorting. accessed
-        if (prev_item != cache_model_sets[set].begin) {
-            prev_item->next = accessed_item->next;
-            accessed_item->next = cache_model_sets[set].begin->next;
+        case POLICY_PLRU: {
+            // walk down the tree: bit 0 points to the left, bit 1 to the right subtree
+            const unsigned int bits = cache_model_plru[set];
+            unsigned int node = 1;
+            while (node < cache_config_assoc)
+                node = 2 * node + ((bits >> node) & 1);
+            way = node - cache_config_assoc;
+            break;
         }
+
+        default:
+            // xorshift32
+            randomState ^= randomState << 13;
+            randomState ^= randomState >> 17;
+            randomState ^= randomState << 5;
+            way = randomState % cache_config_assoc;
+            break;
     }
+    return way;
+}
 
-    // accessed is the youngest in the set now
-    cache_model_sets[set].begin->next = accessed_item;
-    assert(accessed_item != accessed_item->next);
+/**
+ * @brief update replacement state after an access on a line
+ * @param load true, if tag was loaded into this line by this access
+ **/
+inline void HWCache::_touch_line(unsigned int set, unsigned int way, bool load)
+{
+    switch (policy) {
+        case POLICY_LRU:
+            cache_model_stamps[set * cache_config_assoc + way] = ++stampCounter;
+            break;
 
-    // finally, set bits
-    accessed_item->dirty = (write && opMode == OPMODE_WRITEBACK);
+        case POLICY_MRU:
+            // a loaded line becomes LRU, a hit makes it MRU
+            cache_model_stamps[set * cache_config_assoc + way] = load ? --insertStamp : ++stampCounter;
+            break;
 
-    //if (traceFile)
-    //    fprint_set(traceFile, set);
-    return cycles;
+        case POLICY_FIFO:
+            if (load)
+                cache_model_stamps[set * cache_config_assoc + way] = ++stampCounter;
+            break;
+
+        case POLICY_PLRU: {
+            // let all nodes on the path point away from the accessed line
+            unsigned int bits = cache_model_plru[set];
+            for (unsigned int node = way + cache_config_assoc; node > 1; node >>= 1) {
+                const unsigned int parent = node >> 1;
+                if (node & 1)
+                    bits &= ~(1U << parent);
+                else
+                    bits |= 1U << parent;
+            }
+            cache_model_plru[set] = bits;
+            break;
+        }
+
+        default:
+            break;
+    }
 }
 
 inline int HWCache::_access_set
@@ -262,27 +356,18 @@ inline int HWCache::_access_set
 {
     int cycles = 0;
     assert(set < cache_config_nsets);
-    cache_entry_t* checked_item = cache_model_sets[set].begin;  ///< begin is the dummy item
-
-    // linear search for tag in set
-    cache_entry_t* prev_item;
-    cache_entry_t* found_item = NULL;
-    int k;
-    for (k = 0; k < cache_config_assoc; ++k) {
-        prev_item = checked_item;
-        if (NULL == checked_item->next) break;
-
-        checked_item = checked_item->next;
-        if (checked_item->tag == tag) {
-            found_item = checked_item;
-            break;
-        }
-    }
-    assert(k <= cache_model_sets[set].num_entries);
+    const unsigned int base = set * cache_config_assoc;
+    const unsigned int num_entries = cache_model_used[set];
+    const unsigned int* tags = cache_model_tags + base;
+
+    // search tag in valid ways, tags in a set are unique
+    unsigned int way = num_entries;
+    for (unsigned int k = 0; k < num_entries; ++k)
+        way = (tags[k] == tag) ? k : way;
+    const bool found = way < num_entries;
 
     // hit/miss penalties
-    if (found_item) {
-        assert(found_item != cache_model_sets[set].begin);
+    if (found) {
         cycles = cacheHitCycles;
     } else {
         cycles = cacheMissCycles;
@@ -293,11 +378,41 @@ inline int HWCache::_access_set
         cycles += cacheWritethroughCycles;
     }
 
+    bool evict = false;
+    bool writeback = false;
+    unsigned int evicted = 0;
     if (allow_update) {
-        cycles += _update_set_lru(set, prev_item, found_item, checked_item, tag, write);
+        if (!found) {
+            if (num_entries == cache_config_assoc) {
+                // eviction needed
+                way = _select_victim(set);
+                evict = true;
+                evicted = tags[way];
+                trace("E s=%d, t=0x%x", set, tags[way]);
+                if (opMode == OPMODE_WRITEBACK && cache_model_dirty[base + way]) {
+                    cycles += cacheWritebackCycles;
+                    stats.num_writeback++;
+                    writeback = true;
+                    trace("WB s=%d, t=0x%x", set, tags[way]);
+                }
+                stats.num_evict++;
+            } else {
+                // space left in set: take free line
+                cache_model_used[set]++;
+            }
+            cache_model_tags[base + way] = tag;
+            cache_model_dirty[base + way] = 0;
+        }
+        _touch_line(set, way, !found);
+
+        // finally, set bits
+        if (write && opMode == OPMODE_WRITEBACK)
+            cache_model_dirty[base + way] = 1;
     }
 
     stats.num_access++;
+    if (profile)
+        profile->Access(core->PC, tag, !found, evict, evicted, writeback);
     return cycles;
 }
 
@@ -331,19 +446,30 @@ int HWCache::_serve_access
 
 int HWCache::access(unsigned int addr, unsigned char len, bool write) {
     int cycles = 0;
+    if (sweep)
+        sweep->Access(addr, len, write);
     if (opState == OPSTATE_ENABLED || opState == OPSTATE_LOCKED) {
         cycles = _serve_access(addr, len, write, opState != OPSTATE_LOCKED);
+        stats.num_cycles += cycles;
     }
     return cycles;
 }
 
+int HWCache::GetMaxAccessCycles(void) const {
+    // miss with write and writeback, unaligned access touches 2 sets
+    const int cycles = (cacheHitCycles > cacheMissCycles) ? cacheHitCycles : cacheMissCycles;
+    return 2 * (cycles + cacheWritethroughCycles + cacheWritebackCycles);
+}
+
 void HWCache::_clear_cache(void) {
-    for (int k = 0; k < cache_config_nsets; ++k) {
-        cache_model_sets[k].num_entries = 0;
-    }
-    // each set has one leading dummy entry
-    const unsigned nbytes = sizeof(cache_entry_t) * cache_config_nsets * (cache_config_assoc + 1);
-    memset((void*)cache_model_lines, 0, nbytes);
+    const unsigned int nlines = cache_config_nsets * cache_config_assoc;
+    memset((void*)cache_model_used, 0, sizeof(unsigned int) * cache_config_nsets);
+    memset((void*)cache_model_plru, 0, sizeof(unsigned int) * cache_config_nsets);
+    memset((void*)cache_model_tags, 0, sizeof(unsigned int) * nlines);
+    memset((void*)cache_model_dirty, 0, sizeof(unsigned char) * nlines);
+    memset((void*)cache_model_stamps, 0, sizeof(unsigned long) * nlines);
+    stampCounter = numeric_limits<unsigned long>::max() / 2;
+    insertStamp = stampCounter;
     stats.num_clears++;
 }
 
@@ -370,6 +496,8 @@ void HWCache::SetCcr(unsigned char newval) {
                 clearDoneTime = SystemClock::Instance().GetCurrentTime() + t;
                 opState = OPSTATE_CLEARING;
                 _clear_cache();
+                if (sweep)
+                    sweep->Clear();
                 ccr &= ~CTRL_CLEAR;  // immediately revoke bit
                 trace("CL start");
                 break; // to ignore any other requests
@@ -415,6 +543,10 @@ void HWCache::SetCcr(unsigned char newval) {
             }
             break;
     }
+
+    // activate engine for cpu hold and clear state
+    if((cpuHoldCycles > 0) || (opState == OPSTATE_CLEARING))
+        core->AddToCycleList(this);
 }
 
 unsigned int HWCache::CpuCycle() {
@@ -433,8 +565,12 @@ unsigned int HWCache::CpuCycle() {
     }
 
     // deactivate engine, if not used
-    //if((opState == OPSTATE_READY) && (cpuHoldCycles == 0) && (opEnableCycles == 0))
-    //    core->RemoveFromCycleList(this);
+    if(cpuHoldCycles == 0) {
+        if(opState == OPSTATE_CLEARING)
+            core->SleepHardwareUntil(this, clearDoneTime);
+        else
+            core->RemoveFromCycleList(this);
+    }
 
     // handle cpu hold state
     if(cpuHoldCycles > 0) {
@@ -463,3 +599,157 @@ void HWCache::ClearIrqFlag(unsigned int vector) {
         irqSystem->ClearIrqFlag(irqVectorNo);
 }
 
+
+CacheConfig::CacheConfig():
+    enabled(true),
+    lines(64),
+    linesize(32),
+    assoc(4),
+    hitCycles(0),
+    missCycles(3),
+    writethroughCycles(5),
+    writebackCycles(5),
+    clearTime(0),
+    policy(HWCache::POLICY_LRU),
+    mode(HWCache::OPMODE_WRITEBACK),
+    trace(false),
+    profile(false),
+    report(true) {}
+
+//! parses a not negative number for CacheConfig::Set
+static bool cache_config_number(const std::string &value, long long &n) {
+    char *end;
+    if (value.empty())
+        return false;
+    n = strtoll(value.c_str(), &end, 0);
+    return (*end == 0) && (n >= 0);
+}
+
+//! parses a switch for CacheConfig::Set
+static bool cache_config_bool(const std::string &value, bool &b) {
+    if (value == "1" || value == "on" || value == "yes" || value == "true")
+        b = true;
+    else if (value == "0" || value == "off" || value == "no" || value == "false")
+        b = false;
+    else
+        return false;
+    return true;
+}
+
+std::string CacheConfig::Set(const std::string &key, const std::string &value) {
+    long long n = 0;
+    if (key == "on" || key == "off") {
+        if (!value.empty())
+            return "'" + key + "' has no value";
+        enabled = (key == "on");
+    } else if (key == "enable") {
+        if (!cache_config_bool(value, enabled))
+            return "enable needs on or off, not '" + value + "'";
+    } else if (key == "trace") {
+        if (!cache_config_bool(value, trace))
+            return "trace needs on or off, not '" + value + "'";
+    } else if (key == "profile") {
+        if (!cache_config_bool(value, profile))
+            return "profile needs on or off, not '" + value + "'";
+    } else if (key == "sweep") {
+        if (value.empty())
+            return "sweep needs a entry";
+        sweeps.push_back(value);
+    } else if (key == "policy") {
+        if (!HWCache::ParsePolicy(value, policy))
+            return "unknown policy '" + value + "', use lru, plru, fifo, random or mru";
+    } else if (key == "mode") {
+        if (value == "writeback" || value == "wb")
+            mode = HWCache::OPMODE_WRITEBACK;
+        else if (value == "writethrough" || value == "wt")
+            mode = HWCache::OPMODE_WRITETHROUGH;
+        else
+            return "unknown write mode '" + value + "', use writeback or writethrough";
+    } else if (key == "lines" || key == "linesize" || key == "assoc" || key == "hit" || key == "miss" ||
+               key == "writethrough" || key == "writeback" || key == "clear") {
+        if (!cache_config_number(value, n) || n > 0x7fffffff)
+            return key + " needs a number, not '" + value + "'";
+        if (key == "lines") lines = n;
+        else if (key == "linesize") linesize = n;
+        else if (key == "assoc") assoc = n;
+        else if (key == "hit") hitCycles = n;
+        else if (key == "miss") missCycles = n;
+        else if (key == "writethrough") writethroughCycles = n;
+        else if (key == "writeback") writebackCycles = n;
+        else clearTime = n;
+    } else {
+        return "unknown key '" + key + "'";
+    }
+    return "";
+}
+
+void CacheConfig::Apply(const std::string &cache, const std::vector<std::string> &options) {
+    for (size_t k = 0; k < options.size(); ++k) {
+        const std::string &opt = options[k];
+        size_t colon = opt.find(':');
+        if (colon == std::string::npos)
+            avr_error("cache option '%s': use <cache>:<key>=<value>[,...]", opt.c_str());
+        if (opt.compare(0, colon, cache) != 0)
+            continue;
+        size_t pos = colon + 1;
+        while (pos <= opt.size()) {
+            size_t comma = opt.find(',', pos);
+            if (comma == std::string::npos)
+                comma = opt.size();
+            std::string setting = opt.substr(pos, comma - pos);
+            if (setting.compare(0, 6, "sweep=") == 0) {
+                // takes all following settings
+                comma = opt.size();
+                setting = opt.substr(pos);
+            }
+            size_t eq = setting.find('=');
+            std::string key = setting.substr(0, eq);
+            std::string value = (eq == std::string::npos) ? "" : setting.substr(eq + 1);
+            std::string err = Set(key, value);
+            if (!err.empty())
+                avr_error("cache option '%s': %s", opt.c_str(), err.c_str());
+            pos = comma + 1;
+        }
+    }
+}
+
+std::string CacheConfig::Check(void) const {
+    stringstream ss;
+    if (linesize < 4 || !powerof_two(linesize))
+        ss << "line size " << linesize << " must be a power of two and at least 4 bytes";
+    else if (assoc == 0 || lines == 0 || lines % assoc != 0)
+        ss << lines << " lines can't be divided into sets of " << assoc << " lines";
+    else if (policy == HWCache::POLICY_PLRU && (!powerof_two(assoc) || assoc > 32))
+        ss << "tree PLRU needs a power of two associativity up to 32, not " << assoc;
+    else if (hitCycles < 0 || missCycles < 0 || writethroughCycles < 0 || writebackCycles < 0)
+        ss << "latencies must not be negative";
+    return ss.str();
+}
+
+void CacheConfig::ReadFile(const std::string &filename, std::vector<std::string> &options) {
+    ifstream in(filename.c_str());
+    if (!in)
+        avr_error("can't open cache config file '%s'", filename.c_str());
+    std::string line, section;
+    for (int lineno = 1; getline(in, line); ++lineno) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+        // remove all white space, keys and values don't contain any
+        std::string text;
+        for (size_t k = 0; k < line.size(); ++k)
+            if (!isspace((unsigned char)line[k]))
+                text += line[k];
+        if (text.empty())
+            continue;
+        if (text[0] == '[') {
+            if (text[text.size() - 1] != ']' || text.size() < 3)
+                avr_error("%s:%d: invalid section '%s'", filename.c_str(), lineno, text.c_str());
+            section = text.substr(1, text.size() - 2);
+        } else {
+            if (section.empty())
+                avr_error("%s:%d: setting outside of a [<cache>] section", filename.c_str(), lineno);
+            options.push_back(section + ":" + text);
+        }
+    }
+}
@@ -33,6 +33,11 @@
 #include "memory.h"
 #include "traceval.h"
 #include "irqsystem.h"
+#include <vector>
+
+class CacheConfig;
+class CacheSweep;
+class CacheProfile;
 
 /**
  * @brief abstract cache model copied from HWEeprom.
@@ -56,6 +61,16 @@ class HWCache: public Hardware, public TraceValueRegister {
           OPMODE_WRITETHROUGH  ///< implies write-allocate
         } op_mode_e;
 
+        //! replacement policy, which line of a full set is evicted
+        typedef enum {
+          POLICY_LRU = 0,  ///< least recently used line
+          POLICY_PLRU,     ///< tree pseudo LRU, needs power of two associativity
+          POLICY_FIFO,     ///< oldest loaded line, hits don't change the order
+          POLICY_RANDOM,   ///< random line, fixed seed for reproducible runs
+          POLICY_MRU,      ///< MRU insertion (LIP): LRU line, but a new line is inserted as LRU
+          POLICY_COUNT
+        } repl_policy_e;
+
         typedef struct {
             unsigned long num_access;
             unsigned long num_miss;
@@ -63,28 +78,18 @@ class HWCache: public Hardware, public TraceValueRegister {
             unsigned long num_writeback;
             unsigned long num_unaligned;
             unsigned long num_clears;
+            unsigned long long num_cycles;  ///< sum of wait states returned by access
         } cache_stats_t;
 
     protected:
 
-        //! one cache item of a set
-        typedef struct cache_entry_s {
-            unsigned int tag;
-            bool dirty;
-            cache_entry_s* next; ///< NULL if no older entries than this
-        } cache_entry_t;
-
-        /**
-         * @brief each set points to a linked list which is contiguous in memory and has
-         * length assoc+1, whereas the first element of the list is always present and a DUMMY.
-         * Dummy points to the actual list, whereas the items in the list are sorted by their age.
-         */
-        typedef struct cache_set_s {
-            cache_entry_t* begin;  ///< points to NULL-terminated list of
-            unsigned int num_entries;
-        } cache_set_t;
+        friend class CacheSweep;
 
         AvrDevice *core;
+        std::string cacheName;  ///< name of trace group, in trace file name and statistics
+        bool report;  ///< print config and statistics
+        CacheSweep *sweep;  ///< models observing all accesses, NULL if none
+        CacheProfile *profile;  ///< counts per instruction and conflict sets, NULL if none
         // register stuff
         unsigned char ccr;
         unsigned char ccr_mask;
@@ -94,6 +99,7 @@ class HWCache: public Hardware, public TraceValueRegister {
         // device state:
         op_state_e opState;  ///< state machine
         op_mode_e opMode;
+        op_mode_e resetMode;  ///< opMode after reset
         int cpuHoldCycles;
         SystemClockOffset clearDoneTime;
         // user params:
@@ -106,12 +112,20 @@ class HWCache: public Hardware, public TraceValueRegister {
         int cacheWritethroughCycles;
         int cacheWritebackCycles;
         SystemClockOffset cacheClearTime;  ///< time, not clocks
+        repl_policy_e policy;
         // computed:
         unsigned int cache_config_nsets;
         unsigned int cache_offsetbits;
-        // data for model:
-        cache_entry_t* cache_model_lines;
-        cache_set_t* cache_model_sets;
+        /* data for model: arrays with cache_config_assoc items per set for
+           each line, the first num_entries ways of a set are valid. */
+        unsigned int* cache_model_tags;
+        unsigned char* cache_model_dirty;
+        unsigned long* cache_model_stamps;  ///< LRU/MRU: last access, FIFO: load, MRU: load is oldest
+        unsigned int* cache_model_used;  ///< num_entries for each set
+        unsigned int* cache_model_plru;  ///< tree bits for each set, bit k is node k
+        unsigned long stampCounter;  ///< last stamp of an access, counts up
+        unsigned long insertStamp;  ///< MRU: last stamp of a load, counts down
+        unsigned int randomState;
 
         // for stats
         cache_stats_t stats;
@@ -119,9 +133,8 @@ class HWCache: public Hardware, public TraceValueRegister {
         void _init_cache_model(void);
         int _serve_access(unsigned int addr, unsigned char len, bool write, bool allow_update);
         inline int _access_set(unsigned int set, unsigned int tag, bool write, bool allow_update);
-        inline int _update_set_lru(unsigned set, cache_entry_t* prev_item,
-                                   cache_entry_t* accessed_item, cache_entry_t* checked_item,
-                                   unsigned tag, bool write);
+        inline unsigned int _select_victim(unsigned int set);
+        inline void _touch_line(unsigned int set, unsigned int way, bool load);
         void _clear_cache(void);
         void _cleanup_cache_model(void);
         void trace(const char *fmt, ...);
@@ -139,19 +152,29 @@ class HWCache: public Hardware, public TraceValueRegister {
           CTRL_MODES = 48,
         };
 
+        //! Creates a cache with geometry, latencies and policy from config
+        /*! Fails by avr_error, if config has a invalid geometry, see CacheConfig::Check */
         HWCache(AvrDevice *core,
-                unsigned int lines,
-                unsigned int linesize,
-                unsigned int assoc,
+                const CacheConfig &config,
                 HWIrqSystem *irqs,
-                unsigned int size,
                 unsigned int irqVec,
-                bool trace_on=false);
+                const std::string &name="CACHE");
 
         virtual ~HWCache();
 
         //! returns number of cpu cycles taken to access data item
         int access(unsigned int addr, unsigned char len, bool write=false);
+        //! upper bound for the result of access
+        int GetMaxAccessCycles(void) const;
+        //! returns true, if result of access can change by time (cache clear is running)
+        bool IsClearing(void) const { return opState == OPSTATE_CLEARING; }
+        //! returns true, if accesses are attributed to core->PC
+        bool IsProfiling(void) const { return profile != NULL; }
+
+        //! name of a replacement policy, as used in statistics
+        static const char *GetPolicyName(repl_policy_e policy);
+        //! replacement policy for a name (case insensitive), false for a unknown name
+        static bool ParsePolicy(const std::string &name, repl_policy_e &policy);
 
         std::string get_stats(void);
         void print_stats(void);
@@ -170,4 +193,46 @@ class HWCache: public Hardware, public TraceValueRegister {
         FILE* traceFile;
 };
 
+//! Parameters for a HWCache, created by a device
+/*! The device sets its defaults and applies the options given by command
+    line or config file (see AvrFactory::AddCacheOption) before it creates
+    the cache. */
+class CacheConfig {
+    public:
+        bool enabled;  ///< device creates this cache
+        unsigned int lines;  ///< count of lines
+        unsigned int linesize;  ///< bytes per line, power of two
+        unsigned int assoc;  ///< lines per set
+        int hitCycles;
+        int missCycles;
+        int writethroughCycles;
+        int writebackCycles;
+        SystemClockOffset clearTime;  ///< ns for CTRL_CLEAR, 0 for default of write mode
+        HWCache::repl_policy_e policy;
+        HWCache::op_mode_e mode;  ///< write mode after reset
+        bool trace;  ///< write cache trace file
+        bool profile;  ///< write misses per instruction and function and conflict sets
+        bool report;  ///< print config and statistics, false for models of a CacheSweep
+        std::vector<std::string> sweeps;  ///< entries for a CacheSweep, see there
+
+        //! Defaults: 64 lines with 32 bytes, 4-way LRU writeback cache
+        CacheConfig();
+
+        //! Sets one parameter, returns a error message or a empty string
+        /*! Keys are enable, lines, linesize, assoc, hit, miss, writethrough,
+            writeback, clear, policy, mode, trace, profile and sweep. "on" and "off" are
+            short for enable=1 and enable=0. Each sweep adds a entry to sweeps. */
+        std::string Set(const std::string &key, const std::string &value);
+        //! Applies all options "<cache>:<key>=<value>[,...]" for cache, fails by avr_error
+        /*! A sweep key takes the rest of the option as value, commas included. */
+        void Apply(const std::string &cache, const std::vector<std::string> &options);
+        //! Returns a error message for a invalid geometry or a empty string
+        std::string Check(void) const;
+
+        //! Reads a cache config file and appends its settings to options
+        /*! The file has sections "[<cache>]" and lines "<key> = <value>",
+            '#' starts a comment. Fails by avr_error. */
+        static void ReadFile(const std::string &filename, std::vector<std::string> &options);
+};
+
 #endif
@@ -206,6 +206,7 @@ void HWEeprom::SetEecr(unsigned char newval) {
             // enable write mode, mode change will not happen!
             if((eecr & CTRL_ENABLE) == CTRL_ENABLE) {
                 opEnableCycles = 4;
+                core->AddToCycleList(this);
             }
             // read is ignored here
             eecr &= ~CTRL_READ;
@@ -262,6 +263,9 @@ unsigned int HWEeprom::CpuCycle() {
     // deactivate engine, if not used
     if((opState == OPSTATE_READY) && (cpuHoldCycles == 0) && (opEnableCycles == 0))
         core->RemoveFromCycleList(this);
+    // nothing to do until write operation is finished
+    else if((opState == OPSTATE_WRITE) && (cpuHoldCycles == 0) && (opEnableCycles == 0))
+        core->SleepHardwareUntil(this, writeDoneTime);
     
     // handle cpu hold state
     if(cpuHoldCycles > 0) {
@@ -67,7 +67,7 @@ class RWSreg: public RWMemoryMember {
     public:
         RWSreg(TraceValueRegister *registry, HWSreg *s): RWMemoryMember(registry, "SREG"), status(s) {}
         //! reflect a change, which comes from CPU core
-        void trigger_change(void) { tv->change((int)*status); }
+        void trigger_change(void) { if(tv) tv->change((int)*status); }
 
     protected:
         HWSreg *status;
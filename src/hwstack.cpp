@@ -27,11 +27,25 @@
 #include "avrerror.h"
 #include "avrmalloc.h"
 #include "flash.h"
+#include "tracewriter.h"
 #include <assert.h>
 #include <cstdio>  // NULL
 
 using namespace std;
 
+//! Traces new stack pointer and, if val >= 0, the byte pushed or popped
+static void TraceStack(unsigned long sp, int val) {
+    AsyncTraceWriter *writer = sysConHandler.GetTraceWriter();
+    if(writer != NULL) {
+        writer->Stack(sp, val);
+        return;
+    }
+    traceOut << "SP=0x" << hex << sp;
+    if(val >= 0)
+        traceOut << " 0x" << val;
+    traceOut << dec << " ";
+}
+
 HWStack::HWStack(AvrDevice *c):
     core(c),
     m_ThreadList(*c)
@@ -93,7 +107,7 @@ void HWStackSram::Push(unsigned char val) {
     sph_reg.hardwareChange((stackPointer & 0x00ff00)>>8);
     
     if(core->trace_on == 1)
-        traceOut << "SP=0x" << hex << stackPointer << " 0x" << int(val) << dec << " ";
+        TraceStack(stackPointer, val);
     m_ThreadList.OnPush();
     CheckReturnPoints();
     
@@ -110,7 +124,7 @@ unsigned char HWStackSram::Pop() {
     sph_reg.hardwareChange((stackPointer & 0x00ff00)>>8);
     
     if(core->trace_on == 1)
-        traceOut << "SP=0x" << hex << stackPointer << " 0x" << int(core->GetRWMem(stackPointer)) << dec << " ";
+        TraceStack(stackPointer, core->GetRWMem(stackPointer));
     m_ThreadList.OnPop();
     CheckReturnPoints();
     return core->GetRWMem(stackPointer);
@@ -148,7 +162,7 @@ void HWStackSram::SetSpl(unsigned char val) {
     spl_reg.hardwareChange(stackPointer & 0x0000ff);
     
     if(core->trace_on == 1)
-        traceOut << "SP=0x" << hex << stackPointer << dec << " " ; 
+        TraceStack(stackPointer, -1);
     if(oldSP != stackPointer)
         m_ThreadList.OnSPWrite(stackPointer);
     CheckReturnPoints();
@@ -165,7 +179,7 @@ void HWStackSram::SetSph(unsigned char val) {
     sph_reg.hardwareChange((stackPointer & 0x00ff00)>>8);
 
     if(core->trace_on == 1)
-        traceOut << "SP=0x" << hex << stackPointer << dec << " " ; 
+        TraceStack(stackPointer, -1);
     if(oldSP != stackPointer)
         m_ThreadList.OnSPWrite(stackPointer);
     CheckReturnPoints();
@@ -566,6 +566,12 @@ unsigned int BasicTimerUnit::CpuCycle() {
     if(premx->isClock(cs))
         CountTimer();
     InputCapture();
+    // sleep until next prescaler clock, if input capture isn't used
+    if((icapSource == NULL) || WGMuseICR()) {
+        unsigned int d = premx->GetClockDistance(cs);
+        if(d > 1)
+            core->SleepHardwareUntil(this, SystemClock::Instance().GetCurrentTime() + d * core->GetClockFreq());
+    }
     return 0;
 }
 
@@ -832,6 +838,7 @@ unsigned char HWTimer16::GetComplexRegister(bool is_icr, bool high) {
 
 void HWTimer16::ChangeWGM(WGMtype mode) {
     wgm = mode;
+    WakeUp(); // input capture could be used now
     switch(wgm) {
         case WGM_RESERVED:
         case WGM_tablesize:
@@ -136,6 +136,8 @@ class BasicTimerUnit: public Hardware, public TraceValueRegister {
         void HandleEvent(CEtype event) { (this->*wgmfunc[wgm])(event); }
         //! Set clock mode
         void SetClockMode(int _cs);
+        //! Wake up from sleeping till next prescaler clock, if counter is running
+        void WakeUp(void) { if(cs != 0) core->AddToCycleList(this); }
         //! Set the counter itself
         void SetCounter(unsigned long val);
         //! Set compare output mode
@@ -62,6 +62,14 @@ bool PrescalerMultiplexer::isClock(unsigned int cs) {
     }
 }
 
+unsigned int PrescalerMultiplexer::GetClockDistance(unsigned int cs) {
+    static const unsigned int div[8] = { 0, 0, 8, 32, 64, 128, 256, 1024 };
+    
+    if(cs < 2 || cs > 7)
+        return 0;
+    return prescaler->GetClockDistance(div[cs]);
+}
+
 PrescalerMultiplexerExt::PrescalerMultiplexerExt(HWPrescaler *ps, PinAtPort pi):
     PrescalerMultiplexer(ps),
     clkpin(pi) {
@@ -105,6 +113,14 @@ bool PrescalerMultiplexerExt::isClock(unsigned int cs) {
     }
 }
 
+unsigned int PrescalerMultiplexerExt::GetClockDistance(unsigned int cs) {
+    static const unsigned int div[6] = { 0, 0, 8, 64, 256, 1024 };
+    
+    if(cs < 2 || cs > 5)
+        return 0; // also pin clock isn't predictable
+    return prescaler->GetClockDistance(div[cs]);
+}
+
 PrescalerMultiplexerT15::PrescalerMultiplexerT15(HWPrescaler *ps):
     PrescalerMultiplexer(ps) {}
 
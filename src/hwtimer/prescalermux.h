@@ -44,6 +44,10 @@ class PrescalerMultiplexer {
         //! @param cs multiplexer select value
         //! @return true, if a clock event occured
         virtual bool isClock(unsigned int cs);
+        //! Count of cycles until next clock event
+        //! @param cs multiplexer select value
+        //! @return cycles until isClock returns true, 0 if unknown
+        virtual unsigned int GetClockDistance(unsigned int cs);
     
 };
 
@@ -61,6 +65,7 @@ class PrescalerMultiplexerExt: public PrescalerMultiplexer {
         //! Creates a multiplexer instance with a count input pin, connected with prescaler
         PrescalerMultiplexerExt(HWPrescaler *ps, PinAtPort pi);
         virtual bool isClock(unsigned int cs);
+        virtual unsigned int GetClockDistance(unsigned int cs);
     
 };
 
@@ -72,6 +77,7 @@ class PrescalerMultiplexerT15: public PrescalerMultiplexer {
         //! Creates a multiplexer instance for timer 1 on ATTiny15, connected with prescaler
         PrescalerMultiplexerT15(HWPrescaler *ps);
         virtual bool isClock(unsigned int cs);
+        virtual unsigned int GetClockDistance(unsigned int cs) { return 0; }
     
 };
 
@@ -30,10 +30,10 @@ HWPrescaler::HWPrescaler(AvrDevice *core, const std::string &tracename):
     Hardware(core),
     _resetBit(-1),
     _resetSyncBit(-1),
+    core(core),
     countEnable(true)
 {
-    core->AddToCycleList(this);
-    trace_direct(&(core->coreTraceGroup), "PRESCALER" + tracename, &preScaleValue);
+    Init(tracename);
     resetRegister = NULL;
 }
 
@@ -44,10 +44,10 @@ HWPrescaler::HWPrescaler(AvrDevice *core,
     Hardware(core),
     _resetBit(resetBit),
     _resetSyncBit(-1),
+    core(core),
     countEnable(true)
 {
-    core->AddToCycleList(this);
-    trace_direct(&(core->coreTraceGroup), "PRESCALER" + tracename, &preScaleValue);
+    Init(tracename);
     resetRegister = ioreg;
     ioreg->connectSRegClient(this);
 }
@@ -60,14 +60,39 @@ HWPrescaler::HWPrescaler(AvrDevice *core,
     Hardware(core),
     _resetBit(resetBit),
     _resetSyncBit(resetSyncBit),
+    core(core),
     countEnable(true)
 {
-    core->AddToCycleList(this);
-    trace_direct(&(core->coreTraceGroup), "PRESCALER" + tracename, &preScaleValue);
+    Init(tracename);
     resetRegister = ioreg;
     ioreg->connectSRegClient(this);
 }
 
+//! Traces prescaler counter, which is calculated on demand
+class TracePrescalerValue: public TraceValue {
+    public:
+        TracePrescalerValue(HWPrescaler *p, const std::string &name):
+            TraceValue(16, name), prescaler(p) {}
+
+        virtual void cycle() {
+            change(prescaler->GetValue());
+            set_written();
+        }
+
+        virtual bool polled() const { return true; }
+
+    private:
+        HWPrescaler *prescaler;
+};
+
+void HWPrescaler::Init(const std::string &tracename) {
+    countByCycle = true;
+    preScaleValue = 0;
+    baseCycle = core->GetHardwareCycles();
+    TraceValueRegister *t = &(core->coreTraceGroup);
+    t->RegisterTraceValue(new TracePrescalerValue(this, t->GetTraceValuePrefix() + "PRESCALER" + tracename));
+}
+
 unsigned char HWPrescaler::set_from_reg(const IOSpecialReg *reg, unsigned char nv) {
     // check, if this is the right register
     if(reg != resetRegister) return nv;
@@ -80,6 +105,7 @@ unsigned char HWPrescaler::set_from_reg(const IOSpecialReg *reg, unsigned char n
     
     if(reset) {
         Reset();  // reset requested
+        core->WakeAllHardware(); // timers have to calculate the next clock again
         if(sync)
             countEnable = false; // sync asserted, stop counting
         else {
@@ -105,6 +131,8 @@ HWPrescalerAsync::HWPrescalerAsync(AvrDevice *core,
     asyreg->connectSRegClient(this);
     pinstate = tosc_pin.GetPin();
     clockselect = false;
+    countByCycle = false;
+    core->AddToCycleList(this);
 }
 
 HWPrescalerAsync::HWPrescalerAsync(AvrDevice *core,
@@ -123,6 +151,8 @@ HWPrescalerAsync::HWPrescalerAsync(AvrDevice *core,
     asyreg->connectSRegClient(this);
     pinstate = tosc_pin.GetPin();
     clockselect = false;
+    countByCycle = false;
+    core->AddToCycleList(this);
 }
 
 unsigned int HWPrescalerAsync::CpuCycle() {
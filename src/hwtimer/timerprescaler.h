@@ -41,9 +41,14 @@ class HWPrescaler: public Hardware, public IOSpecialRegClient {
         int _resetSyncBit; //!< holds sync bit position for prescaler reset synchronisation
         
     protected:
+        AvrDevice *core; //!< device, which clocks this prescaler
         IOSpecialReg* resetRegister; //!< instance of IO register with reset bits
-        unsigned short preScaleValue; //!< prescaler counter value
+        unsigned short preScaleValue; //!< prescaler counter value at hardware cycle baseCycle
+        unsigned long long baseCycle; //!< hardware cycle, where preScaleValue was valid
         bool countEnable;  //!< enables counting of prescaler (for reset sync)
+        bool countByCycle; //!< counter is calculated from hardware cycles, not counted in CpuCycle
+        //! Creates trace value for prescaler counter and initialise counter
+        void Init(const std::string &tracename);
         //! IO register interface set method, see IOSpecialRegClient
         unsigned char set_from_reg(const IOSpecialReg *reg, unsigned char nv);
         //! IO register interface get method, see IOSpecialRegClient
@@ -63,18 +68,24 @@ class HWPrescaler: public Hardware, public IOSpecialRegClient {
                     IOSpecialReg *ioreg,
                     int resetBit,
                     int resetSyncBit);
-        //! Count functionality for prescaler
-        virtual unsigned int CpuCycle() {
-            if(countEnable) {
-              preScaleValue++;
-              if(preScaleValue > 1023) preScaleValue = 0;
-            }
-            return 0;
-        }
         //! Get method for current prescaler counter value
-        unsigned short GetValue() { return preScaleValue; }
+        /*! HWPrescaler isn't in the cycle list, the counter value is
+          calculated from AvrDevice::GetHardwareCycles instead. */
+        unsigned short GetValue() {
+            if(countByCycle && countEnable)
+                return (preScaleValue + (core->GetHardwareCycles() - baseCycle)) % 1024;
+            return preScaleValue;
+        }
+        //! Count of cycles until prescaler counter is next time a multiple of div
+        /*! Returns 0, if this isn't predictable, because the prescaler is
+          stopped or counts on external clock. */
+        unsigned int GetClockDistance(unsigned int div) {
+            if(!countByCycle || !countEnable)
+                return 0;
+            return div - GetValue() % div;
+        }
         //! Reset method, sets prescaler counter to 0
-        void Reset(){ preScaleValue = 0; }
+        void Reset(){ preScaleValue = 0; baseCycle = core->GetHardwareCycles(); }
 };
 
 //! Extends HWPrescaler with a external clock oszillator pin
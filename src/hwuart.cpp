@@ -90,10 +90,12 @@ void HWUart::SetUsr(unsigned char val) {
 } 
 
 void HWUart::SetUbrr(unsigned char val) {
+    WakeUp(); // baud counter for idle time depends on old value
     ubrr = (ubrr & 0xff00) | val;
 }
 
 void HWUart::SetUbrrhi(unsigned char val) {
+    WakeUp();
     ubrr = (ubrr & 0xff) | ((val & 0xf) << 8);
 }
 
@@ -124,6 +126,7 @@ void HWUart::SetFrameLengthFromRegister() {
 }
 
 void HWUart::SetUcr(unsigned char val) { 
+    WakeUp();
     unsigned char ucrold=ucr;
     ucr=val;
     SetFrameLengthFromRegister();
@@ -145,16 +148,6 @@ void HWUart::SetUcr(unsigned char val) {
         pinRx.SetAlternateDdr(0);       // input 
     }
 
-    //prepared for later remove from hwuart from every cpu cycle (only on demand)
-#if 0
-    //Check if one of Rx or Tx is enabled NEW!
-    if ( ucr & ( RXEN|TXEN) ) {//now one of rx or tx is on
-        if ( !(ucrold & (RXEN|TXEN)) ) { //but there was nothing on before
-            core->AddToCycleList(this); //enable the cpu cycle list!
-        }
-    }
-#endif
-
     unsigned char irqold= ucrold&usr;
     unsigned char irqnew= ucr&usr;
 
@@ -178,10 +171,37 @@ unsigned int HWUart::CpuCycle() {
     // controling read sequence down counter
     if(regSeq > 0)
         regSeq--;
+
+    // remove from cycle list, if receiver and transmitter are disabled, the
+    // baud counters are calculated on WakeUp
+    if(((ucr & (RXEN | TXEN)) == 0) && (regSeq == 0)) {
+        idle = true;
+        idleCycle = core->GetHardwareCycles();
+        core->RemoveFromCycleList(this);
+    }
       
     return 0;
 }
 
+void HWUart::WakeUp(void) {
+    if(!idle)
+        return;
+    idle = false;
+    core->AddToCycleList(this);
+
+    // baudCnt and baudCnt16 as if CpuCycle was called for each idle cycle,
+    // CpuCycleRx does nothing and CpuCycleTx counts only baudCnt16
+    unsigned long long k = core->GetHardwareCycles() - idleCycle;
+    unsigned long long p = ubrr + 1;
+    unsigned long long w = (baudCnt < (int)p) ? p - baudCnt : 1; // cycles to first wrap
+    if(k < w)
+        baudCnt += k;
+    else {
+        baudCnt = (k - w) % p;
+        baudCnt16 = (baudCnt16 + 1 + (k - w) / p) % 16;
+    }
+}
+
 unsigned int HWUart::CpuCycleRx() {
     // receiver part
     //
@@ -538,6 +558,8 @@ HWUart::HWUart(AvrDevice *core,
     vectorRx(rx_interrupt),
     vectorUdre(udre_interrupt),
     vectorTx(tx_interrupt),
+    core(core),
+    idle(false),
     udr_reg(this, "UDR",
             this, &HWUart::GetUdr, &HWUart::SetUdr),
     usr_reg(this, "USR",
@@ -604,6 +626,7 @@ void HWUart::CheckForNewClearIrq(unsigned char val) {
 }
 
 void HWUart::Reset() {
+    WakeUp(); // counters are reset now
     udrWrite = 0;
     udrRead = 0;
     usr = UDRE; //UDRE in USR is set 1 on reset
@@ -640,6 +663,7 @@ unsigned char HWUsart::GetUcsrc() { return ucsrc; }
 
 unsigned char HWUsart::GetUcsrcUbrrh() {
     if(regSeq == 0) {
+        WakeUp(); // count down regSeq
         regSeq = 2;
         return GetUbrrhi();
     } else {
@@ -63,6 +63,13 @@ class HWUart: public Hardware, public TraceValueRegister {
         
         int baudCnt;
 
+        AvrDevice *core;         //!< Connection to device, for cycle list
+        bool idle;               //!< UART is removed from cycle list, while receiver and transmitter are disabled
+        unsigned long long idleCycle; //!< Hardware cycle, where UART was removed from cycle list
+
+        //! Puts UART back to cycle list and calculates baud counters for idle time
+        void WakeUp(void);
+
         enum T_RxState {
             RX_DISABLED,
             RX_WAIT_FOR_HIGH,
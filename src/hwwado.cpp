@@ -47,6 +47,7 @@ void HWWado::SetWdtcr(unsigned char val) {
 		cntWde=4;
 	}
 
+	core->AddToCycleList(this);
 } 
 
 unsigned int HWWado::CpuCycle() {
@@ -61,6 +62,12 @@ unsigned int HWWado::CpuCycle() {
 		core->Reset();
 	}
 
+	if (cntWde==0) {
+		if (( wdtcr& WDE )== 0)
+			core->RemoveFromCycleList(this); //wado disabled, wait for SetWdtcr
+		else
+			core->SleepHardwareUntil(this, timeOutAt+1); //wait for timeout, Wdr wakes up
+	}
 
 	return 0;
 }
@@ -71,6 +78,7 @@ HWWado::HWWado(AvrDevice *c):
     core(c),
     wdtcr_reg(this, "WDTCR",
               this, &HWWado::GetWdtcr, &HWWado::SetWdtcr) {
+	cntWde=0;
 	core->AddToCycleList(this);
 	Reset();
 }
@@ -117,4 +125,5 @@ void HWWado::Wdr() {
 			break;
 
 	}
+	core->AddToCycleList(this); //timeout has changed
 }
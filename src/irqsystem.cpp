@@ -29,6 +29,8 @@
 #include "systemclock.h"
 #include "helper.h"
 #include "avrerror.h"
+#include "tracebin.h"
+#include "profiler.h"
 
 #include "application.h"
 
@@ -261,6 +263,8 @@ void HWIrqSystem::IrqHandlerStarted(unsigned int vector) {
     if (core->trace_on) {
         traceOut << core->GetFname() << " IrqSystem: IrqHandlerStarted Vec: " << vector << endl;
     }
+    if(core->profiler)
+        core->profiler->OnIrqStart(vector, core->newIrqPc, core->PC);
 
     if (irqStatistic.entries[vector].actual.handlerStarted==0) {
         irqStatistic.entries[vector].actual.handlerStarted=SystemClock::Instance().GetCurrentTime();
@@ -273,6 +277,10 @@ void HWIrqSystem::IrqHandlerFinished(unsigned int vector) {
     if (core->trace_on) {
         traceOut << core->GetFname() << " IrqSystem: IrqHandler Finished Vec: " << vector << endl;
     }
+    if(core->binaryTrace)
+        core->binaryTrace->IrqExit(vector);
+    if(core->profiler)
+        core->profiler->OnIrqFinished(vector);
 
     if (irqStatistic.entries[vector].actual.handlerFinished==0) {
         irqStatistic.entries[vector].actual.handlerFinished=SystemClock::Instance().GetCurrentTime();
@@ -0,0 +1,460 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <string.h>
+#include <stdarg.h>
+
+#include "jit.h"
+#include "avrdevice.h"
+#include "blockcache.h"
+#include "decoder.h"
+#include "flash.h"
+#include "hwsreg.h"
+#include "rwmem.h"
+#include "avrerror.h"
+
+#ifdef HAVE_JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+bool JitCompiler::IsSupported(void) {
+#ifdef HAVE_JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+JitCompiler::JitCompiler(AvrDevice *c):
+    core(c),
+    codePtr(NULL),
+    codeLeft(0),
+    compiled(0),
+    deadBytes(0) {}
+
+void JitCompiler::Release(TranslatedBlock *b) {
+    deadBytes += b->jitBytes;
+    b->jitBytes = 0;
+}
+
+#ifdef HAVE_JIT_X86_64
+
+//! size of one chunk of code memory
+static const unsigned int chunkSize = 64 * 1024;
+
+JitCompiler::~JitCompiler() {
+    for(unsigned int i = 0; i < chunks.size(); i++)
+        munmap(chunks[i], chunkSize);
+}
+
+unsigned long JitCompiler::GetCodeMemorySize(void) const {
+    return (unsigned long)chunks.size() * chunkSize;
+}
+
+void JitCompiler::Flush(void) {
+    core->Flash->GetBlockCache()->DropNativeCode();
+    for(unsigned int i = 0; i < chunks.size(); i++)
+        munmap(chunks[i], chunkSize);
+    chunks.clear();
+    codePtr = NULL;
+    codeLeft = 0;
+    deadBytes = 0;
+}
+
+unsigned char *JitCompiler::Allocate(unsigned int size) {
+    if(size > codeLeft) {
+        // reuse memory, if a new chunk would be mostly for dead code
+        if(2 * deadBytes >= GetCodeMemorySize() && !chunks.empty())
+            Flush();
+        void *p = mmap(NULL, chunkSize, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(p == MAP_FAILED)
+            return NULL;
+        chunks.push_back((unsigned char *)p);
+        codePtr = (unsigned char *)p;
+        codeLeft = chunkSize;
+    }
+    unsigned char *p = codePtr;
+    codePtr += size;
+    codeLeft -= size;
+    return p;
+}
+
+/* x86-64 registers and condition codes used by the code generator. rsi
+   holds the address of the status register and rdi the address of the flat
+   data memory of AvrDevice for the whole sequence, AVR registers are
+   accessed with their number as displacement to rdi. */
+enum { EAX = 0, ECX = 1, EDX = 2 };
+enum { CC_O = 0x0, CC_C = 0x2, CC_Z = 0x4, CC_S = 0x8, CC_L = 0xc };
+//! flags in HWSreg_bool, in order of SREG bits
+enum { F_C, F_Z, F_N, F_V, F_S, F_H, F_T, F_I };
+
+//! Collects machine code for one instruction sequence
+class X86Emitter {
+
+    public:
+        vector<unsigned char> code;
+
+        X86Emitter(HWSreg *s, unsigned char *mem) {
+            flagOffset[F_C] = (unsigned char *)&s->C - (unsigned char *)s;
+            flagOffset[F_Z] = (unsigned char *)&s->Z - (unsigned char *)s;
+            flagOffset[F_N] = (unsigned char *)&s->N - (unsigned char *)s;
+            flagOffset[F_V] = (unsigned char *)&s->V - (unsigned char *)s;
+            flagOffset[F_S] = (unsigned char *)&s->S - (unsigned char *)s;
+            flagOffset[F_H] = (unsigned char *)&s->H - (unsigned char *)s;
+            flagOffset[F_T] = (unsigned char *)&s->T - (unsigned char *)s;
+            flagOffset[F_I] = (unsigned char *)&s->I - (unsigned char *)s;
+            Bytes(2, 0x48, 0xbe);                       // movabs rsi, status
+            Imm64(s);
+            Bytes(2, 0x48, 0xbf);                       // movabs rdi, mem
+            Imm64(mem);
+        }
+
+        void Bytes(int n, ...);
+        void Imm64(const void *p) {
+            unsigned long long v = (unsigned long long)p;
+            for(int i = 0; i < 8; i++)
+                code.push_back((v >> (8 * i)) & 0xff);
+        }
+
+        //! movzx x, byte [rdi + reg]
+        void LoadReg(int x, int reg) { Bytes(4, 0x0f, 0xb6, 0x47 | (x << 3), reg); }
+        //! mov byte [rdi + reg], x
+        void StoreReg(int reg, int x) { Bytes(3, 0x88, 0x47 | (x << 3), reg); }
+        //! mov byte [rdi + reg], k
+        void StoreRegImm(int reg, unsigned char k) { Bytes(4, 0xc6, 0x47, reg, k); }
+        //! setcc byte [flag]
+        void SetFlag(int cc, int f) { Bytes(4, 0x0f, 0x90 | cc, 0x46, flagOffset[f]); }
+        //! mov byte [flag], k
+        void StoreFlagImm(int f, unsigned char k) { Bytes(4, 0xc6, 0x46, flagOffset[f], k); }
+        //! mov byte [flag], x
+        void StoreFlag(int f, int x) { Bytes(3, 0x88, 0x46 | (x << 3), flagOffset[f]); }
+        //! movzx x, byte [flag]
+        void LoadFlag(int x, int f) { Bytes(4, 0x0f, 0xb6, 0x46 | (x << 3), flagOffset[f]); }
+        //! xor x, byte [flag]
+        void XorFlag(int x, int f) { Bytes(3, 0x32, 0x46 | (x << 3), flagOffset[f]); }
+        //! CF = C
+        void LoadCarry(void) {
+            LoadFlag(EDX, F_C);
+            Bytes(2, 0xd1, 0xea);                       // shr edx, 1
+        }
+
+        //! H, V, N, S, Z, C from a 8 bit add or sub in al
+        /*! x86 flags AF, OF, SF, CF match the formulas in decoder.cpp for
+          add and sub with and without carry. If keepZ is set, Z is cleared on
+          non zero result but not set (CPC, SBC, SBCI). */
+        void ArithFlags(bool keepZ) {
+            Bytes(2, 0x9c, 0x5a);                       // pushfq; pop rdx
+            SetFlag(CC_C, F_C);
+            SetFlag(CC_O, F_V);
+            SetFlag(CC_S, F_N);
+            SetFlag(CC_L, F_S);
+            if(keepZ) {
+                Bytes(3, 0x0f, 0x94, 0xc1);             // setz cl
+                Bytes(3, 0x20, 0x4e, flagOffset[F_Z]);  // and byte [Z], cl
+            } else
+                SetFlag(CC_Z, F_Z);
+            Bytes(3, 0xc1, 0xea, 0x04);                 // shr edx, 4 (AF)
+            Bytes(3, 0x83, 0xe2, 0x01);                 // and edx, 1
+            StoreFlag(F_H, EDX);
+        }
+
+        //! V = 0, N, S = N, Z from a logic operation in al
+        void LogicFlags(void) {
+            StoreFlagImm(F_V, 0);
+            SetFlag(CC_S, F_N);
+            SetFlag(CC_S, F_S);
+            SetFlag(CC_Z, F_Z);
+        }
+
+        //! C from CF, N, Z from al, V = N ^ C, S = N ^ V after a right shift
+        void ShiftFlags(void) {
+            SetFlag(CC_C, F_C);
+            Bytes(2, 0x84, 0xc0);                       // test al, al
+            SetFlag(CC_S, F_N);
+            SetFlag(CC_Z, F_Z);
+            LoadFlag(EDX, F_N);
+            XorFlag(EDX, F_C);
+            StoreFlag(F_V, EDX);
+            LoadFlag(EDX, F_C);
+            StoreFlag(F_S, EDX);
+        }
+
+    private:
+        signed char flagOffset[8];
+};
+
+void X86Emitter::Bytes(int n, ...) {
+    va_list ap;
+    va_start(ap, n);
+    for(int i = 0; i < n; i++)
+        code.push_back((unsigned char)va_arg(ap, int));
+    va_end(ap);
+}
+
+//! Returns r, if register r is plain memory, or -1, if it has a hook
+static int RegIndex(AvrDevice *core, unsigned int r) {
+    return (core->rw[r] == NULL) ? (int)r : -1;
+}
+
+/*! Emits code for instruction op, if it can be compiled.
+  \return used cpu cycles or 0, if instruction isn't supported */
+static int EmitInstruction(X86Emitter &e, AvrDevice *core, DecodedInstruction *insn, word op) {
+    unsigned int d5 = (op >> 4) & 0x1f;
+    unsigned int r5 = (op & 0x0f) | ((op >> 5) & 0x10);
+    unsigned int d4 = 16 + ((op >> 4) & 0x0f);
+    unsigned char K8 = ((op >> 4) & 0xf0) | (op & 0x0f);
+    int rd = RegIndex(core, d5);
+    int rr = RegIndex(core, r5);
+    int rd4 = RegIndex(core, d4);
+
+    // two register operands: ADD, ADC, SUB, SBC, CP, CPC, AND, OR, EOR, MOV
+    if(dynamic_cast<avr_op_MOV *>(insn) != NULL) {
+        if(rd < 0 || rr < 0) return 0;
+        e.LoadReg(EAX, rr);
+        e.StoreReg(rd, EAX);
+        return 1;
+    }
+    int alu = -1;      // x86 opcode for "op al, cl"
+    bool carry = false, keepZ = false, store = true, logic = false;
+    if(dynamic_cast<avr_op_ADD *>(insn) != NULL) alu = 0x00;
+    else if(dynamic_cast<avr_op_ADC *>(insn) != NULL) { alu = 0x10; carry = true; }
+    else if(dynamic_cast<avr_op_SUB *>(insn) != NULL) alu = 0x28;
+    else if(dynamic_cast<avr_op_SBC *>(insn) != NULL) { alu = 0x18; carry = keepZ = true; }
+    else if(dynamic_cast<avr_op_CP *>(insn) != NULL) { alu = 0x38; store = false; }
+    else if(dynamic_cast<avr_op_CPC *>(insn) != NULL) { alu = 0x18; carry = keepZ = true; store = false; }
+    else if(dynamic_cast<avr_op_AND *>(insn) != NULL) { alu = 0x20; logic = true; }
+    else if(dynamic_cast<avr_op_OR *>(insn) != NULL) { alu = 0x08; logic = true; }
+    else if(dynamic_cast<avr_op_EOR *>(insn) != NULL) { alu = 0x30; logic = true; }
+    if(alu >= 0) {
+        if(rd < 0 || rr < 0) return 0;
+        e.LoadReg(EAX, rd);
+        e.LoadReg(ECX, rr);
+        if(carry)
+            e.LoadCarry();
+        e.Bytes(2, alu, 0xc8);                          // op al, cl
+        if(logic)
+            e.LogicFlags();
+        else
+            e.ArithFlags(keepZ);
+        if(store)
+            e.StoreReg(rd, EAX);
+        return 1;
+    }
+
+    // register and immediate: CPI, SUBI, SBCI, ANDI, ORI, LDI
+    if(dynamic_cast<avr_op_LDI *>(insn) != NULL) {
+        if(rd4 < 0) return 0;
+        e.StoreRegImm(rd4, K8);
+        return 1;
+    }
+    carry = keepZ = logic = false;
+    store = true;
+    if(dynamic_cast<avr_op_CPI *>(insn) != NULL) { alu = 0x3c; store = false; }
+    else if(dynamic_cast<avr_op_SUBI *>(insn) != NULL) alu = 0x2c;
+    else if(dynamic_cast<avr_op_SBCI *>(insn) != NULL) { alu = 0x1c; carry = keepZ = true; }
+    else if(dynamic_cast<avr_op_ANDI *>(insn) != NULL) { alu = 0x24; logic = true; }
+    else if(dynamic_cast<avr_op_ORI *>(insn) != NULL) { alu = 0x0c; logic = true; }
+    if(alu >= 0) {
+        if(rd4 < 0) return 0;
+        e.LoadReg(EAX, rd4);
+        if(carry)
+            e.LoadCarry();
+        e.Bytes(2, alu, K8);                            // op al, K
+        if(logic)
+            e.LogicFlags();
+        else
+            e.ArithFlags(keepZ);
+        if(store)
+            e.StoreReg(rd4, EAX);
+        return 1;
+    }
+
+    // one register operand: COM, NEG, INC, DEC, ASR, LSR, ROR, SWAP
+    int unary = -1;
+    if(dynamic_cast<avr_op_COM *>(insn) != NULL) unary = 0;
+    else if(dynamic_cast<avr_op_NEG *>(insn) != NULL) unary = 1;
+    else if(dynamic_cast<avr_op_INC *>(insn) != NULL) unary = 2;
+    else if(dynamic_cast<avr_op_DEC *>(insn) != NULL) unary = 3;
+    else if(dynamic_cast<avr_op_ASR *>(insn) != NULL) unary = 4;
+    else if(dynamic_cast<avr_op_LSR *>(insn) != NULL) unary = 5;
+    else if(dynamic_cast<avr_op_ROR *>(insn) != NULL) unary = 6;
+    else if(dynamic_cast<avr_op_SWAP *>(insn) != NULL) unary = 7;
+    if(unary >= 0) {
+        if(rd < 0) return 0;
+        e.LoadReg(EAX, rd);
+        switch(unary) {
+            case 0:
+                e.Bytes(4, 0xf6, 0xd0, 0x84, 0xc0);     // not al; test al, al
+                e.StoreFlagImm(F_C, 1);
+                e.LogicFlags();
+                break;
+            case 1:
+                e.Bytes(2, 0xf6, 0xd8);                 // neg al
+                e.ArithFlags(false);
+                break;
+            case 2:
+            case 3:
+                e.Bytes(2, 0xfe, (unary == 2) ? 0xc0 : 0xc8); // inc al, dec al
+                e.SetFlag(CC_O, F_V);
+                e.SetFlag(CC_S, F_N);
+                e.SetFlag(CC_L, F_S);
+                e.SetFlag(CC_Z, F_Z);
+                break;
+            case 4:
+                e.Bytes(2, 0xd0, 0xf8);                 // sar al, 1
+                e.ShiftFlags();
+                break;
+            case 5:
+                e.Bytes(2, 0xd0, 0xe8);                 // shr al, 1
+                e.ShiftFlags();
+                break;
+            case 6:
+                e.LoadCarry();
+                e.Bytes(2, 0xd0, 0xd8);                 // rcr al, 1
+                e.ShiftFlags();
+                break;
+            case 7:
+                e.Bytes(3, 0xc0, 0xc0, 0x04);           // rol al, 4
+                break;
+        }
+        e.StoreReg(rd, EAX);
+        return 1;
+    }
+
+    // register pairs: MOVW, ADIW, SBIW
+    if(dynamic_cast<avr_op_MOVW *>(insn) != NULL) {
+        unsigned int d = ((op >> 4) & 0x0f) * 2, r = (op & 0x0f) * 2;
+        for(unsigned int i = 0; i < 2; i++) {
+            int dst = RegIndex(core, d + i), src = RegIndex(core, r + i);
+            if(dst < 0 || src < 0) return 0;
+            e.LoadReg(EAX, src);
+            e.StoreReg(dst, EAX);
+        }
+        return 1;
+    }
+    bool adiw = dynamic_cast<avr_op_ADIW *>(insn) != NULL;
+    if(adiw || (dynamic_cast<avr_op_SBIW *>(insn) != NULL)) {
+        unsigned int d = 24 + ((op >> 4) & 0x03) * 2;
+        unsigned char K = ((op >> 2) & 0x30) | (op & 0x0f);
+        int rl = RegIndex(core, d), rh = RegIndex(core, d + 1);
+        if(rl < 0 || rh < 0) return 0;
+        e.LoadReg(EAX, rl);
+        e.LoadReg(ECX, rh);
+        e.Bytes(5, 0xc1, 0xe1, 0x08, 0x09, 0xc8);       // shl ecx, 8; or eax, ecx
+        e.Bytes(4, 0x66, adiw ? 0x05 : 0x2d, K, 0x00);  // add ax, K or sub ax, K
+        e.SetFlag(CC_C, F_C);
+        e.SetFlag(CC_O, F_V);
+        e.SetFlag(CC_S, F_N);
+        e.SetFlag(CC_L, F_S);
+        e.SetFlag(CC_Z, F_Z);
+        e.StoreReg(rl, EAX);
+        e.Bytes(5, 0x89, 0xc1, 0xc1, 0xe9, 0x08);       // mov ecx, eax; shr ecx, 8
+        e.StoreReg(rh, ECX);
+        return 2;
+    }
+
+    // status register: BSET, BCLR but not SEI, CLI, because they change irq state
+    bool bset = dynamic_cast<avr_op_BSET *>(insn) != NULL;
+    if(bset || (dynamic_cast<avr_op_BCLR *>(insn) != NULL)) {
+        unsigned int bit = (op >> 4) & 0x07;
+        if(bit == F_I) return 0;
+        e.StoreFlagImm(bit, bset ? 1 : 0);
+        return 1;
+    }
+
+    if(dynamic_cast<avr_op_NOP *>(insn) != NULL)
+        return 1;
+
+    return 0;
+}
+
+void JitCompiler::Compile(TranslatedBlock *b) {
+    AvrFlash *flash = core->Flash;
+    unsigned int size = b->entries.size();
+    Release(b);  // old code of b, if compiled again
+
+    for(unsigned int i = 0; i < size; ) {
+        X86Emitter e(core->status, core->GetDataMem());
+        unsigned int n = 0, cycles = 0, last = 0;
+        for(; i + n < size; n++) {
+            const BlockEntry &be = b->entries[i + n];
+            unsigned int mark = e.code.size();
+            int c = EmitInstruction(e, core, be.rec.insn, flash->ReadMemRawWord(be.pc * 2));
+            if(c == 0) {
+                e.code.resize(mark);
+                break;
+            }
+            cycles += c;
+            last = c;
+        }
+        // a conditional branch at the end is executed by the interpreter
+        bool branch = (i + n < size) &&
+                      ((dynamic_cast<avr_op_BRBS *>(b->entries[i + n].rec.insn) != NULL) ||
+                       (dynamic_cast<avr_op_BRBC *>(b->entries[i + n].rec.insn) != NULL));
+        if((n == 0) || ((n == 1) && !branch)) {
+            i += n + 1;
+            continue;
+        }
+
+        e.Bytes(1, 0xc3);                               // ret
+        unsigned char *p = Allocate(e.code.size());
+        if(p == NULL || mprotect(chunks.back(), chunkSize, PROT_READ | PROT_WRITE) != 0) {
+            avr_warning("JIT: can't get memory for native code, use interpreter");
+            return;
+        }
+        memcpy(p, &e.code[0], e.code.size());
+        mprotect(chunks.back(), chunkSize, PROT_READ | PROT_EXEC);
+        b->jitBytes += e.code.size();
+
+        BlockEntry &first = b->entries[i];
+        first.jit = (JitFunction)p;
+        first.jitLen = n;
+        first.jitCycles = cycles;
+        first.fuse = n + (branch ? 1 : 0);
+        first.span = branch ? cycles : cycles - last;
+        compiled++;
+        i += first.fuse;
+    }
+}
+
+#else
+
+JitCompiler::~JitCompiler() {}
+
+unsigned long JitCompiler::GetCodeMemorySize(void) const {
+    return 0;
+}
+
+void JitCompiler::Flush(void) {}
+
+unsigned char *JitCompiler::Allocate(unsigned int size) {
+    return NULL;
+}
+
+void JitCompiler::Compile(TranslatedBlock *b) {}
+
+#endif
@@ -0,0 +1,96 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef JIT
+#define JIT
+
+#include <vector>
+
+#include "types.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define HAVE_JIT_X86_64 1
+#endif
+
+class AvrDevice;
+class TranslatedBlock;
+
+//! Native code for a sequence of instructions, works directly on registers and SREG
+typedef void (*JitFunction)(void);
+
+//! Translates hot blocks from BlockCache into native x86-64 code
+/*! Only register to register instructions are compiled: ALU operations,
+  LDI, MOV, MOVW, ADIW, SBIW, SWAP, NOP and BSET/BCLR without I flag. A
+  branch at the end of such a sequence is executed by the interpreter after
+  the native code. Everything else, especially I/O access, SPM, SLEEP, WDR and
+  all what touches Hardware objects is left to the interpreter. The used cpu
+  cycles of a compiled sequence are fixed and are the same as returned by
+  DecodedInstruction::Execute, so AvrDevice::RunBlocks can account them like
+  for a superinstruction.
+
+  Code of invalidated blocks is counted by Release. If it's at least half
+  of the mapped code memory, when a new chunk would be needed, all code is
+  freed and all blocks drop their native code, hot blocks are compiled
+  again. So firmware, which rewrites flash, doesn't grow code memory. */
+class JitCompiler {
+
+    public:
+        //! Count of executions of a block, before it will be compiled
+        static const unsigned int hotThreshold = 16;
+
+        JitCompiler(AvrDevice *c);
+        ~JitCompiler();
+
+        //! Returns true, if there is a code generator for this host
+        static bool IsSupported(void);
+
+        //! Compiles all sequences of at least 2 supported instructions in block b
+        /*! Sets jit, jitLen, jitCycles and also fuse and span on the first
+          entry of each sequence. */
+        void Compile(TranslatedBlock *b);
+
+        //! Native code of block b isn't used any more, called before b is deleted
+        void Release(TranslatedBlock *b);
+
+        //! Count of compiled instruction sequences
+        unsigned int GetCompiledCount(void) const { return compiled; }
+
+        //! Size of mapped code memory in bytes
+        unsigned long GetCodeMemorySize(void) const;
+
+    private:
+        AvrDevice *core;
+        std::vector<unsigned char *> chunks;  //!< allocated code memory
+        unsigned char *codePtr;     //!< free space in last chunk
+        unsigned int codeLeft;      //!< count of free bytes in last chunk
+        unsigned int compiled;
+        unsigned long deadBytes;    //!< code of released blocks, still in chunks
+
+        unsigned char *Allocate(unsigned int size);
+        //! Frees all code memory, blocks drop their native code
+        void Flush(void);
+};
+
+#endif
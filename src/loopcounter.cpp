@@ -0,0 +1,135 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <fstream>
+#include <iomanip>
+
+#include "loopcounter.h"
+#include "avrdevice.h"
+#include "avrerror.h"
+#include "flash.h"
+#include "hwstack.h"
+
+using namespace std;
+
+LoopCounter::LoopCounter(AvrDevice *c, const string &f):
+    core(c),
+    filename(f) {}
+
+size_t LoopCounter::Find(unsigned int header) const {
+    for(size_t i = active.size(); i > 0; i--)
+        if(active[i - 1].header == header)
+            return i;
+    return 0;
+}
+
+void LoopCounter::Leave(size_t i, bool inclusive) {
+    size_t n = inclusive ? i : i + 1;
+    while(active.size() > n) {
+        const Activation &a = active.back();
+        LoopStats &s = stats[a.header];
+        s.entries++;
+        if(a.count < s.min)
+            s.min = a.count;
+        if(a.count > s.max)
+            s.max = a.count;
+        s.total += a.count;
+        active.pop_back();
+    }
+}
+
+void LoopCounter::DropReturned(void) {
+    unsigned long sp = core->stack->GetStackPointer();
+    size_t i = active.size();
+    while((i > 0) && (active[i - 1].sp < sp))
+        i--;
+    Leave(i, true);
+}
+
+void LoopCounter::OnBackEdge(unsigned int source, unsigned int target, bool conditional) {
+    DropReturned();
+    size_t i = Find(target);
+    if(i > 0) {
+        Leave(i - 1, false); // inner loops are left
+        active[i - 1].count++;
+    } else {
+        Activation a;
+        a.header = target;
+        a.count = 1;
+        a.sp = core->stack->GetStackPointer();
+        active.push_back(a);
+    }
+    if(conditional && (exits.find(source + 1) == exits.end())) {
+        exits[source + 1] = target;
+        core->SetPCFlag(source + 1, PCFLAG_LOOPEXIT);
+    }
+}
+
+void LoopCounter::OnExit(unsigned int pc) {
+    DropReturned();
+    map<unsigned int, unsigned int>::const_iterator e = exits.find(pc);
+    if(e == exits.end())
+        return;
+    size_t i = Find(e->second);
+    if(i > 0)
+        Leave(i - 1, true);
+}
+
+const map<unsigned int, LoopStats> &LoopCounter::GetStats(void) {
+    Leave(0, true);
+    return stats;
+}
+
+void LoopCounter::Write(void) {
+    ofstream os(filename.c_str());
+    if(!os.is_open())
+        avr_error("Can't open loop bounds file '%s'", filename.c_str());
+    Write(os);
+}
+
+void LoopCounter::Write(ostream &os) {
+    const map<unsigned int, LoopStats> &s = GetStats();
+    os << "# loop bounds of " << core->GetFname() << ", counts are back-edges per entry" << endl
+       << "# function offset header source entries min max total" << endl;
+    for(map<unsigned int, LoopStats>::const_iterator i = s.begin(); i != s.end(); i++) {
+        // enclosing symbol is the last one at or below the header
+        string function = "-";
+        unsigned int offset = i->first * 2;
+        int id = core->Flash->GetSymbolId(i->first);
+        if(id >= 0) {
+            const FlashSymbol &f = core->Flash->GetSymbol(id);
+            function = f.last;
+            offset = (i->first - f.addr) * 2;
+        }
+        SourceLine l = core->Flash->GetSourceLine(i->first);
+        os << function << " 0x" << hex << offset << " 0x" << (i->first * 2) << dec << " ";
+        if(l.file >= 0)
+            os << core->Flash->sourceFiles[l.file] << ":" << l.line;
+        else
+            os << "-";
+        os << " " << i->second.entries << " " << i->second.min << " " << i->second.max
+           << " " << i->second.total << endl;
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef LOOPCOUNTER
+#define LOOPCOUNTER
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <map>
+
+class AvrDevice;
+
+//! Iteration statistic of one loop, counts are back-edges per entry of the loop
+struct LoopStats {
+    unsigned long long entries;  //!< count of entries into the loop
+    unsigned long long min;      //!< minimal count of back-edges of one entry
+    unsigned long long max;      //!< maximal count of back-edges of one entry
+    unsigned long long total;    //!< sum of back-edges of all entries
+
+    LoopStats(): entries(0), min(~0ULL), max(0), total(0) {}
+};
+
+//! Measures loop bounds online by back-edges of taken jumps and branches
+/*! A taken branch or jump to the same or a lower flash address is a
+  back-edge, its target the loop header. The first back-edge to a header,
+  which isn't active, enters the loop, each further one is a iteration.
+  A loop is left, if the not taken conditional back-edge falls through (the
+  address after it gets PCFLAG_LOOPEXIT, see AvrDevice::StepCycle), if an
+  enclosing loop iterates, or if the function with the loop has returned
+  (stack pointer is above the one on entry). The count of back-edges
+  per entry is recorded, for a loop with test at the end (do-while) the
+  body is executed once more.
+
+  Write prints one line for each loop header, with enclosing symbol and
+  source line, if DWARF line info is available. */
+class LoopCounter {
+
+    public:
+        LoopCounter(AvrDevice *c, const std::string &filename);
+
+        //! Taken back-edge from word address source to target
+        void OnBackEdge(unsigned int source, unsigned int target, bool conditional);
+        //! Instruction boundary on a address with PCFLAG_LOOPEXIT
+        void OnExit(unsigned int pc);
+
+        //! Ends all active loops, statistic by word address of loop header
+        const std::map<unsigned int, LoopStats> &GetStats(void);
+
+        //! Writes loop statistic to file name given on construction
+        void Write(void);
+        //! Writes loop statistic to stream os
+        void Write(std::ostream &os);
+
+    protected:
+        //! A active loop
+        struct Activation {
+            unsigned int header;        //!< word address of loop header
+            unsigned long long count;   //!< back-edges since entry
+            unsigned long sp;           //!< stack pointer on entry
+        };
+
+        AvrDevice *core;
+        std::string filename;
+        std::map<unsigned int, LoopStats> stats;
+        std::vector<Activation> active;
+        std::map<unsigned int, unsigned int> exits;  //!< loop header by exit address
+
+        //! Ends loops of functions, which have returned
+        void DropReturned(void);
+        //! Ends all active loops above index i and loop i itself, if inclusive
+        void Leave(size_t i, bool inclusive);
+        //! Returns index of header in active + 1, 0 if not active
+        size_t Find(unsigned int header) const;
+};
+
+#endif
@@ -75,7 +75,7 @@ string Memory::GetSymbolAtAddress(unsigned int add){
     if(ii == sym.end())
         return ""; // we have no symbols at all
     do {
-        if(lastAddr != ii->first) {
+        if((ii == sym.begin()) || (lastAddr != ii->first)) {
             last_ii = ii;
             lastName = ii->second;
         }
@@ -79,7 +79,7 @@ class Memory {
         /*! Add the (address, symbol) pair
         
           @param p a std::pair with address and symbol string */
-        void AddSymbol(std::pair<unsigned int, std::string> p) { sym.insert(p); }
+        virtual void AddSymbol(std::pair<unsigned int, std::string> p) { sym.insert(p); }
         
         /*! Returns the size in bytes of memory block */
         unsigned int GetSize() { return size; }
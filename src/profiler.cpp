@@ -0,0 +1,218 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <iomanip>
+#include <sstream>
+
+#include "profiler.h"
+#include "avrdevice.h"
+#include "flash.h"
+#include "systemclock.h"
+
+using namespace std;
+
+const unsigned int FunctionProfiler::noFunction;
+
+FunctionProfiler::FunctionProfiler(AvrDevice *c, bool irq):
+    Printable(cout),
+    core(c),
+    startCycle(SystemClock::Instance().GetClockCycles()),
+    irqAware(irq),
+    pending(EV_NONE),
+    pendingPc(0),
+    pendingReturnPc(0),
+    pendingVector(-1)
+{
+    Application::GetInstance()->RegisterPrintable(this);
+}
+
+void FunctionProfiler::OnCall(unsigned int target, unsigned int returnPc) {
+    if(target == returnPc)
+        return; // rcall .+0
+    pending = EV_CALL;
+    pendingPc = target;
+    pendingReturnPc = returnPc;
+    core->SetPCFlag(target, PCFLAG_PROFILE);
+}
+
+void FunctionProfiler::OnIrqStart(unsigned int vector, unsigned int handler, unsigned int returnPc) {
+    if(frames.empty())
+        preemptions[vector][noFunction]++;
+    else {
+        preemptions[vector][frames.back().function]++;
+        frames.back().preempted = true;
+    }
+    // called on a instruction boundary, so the handler starts now, the
+    // cycles to push the return address belong to the handler
+    Frame f;
+    f.function = handler;
+    f.returnPc = returnPc;
+    f.start = SystemClock::Instance().GetClockCycles();
+    f.callees = 0;
+    f.irq = 0;
+    f.vector = vector;
+    f.preempted = false;
+    frames.push_back(f);
+}
+
+void FunctionProfiler::OnIrqFinished(unsigned int vector) {
+    // the return instruction follows, OnReturn doesn't change this
+    pendingVector = vector;
+}
+
+void FunctionProfiler::OnReturn(unsigned int returnPc) {
+    pending = EV_RETURN;
+    pendingPc = returnPc;
+    core->SetPCFlag(returnPc, PCFLAG_PROFILE);
+}
+
+void FunctionProfiler::OnBoundary(unsigned int pc) {
+    if((pending == EV_NONE) || (pc != pendingPc))
+        return;
+    unsigned long long now = SystemClock::Instance().GetClockCycles();
+
+    if(pending == EV_CALL) {
+        Frame f;
+        f.function = pendingPc;
+        f.returnPc = pendingReturnPc;
+        f.start = now;
+        f.callees = 0;
+        f.irq = 0;
+        f.vector = -1;
+        f.preempted = false;
+        frames.push_back(f);
+    } else {
+        if(pendingVector >= 0) {
+            // drop functions, which were not left by a return inside the handler
+            size_t i = frames.size();
+            while((i > 0) && (frames[i - 1].vector != pendingVector))
+                i--;
+            if(i > 0)
+                while(frames.size() > i)
+                    Leave(now, noFunction);
+        }
+        if(!frames.empty())
+            Leave(now, pc);
+    }
+    pending = EV_NONE;
+    pendingVector = -1;
+}
+
+void FunctionProfiler::Leave(unsigned long long now, unsigned int pc) {
+    Frame f = frames.back();
+    frames.pop_back();
+    FunctionStats &s = stats[f.function];
+    unsigned long long incl = now - f.start;
+    unsigned long long excl = incl - f.callees;
+    unsigned long long net = incl - f.irq;
+    s.count++;
+    if(incl < s.inclMin)
+        s.inclMin = incl;
+    if(incl > s.inclMax)
+        s.inclMax = incl;
+    s.inclSum += incl;
+    if(excl < s.exclMin)
+        s.exclMin = excl;
+    if(excl > s.exclMax)
+        s.exclMax = excl;
+    s.exclSum += excl;
+    if(net < s.netMin)
+        s.netMin = net;
+    if(net > s.netMax)
+        s.netMax = net;
+    s.netSum += net;
+    if(f.preempted)
+        s.preempted++;
+    s.vector = f.vector;
+    if(f.returnPc != pc)
+        s.valid = false; // stack was manipulated, return to other address
+    if(!frames.empty()) {
+        Frame &parent = frames.back();
+        parent.callees += incl;
+        // a interrupt handler preempts the caller completely, otherwise pass the interrupts
+        parent.irq += (f.vector >= 0) ? incl : f.irq;
+    }
+}
+
+string FunctionProfiler::FunctionName(unsigned int pc, int vector) {
+    if(pc == noFunction)
+        return "(no function)";
+    int id = core->Flash->GetSymbolId(pc);
+    if((id >= 0) && (core->Flash->GetSymbol(id).addr == pc))
+        return core->Flash->GetSymbol(id).last; // last one, like simulavr2times.py
+    ostringstream os;
+    if(vector >= 0)
+        os << "irq " << vector;
+    else
+        os << "0x" << hex << (pc * 2);
+    return os.str();
+}
+
+void FunctionProfiler::operator()() {
+    out << "Function profile of " << core->GetFname() << " (cpu cycles):" << endl;
+    out << left << setw(32) << "function" << right
+        << setw(10) << "count"
+        << setw(12) << "bcet" << setw(12) << "wcet" << setw(14) << "total";
+    if(irqAware)
+        out << setw(12) << "bcet-net" << setw(12) << "wcet-net" << setw(14) << "total-net";
+    out << setw(12) << "bcet-self" << setw(12) << "wcet-self" << setw(14) << "total-self";
+    if(irqAware)
+        out << setw(11) << "preempted";
+    out << endl;
+    bool invalid = false;
+    for(map<unsigned int, FunctionStats>::const_iterator i = stats.begin(); i != stats.end(); i++) {
+        const FunctionStats &s = i->second;
+        string name = FunctionName(i->first, s.vector);
+        if(!s.valid) {
+            name += " *";
+            invalid = true;
+        }
+        out << left << setw(32) << name << right
+            << setw(10) << s.count
+            << setw(12) << s.inclMin << setw(12) << s.inclMax << setw(14) << s.inclSum;
+        if(irqAware)
+            out << setw(12) << s.netMin << setw(12) << s.netMax << setw(14) << s.netSum;
+        out << setw(12) << s.exclMin << setw(12) << s.exclMax << setw(14) << s.exclSum;
+        if(irqAware)
+            out << setw(11) << s.preempted;
+        out << endl;
+    }
+    for(vector<Frame>::const_iterator f = frames.begin(); f != frames.end(); f++)
+        out << "still running: " << FunctionName(f->function, f->vector) << endl;
+    if(invalid)
+        out << "* returned to other address than expected, timing may be wrong" << endl;
+    if(irqAware && !preemptions.empty()) {
+        out << "Interrupt preemptions:" << endl;
+        out << left << setw(12) << "vector" << setw(32) << "function" << right << setw(10) << "count" << endl;
+        typedef map<unsigned int, map<unsigned int, unsigned long long> >::const_iterator viter;
+        typedef map<unsigned int, unsigned long long>::const_iterator fiter;
+        for(viter v = preemptions.begin(); v != preemptions.end(); v++)
+            for(fiter f = v->second.begin(); f != v->second.end(); f++)
+                out << left << setw(12) << v->first << setw(32) << FunctionName(f->first)
+                    << right << setw(10) << f->second << endl;
+    }
+    out << "Total cycles: " << (SystemClock::Instance().GetClockCycles() - startCycle) << endl;
+}
+
@@ -0,0 +1,147 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef PROFILER
+#define PROFILER
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "printable.h"
+
+class AvrDevice;
+
+//! Timing statistic of one function, times are in cpu cycles
+struct FunctionStats {
+    unsigned long long count;     //!< count of completed calls
+    unsigned long long inclMin;   //!< BCET including called functions
+    unsigned long long inclMax;   //!< WCET including called functions
+    unsigned long long inclSum;
+    unsigned long long exclMin;   //!< BCET without called functions
+    unsigned long long exclMax;   //!< WCET without called functions
+    unsigned long long exclSum;
+    unsigned long long netMin;    //!< BCET including called functions, without interrupts
+    unsigned long long netMax;    //!< WCET including called functions, without interrupts
+    unsigned long long netSum;
+    unsigned long long preempted; //!< count of calls, which were interrupted
+    int vector;   //!< irq vector, if this is a interrupt handler, -1 otherwise
+    bool valid;   //!< false, if a return didn't match the call
+
+    FunctionStats(): count(0), inclMin(~0ULL), inclMax(0), inclSum(0),
+                     exclMin(~0ULL), exclMax(0), exclSum(0),
+                     netMin(~0ULL), netMax(0), netSum(0), preempted(0),
+                     vector(-1), valid(true) {}
+};
+
+//! Measures execution times of functions online, without trace output
+/*! CALL, RCALL, ICALL, EICALL and interrupt entries are calls, RET and RETI
+  returns. Like scripts/simtrace.py the time of a call starts with the
+  first instruction of the called function and ends with the first
+  instruction after the return, so the cycles of the call instruction
+  belong to the caller and the cycles of the return to the called function.
+  A call to the next instruction (rcall .+0) is ignored, it's used to get
+  the own address or to reserve stack space.
+
+  The exact cycle, in which the next instruction starts (after wait states,
+  instruction cache misses and cpu holds), is known only on the next
+  instruction boundary. So a call or return is only noted by the
+  instruction and PCFLAG_PROFILE is set on the next PC. AvrDevice::StepCycle
+  calls OnBoundary on instruction boundaries with this flag.
+
+  Interrupt handlers are started by HWIrqSystem::IrqHandlerStarted, which is
+  called on the instruction boundary, where the interrupt is accepted, so the
+  cycles to push the return address belong to the handler. They end with the
+  RETI, which returns to HWIrqSystem::IrqHandlerFinished. Cycles of
+  a interrupt handler count as cycles of a called function for the
+  interrupted function, so the exclusive time never contains them. The net
+  time is the inclusive time without all interrupts, which happened while the
+  function was running. Functions, which are left inside a interrupt handler
+  without a return (longjmp, stack manipulation), are dropped, when the
+  handler is finished, and marked as not valid.
+
+  In interrupt aware mode the report shows net times and which function
+  was preempted how often by which interrupt. Otherwise only the inclusive
+  and exclusive times are shown, with interrupt handlers as functions.
+
+  The result is printed with Application::PrintResults. */
+class FunctionProfiler: public Printable {
+
+    public:
+        FunctionProfiler(AvrDevice *c, bool irqAware);
+        virtual ~FunctionProfiler() {}
+
+        //! Called by a call instruction, target and returnPc are word addresses
+        void OnCall(unsigned int target, unsigned int returnPc);
+        //! Called by RET and RETI, returnPc is the next PC
+        void OnReturn(unsigned int returnPc);
+        //! Called by HWIrqSystem::IrqHandlerStarted, handler and returnPc are word addresses
+        void OnIrqStart(unsigned int vector, unsigned int handler, unsigned int returnPc);
+        //! Called by HWIrqSystem::IrqHandlerFinished, before the return of the handler
+        void OnIrqFinished(unsigned int vector);
+        //! Instruction boundary on a address with PCFLAG_PROFILE
+        void OnBoundary(unsigned int pc);
+
+        //! Statistic by word address of function
+        const std::map<unsigned int, FunctionStats> &GetStats(void) const { return stats; }
+        //! Count of preemptions by irq vector and word address of interrupted function
+        /*! A interrupt outside of any measured function is counted for address noFunction */
+        const std::map<unsigned int, std::map<unsigned int, unsigned long long> > &GetPreemptions(void) const { return preemptions; }
+        static const unsigned int noFunction = ~0U;
+        //! Prints report
+        void operator()();
+
+    protected:
+        //! A running function
+        struct Frame {
+            unsigned int function;      //!< word address
+            unsigned int returnPc;      //!< expected return address
+            unsigned long long start;   //!< cycle of first instruction
+            unsigned long long callees; //!< cycles spent in called functions
+            unsigned long long irq;     //!< cycles spent in interrupt handlers
+            int vector;                 //!< irq vector of a interrupt handler or -1
+            bool preempted;             //!< true, if a interrupt happened in this call
+        };
+
+        AvrDevice *core;
+        std::map<unsigned int, FunctionStats> stats;
+        std::vector<Frame> frames;
+        unsigned long long startCycle; //!< cycle, when profiler was created
+        bool irqAware;                 //!< print net times and preemptions
+        std::map<unsigned int, std::map<unsigned int, unsigned long long> > preemptions;
+
+        //! Pending call or return, resolved on next instruction boundary
+        enum { EV_NONE, EV_CALL, EV_RETURN } pending;
+        unsigned int pendingPc;        //!< PC of next instruction
+        unsigned int pendingReturnPc;  //!< return address of pending call
+        int pendingVector;             //!< irq vector of pending return or -1
+
+        //! Name of function at word address pc, hex byte address, if there is no symbol
+        std::string FunctionName(unsigned int pc, int vector = -1);
+        //! Removes top frame, which returned at cycle now to pc, and records its times
+        void Leave(unsigned long long now, unsigned int pc);
+};
+
+#endif
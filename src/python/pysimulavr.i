@@ -169,16 +169,6 @@ namespace std {
 %include "flash.h"
 %include "hweeprom.h"
 
-%extend Breakpoints {
-  void RemoveBreakpoint(unsigned bp) {
-    Breakpoints::iterator ii;
-    if ((ii = find($self->begin(), $self->end(), bp)) != $self->end()) $self->erase(ii);
-  }
-  void AddBreakpoint(unsigned bp) {
-    $self->push_back(bp);
-  }
-}
-
 %include "avrsignature.h"
 
 %include "avrerror.h"
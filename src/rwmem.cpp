@@ -42,18 +42,21 @@ using namespace std;
 RWMemoryMember::RWMemoryMember(TraceValueRegister *_reg,
                                const std::string &_tracename,
                                const int index):
+    tv(NULL),
     registry(_reg),
     tracename(_tracename),
+    traceindex(index),
     isInvalid(false)
 {
     if (_tracename.size()) {
-        tv = new TraceValue(8, registry->GetTraceValuePrefix() + _tracename, index);
         if (!registry) {
             avr_error("registry not initialized for RWMemoryMember '%s'.", _tracename.c_str());
         }
-        registry->RegisterTraceValue(tv);
-    } else {
-        tv=0;
+        // TraceValue is created by CreateTraceValue, if it's requested
+        string n = registry->GetTraceValuePrefix() + _tracename;
+        if (index >= 0)
+            n += int2str(index);
+        registry->RegisterTraceValueSource(n, this);
     }
 }
 
@@ -61,8 +64,21 @@ RWMemoryMember::RWMemoryMember(void):
     tv(NULL),
     registry(NULL),
     tracename(""),
+    traceindex(-1),
     isInvalid(true) {}
 
+RWMemoryMember::RWMemoryMember(TraceValue *t):
+    tv(t),
+    registry(NULL),
+    tracename(""),
+    traceindex(-1),
+    isInvalid(false) {}
+
+TraceValue *RWMemoryMember::CreateTraceValue(int idx) {
+    tv = new TraceValue(8, registry->GetTraceValuePrefix() + tracename, traceindex);
+    return tv;
+}
+
 RWMemoryMember::operator unsigned char() const {
     if (tv)
         tv->read();
@@ -192,23 +208,17 @@ void OSCCALRegister::set(unsigned char v) {
     value = v;
 }
 
-RAM::RAM(TraceValueCoreRegister *_reg, const std::string &name, const size_t number, const size_t maxsize) {
-    corereg = _reg;
-    value = 0xaa;
-    if(name.size()) {
-        tv = new TraceValue(8, corereg->GetTraceValuePrefix() + name, number);
-        if(!corereg) {
-            avr_error("registry not initialized for RWMemoryMember '%s'.", name.c_str());
-        }
-        corereg->RegisterTraceSetValue(tv, name, maxsize);
-    } else {
-        tv = NULL;
-    }
+RAM::RAM(TraceValue *t, unsigned char *v):
+    RWMemoryMember(t),
+    value(v) {}
+
+RAM::~RAM() {
+    tv = NULL; // trace value is owned by AvrDevice
 }
 
-unsigned char RAM::get() const { return value; }
+unsigned char RAM::get() const { return *value; }
 
-void RAM::set(unsigned char v) { value=v; }
+void RAM::set(unsigned char v) { *value = v; }
 
 InvalidMem::InvalidMem(AvrDevice* _c, int _a):
     RWMemoryMember(),
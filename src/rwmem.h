@@ -38,8 +38,9 @@ class TraceValue;
 
 //!Member of any memory area in an AVR device.
 /*! Allows to be read and written byte-wise.
-  Accesses can be traced if necessary. */
-class RWMemoryMember {
+  Accesses can be traced if necessary. The TraceValue is created on demand,
+  when a dumper asks for it, until then accesses aren't traced. */
+class RWMemoryMember: public TraceValueSource {
     
     public:
         /*! Constructs a new memory member cell
@@ -55,6 +56,9 @@ class RWMemoryMember {
         /*! Constructs a new memory member cell
           with no trace value name. (for InvalidRam) */
         RWMemoryMember(void);
+        /*! Constructs a new memory member cell, which uses a existing trace
+          value. The trace value isn't owned by this cell. (for RAM) */
+        RWMemoryMember(TraceValue *t);
 #ifndef SWIG
         //! Read access on memory
         operator unsigned char() const;
@@ -66,6 +70,9 @@ class RWMemoryMember {
         virtual ~RWMemoryMember();
         const std::string &GetTraceName(void) { return tracename; }
         bool IsInvalid(void) const { return isInvalid; } 
+        
+        //! Creates the TraceValue for this cell, called by TraceValueRegister
+        TraceValue *CreateTraceValue(int idx);
 
     protected:
         /*! This function is the function which will
@@ -84,6 +91,7 @@ class RWMemoryMember {
         mutable TraceValue *tv;
         TraceValueRegister *registry;
         const std::string tracename;
+        const int traceindex; //!< index of this cell for TraceValue
         const bool isInvalid;
 };
 
@@ -176,23 +184,22 @@ class OSCCALRegister: public RWMemoryMember, public Hardware {
         int cal_type;
 };
 
-//! One byte in any AVR RAM
-/*! Allows clean read and write accesses and simply has one stored byte. */
+//! Hook on one byte in any AVR RAM or on a core register
+/*! The byte itself is stored in the flat data memory of AvrDevice. A hook is
+  only created for bytes, which have to be traced or checked for read before
+  write, see AvrDevice::EnableDataMemHooks. */
 class RAM : public RWMemoryMember {
     
     public:
-        RAM(TraceValueCoreRegister *registry,
-            const std::string &tracename,
-            const size_t number,
-            const size_t maxsize);
+        RAM(TraceValue *t, unsigned char *v);
+        ~RAM();
         
     protected:
         unsigned char get() const;
         void set(unsigned char);
         
     private:
-        unsigned char value;
-        TraceValueCoreRegister *corereg;
+        unsigned char *value;
 };
 
 //! Memory on which access should be avoided! :-)
@@ -245,12 +252,8 @@ class IOReg: public RWMemoryMember {
             RWMemoryMember(registry, tracename),
             p(_p),
             g(_g),
-            s(_s)
-        {
-            // 'undefined state' doesn't really make sense for IO registers 
-            if (tv)
-                tv->set_written();
-        }
+            s(_s),
+            traced(tracename.size() > 0) {}
         
         /*! Reflects a value change from hardware (for example timer count occured)
           @param val the new register value */
@@ -261,23 +264,32 @@ class IOReg: public RWMemoryMember {
                 registry->UnregisterTraceValue(tv);
                 delete tv;
                 tv = NULL;
-            }
+            } else if(traced)
+                registry->UnregisterTraceValueSource(this);
+            traced = false;
+        }
+        
+        TraceValue *CreateTraceValue(int idx) {
+            TraceValue *t = RWMemoryMember::CreateTraceValue(idx);
+            // 'undefined state' doesn't really make sense for IO registers 
+            t->set_written();
+            return t;
         }
         
     protected:
         unsigned char get() const {
             if (g)
                 return (p->*g)();
-            else if (tv) {
-                avr_warning("Reading of '%s' is not supported.", tv->name().c_str());
+            else if (traced) {
+                avr_warning("Reading of '%s' is not supported.", (registry->GetTraceValuePrefix() + tracename).c_str());
             }
             return 0;
         }
         void set(unsigned char val) {
             if (s)
                 (p->*s)(val);
-            else if (tv) {
-                avr_warning("Writing of '%s' (with %d) is not supported.", tv->name().c_str(), val);
+            else if (traced) {
+                avr_warning("Writing of '%s' (with %d) is not supported.", (registry->GetTraceValuePrefix() + tracename).c_str(), val);
             }
         }
         
@@ -285,6 +297,7 @@ class IOReg: public RWMemoryMember {
         P *p;
         getter_t g;
         setter_t s;
+        bool traced; //!< has TraceValue or can create it
 };
 
 class IOSpecialReg;
@@ -338,7 +351,13 @@ class IOSpecialReg: public RWMemoryMember {
         void Reset(void) { Reset(0); }
         //! Register reset functionality, sets internal register value to val.
         //! @param val the reset value
-        void Reset(unsigned char val) { value = 0; if(tv) tv->set_written(val); }
+        void Reset(unsigned char val) { value = 0; resetValue = val; if(tv) tv->set_written(val); }
+        
+        TraceValue *CreateTraceValue(int idx) {
+            TraceValue *t = RWMemoryMember::CreateTraceValue(idx);
+            t->set_written(resetValue);
+            return t;
+        }
         
         /*! Reflects a value change from hardware (for example timer count occured)
           @param val the new register value */
@@ -357,6 +376,7 @@ class IOSpecialReg: public RWMemoryMember {
         
     private:
         unsigned char value; //!< Internal register value
+        unsigned char resetValue; //!< value of last Reset, for a TraceValue created later
 };
 
 #endif
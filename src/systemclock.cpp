@@ -33,6 +33,7 @@
 
 #include "signal.h"
 #include <assert.h>
+#include <limits>
 
 using namespace std;
 
@@ -112,6 +113,10 @@ SystemClock::SystemClock() {
     static int no = 0;
     _clockcycles = 0; // MBe
     currentTime = 0; 
+    runAhead = false;
+    runAheadLimit = 0;
+    runAheadSteps = 0;
+    currentMember = NULL;
     no++;
     if(no > 1)
         avr_error("Crazy problem: Second instance of SystemClock created!");
@@ -123,7 +128,7 @@ void SystemClock::SetTraceModeForAllMembers(int trace_on) {
     {
         AvrDevice* core = dynamic_cast<AvrDevice*>( mi->second );
         if(core != NULL)
-            core->trace_on = trace_on;
+            core->SetTraceOn(trace_on);
     }
 } 
 
@@ -157,7 +162,9 @@ int SystemClock::Step(bool &untilCoreStepFinished) {
         syncMembers.RemoveMinimum();
 
         // do a step on simulation member
+        currentMember = core;
         int rc = core->Step(untilCoreStepFinished, &nextStepIn_ns);
+        currentMember = NULL;
         if (rc)
             res = rc;
 
@@ -186,6 +193,16 @@ int SystemClock::Step(bool &untilCoreStepFinished) {
     return res;
 }
 
+bool SystemClock::CanRunAhead(const SimulationMember *member, SystemClockOffset nextTime, SystemClockOffset period) const {
+    if(!runAhead || breakMessage || !asyncMembers.empty() || (member != currentMember))
+        return false;
+    // Run and RunTimeRange check the time of the previous step against the limit
+    if(nextTime - period >= runAheadLimit)
+        return false;
+    // the calling simulation member isn't in syncMembers while it is processing Step
+    return syncMembers.IsEmpty() || (nextTime < syncMembers.GetMinimumKey());
+}
+
 void SystemClock::Reschedule(SimulationMember *sm, SystemClockOffset newTime) {
 
     for(unsigned i = 0; i < syncMembers.size(); i++) {
@@ -224,11 +241,14 @@ long SystemClock::Endless() {
     signal(SIGINT, OnBreak);
     signal(SIGTERM, OnBreak);
 
+    runAhead = true;
+    runAheadLimit = numeric_limits<SystemClockOffset>::max();
     while(breakMessage == false) {
         //steps++;
         bool untilCoreStepFinished = false;
         Step(untilCoreStepFinished);
     }
+    runAhead = false;
 
     return _clockcycles; // these are clock cycles
 }
@@ -241,13 +261,19 @@ long SystemClock::Run(SystemClockOffset maxRunTime) {
     signal(SIGINT, OnBreak);
     signal(SIGTERM, OnBreak);
 
+    runAhead = true;
+    runAheadLimit = maxRunTime;
     while((breakMessage== false) &&
           (SystemClock::Instance().GetCurrentTime() < maxRunTime)) {
         steps++;
         bool untilCoreStepFinished = false;
-        if (Step(untilCoreStepFinished))
+        long aheadSteps = runAheadSteps;
+        int rc = Step(untilCoreStepFinished);
+        steps += runAheadSteps - aheadSteps; // each cycle run ahead replaces a step
+        if (rc)
             break;
     }
+    runAhead = false;
 
     return steps;
 }
@@ -262,12 +288,18 @@ long SystemClock::RunTimeRange(SystemClockOffset timeRange) {
     signal(SIGTERM, OnBreak);
     
     timeRange += SystemClock::Instance().GetCurrentTime();
+    runAhead = true;
+    runAheadLimit = timeRange;
     while((breakMessage == false) && (SystemClock::Instance().GetCurrentTime() < timeRange)) {
         untilCoreStepFinished = false;
-        if (Step(untilCoreStepFinished))
+        long aheadSteps = runAheadSteps;
+        int rc = Step(untilCoreStepFinished);
+        steps += runAheadSteps - aheadSteps; // each cycle run ahead replaces a step
+        if (rc)
             break;
         steps++;
     }
+    runAhead = false;
     
     return steps;
 }
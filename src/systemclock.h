@@ -91,6 +91,10 @@ class SystemClock
         SystemClockOffset currentTime;  //!< time in [ns] since start of simulation
         MinHeap<SystemClockOffset, SimulationMember *> syncMembers;  //!< earliest first
         std::vector<SimulationMember*> asyncMembers; //!< List of asynchron working simulation members, will be called every step!
+        bool runAhead; //!< Flag, true while Endless, Run or RunTimeRange is running
+        SimulationMember *currentMember; //!< synchron simulation member, which is processing Step or NULL
+        SystemClockOffset runAheadLimit; //!< simulation member can run ahead, while current time is below this limit
+        long runAheadSteps; //!< count of cycles processed by RunAheadCycle, each of them replaces a Step call
         
     public:
         // MBe: added this to include clock cycles in trace
@@ -110,11 +114,30 @@ class SystemClock
         void AddAsyncMember(SimulationMember *dev);
         //! Process one simulation step
         int Step(bool &untilCoreStepFinished);
+        //! Check, if a simulation member can process its cycles up to nextTime within the actual step
+        /*! This is possible only inside Endless, Run or RunTimeRange, if there is
+            no async simulation member and no other simulation member is scheduled
+            up to nextTime. So the result of the simulation is the same, as if the
+            simulation member would be called by Step for each cycle. It's not
+            possible, if member is called by a other simulation member, like
+            GdbServer, which has to see each cycle.
+            \param member simulation member, which wants to run ahead
+            \param nextTime time of the last cycle to process
+            \param period clock period of simulation member */
+        bool CanRunAhead(const SimulationMember *member, SystemClockOffset nextTime, SystemClockOffset period) const;
+        //! Proceed to nextTime, simulation member has processed this cycle itself
+        /*! Call this only, if CanRunAhead returned true for nextTime! */
+        void RunAheadCycle(SystemClockOffset nextTime) { currentTime = nextTime; _clockcycles++; runAheadSteps++; }
         //! Run simulation endless till SIGINT or SIGTERM signal, return the number of CPU cycles
         long Endless();
         //! Run simulation till given time is arrived or signal is cached
+        /*! Returns the number of simulation steps, a cycle run ahead by a
+            simulation member counts as the step it replaces. Use
+            GetClockCycles for the number of CPU cycles. */
         long Run(SystemClockOffset maxRunTime);
         //! Like Run method, but stops on breakpoint or after given time offset
+        /*! Returns the number of simulation steps like Run, without the
+            step, which stopped on a breakpoint. */
         long RunTimeRange(SystemClockOffset timeRange);
         //! Returns the central SystemClock instance for the application
         /*! There will be only one instance on a application! */
@@ -0,0 +1,545 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <string.h>
+#include <vector>
+
+#include "tracebin.h"
+#include "avrdevice.h"
+#include "flash.h"
+#include "decoder.h"
+#include "helper.h"
+#include "hwstack.h"
+#include "hwsreg.h"
+#include "ioregs.h"
+#include "systemclock.h"
+#include "avrerror.h"
+
+using namespace std;
+
+static const char magic[8] = { 'S', 'I', 'M', 'A', 'V', 'R', 'B', 'T' };
+static const unsigned char version = 2;
+static const unsigned char twoWords = 0x80; //!< flag in type byte of INSN
+
+BinaryTraceWriter::BinaryTraceWriter(const string &name):
+    out(name.c_str(), ios::out | ios::binary | ios::trunc),
+    used(0),
+    lastCycle(0),
+    nextPc(0),
+    sreg(0),
+    sp(0),
+    rampz(0),
+    rampzAddr(0),
+    pushs(false),
+    pops(false),
+    stackInRam(false),
+    store(false),
+    storeAddr(0),
+    storeValue(0),
+    load(false),
+    loadAddr(0),
+    loadReg(0)
+{
+    if(!out.is_open())
+        avr_error("can't open binary trace file '%s'", name.c_str());
+}
+
+BinaryTraceWriter::~BinaryTraceWriter() {
+    Flush();
+    out.close();
+}
+
+void BinaryTraceWriter::Flush(void) {
+    out.write((const char *)buffer, used);
+    used = 0;
+}
+
+void BinaryTraceWriter::PutVarint(unsigned long long v) {
+    while(v >= 0x80) {
+        Put((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    Put(v);
+}
+
+void BinaryTraceWriter::PutString(const string &s) {
+    PutVarint(s.length());
+    for(unsigned int i = 0; i < s.length(); i++)
+        Put(s[i]);
+}
+
+void BinaryTraceWriter::PutCycleDelta(void) {
+    unsigned long long cycle = SystemClock::Instance().GetClockCycles();
+    PutVarint(cycle - lastCycle);
+    lastCycle = cycle;
+}
+
+void BinaryTraceWriter::SaveState(AvrDevice *core) {
+    memcpy(regs, core->GetDataMem(), sizeof(regs));
+    sreg = (int)*(core->status);
+    sp = core->stack->GetStackPointer();
+    rampz = (core->rampz != NULL) ? core->rampz->GetRegVal() : 0;
+}
+
+unsigned int BinaryTraceIoAddress(AvrDevice *core, const RWMemoryMember *reg) {
+    unsigned int start = core->GetMemRegisterSize();
+    for(unsigned int a = start; a < start + core->GetMemIOSize(); a++) {
+        if(core->rw[a] == reg)
+            return a;
+    }
+    return 0;
+}
+
+void BinaryTraceWriter::WriteHeader(AvrDevice *core) {
+    for(unsigned int i = 0; i < sizeof(magic); i++)
+        Put(magic[i]);
+    Put(version);
+    PutString(core->GetDeviceName());
+    PutString(core->GetFname());
+    lastCycle = SystemClock::Instance().GetClockCycles();
+    PutVarint(lastCycle);
+    SaveState(core);
+    for(unsigned int i = 0; i < sizeof(regs); i++)
+        Put(regs[i]);
+    Put(sreg);
+    PutVarint(sp);
+    Put(rampz);
+    multimap<unsigned int, string> &sym = core->Flash->sym;
+    PutVarint(sym.size());
+    for(multimap<unsigned int, string>::iterator i = sym.begin(); i != sym.end(); i++) {
+        PutVarint(i->first);
+        PutString(i->second);
+    }
+    stackInRam = dynamic_cast<HWStackSram *>(core->stack) != NULL;
+    rampzAddr = (core->rampz != NULL) ? BinaryTraceIoAddress(core, &core->rampz->ext_reg) : 0;
+    nextPc = 0;
+}
+
+void BinaryTraceWriter::BeginInstruction(AvrDevice *core, unsigned int pc) {
+    word op = core->Flash->ReadMemRawWord(pc * 2);
+    word op2 = 0;
+    bool is2Words = core->Flash->GetInstruction(pc)->IsInstruction2Words();
+
+    Put(is2Words ? (BTREC_INSN | twoWords) : BTREC_INSN);
+    PutCycleDelta();
+    int delta = (int)pc - (int)nextPc;
+    PutVarint((unsigned int)((delta << 1) ^ (delta >> 31)));
+    Put(op & 0xff);
+    Put(op >> 8);
+    nextPc = pc + 1;
+    if(is2Words) {
+        op2 = core->Flash->ReadMemRawWord(pc * 2 + 2);
+        Put(op2 & 0xff);
+        Put(op2 >> 8);
+        nextPc++;
+    }
+
+    SaveState(core);
+
+    // find stores, see lookup_opcode for the encodings
+    unsigned char r = (op >> 4) & 0x1f;
+    unsigned int x = regs[26] + (regs[27] << 8);
+    unsigned int y = regs[28] + (regs[29] << 8);
+    unsigned int z = regs[30] + (regs[31] << 8);
+    store = true;
+    storeValue = regs[r];
+    if((op & 0xFE0F) == 0x9200)          // STS
+        storeAddr = op2;
+    else if((op & 0xFE0F) == 0x920C)     // ST X
+        storeAddr = x;
+    else if((op & 0xFE0F) == 0x920D)     // ST X+
+        storeAddr = x;
+    else if((op & 0xFE0F) == 0x920E)     // ST -X
+        storeAddr = x - 1;
+    else if((op & 0xFE0F) == 0x9209)     // ST Y+
+        storeAddr = y;
+    else if((op & 0xFE0F) == 0x920A)     // ST -Y
+        storeAddr = y - 1;
+    else if((op & 0xFE0F) == 0x9201)     // ST Z+
+        storeAddr = z;
+    else if((op & 0xFE0F) == 0x9202)     // ST -Z
+        storeAddr = z - 1;
+    else if((op & 0xD200) == 0x8200)     // STD Y+q, STD Z+q
+        storeAddr = ((op & 0x0008) ? y : z) + (((op >> 8) & 0x20) | ((op >> 7) & 0x18) | (op & 0x07));
+    else if((op & 0xF800) == 0xB800)     // OUT
+        storeAddr = (((op >> 5) & 0x30) | (op & 0x0f)) + 0x20;
+    else
+        store = false;
+    storeAddr &= 0xffff;
+
+    load = true;
+    loadReg = r;
+    if((op & 0xFE0F) == 0x9000)          // LDS
+        loadAddr = op2;
+    else if((op & 0xFE0F) == 0x900C)     // LD X
+        loadAddr = x;
+    else if((op & 0xFE0F) == 0x900D)     // LD X+
+        loadAddr = x;
+    else if((op & 0xFE0F) == 0x900E)     // LD -X
+        loadAddr = x - 1;
+    else if((op & 0xFE0F) == 0x9009)     // LD Y+
+        loadAddr = y;
+    else if((op & 0xFE0F) == 0x900A)     // LD -Y
+        loadAddr = y - 1;
+    else if((op & 0xFE0F) == 0x9001)     // LD Z+
+        loadAddr = z;
+    else if((op & 0xFE0F) == 0x9002)     // LD -Z
+        loadAddr = z - 1;
+    else if((op & 0xD200) == 0x8000)     // LDD Y+q, LDD Z+q
+        loadAddr = ((op & 0x0008) ? y : z) + (((op >> 8) & 0x20) | ((op >> 7) & 0x18) | (op & 0x07));
+    else if((op & 0xF800) == 0xB000)     // IN
+        loadAddr = (((op >> 5) & 0x30) | (op & 0x0f)) + 0x20;
+    else
+        load = false;
+    loadAddr &= 0xffff;
+
+    pops = ((op & 0xFE0F) == 0x900F) ||   // POP
+           (op == 0x9508) ||              // RET
+           (op == 0x9518);                // RETI
+
+    pushs = ((op & 0xFE0F) == 0x920F) ||  // PUSH
+            ((op & 0xF000) == 0xD000) ||  // RCALL
+            ((op & 0xFE0E) == 0x940E) ||  // CALL
+            (op == 0x9509) ||             // ICALL
+            (op == 0x9519);               // EICALL
+}
+
+void BinaryTraceWriter::EndInstruction(AvrDevice *core) {
+    const unsigned char *mem = core->GetDataMem();
+    if(load) {
+        Put(BTREC_LOAD);
+        PutVarint(loadAddr);
+        Put(mem[loadReg]);
+    }
+    if(memcmp(regs, mem, sizeof(regs)) != 0) {
+        for(unsigned int i = 0; i < sizeof(regs); i++) {
+            if(regs[i] != mem[i]) {
+                Put(BTREC_REG);
+                Put(i);
+                Put(mem[i]);
+            }
+        }
+    }
+    if(store) {
+        Put(BTREC_MEM);
+        PutVarint(storeAddr);
+        Put(storeValue);
+    }
+    if(core->rampz != NULL) {
+        unsigned char z = core->rampz->GetRegVal();
+        if((z != rampz) && !(store && (storeAddr == rampzAddr))) {
+            // ELPM Z+ over a 64KiB boundary
+            Put(BTREC_MEM);
+            PutVarint(rampzAddr);
+            Put(z);
+        }
+    }
+    unsigned char s = (int)*(core->status);
+    if(s != sreg) {
+        Put(BTREC_SREG);
+        Put(s);
+    }
+    unsigned long newSp = core->stack->GetStackPointer();
+    if(newSp != sp) {
+        Put(BTREC_SP);
+        PutVarint(newSp);
+        if(pushs && stackInRam) {
+            for(unsigned long a = sp; a > newSp; a--) {
+                Put(BTREC_MEM);
+                PutVarint(a);
+                Put(core->GetRWMem(a));
+            }
+        }
+        if(pops && stackInRam) {
+            for(unsigned long a = sp + 1; a <= newSp; a++) {
+                Put(BTREC_LOAD);
+                PutVarint(a);
+                Put(core->GetRWMem(a));
+            }
+        }
+    }
+}
+
+void BinaryTraceWriter::IrqEntry(AvrDevice *core, unsigned int pc, unsigned int vector, unsigned int addr) {
+    Put(BTREC_IRQ_ENTRY);
+    PutCycleDelta();
+    PutVarint(pc);
+    PutVarint(vector);
+    PutVarint(addr);
+    SaveState(core);
+    store = false;
+    load = false;
+    pushs = true;
+    pops = false;
+}
+
+void BinaryTraceWriter::IrqExit(unsigned int vector) {
+    Put(BTREC_IRQ_EXIT);
+    PutVarint(vector);
+}
+
+void BinaryTraceWriter::Hold(unsigned int pc) {
+    Put(BTREC_HOLD);
+    PutCycleDelta();
+    PutVarint(pc);
+}
+
+BinaryTraceReader::BinaryTraceReader(const string &n):
+    in(n.c_str(), ios::in | ios::binary),
+    used(0),
+    pos(0),
+    name(n)
+{
+    if(!in.is_open())
+        avr_error("can't open binary trace file '%s'", name.c_str());
+    for(unsigned int i = 0; i < sizeof(magic); i++) {
+        if(Get(true) != magic[i])
+            avr_error("'%s' isn't a binary trace file", name.c_str());
+    }
+    int v = Get();
+    if(v != version)
+        avr_error("binary trace file '%s' has unsupported version %d", name.c_str(), v);
+    deviceName = GetString();
+    programName = GetString();
+    startCycle = GetVarint();
+    for(unsigned int i = 0; i < sizeof(regs); i++)
+        regs[i] = Get();
+    sreg = Get();
+    sp = GetVarint();
+    rampz = Get();
+    unsigned long long cnt = GetVarint();
+    for(; cnt > 0; cnt--) {
+        unsigned int addr = GetVarint();
+        symbols.insert(pair<unsigned int, string>(addr, GetString()));
+    }
+    cycle = startCycle;
+    nextPc = 0;
+}
+
+bool BinaryTraceReader::Fill(void) {
+    in.read((char *)buffer, sizeof(buffer));
+    used = in.gcount();
+    pos = 0;
+    return used > 0;
+}
+
+int BinaryTraceReader::Get(bool eofAllowed) {
+    if((pos == used) && !Fill()) {
+        if(!eofAllowed)
+            avr_error("binary trace file '%s' is truncated", name.c_str());
+        return -1;
+    }
+    return buffer[pos++];
+}
+
+unsigned long long BinaryTraceReader::GetVarint(void) {
+    unsigned long long v = 0;
+    int shift = 0;
+    int b;
+    do {
+        b = Get();
+        v |= (unsigned long long)(b & 0x7f) << shift;
+        shift += 7;
+    } while(b & 0x80);
+    return v;
+}
+
+string BinaryTraceReader::GetString(void) {
+    unsigned long long len = GetVarint();
+    string s;
+    for(; len > 0; len--)
+        s += (char)Get();
+    return s;
+}
+
+bool BinaryTraceReader::Next(BinaryTraceRecord &r) {
+    int t = Get(true);
+    if(t < 0)
+        return false;
+    r.type = (BinaryTraceRecordType)(t & ~twoWords);
+    r.cycle = cycle;
+    r.words = 0;
+    switch(r.type) {
+        case BTREC_INSN: {
+            cycle += GetVarint();
+            r.cycle = cycle;
+            unsigned int zz = GetVarint();
+            int delta = (zz >> 1) ^ -(int)(zz & 1);
+            r.pc = nextPc + delta;
+            r.opcode[0] = Get();
+            r.opcode[0] |= Get() << 8;
+            r.words = 1;
+            if(t & twoWords) {
+                r.opcode[1] = Get();
+                r.opcode[1] |= Get() << 8;
+                r.words = 2;
+            }
+            nextPc = r.pc + r.words;
+            break;
+        }
+        case BTREC_REG:
+            r.addr = Get();
+            r.value = Get();
+            break;
+        case BTREC_MEM:
+        case BTREC_LOAD:
+            r.addr = GetVarint();
+            r.value = Get();
+            break;
+        case BTREC_SREG:
+            r.value = Get();
+            break;
+        case BTREC_SP:
+            r.value = GetVarint();
+            break;
+        case BTREC_IRQ_ENTRY:
+            cycle += GetVarint();
+            r.cycle = cycle;
+            r.pc = GetVarint();
+            r.addr = GetVarint();
+            r.value = GetVarint();
+            break;
+        case BTREC_IRQ_EXIT:
+            r.addr = GetVarint();
+            break;
+        case BTREC_HOLD:
+            cycle += GetVarint();
+            r.cycle = cycle;
+            r.pc = GetVarint();
+            break;
+        default:
+            avr_error("binary trace file '%s' has unknown record type %d", name.c_str(), t);
+    }
+    return true;
+}
+
+
+//! Start of a trace line like in AvrDevice::StepCycle
+static void LinePrefix(ostream &os, AvrDevice *dev, unsigned int pc, unsigned long long cycle) {
+    os << dev->GetFname() << " " << HexShort(pc << 1) << dec << ": " << cycle << ": ";
+    dev->Flash->WriteSymbolAtAddress(os, pc, 30);
+    os << " ";
+}
+
+void ConvertBinaryTrace(BinaryTraceReader &reader, AvrDevice *dev, ostream &os) {
+    dev->SetFname(reader.GetProgramName());
+    dev->Flash->sym = reader.GetSymbols();
+    dev->Flash->BuildSymbolIndex();
+
+    // state after the last instruction
+    unsigned char regs[32];
+    for(unsigned int r = 0; r < 32; r++)
+        regs[r] = reader.GetStartReg(r);
+    unsigned char sreg = reader.GetStartSREG();
+    unsigned long sp = reader.GetStartSP();
+    unsigned char rampz = reader.GetStartRAMPZ();
+    unsigned int rampzAddr = (dev->rampz != NULL) ? BinaryTraceIoAddress(dev, &dev->rampz->ext_reg) : 0;
+    // a hardware stack doesn't print to trace
+    HWStackSram *stack = dynamic_cast<HWStackSram *>(dev->stack);
+    unsigned int splAddr = (stack != NULL) ? BinaryTraceIoAddress(dev, &stack->spl_reg) : 0;
+    unsigned int sphAddr = (stack != NULL) ? BinaryTraceIoAddress(dev, &stack->sph_reg) : 0;
+    vector<DecodedInstruction *> insns(0x10000, (DecodedInstruction *)NULL);
+
+    // a timed record (INSN, IRQ_ENTRY, HOLD) is printed, when the next one is
+    // known, because "IRQ prepared" is printed before the instruction, which
+    // precedes a irq entry
+    BinaryTraceRecord cur, next;
+    vector<BinaryTraceRecord> records;
+    bool haveNext = reader.Next(next);
+    while(haveNext) {
+        cur = next;
+        records.clear();
+        unsigned long newSp = sp;
+        while((haveNext = reader.Next(next)) &&
+              (next.type != BTREC_INSN) && (next.type != BTREC_IRQ_ENTRY) && (next.type != BTREC_HOLD)) {
+            records.push_back(next);
+            if(next.type == BTREC_SP)
+                newSp = next.value;
+        }
+
+        LinePrefix(os, dev, cur.pc, cur.cycle);
+        bool showSreg = false;
+        if(cur.type == BTREC_INSN) {
+            if(haveNext && (next.type == BTREC_IRQ_ENTRY))
+                os << "IRQ prepared for addr " << hex << next.value << dec << "\n";
+            if(insns[cur.opcode[0]] == NULL)
+                insns[cur.opcode[0]] = lookup_opcode(cur.opcode[0], dev);
+            unsigned int z = (rampz << 16) + regs[30] + (regs[31] << 8);
+            showSreg = insns[cur.opcode[0]]->Disassemble(os, cur.pc, (cur.words == 2) ? cur.opcode[1] : 0, z);
+        } else if(cur.type == BTREC_IRQ_ENTRY)
+            os << "IRQ DETECTED: VectorAddr: " << cur.value;
+        else
+            os << "CPU-Hold by IO-Hardware ";
+
+        // stack output in the order of HWStackSram, pushs and pops follow the SP record
+        bool afterSp = false;
+        for(unsigned int i = 0; i < records.size(); i++) {
+            const BinaryTraceRecord &r = records[i];
+            switch(r.type) {
+                case BTREC_REG:
+                    regs[r.addr] = r.value;
+                    break;
+                case BTREC_MEM:
+                    if(afterSp)
+                        os << "SP=0x" << hex << r.addr - 1 << " 0x" << r.value << dec << " ";
+                    else if((stack != NULL) && ((r.addr == splAddr) || (r.addr == sphAddr)))
+                        os << "SP=0x" << hex << newSp << dec << " ";
+                    if((rampzAddr != 0) && (r.addr == rampzAddr))
+                        rampz = r.value;
+                    break;
+                case BTREC_LOAD:
+                    if(afterSp)
+                        os << "SP=0x" << hex << r.addr << " 0x" << r.value << dec << " ";
+                    break;
+                case BTREC_SREG:
+                    sreg = r.value;
+                    break;
+                case BTREC_SP:
+                    sp = r.value;
+                    afterSp = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+        if(showSreg) {
+            HWSreg s;
+            s = sreg;
+            os << (string)s;
+        }
+        os << "\n";
+
+        // remaining cycles of instruction or irq entry
+        if(haveNext) {
+            for(unsigned long long c = cur.cycle + 1; c < next.cycle; c++) {
+                LinePrefix(os, dev, cur.pc, c);
+                os << "CPU-waitstate\n";
+            }
+        }
+    }
+
+    for(unsigned int i = 0; i < insns.size(); i++)
+        delete insns[i];
+}
@@ -0,0 +1,212 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef TRACEBIN
+#define TRACEBIN
+
+#include <string>
+#include <map>
+#include <fstream>
+#include <ostream>
+
+#include "types.h"
+
+class AvrDevice;
+class RWMemoryMember;
+
+//! Record types of a binary trace, see BinaryTraceWriter for the file layout
+enum BinaryTraceRecordType {
+    BTREC_INSN = 1,      //!< instruction executed: cycle delta, pc delta, opcode word(s)
+    BTREC_REG = 2,       //!< write to register r0-r31: register, value
+    BTREC_MEM = 3,       //!< write to data memory or io space by core: address, value
+    BTREC_SREG = 4,      //!< status register changed: value
+    BTREC_SP = 5,        //!< stack pointer changed: value
+    BTREC_IRQ_ENTRY = 6, //!< irq entry: cycle delta, pc, vector, vector address
+    BTREC_IRQ_EXIT = 7,  //!< irq handler finished by RETI: vector
+    BTREC_HOLD = 8,      //!< cpu held by hardware: cycle delta, pc
+    BTREC_LOAD = 9       //!< read from data memory or io space by core: address, value
+};
+
+//! One record of a binary trace, as returned by BinaryTraceReader
+/*! Write records (REG, MEM, SREG, SP), LOAD and IRQ_EXIT belong to the last
+  INSN or IRQ_ENTRY record before them. */
+struct BinaryTraceRecord {
+    BinaryTraceRecordType type;
+    unsigned long long cycle; //!< cpu cycle of INSN, IRQ_ENTRY or HOLD, cycle of last such record otherwise
+    unsigned int pc;          //!< word address for INSN, IRQ_ENTRY (interrupted instruction) and HOLD
+    word opcode[2];           //!< opcode of INSN, second word only valid, if words is 2
+    unsigned char words;      //!< count of opcode words for INSN
+    unsigned int addr;        //!< register for REG, data address for MEM and LOAD, vector for IRQ_ENTRY and IRQ_EXIT
+    unsigned int value;       //!< written or read value (REG, MEM, SREG, SP, LOAD), vector word address for IRQ_ENTRY
+};
+
+//! Writes a compact binary instruction trace of one core
+/*! The file starts with a header:
+
+  - magic "SIMAVRBT" and a version byte
+  - device name and program file name (strings)
+  - start cycle (varint)
+  - r0-r31 (32 bytes), SREG (byte), stack pointer (varint) and RAMPZ (byte,
+    0 without RAMPZ) at start
+  - count of flash symbols (varint), for each symbol word address (varint) and name (string)
+
+  A string is stored as varint length and the characters. Varints are
+  unsigned LEB128, 7 bits per byte, low bits first. The header is followed by
+  records, each starts with its type byte (BinaryTraceRecordType):
+
+  - INSN: cycle delta to last timed record (varint), pc delta to the address
+    behind the last instruction (zigzag varint, so 0 for linear code), opcode
+    (2 bytes, little endian). Bit 7 of type byte is set for 2 word
+    instructions, then the second word follows.
+  - REG: register (byte), value (byte)
+  - MEM: address (varint), value (byte)
+  - SREG: value (byte)
+  - SP: value (varint)
+  - IRQ_ENTRY: cycle delta (varint), pc (varint), vector (varint), vector address (varint)
+  - IRQ_EXIT: vector (varint)
+  - HOLD: cycle delta (varint), pc (varint)
+  - LOAD: address (varint), value (byte)
+
+  Changes of registers, SREG, stack pointer and RAMPZ are found by comparison
+  with the state before the instruction, RAMPZ changes are recorded as MEM.
+  Memory writes are recorded for ST, STD, STS, OUT and for return addresses
+  and registers pushed to stack, but not for SBI and CBI. The MEM records of
+  pushs follow the SP record.
+
+  The value each LD, LDD, LDS and IN returned is recorded by a LOAD record,
+  also if the destination register doesn't change, as are the bytes read by
+  POP, RET and RETI from stack. So the trace can be converted to text without
+  replaying the instructions, which would read IO registers again. */
+class BinaryTraceWriter {
+
+    public:
+        //! Opens file name for writing, aborts, if this isn't possible
+        BinaryTraceWriter(const std::string &name);
+        //! Flushes buffer and closes file
+        ~BinaryTraceWriter();
+
+        //! Writes file header with symbols and current state of core
+        void WriteHeader(AvrDevice *core);
+
+        //! Writes INSN record for instruction at word address pc and saves core state
+        void BeginInstruction(AvrDevice *core, unsigned int pc);
+        //! Writes changes of core state since BeginInstruction or IrqEntry
+        void EndInstruction(AvrDevice *core);
+        //! Writes IRQ_ENTRY record and saves core state, pushs are recorded by EndInstruction
+        void IrqEntry(AvrDevice *core, unsigned int pc, unsigned int vector, unsigned int addr);
+        //! Writes IRQ_EXIT record
+        void IrqExit(unsigned int vector);
+        //! Writes HOLD record for a cycle, where hardware holds the cpu
+        void Hold(unsigned int pc);
+
+    private:
+        std::ofstream out;
+        unsigned char buffer[65536];
+        unsigned int used;            //!< used bytes in buffer
+        unsigned long long lastCycle; //!< cycle of last timed record
+        unsigned int nextPc;          //!< word address behind last instruction
+        unsigned char regs[32];       //!< registers before instruction
+        unsigned char sreg;           //!< SREG before instruction
+        unsigned long sp;             //!< stack pointer before instruction
+        unsigned char rampz;          //!< RAMPZ before instruction
+        unsigned int rampzAddr;       //!< data address of RAMPZ or 0
+        bool pushs;                   //!< instruction or irq entry pushs to stack
+        bool pops;                    //!< instruction pops from stack
+        bool stackInRam;              //!< stack is in data memory, not a hardware stack
+        bool store;                   //!< instruction stores storeValue to storeAddr
+        unsigned int storeAddr;
+        unsigned char storeValue;
+        bool load;                    //!< instruction loads register loadReg from loadAddr
+        unsigned int loadAddr;
+        unsigned char loadReg;
+
+        void Flush(void);
+        void Put(unsigned char b) {
+            if(used == sizeof(buffer))
+                Flush();
+            buffer[used++] = b;
+        }
+        void PutVarint(unsigned long long v);
+        void PutString(const std::string &s);
+        void PutCycleDelta(void);
+        void SaveState(AvrDevice *core);
+};
+
+//! Data address of IO register reg on core, 0 if it isn't in the IO space
+unsigned int BinaryTraceIoAddress(AvrDevice *core, const RWMemoryMember *reg);
+
+//! Reads a binary trace written by BinaryTraceWriter record by record
+class BinaryTraceReader {
+
+    public:
+        //! Opens file name and reads header, aborts, if it isn't a binary trace
+        BinaryTraceReader(const std::string &name);
+
+        //! Reads next record, returns false on end of file
+        bool Next(BinaryTraceRecord &r);
+
+        const std::string &GetDeviceName(void) const { return deviceName; }
+        const std::string &GetProgramName(void) const { return programName; }
+        unsigned long long GetStartCycle(void) const { return startCycle; }
+        //! Value of register r at start of trace
+        unsigned char GetStartReg(unsigned int r) const { return regs[r]; }
+        unsigned char GetStartSREG(void) const { return sreg; }
+        unsigned long GetStartSP(void) const { return sp; }
+        unsigned char GetStartRAMPZ(void) const { return rampz; }
+        //! Flash symbols of program, key is word address
+        const std::multimap<unsigned int, std::string> &GetSymbols(void) const { return symbols; }
+
+    private:
+        std::ifstream in;
+        unsigned char buffer[65536];
+        unsigned int used;     //!< count of bytes in buffer
+        unsigned int pos;      //!< read position in buffer
+        std::string name;
+        std::string deviceName;
+        std::string programName;
+        unsigned long long startCycle;
+        unsigned char regs[32];
+        unsigned char sreg;
+        unsigned long sp;
+        unsigned char rampz;
+        std::multimap<unsigned int, std::string> symbols;
+        unsigned long long cycle; //!< cycle of last timed record
+        unsigned int nextPc;      //!< word address behind last instruction
+
+        bool Fill(void);
+        //! Returns next byte, aborts on truncated file, if eofAllowed is false
+        int Get(bool eofAllowed = false);
+        unsigned long long GetVarint(void);
+        std::string GetString(void);
+};
+
+//! Writes the trace read by reader as text like simulavr -t
+/*! dev is a device of the traced type, it's used only to disassemble the
+  instructions and to look up flash symbols, no instruction is executed.
+  Messages of peripherals (like pending interrupts) are not part of a binary
+  trace and so not in the output. */
+void ConvertBinaryTrace(BinaryTraceReader &reader, AvrDevice *dev, std::ostream &os);
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <limits>
+
+#include "tracefilter.h"
+#include "avrerror.h"
+#include "flash.h"
+#include "hwstack.h"
+#include "helper.h"
+#include "string2.h"
+#include "systemclock.h"
+
+using namespace std;
+
+//! Parses <start>[-<end>], end is max, if not given
+static bool ParseWindow(const string &s, unsigned long long &start, unsigned long long &end) {
+    char *e;
+    end = numeric_limits<SystemClockOffset>::max();
+    if(!StringToUnsignedLongLong(s.c_str(), &start, &e, 0))
+        return false;
+    if(*e == '\0')
+        return true;
+    if(*e != '-')
+        return false;
+    const char *p = e + 1;
+    return StringToUnsignedLongLong(p, &end, &e, 0) && (*e == '\0') && (end > start);
+}
+
+//! Word address of label or hex word address, labels first, because 'f' is a label and a number
+static unsigned int GetAddress(AvrFlash *flash, const string &s) {
+    multimap<unsigned int, string>::const_iterator i;
+    for(i = flash->sym.begin(); i != flash->sym.end(); i++)
+        if(i->second == s)
+            return i->first;
+    return flash->GetAddressAtSymbol(s);
+}
+
+TraceFilter::TraceFilter(AvrDevice *c):
+    Hardware(c),
+    core(c),
+    active(false),
+    lastBoundary(~0ULL) {}
+
+void TraceFilter::Add(const string &spec) {
+    size_t colon = spec.find(':');
+    string kind = spec.substr(0, colon);
+    string arg = (colon == string::npos) ? "" : spec.substr(colon + 1);
+    Filter f;
+    f.from = f.to = f.vector = 0;
+    f.start = f.end = 0;
+    f.count = f.left = 0;
+    f.sp = 0;
+    f.on = false;
+
+    if(kind == "sym") {
+        f.kind = FILTER_SYMBOL;
+        f.from = GetAddress(core->Flash, arg);
+        core->SetPCFlag(f.from, PCFLAG_TRACE);
+    } else if(kind == "pc") {
+        size_t dash = arg.find('-');
+        if(dash == string::npos)
+            avr_error("trace filter '%s': range <from>-<to> expected", spec.c_str());
+        f.kind = FILTER_PC;
+        f.from = GetAddress(core->Flash, arg.substr(0, dash));
+        f.to = GetAddress(core->Flash, arg.substr(dash + 1));
+        if(f.to <= f.from)
+            avr_error("trace filter '%s': empty range", spec.c_str());
+        for(unsigned int pc = f.from; pc < f.to; pc++)
+            core->SetPCFlag(pc, PCFLAG_TRACE);
+    } else if((kind == "time") || (kind == "cycles")) {
+        unsigned long long start, end;
+        if(!ParseWindow(arg, start, end))
+            avr_error("trace filter '%s': window <start>[-<end>] expected", spec.c_str());
+        // window in ns, end is clamped to max, a start beyond max would wrap
+        unsigned long long period = (kind == "cycles") ? core->GetClockFreq() : 1;
+        unsigned long long max = numeric_limits<SystemClockOffset>::max() / period;
+        if(start > max)
+            avr_error("trace filter '%s': start out of range", spec.c_str());
+        f.kind = FILTER_TIME;
+        f.start = start * period;
+        f.end = min(end, max) * period;
+        // first check on next cycle is too late for a window, which starts now
+        SystemClockOffset now = SystemClock::Instance().GetCurrentTime();
+        f.on = (now >= f.start) && (now < f.end);
+        core->AddToCycleList(this);
+    } else if(kind == "irq") {
+        vector<string> v = split(arg, ":");
+        unsigned long vector;
+        unsigned long long count;
+        if((v.size() != 2) ||
+           !StringToUnsignedLong(v[0].c_str(), &vector, NULL, 0) ||
+           !StringToUnsignedLongLong(v[1].c_str(), &count, NULL, 0))
+            avr_error("trace filter '%s': <vector>:<count> expected", spec.c_str());
+        f.kind = FILTER_IRQ;
+        f.vector = vector;
+        f.count = count;
+    } else
+        avr_error("unknown trace filter '%s'", spec.c_str());
+
+    filters.push_back(f);
+    SetActive();
+    core->UpdateStepCycle();
+}
+
+void TraceFilter::SetActive(void) {
+    active = false;
+    for(size_t i = 0; i < filters.size(); i++)
+        if(filters[i].on)
+            active = true;
+}
+
+bool TraceFilter::Update(unsigned int pc) {
+    // StepCycle asks twice on a boundary, if the variant changes
+    unsigned long long cycle = core->GetHardwareCycles();
+    if(cycle == lastBoundary)
+        return active;
+    lastBoundary = cycle;
+
+    unsigned long sp = core->stack->GetStackPointer();
+    for(size_t i = 0; i < filters.size(); i++) {
+        Filter &f = filters[i];
+        switch(f.kind) {
+            case FILTER_SYMBOL:
+                if(f.on && (sp > f.sp))
+                    f.on = false; // function has returned
+                if(!f.on && (pc == f.from)) {
+                    f.on = true;
+                    f.sp = sp;
+                }
+                break;
+            case FILTER_PC:
+                f.on = (pc >= f.from) && (pc < f.to);
+                break;
+            case FILTER_IRQ:
+                if(f.on) {
+                    if(f.left == 0)
+                        f.on = false;
+                    else
+                        f.left--;
+                }
+                break;
+            case FILTER_TIME:
+                break; // see CpuCycle
+        }
+    }
+    SetActive();
+    return active;
+}
+
+void TraceFilter::OnIrq(unsigned int vector) {
+    for(size_t i = 0; i < filters.size(); i++) {
+        Filter &f = filters[i];
+        if((f.kind == FILTER_IRQ) && (f.vector == vector) && (f.count > 0)) {
+            f.on = true;
+            f.left = f.count;
+            active = true;
+        }
+    }
+}
+
+unsigned int TraceFilter::CpuCycle(void) {
+    // hardware is cycled after the instruction boundary, so set the state
+    // for the next cycle, StepCycle switches on its boundary
+    SystemClockOffset period = core->GetClockFreq();
+    SystemClockOffset t = SystemClock::Instance().GetCurrentTime() + period;
+    SystemClockOffset next = numeric_limits<SystemClockOffset>::max();
+    bool changed = false;
+    for(size_t i = 0; i < filters.size(); i++) {
+        Filter &f = filters[i];
+        if(f.kind != FILTER_TIME)
+            continue;
+        bool on = (t >= f.start) && (t < f.end);
+        if(on != f.on) {
+            f.on = on;
+            changed = true;
+        }
+        if(t < f.start)
+            next = min(next, f.start - period);
+        else if(t < f.end)
+            next = min(next, f.end - period);
+    }
+    if(changed) {
+        SetActive();
+        core->UpdateStepCycle();
+    }
+    core->SleepHardwareUntil(this, next);
+    return 0;
+}
+
+void TraceFilter::Reset(void) {
+    // stack and irqs start again
+    for(size_t i = 0; i < filters.size(); i++)
+        if(filters[i].kind != FILTER_TIME)
+            filters[i].on = false;
+    SetActive();
+    core->UpdateStepCycle();
+}
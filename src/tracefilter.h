@@ -0,0 +1,103 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef TRACEFILTER
+#define TRACEFILTER
+
+#include <string>
+#include <vector>
+
+#include "hardware.h"
+#include "avrdevice.h"
+
+//! Restricts trace output of a core to selected parts of the program run
+/*! Each filter enables the trace for a part of the run, the trace is on, if
+  one of them is on:
+
+  - sym:<label> from entry of function <label> until it returns (stack
+    pointer is above the one on entry), including called functions and irqs
+  - pc:<from>-<to> while PC is in range from <from> up to, but not
+    including <to>, labels or word addresses like for -T
+  - time:<start>[-<end>] from simulation time <start> up to <end> in ns
+  - cycles:<start>[-<end>] like time, but in clock cycles of the core
+  - irq:<vector>:<count> the first <count> instructions after entry
+    into irq vector <vector>, on each entry
+
+  Entries into functions and PC ranges are found by PCFLAG_TRACE, time
+  windows by sleeping as hardware until the next start or end. So outside
+  of the filters the core runs without trace, AvrDevice::StepCycle asks
+  OnBoundary on each instruction boundary and switches the variant. */
+class TraceFilter: public Hardware {
+
+    public:
+        TraceFilter(AvrDevice *c);
+
+        //! Adds a filter, see class description for spec, aborts on errors
+        void Add(const std::string &spec);
+
+        //! Returns true, if trace output is enabled by one of the filters
+        bool IsActive(void) const { return active; }
+
+        //! Instruction boundary on word address pc, returns IsActive afterwards
+        /*! Cheap, if trace is off and pc has no PCFLAG_TRACE. */
+        bool OnBoundary(unsigned int pc) {
+            if(!active && !(core->GetPCFlags(pc) & PCFLAG_TRACE))
+                return false;
+            return Update(pc);
+        }
+        //! Core enters irq vector
+        void OnIrq(unsigned int vector);
+
+        unsigned int CpuCycle(void);
+        void Reset(void);
+
+    protected:
+        enum FilterKind { FILTER_SYMBOL, FILTER_PC, FILTER_TIME, FILTER_IRQ };
+
+        struct Filter {
+            FilterKind kind;
+            unsigned int from;          //!< word address of function or begin of range
+            unsigned int to;            //!< word address after range
+            SystemClockOffset start;    //!< begin of time window
+            SystemClockOffset end;      //!< end of time window
+            unsigned int vector;        //!< irq vector
+            unsigned long long count;   //!< instructions to trace after irq entry
+            bool on;                    //!< filter enables trace
+            unsigned long sp;           //!< stack pointer on entry of function
+            unsigned long long left;    //!< instructions left after irq entry
+        };
+
+        AvrDevice *core;
+        std::vector<Filter> filters;
+        bool active;                    //!< one of filters is on
+        unsigned long long lastBoundary; //!< hardware cycle of last Update
+
+        //! Updates PC dependent filters, returns IsActive afterwards
+        bool Update(unsigned int pc);
+        //! Sets active from filters
+        void SetActive(void);
+};
+
+#endif
@@ -45,7 +45,10 @@ TraceValue::TraceValue(size_t bits,
     v(0xaffeaffe),
     f(0),
     _written(false),
-    _enabled(false) {}
+    _enabled(false),
+    _dumpers(0),
+    _generation(0),
+    _queued(false) {}
 
 size_t TraceValue::bits() const { return b; }
 
@@ -70,6 +73,7 @@ void TraceValue::change(unsigned val) {
     if ((v != val) || !_written) {
         f |= CHANGE;
         v = val;
+        queue();
     }
 }
 
@@ -78,6 +82,7 @@ void TraceValue::change(unsigned val, unsigned mask) {
     if (((v & mask) != (val & mask)) || !_written) {
         f |= CHANGE;
         v = (v & ~mask) | (val & mask);
+        queue();
     }
 }
 
@@ -88,10 +93,12 @@ void TraceValue::write(unsigned val) {
     }
     f |= WRITE;
     _written = true;
+    queue();
 }
 
 void TraceValue::read() {
     f |= READ;
+    queue();
 }
 
 bool TraceValue::written() const { return _written;  }
@@ -127,6 +134,7 @@ void TraceValue::cycle() {
             f|=CHANGE;
             _written=true; // FIXME: This detection can fail!
             v=nv;
+            queue();
         }
     }
 }
@@ -146,6 +154,24 @@ void TraceValue::dump(Dumper &d) {
     f=0;
 }
 
+void TraceValue::dump(const std::vector<Dumper*> &d) {
+    for (size_t j=0; j<d.size(); j++) {
+        if (!(_dumpers & (1u << j)))
+            continue;
+        if (f&READ) {
+            d[j]->markRead(this);
+            if (!_written)
+                d[j]->markReadUnknown(this);
+        }
+        if (f&WRITE)
+            d[j]->markWrite(this);
+        if (f&CHANGE)
+            d[j]->markChange(this);
+    }
+    f=0;
+    _queued=false;
+}
+
 char TraceValue::VcdBit(int bitNo) const {
     if (_written)
         return (v & (1 << bitNo)) ? '1' : '0';
@@ -170,6 +196,9 @@ TraceValueRegister::~TraceValueRegister() {
     for (valmap_t::iterator i = _tvr_values.begin(); i != _tvr_values.end(); i++)
         delete i->first;
     _tvr_values.clear();
+    for (srcmap_t::iterator i = _tvr_sources.begin(); i != _tvr_sources.end(); i++)
+        delete i->first;
+    _tvr_sources.clear();
     for (regmap_t::iterator i = _tvr_registers.begin(); i != _tvr_registers.end(); i++)
         delete i->first;
     _tvr_registers.clear();
@@ -186,22 +215,24 @@ void TraceValueRegister::_tvr_registerTraceValues(TraceValueRegister *r) {
 }
 
 size_t TraceValueRegister::_tvr_getValuesCount(void) {
-    size_t cnt = _tvr_values.size();
+    size_t cnt = _tvr_values.size() + _tvr_sources.size();
     for (regmap_t::iterator i = _tvr_registers.begin(); i != _tvr_registers.end(); i++)
         cnt += (i->second)->_tvr_getValuesCount();
     return cnt;
 }
 
-void TraceValueRegister::_tvr_insertTraceValuesToSet(TraceSet &t) {
+void TraceValueRegister::_tvr_insertTraceValuesToSet(TraceSet &t, bool withSets) {
+    // all values are requested, so create them now
+    while(_tvr_sources.size() > 0)
+        _tvr_createFromSource(_tvr_sources.begin());
     for (valmap_t::iterator i = _tvr_values.begin(); i != _tvr_values.end(); i++)
         t.push_back(i->second);
     for (regmap_t::iterator i = _tvr_registers.begin(); i != _tvr_registers.end(); i++)
-        (i->second)->_tvr_insertTraceValuesToSet(t);
+        (i->second)->_tvr_insertTraceValuesToSet(t, withSets);
 }
 
-void TraceValueRegister::RegisterTraceValue(TraceValue *t) {
+std::string TraceValueRegister::_tvr_checkName(const std::string &p) {
     // check for duplicate names and the right prefix
-    string p = t->name();
     unsigned int idx = _tvr_scopeprefix.length();
     if((p.length() <= idx) || (p.substr(0, idx) != _tvr_scopeprefix))
         avr_error("add TraceValue denied: wrong prefix: '%s', scope is '%s'",
@@ -210,13 +241,44 @@ void TraceValueRegister::RegisterTraceValue(TraceValue *t) {
     if(n.find('.') != string::npos)
         avr_error("add TraceValue denied: wrong name: '%s', scope is '%s'",
                   n.c_str(), _tvr_scopeprefix.c_str());
-    // register this TraceValue
-    if(GetTraceValueByName(n) == NULL) {
-        string *s = new string(n);
-        pair<string*, TraceValue*> v(s, t);
-        _tvr_values.insert(v);
-    } else
+    for (srcmap_t::iterator i = _tvr_sources.begin(); i != _tvr_sources.end(); i++) {
+        if(n == *(i->first))
+            avr_error("add TraceValue denied: name found: '%s'", n.c_str());
+    }
+    if(GetTraceValueByName(n) != NULL)
         avr_error("add TraceValue denied: name found: '%s'", n.c_str());
+    return n;
+}
+
+void TraceValueRegister::RegisterTraceValue(TraceValue *t) {
+    string *s = new string(_tvr_checkName(t->name()));
+    pair<string*, TraceValue*> v(s, t);
+    _tvr_values.insert(v);
+}
+
+void TraceValueRegister::RegisterTraceValueSource(const std::string &name, TraceValueSource *src) {
+    string *s = new string(_tvr_checkName(name));
+    pair<string*, TraceValueSource*> v(s, src);
+    _tvr_sources.insert(v);
+}
+
+void TraceValueRegister::UnregisterTraceValueSource(TraceValueSource *src) {
+    for (srcmap_t::iterator i = _tvr_sources.begin(); i != _tvr_sources.end(); i++) {
+        if(i->second == src) {
+            delete i->first;
+            _tvr_sources.erase(i);
+            break;
+        }
+    }
+}
+
+TraceValue* TraceValueRegister::_tvr_createFromSource(srcmap_t::iterator i) {
+    TraceValueSource *src = i->second;
+    delete i->first;
+    _tvr_sources.erase(i);
+    TraceValue *t = src->CreateTraceValue(-1);
+    RegisterTraceValue(t);
+    return t;
 }
 
 void TraceValueRegister::UnregisterTraceValue(TraceValue *t) {
@@ -243,6 +305,10 @@ TraceValue* TraceValueRegister::GetTraceValueByName(const std::string &name) {
         if(name == *(i->first))
             return i->second;
     }
+    for (srcmap_t::iterator i = _tvr_sources.begin(); i != _tvr_sources.end(); i++) {
+        if(name == *(i->first))
+            return _tvr_createFromSource(i);
+    }
     return NULL;
 }
 
@@ -278,10 +344,10 @@ TraceSet* TraceValueRegister::GetAllTraceValues(void) {
     return result;
 }
 
-TraceSet* TraceValueRegister::GetAllTraceValuesRecursive(void) {
+TraceSet* TraceValueRegister::GetAllTraceValuesRecursive(bool withSets) {
     TraceSet* result = new TraceSet;
     result->reserve(_tvr_getValuesCount());
-    _tvr_insertTraceValuesToSet(*result);
+    _tvr_insertTraceValuesToSet(*result, withSets);
     return result;
 }
 
@@ -308,6 +374,26 @@ void TraceValueCoreRegister::RegisterTraceSetValue(TraceValue *t, const std::str
     (*set)[t->index()] = t;
 }
 
+void TraceValueCoreRegister::RegisterTraceSetSource(const std::string &name, const size_t size, TraceValueSource *src) {
+    TraceSet *set = new TraceSet(size, NULL);
+    string *s = new string(name);
+    pair<string*, TraceSet*> v(s, set);
+    _tvr_valset.insert(v);
+    _tvr_setsources[set] = src;
+}
+
+TraceValue* TraceValueCoreRegister::_tvr_setvalue(TraceSet *set, size_t idx) {
+    TraceValue *t = (*set)[idx];
+    if(t == NULL) {
+        map<TraceSet*, TraceValueSource*>::iterator i = _tvr_setsources.find(set);
+        if(i != _tvr_setsources.end()) {
+            t = i->second->CreateTraceValue(idx);
+            (*set)[idx] = t;
+        }
+    }
+    return t;
+}
+
 TraceValue* TraceValueCoreRegister::GetTraceValueByName(const std::string &name) {
     TraceValue *res = TraceValueRegister::GetTraceValueByName(name);
     if(res == NULL) {
@@ -320,7 +406,7 @@ TraceValue* TraceValueCoreRegister::GetTraceValueByName(const std::string &name)
                 if(n == *(i->first)) {
                     TraceSet *set = i->second;
                     if(v < (int)set->size())
-                        res = (*set)[v];
+                        res = _tvr_setvalue(set, v);
                     break;
                 }
             }
@@ -342,13 +428,15 @@ size_t TraceValueCoreRegister::_tvr_getValuesCount(void) {
     return cnt;
 }
 
-void TraceValueCoreRegister::_tvr_insertTraceValuesToSet(TraceSet &t) {
-    TraceValueRegister::_tvr_insertTraceValuesToSet(t);
+void TraceValueCoreRegister::_tvr_insertTraceValuesToSet(TraceSet &t, bool withSets) {
+    TraceValueRegister::_tvr_insertTraceValuesToSet(t, withSets);
+    if(!withSets)
+        return;
     // now insert also all values from _tvr_valset
     for(setmap_t::iterator i = _tvr_valset.begin(); i != _tvr_valset.end(); i++) {
         TraceSet* s = i->second;
-        for(TraceSet::iterator j = s->begin(); j != s->end(); j++)
-            t.push_back(*j);
+        for(size_t j = 0; j < s->size(); j++)
+            t.push_back(_tvr_setvalue(s, j));
     }
 }
 
@@ -381,18 +469,54 @@ bool WarnUnknown::enabled(const TraceValue *t) const {
 }
 
 void DumpVCD::valout(const TraceValue *v) {
-    osbuffer << 'b';
+    if (v->bits() == 1) {
+        buffer += v->VcdBit(0);
+        return;
+    }
+    buffer += 'b';
     for (int i = v->bits()-1; i >= 0; i--)
-        osbuffer << v->VcdBit(i);
+        buffer += v->VcdBit(i);
+    buffer += ' ';
+}
 
+void DumpVCD::valchange(const TraceValue *v, size_t n) {
+    valout(v);
+    buffer += codes[n];
+    buffer += '\n';
 }
 
-void DumpVCD::flushbuffer(void) {
-    if(changesWritten) {
-        *os << osbuffer.str();
-        changesWritten = false;
+void DumpVCD::numout(unsigned long long n) {
+    char buf[24];
+    char *p = buf + sizeof(buf);
+    do {
+        *--p = '0' + n % 10;
+        n /= 10;
+    } while(n != 0);
+    buffer.append(p, buf + sizeof(buf) - p);
+}
+
+void DumpVCD::allvalues(void) {
+    for (size_t n=0; n<tv.size(); n++) {
+        valchange(tv[n], n*(1+rs+ws));
+        // reset RS, WS
+        for (int s=1; s<=rs+ws; s++) {
+            buffer += '0';
+            buffer += codes[n*(1+rs+ws)+s];
+            buffer += '\n';
+        }
     }
-    osbuffer.str("");
+}
+
+void DumpVCD::flushbuffer(void) {
+    if(!buffer.empty())
+        output(buffer.data(), buffer.size());
+    buffer.clear();
+    cycleStart = 0;
+    blockStarted = false;
+}
+
+void DumpVCD::output(const char *data, size_t len) {
+    os->write(data, len);
 }
 
 DumpVCD::DumpVCD(ostream *_os,
@@ -403,7 +527,10 @@ DumpVCD::DumpVCD(ostream *_os,
     rs(rstrobes),
     ws(wstrobes),
     changesWritten(false),
-    os(_os)
+    os(_os),
+    cycleStart(0),
+    flushSize(1 << 20),
+    blockStarted(false)
 {}
 
 DumpVCD::DumpVCD(const std::string &_name,
@@ -414,7 +541,10 @@ DumpVCD::DumpVCD(const std::string &_name,
     rs(rstrobes),
     ws(wstrobes),
     changesWritten(false),
-    os(new ofstream(_name.c_str()))
+    os(new ofstream(_name.c_str())),
+    cycleStart(0),
+    flushSize(1 << 20),
+    blockStarted(false)
 {}
 
 void DumpVCD::setActiveSignals(const TraceSet &act) {
@@ -429,82 +559,94 @@ void DumpVCD::setActiveSignals(const TraceSet &act) {
 }
 
 void DumpVCD::start() {
-    *os <<
+    // identifier codes: printable characters from '!' to '~', base 94
+    size_t cnt = tv.size()*(1+rs+ws);
+    codes.resize(cnt);
+    for (size_t n=0; n<cnt; n++) {
+        size_t c = n;
+        do {
+            codes[n] += (char)('!' + c % 94);
+            c /= 94;
+        } while(c != 0);
+    }
+
+    buffer +=
         "$version\n"
         "\tSimulavr VCD dump file generator\n"
         "$end\n";
     
-    *os << "$timescale 1" << tscale << " $end\n";
-    typedef TraceSet::iterator iter;
-    unsigned n=0;
-    for (iter i=tv.begin();
-         i!=tv.end(); i++) {
-        string s=(*i)->name();
+    buffer += "$timescale 1" + tscale + " $end\n";
+    for (size_t n=0; n<tv.size(); n++) {
+        string s=tv[n]->name();
 
         /* find last dot in string as divider
            between name of the variable and the module string. */
         int ld;
         for (ld=s.size()-1; ld>0; ld--)
             if (s[ld]=='.') break;
+        string var=s.substr(ld+1, s.size()-1);
     
-        *os << "$scope module " << s.substr(0, ld) << " $end\n";
-        *os << "$var wire " << (*i)->bits() << ' ' << n*(1+rs+ws) << ' ' << s.substr(ld+1, s.size()-1) << " $end\n";
+        buffer += "$scope module " + s.substr(0, ld) + " $end\n";
+        buffer += "$var wire " + int2str(tv[n]->bits()) + ' ' + codes[n*(1+rs+ws)] + ' ' + var + " $end\n";
         if (rs)
-            *os << "$var wire 1 " << n*(1+rs+ws)+1 << ' ' << s.substr(ld+1, s.size()-1)+"_R" << " $end\n";
+            buffer += "$var wire 1 " + codes[n*(1+rs+ws)+1] + ' ' + var + "_R $end\n";
         if (ws)
-            *os << "$var wire 1 " << n*(1+rs+ws)+1+rs << ' ' << s.substr(ld+1, s.size()-1)+"_W" << " $end\n";
-        *os << "$upscope $end\n";
-        n++;
+            buffer += "$var wire 1 " + codes[n*(1+rs+ws)+1+rs] + ' ' + var + "_W $end\n";
+        buffer += "$upscope $end\n";
     }
-    *os << "$enddefinitions $end\n";
+    buffer += "$enddefinitions $end\n";
 
     // mark initial state
-    changesWritten = true;
-    osbuffer << "#0\n$dumpvars\n";
-    n=0;
-    for (iter i=tv.begin();
-         i!=tv.end(); i++) {
-        valout(*i);
-        osbuffer << ' ' << n*(1+rs+ws) << '\n';
-        // reset RS, WS
-        if (rs) {
-            osbuffer << "0" << n*(1+rs+ws)+1 << "\n";
-        }
-        if (ws) {
-            if (rs)
-                osbuffer << "0" << n*(1+rs+ws)+2 << "\n";
-            else
-                osbuffer << "0" << n*(1+rs+ws)+1 << "\n";
-        }
-        n++;
-    }
-    osbuffer << "$end\n";
+    buffer += "#0\n$dumpvars\n";
+    allvalues();
+    buffer += "$end\n";
     flushbuffer();
 }
 
 void DumpVCD::cycle() {
-    // flush the buffer
-    flushbuffer();
+    // drop time marker of last cycle, if nothing changed
+    if(!changesWritten)
+        buffer.resize(cycleStart);
+    changesWritten = false;
+    if(buffer.size() >= flushSize)
+        flushbuffer();
     
     // write new time marker to buffer
     SystemClockOffset clock=SystemClock::Instance().GetCurrentTime();
-    osbuffer << "#" << clock << '\n';
+    if(!blockStarted) {
+        startBlock(clock);
+        blockStarted = true;
+    }
+    cycleStart = buffer.size();
+    buffer += '#';
+    numout(clock);
+    buffer += '\n';
 
     // reset RS, WS states
-    for (size_t i=0; i<marked.size(); i++)
-        osbuffer << "0" << marked[i] << "\n";
+    for (size_t i=0; i<marked.size(); i++) {
+        buffer += '0';
+        buffer += codes[marked[i]];
+        buffer += '\n';
+    }
     if(marked.size())
         changesWritten = true;
     marked.clear();
 }
 
 void DumpVCD::stop() {
-    // flush the buffer
-    flushbuffer();
+    // drop time marker of last cycle, if nothing changed
+    if(!changesWritten)
+        buffer.resize(cycleStart);
+    changesWritten = false;
     
     // write a last time marker to report end of dump
     SystemClockOffset clock=SystemClock::Instance().GetCurrentTime();
-    *os << "#" << clock << '\n';
+    if(!blockStarted)
+        startBlock(clock);
+    buffer += '#';
+    numout(clock);
+    buffer += '\n';
+    flushbuffer();
     
     os->flush(); // flush stream
 }
@@ -512,24 +654,29 @@ void DumpVCD::stop() {
 void DumpVCD::markRead(const TraceValue *t) {
     if (rs) {
         // mark read cycle
-        osbuffer << "1" << id2num[t]*(1+rs+ws)+1 << "\n";
+        size_t n = id2num[t]*(1+rs+ws)+1;
+        buffer += '1';
+        buffer += codes[n];
+        buffer += '\n';
         changesWritten = true;
         // mark to disable @ next cycle
-        marked.push_back(id2num[t]*(1+rs+ws)+1);
+        marked.push_back(n);
     }
 }
 
 void DumpVCD::markWrite(const TraceValue *t) {
     if (ws) {
-        osbuffer << "1" << id2num[t]*(1+rs+ws)+1+rs << "\n";
+        size_t n = id2num[t]*(1+rs+ws)+1+rs;
+        buffer += '1';
+        buffer += codes[n];
+        buffer += '\n';
         changesWritten = true;
-        marked.push_back(id2num[t]*(1+rs+ws)+1+rs);
+        marked.push_back(n);
     }
 }
 
 void DumpVCD::markChange(const TraceValue *t) {
-    valout(t);
-    osbuffer << " " << id2num[t]*(1+rs+ws) << "\n";
+    valchange(t, id2num[t]*(1+rs+ws));
     changesWritten = true;
 }
 
@@ -541,6 +688,8 @@ DumpVCD::~DumpVCD() { delete os; }
 
 int DumpManager::_devidx = 0;
 DumpManager *::DumpManager::_instance = NULL;
+TraceSet DumpManager::dirty;
+unsigned DumpManager::_generation = 0;
 
 DumpManager* DumpManager::Instance(void) {
     if(_instance == NULL)
@@ -559,6 +708,9 @@ void DumpManager::Reset(void) {
 
 DumpManager::DumpManager() {
     singleDeviceApp = false;
+    // values of a former instance may be still on dirty list or point to it
+    _generation++;
+    dirty.clear();
 }
 
 void DumpManager::appendDeviceName(std::string &s) {
@@ -623,14 +775,41 @@ void DumpManager::addDumper(Dumper *dump, const TraceSet &vals) {
         if(find(active.begin(), active.end(), *i) == active.end())
             active.push_back(*i);
     }
+    // traced registers and RAM bytes need a hook, see AvrDevice::EnableDataMemHooks
+    for(vector<AvrDevice*>::iterator d = devices.begin(); d != devices.end(); d++)
+        (*d)->HookTracedDataMem();
     
     // check, if dumper exists in dumps list
     if(find(dumps.begin(), dumps.end(), dump) != dumps.end())
         avr_error("Internal error: Dumper already registered.");
+    if(dumps.size() >= 8 * sizeof(unsigned))
+        avr_error("Too many dumpers, only %d are possible", (int)(8 * sizeof(unsigned)));
     // set active signals for dumper
     dump->setActiveSignals(vals);
     // and insert dumper in dumps list
     dumps.push_back(dump);
+    
+    // ask dumpers once, which values they trace, and attach values to dirty list
+    polled.clear();
+    for(TraceSet::iterator i = active.begin(); i != active.end(); i++) {
+        TraceValue *t = *i;
+        t->_dumpers = 0;
+        for(size_t j = 0; j < dumps.size(); j++)
+            if(dumps[j]->enabled(t))
+                t->_dumpers |= 1u << j;
+        if(t->_generation != _generation) {
+            // new value (or left over from a former DumpManager instance)
+            t->_generation = _generation;
+            t->_queued = false;
+            if(t->f)
+                t->queue(); // accessed before, dump it with next cycle
+        }
+        if(t->polled())
+            polled.push_back(t);
+    }
+    // devices have to call cycle() from now on
+    for(vector<AvrDevice*>::iterator d = devices.begin(); d != devices.end(); d++)
+        (*d)->UpdateStepCycle();
 }
 
 const TraceSet& DumpManager::all() {
@@ -666,14 +845,15 @@ void DumpManager::cycle() {
     for (size_t i=0; i<dumps.size(); i++)
         dumps[i]->cycle();
 
-    // And then, update the TraceValues and dump them
-    for (TraceSet::iterator i=active.begin();
-         i!=active.end(); i++) {
+    // And then, update the polled TraceValues, they queue themselves on change
+    for (TraceSet::iterator i=polled.begin();
+         i!=polled.end(); i++)
         (*i)->cycle();
-        for (size_t j=0; j<dumps.size(); j++)
-            if (dumps[j]->enabled(*i))
-                (*i)->dump(*dumps[j]);
-    }
+
+    // and dump all accessed values
+    for (size_t i=0; i<dirty.size(); i++)
+        dirty[i]->dump(dumps);
+    dirty.clear();
 }
 
 void DumpManager::stopApplication(void) {
@@ -682,6 +862,11 @@ void DumpManager::stopApplication(void) {
         delete dumps[i];
     }
     dumps.clear();
+    for(vector<AvrDevice*>::iterator d = devices.begin(); d != devices.end(); d++) {
+        (*d)->StopBinaryTrace(); // closes binary trace and selects StepCycle variant again
+        (*d)->StopCoverage(); // writes lcov file
+        (*d)->StopLoopCounter(); // writes loop bounds
+    }
 }
 
 void DumpManager::save(ostream &os) const {
@@ -30,6 +30,10 @@
 #include <sstream>
 #include <map>
 #include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "systemclocktypes.h"
 
 /* TODO, notes:
 
@@ -98,6 +102,10 @@ class Dumper;
   accesses, but all state changes will still be represented in the output file.
   This is helpful for e.g. tracing the hidden shadow states in various
   parts of the AVR hardware, such as the timer double buffers.
+
+  Values, which are traced by a Dumper, put themselves on the dirty list of
+  DumpManager on the first access in a cycle, so DumpManager::cycle only
+  handles accessed values and those, which have to be polled.
   */
 class TraceValue {
     
@@ -169,15 +177,22 @@ class TraceValue {
         //! Gives the current set of flag readings
         Atype flags() const;
         
-        //! Called at least once for each cycle if this trace value is activated
+        //! Called at least once for each cycle if this trace value is activated and polled
         /*! This may check for updates to an underlying referenced value etc.
           and update the flags accordingly. */
         virtual void cycle();
         
+        //! True, if cycle() has to be called every cycle, because changes aren't logged
+        virtual bool polled() const { return shadow != 0; }
+        
         /*! Dump the state or state change somewhere. This also resets the current
           flags. */
         virtual void dump(Dumper &d);
         
+        /*! Dump the state or state change to all dumpers in d, which trace this
+          value (see DumpManager::addDumper). This also resets the current flags. */
+        void dump(const std::vector<Dumper*> &d);
+        
         /*! Give back VCD coding of a bit */
         virtual char VcdBit(int bitNo) const;
 
@@ -185,6 +200,7 @@ class TraceValue {
         //! Clear all access flags
         void clear_flags();
         friend class TraceKeeper;
+        friend class DumpManager;
         
     private:
         std::string _name;
@@ -209,6 +225,18 @@ class TraceValue {
         /*! Note that it must additionally be enabled in the particular
           Dumper. */
         bool _enabled;
+        
+        //! Bit j is set, if DumpManager's dumper j traces this value
+        unsigned _dumpers;
+        
+        //! Generation of the DumpManager instance, which traces this value, 0 if not traced
+        unsigned _generation;
+        
+        //! True, if this value is on the dirty list
+        bool _queued;
+        
+        //! Put value on the dirty list of DumpManager, called on every access
+        inline void queue();
 };
 
 class TraceValueOutput: public TraceValue {
@@ -262,9 +290,8 @@ class Dumper {
         virtual ~Dumper() {}
     
         //! Returns true iff tracing a particular value is enabled
-        /*! FIXME: For a lot of values to trace,
-          checking enabled() each time by doing find on a map()
-          could be slow. Here is potential for more optimization! */
+        /*! DumpManager asks this only in addDumper and keeps the result as
+          bit mask in the value. */
         virtual bool enabled(const TraceValue *t) const=0;
 };
 
@@ -281,7 +308,12 @@ class WarnUnknown : public Dumper {
         AvrDevice *core;
 };
 
-/*! Produces value change dump files. */
+/*! Produces value change dump files.
+
+  Value changes are formatted directly into a large buffer with identifier
+  codes, which are prepared in start(). The buffer is written out, if it's
+  larger than flushSize at the begin of a cycle, so output() always gets
+  whole cycles. */
 class DumpVCD : public Dumper {
     
     public:
@@ -318,24 +350,49 @@ class DumpVCD : public Dumper {
         bool enabled(const TraceValue *t) const;
         ~DumpVCD();
         
-    private:
+    protected:
         TraceSet tv;
-        std::map<const TraceValue*, size_t> id2num;
+        std::unordered_map<const TraceValue*, size_t> id2num;
         const std::string tscale;
         const bool rs, ws;
         bool changesWritten;
         
+        //! VCD identifier code for signal number (value, R- and W-strobe per value)
+        std::vector<std::string> codes;
+        
         // list of signals marked last cycle
-        std::vector<int> marked;
+        std::vector<size_t> marked;
         std::ostream *os;
     
-        // buffer for change data
-        std::stringstream osbuffer;
+        //! buffer for header and change data
+        std::string buffer;
+        //! position of the time marker of current cycle in buffer
+        size_t cycleStart;
+        //! buffer is written, if it's larger at the begin of a cycle
+        size_t flushSize;
+        //! false after flushbuffer, until startBlock was called
+        bool blockStarted;
         
+        //! Appends value of v in VCD format to buffer
         void valout(const TraceValue *v);
         
-        //! writes content of osbuffer to os and empty osbuffer afterwards
+        //! Appends value change of signal number n to buffer
+        void valchange(const TraceValue *v, size_t n);
+        
+        //! Appends a decimal number to buffer
+        void numout(unsigned long long n);
+        
+        //! Appends current value of all signals to buffer, like in $dumpvars
+        void allvalues(void);
+        
+        //! writes content of buffer by output() and empty buffer afterwards
         void flushbuffer(void);
+        
+        //! Called in cycle() for the first cycle after the buffer was written
+        virtual void startBlock(SystemClockOffset time) {}
+        
+        //! Writes a part of the VCD file, header or whole cycles
+        virtual void output(const char *data, size_t len);
 };
 
 /*! Manages all active Dumper instances for a given AvrDevice.
@@ -368,12 +425,16 @@ class DumpManager {
           method will be called or the dump manager gets destroyed. */
         void start();
     
-        //! Stop processing on all dumpers and removes it from dumpers list
+        //! Stop processing on all dumpers and removes it from dumpers list, closes binary traces of all devices
         void stopApplication(void);
         
         /*! Process one AVR clock cycle. Must be done after the AVR did all
-          processing so that changed values etc. can be collected. */
+          processing so that changed values etc. can be collected. Only values
+          on the dirty list and polled values are processed. */
         void cycle();
+
+        //! Returns true, if there are dumpers, which need cycle() on every clock cycle
+        bool HasDumpers(void) const { return !dumps.empty(); }
     
         //! Destroys the DumpManager instance and shut down all dumpers
         ~DumpManager() { stopApplication(); }
@@ -424,6 +485,16 @@ class DumpManager {
         
         //! Set of active tracing values
         TraceSet active;
+        //! Active values, which have to be polled every cycle, see TraceValue::polled
+        TraceSet polled;
+        //! Active values, which were accessed in current cycle
+        /*! Static, because trace values may live longer than a DumpManager
+          instance. They queue themselves only, if they are traced by current
+          instance, see _generation. */
+        static TraceSet dirty;
+        //! Generation of current instance, counts instances
+        static unsigned _generation;
+        friend class TraceValue;
         //! Set of all traceable values (placeholder instance for all() method)
         TraceSet _all;
         
@@ -437,6 +508,26 @@ class DumpManager {
         static DumpManager *_instance;
 };
 
+void TraceValue::queue() {
+    if(!_queued && (_generation == DumpManager::_generation)) {
+        _queued = true;
+        DumpManager::dirty.push_back(this);
+    }
+}
+
+//! Creates a TraceValue on first request
+/*! Most trace values are never used in a simulation. Instead of creating
+  them on construction, a source can be registered in TraceValueRegister,
+  which creates the TraceValue, when DumpManager asks for it. */
+class TraceValueSource {
+    
+    public:
+        virtual ~TraceValueSource() {}
+        
+        //! Create the TraceValue, idx is the index in a TraceSet or -1
+        virtual TraceValue *CreateTraceValue(int idx)=0;
+};
+
 //! Build a register for TraceValue's
 /*! This is used by DumpManager to find TraceValues by name */
 class TraceValueRegister {
@@ -444,21 +535,31 @@ class TraceValueRegister {
     private:
         typedef std::map<std::string*, TraceValue*> valmap_t; //!< type of values map
         typedef std::map<std::string*, TraceValueRegister*> regmap_t; //!< type of subregisters map
+        typedef std::map<std::string*, TraceValueSource*> srcmap_t; //!< type of sources map
         
         std::string _tvr_scopename; //!< the scope name itself
         std::string _tvr_scopeprefix; //!< the prefix scope for a TraceValue name
         valmap_t _tvr_values; //!< the registered TraceValue's
         regmap_t _tvr_registers; //!< the sub-registers
+        srcmap_t _tvr_sources; //!< the registered sources for not yet created TraceValue's
         
         //! Registers a TraceValueRegister for this register, build a hierarchy
         void _tvr_registerTraceValues(TraceValueRegister *r);
         
+        //! Checks name of a TraceValue to register and returns name without scope prefix
+        std::string _tvr_checkName(const std::string &p);
+        
+        //! Creates TraceValue from source, registers it and removes source
+        TraceValue* _tvr_createFromSource(srcmap_t::iterator i);
+        
     protected:
         //! Get the count of all TraceValues, that are registered here and descending
         virtual size_t _tvr_getValuesCount(void);
         
         //! Insert all TraceValues into TraceSet, that registered here and descending
-        virtual void _tvr_insertTraceValuesToSet(TraceSet &t);
+        /*! If withSets is false, values in a TraceSet of a core register are
+          skipped and aren't created. */
+        virtual void _tvr_insertTraceValuesToSet(TraceSet &t, bool withSets);
         
     public:
         //! Create a TraceValueRegister, with a scope prefix built on parent scope + name
@@ -487,6 +588,10 @@ class TraceValueRegister {
         void RegisterTraceValue(TraceValue *t);
         //! Unregisters a TraceValue, remove it from register
         void UnregisterTraceValue(TraceValue *t);
+        //! Registers a source, which creates TraceValue with (full) name on demand
+        void RegisterTraceValueSource(const std::string &name, TraceValueSource *s);
+        //! Unregisters a source, if TraceValue isn't created yet
+        void UnregisterTraceValueSource(TraceValueSource *s);
         //! Get a here registered TraceValueRegister by it's name
         TraceValueRegister* GetScopeGroupByName(const std::string &name);
         //! Get a here registered TraceValue by it's name
@@ -498,7 +603,9 @@ class TraceValueRegister {
         //! Get all here registered TraceValue's only (not with descending values)
         TraceSet* GetAllTraceValues(void);
         //! Get all here registered TraceValue's with descending values
-        TraceSet* GetAllTraceValuesRecursive(void);
+        /*! If withSets is false, registers and RAM bytes aren't included, see
+          TraceValueCoreRegister. */
+        TraceSet* GetAllTraceValuesRecursive(bool withSets = true);
 };
 
 /*! TraceValueRegister for CORE group to hold also RAM groups */
@@ -508,6 +615,11 @@ class TraceValueCoreRegister: public TraceValueRegister {
         typedef std::map<std::string*, TraceSet*> setmap_t; //!< type of TraceSet map
         
         setmap_t _tvr_valset; //!< the registered TraceValue's
+        //! sources for not yet created values in a TraceSet
+        std::map<TraceSet*, TraceValueSource*> _tvr_setsources;
+        
+        //! helper function to get value from set, creates it on demand
+        TraceValue* _tvr_setvalue(TraceSet *set, size_t idx);
 
         //! helper function to split up into name an number tail
         int _tvr_numberindex(const std::string &str);
@@ -518,8 +630,8 @@ class TraceValueCoreRegister: public TraceValueRegister {
         virtual size_t _tvr_getValuesCount(void);
         
         //! Insert all TraceValues into TraceSet, that registered here and descending
-        /*! This includes here also values in _tvr_valset! */
-        virtual void _tvr_insertTraceValuesToSet(TraceSet &t);
+        /*! This includes here also values in _tvr_valset, if withSets is true! */
+        virtual void _tvr_insertTraceValuesToSet(TraceSet &t, bool withSets);
         
     public:
         //! Create a TraceValueCoreRegister instance
@@ -529,6 +641,8 @@ class TraceValueCoreRegister: public TraceValueRegister {
         
         //! Registers a TraceValue for this register
         void RegisterTraceSetValue(TraceValue *t, const std::string &name, const size_t size);
+        //! Registers a TraceSet with size values, which are created on demand by src
+        void RegisterTraceSetSource(const std::string &name, const size_t size, TraceValueSource *src);
         //! Get a here registered TraceValue by it's name
         virtual TraceValue* GetTraceValueByName(const std::string &name);
 };
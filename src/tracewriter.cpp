@@ -0,0 +1,387 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <string.h>
+
+#include "tracewriter.h"
+#include "avrdevice.h"
+#include "avrerror.h"
+#include "decoder.h"
+#include "flash.h"
+#include "helper.h"
+#include "hwsreg.h"
+
+/* for preprocessor symbol HAVE_ZLIB */
+#include "config.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace std;
+
+//! records, which must be free on begin of line, if lines are dropped on full ring
+static const size_t lineReserve = 64;
+
+AsyncTraceWriter::AsyncTraceWriter(const string &name, unsigned long long maxlines,
+                                   unsigned int ringSize, bool drop):
+    dropOnFull(drop),
+    dropping(false),
+    dropped(0),
+    produced(0),
+    cachedTail(0),
+    head(0),
+    tail(0),
+    stopping(false),
+    sleeping(false),
+    waiting(false),
+    filename(name),
+    out(NULL),
+    zout(NULL),
+    maxLines(maxlines),
+    lines(0),
+    fileCount(1),
+    showSreg(false)
+{
+    size_t size = 65536;
+    while(size < ringSize)
+        size <<= 1;
+    ring.resize(size / sizeof(AsyncTraceRecord));
+    mask = ring.size() - 1;
+    setp(text, text + sizeof(text));
+
+    compress = (name.length() > 3) && (name.compare(name.length() - 3, 3, ".gz") == 0);
+#ifndef HAVE_ZLIB
+    if(compress)
+        avr_error("can't write compressed trace file '%s', simulavr is built without zlib", name.c_str());
+#endif
+    if(!Open())
+        avr_error("can't open trace file '%s'", name.c_str());
+    writer = thread(&AsyncTraceWriter::Run, this);
+}
+
+AsyncTraceWriter::~AsyncTraceWriter() {
+    Finish();
+}
+
+void AsyncTraceWriter::Finish(void) {
+    if(!writer.joinable())
+        return;
+    PushText();
+    Publish();
+    stopping = true;
+    {
+        lock_guard<mutex> l(lock);
+        wakeup.notify_one();
+    }
+    writer.join();
+    Close();
+    for(map<AvrDevice *, vector<DecodedInstruction *> >::iterator i = decoded.begin(); i != decoded.end(); i++)
+        for(size_t j = 0; j < i->second.size(); j++)
+            delete i->second[j];
+    decoded.clear();
+}
+
+void AsyncTraceWriter::ReleaseDevice(AvrDevice *core) {
+    if(!writer.joinable())
+        return;
+    PushText();
+    Publish();
+    WaitTail(produced);
+    // writer thread is idle now, until the next record is published
+    map<AvrDevice *, vector<DecodedInstruction *> >::iterator i = decoded.find(core);
+    if(i != decoded.end()) {
+        for(size_t j = 0; j < i->second.size(); j++)
+            delete i->second[j];
+        decoded.erase(i);
+    }
+}
+
+int AsyncTraceWriter::overflow(int c) {
+    PushText(c != traits_type::eof());
+    if(c == traits_type::eof())
+        return traits_type::not_eof(c);
+    *pptr() = c;
+    pbump(1);
+    return c;
+}
+
+void AsyncTraceWriter::Wake(void) {
+    if(sleeping) {
+        lock_guard<mutex> l(lock);
+        wakeup.notify_one();
+    }
+}
+
+void AsyncTraceWriter::Publish(void) {
+    head.store(produced, memory_order_release);
+    if(produced - cachedTail > ring.size() / 4) {
+        cachedTail = tail.load(memory_order_acquire);
+        if(produced - cachedTail > ring.size() / 4)
+            Wake();
+    }
+}
+
+void AsyncTraceWriter::WaitTail(size_t until) {
+    unique_lock<mutex> l(lock);
+    waiting = true;
+    wakeup.notify_one();
+    space.wait(l, [this, until] { return tail.load() - until < ring.size(); });
+    waiting = false;
+    cachedTail = tail.load(memory_order_acquire);
+}
+
+AsyncTraceRecord *AsyncTraceWriter::Next(void) {
+    if(dropping)
+        return &scratch;
+    if(produced - cachedTail >= ring.size()) {
+        cachedTail = tail.load(memory_order_acquire);
+        if(produced - cachedTail >= ring.size()) {
+            // full, the writer thread needs the records written so far to make room
+            head.store(produced, memory_order_release);
+            WaitTail(produced - ring.size() + 1);
+        }
+    }
+    return &ring[produced++ & mask];
+}
+
+void AsyncTraceWriter::PushText(bool more) {
+    const char *data = pbase();
+    size_t len = pptr() - pbase();
+    setp(text, text + sizeof(text));
+    if(dropping)
+        return;
+    while(len > 0) {
+        AsyncTraceRecord *r = Next();
+        size_t n = (len > sizeof(r->text)) ? sizeof(r->text) : len;
+        r->type = ATREC_TEXT;
+        r->flags = ((len > n) || more) ? ATREC_CONTINUED : 0;
+        r->len = n;
+        memcpy(r->text, data, n);
+        data += n;
+        len -= n;
+    }
+}
+
+void AsyncTraceWriter::BeginLine(AvrDevice *core, unsigned int pc, SystemClockOffset cycle) {
+    dropping = false;
+    PushText();
+    if(dropOnFull && (ring.size() - (produced - cachedTail) < lineReserve)) {
+        cachedTail = tail.load(memory_order_acquire);
+        if(ring.size() - (produced - cachedTail) < lineReserve) {
+            dropping = true;
+            dropped++;
+            Publish();
+            Wake();
+            return;
+        }
+    }
+    AsyncTraceRecord *r = Next();
+    r->type = ATREC_LINE;
+    r->addr = pc;
+    r->line.core = core;
+    r->line.cycle = cycle;
+}
+
+void AsyncTraceWriter::Instruction(AvrDevice *core, unsigned int pc, word opcode, word next, unsigned int z) {
+    PushText();
+    AsyncTraceRecord *r = Next();
+    r->type = ATREC_INSN;
+    r->addr = pc;
+    r->insn.core = core;
+    r->insn.opcode = opcode;
+    r->insn.next = next;
+    r->insn.z = z;
+}
+
+void AsyncTraceWriter::Event(unsigned char type, unsigned int addr) {
+    PushText();
+    AsyncTraceRecord *r = Next();
+    r->type = type;
+    r->addr = addr;
+}
+
+void AsyncTraceWriter::Stack(unsigned int sp, int val) {
+    PushText();
+    AsyncTraceRecord *r = Next();
+    r->type = ATREC_STACK;
+    r->flags = (val >= 0) ? ATREC_VALUE : 0;
+    r->addr = sp;
+    r->value = val;
+}
+
+void AsyncTraceWriter::EndLine(unsigned char sreg) {
+    PushText();
+    if(dropping) {
+        dropping = false;
+        return;
+    }
+    AsyncTraceRecord *r = Next();
+    r->type = ATREC_END;
+    r->value = sreg;
+    Publish();
+}
+
+bool AsyncTraceWriter::Open(void) {
+    string name = filename;
+    if(fileCount > 1) {
+        // same naming as SystemConsoleHandler::TraceNextLine
+        ostringstream n;
+        size_t idx = filename.rfind('.');
+        if(idx == string::npos)
+            idx = filename.length();
+        n << filename.substr(0, idx) << "_" << fileCount << filename.substr(idx);
+        name = n.str();
+    }
+#ifdef HAVE_ZLIB
+    if(compress)
+        zout = gzopen(name.c_str(), "wb");
+    else
+#endif
+        out = fopen(name.c_str(), "w");
+    if((out == NULL) && (zout == NULL)) {
+        failedFile = name;
+        return false;
+    }
+    return true;
+}
+
+void AsyncTraceWriter::Write(const string &data) {
+#ifdef HAVE_ZLIB
+    if(zout != NULL)
+        gzwrite(zout, data.data(), data.length());
+#endif
+    if(out != NULL)
+        fwrite(data.data(), 1, data.length(), out);
+}
+
+void AsyncTraceWriter::Close(void) {
+#ifdef HAVE_ZLIB
+    if(zout != NULL)
+        gzclose(zout);
+    zout = NULL;
+#endif
+    if(out != NULL)
+        fclose(out);
+    out = NULL;
+}
+
+DecodedInstruction *AsyncTraceWriter::Decode(AvrDevice *core, word opcode) {
+    vector<DecodedInstruction *> &insns = decoded[core];
+    if(insns.empty())
+        insns.resize(0x10000, NULL);
+    if(insns[opcode] == NULL)
+        insns[opcode] = lookup_opcode(opcode, core);
+    return insns[opcode];
+}
+
+void AsyncTraceWriter::Format(const AsyncTraceRecord &r) {
+    // same output as StepCycle, DecodedInstruction::Trace and HWStackSram
+    switch(r.type) {
+        case ATREC_LINE:
+            formatted << r.line.core->GetFname() << " " << HexShort(r.addr << 1) << dec << ": "
+                      << r.line.cycle << ": ";
+            r.line.core->Flash->WriteSymbolAtAddress(formatted, r.addr, 30);
+            formatted << " ";
+            showSreg = false;
+            break;
+        case ATREC_INSN:
+            showSreg = Decode(r.insn.core, r.insn.opcode)->Disassemble(formatted, r.addr, r.insn.next, r.insn.z);
+            break;
+        case ATREC_TEXT:
+            formatted.write(r.text, r.len);
+            break;
+        case ATREC_IRQ:
+            formatted << "IRQ DETECTED: VectorAddr: " << r.addr;
+            break;
+        case ATREC_IRQ_PREPARED:
+            formatted << "IRQ prepared for addr " << hex << r.addr << dec << "\n";
+            break;
+        case ATREC_HOLD:
+            formatted << "CPU-Hold by IO-Hardware ";
+            break;
+        case ATREC_WAIT:
+            formatted << "CPU-waitstate";
+            break;
+        case ATREC_STACK:
+            formatted << "SP=0x" << hex << r.addr;
+            if(r.flags & ATREC_VALUE)
+                formatted << " 0x" << (int)r.value;
+            formatted << dec << " ";
+            break;
+        case ATREC_END:
+            if(showSreg) {
+                HWSreg sreg;
+                sreg = r.value;
+                formatted << (string)sreg;
+            }
+            formatted << "\n";
+            showSreg = false;
+            Write(formatted.str());
+            formatted.str("");
+            lines++;
+            if(maxLines && (lines >= maxLines)) {
+                Close();
+                fileCount++;
+                lines = 0;
+                Open();
+            }
+            break;
+    }
+}
+
+void AsyncTraceWriter::Run(void) {
+    size_t t = tail.load(memory_order_relaxed);
+    while(true) {
+        bool stop = stopping;
+        size_t h = head.load(memory_order_acquire);
+        if(t == h) {
+            // text after the last line
+            if(formatted.tellp() > 0) {
+                Write(formatted.str());
+                formatted.str("");
+            }
+            if(stop)
+                break;
+            unique_lock<mutex> l(lock);
+            sleeping = true;
+            wakeup.wait_for(l, chrono::milliseconds(10),
+                            [this, t] { return (head.load(memory_order_acquire) - t > ring.size() / 4) || stopping || waiting; });
+            sleeping = false;
+            continue;
+        }
+        while(t != h) {
+            Format(ring[t & mask]);
+            t++;
+            if(((t & (ring.size() / 8 - 1)) == 0) || (t == h)) {
+                tail.store(t);
+                if(waiting) {
+                    lock_guard<mutex> l(lock);
+                    space.notify_one();
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,204 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef TRACEWRITER
+#define TRACEWRITER
+
+#include <string>
+#include <vector>
+#include <map>
+#include <streambuf>
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdio.h>
+
+#include "types.h"
+#include "systemclocktypes.h"
+
+struct gzFile_s;
+class AvrDevice;
+class DecodedInstruction;
+
+//! Types of AsyncTraceRecord
+enum {
+    ATREC_LINE,          //!< begin of line: core, pc, cycle
+    ATREC_INSN,          //!< instruction: core, pc, opcode, 2nd opcode word, Z with RAMPZ
+    ATREC_TEXT,          //!< characters written to trace stream
+    ATREC_IRQ,           //!< irq entry: vector address
+    ATREC_IRQ_PREPARED,  //!< irq detected: vector address
+    ATREC_HOLD,          //!< cpu hold by IO hardware
+    ATREC_WAIT,          //!< cpu waitstate
+    ATREC_STACK,         //!< new stack pointer and byte pushed or popped
+    ATREC_END            //!< end of line: SREG
+};
+
+//! Flags of AsyncTraceRecord
+enum {
+    ATREC_CONTINUED = 1, //!< text is continued by the next record
+    ATREC_VALUE = 2      //!< stack record has a value
+};
+
+//! Event of a trace line, as put into the ring buffer of AsyncTraceWriter
+struct AsyncTraceRecord {
+    unsigned char type;  //!< one of ATREC_*
+    unsigned char flags; //!< ATREC_CONTINUED, ATREC_VALUE
+    unsigned char len;   //!< count of characters in text
+    unsigned char value; //!< SREG or stack byte
+    unsigned int addr;   //!< pc (word address), vector address or stack pointer
+    union {
+        struct {
+            AvrDevice *core;
+            SystemClockOffset cycle;
+        } line;
+        struct {
+            AvrDevice *core;
+            word opcode;
+            word next;
+            unsigned int z;
+        } insn;
+        char text[24];
+    };
+};
+
+//! Writes trace output to files from a background thread
+/*! The simulation doesn't format trace lines, if this writer is active.
+  StepCycle, DecodedInstruction::Trace and the stack put fixed size event
+  records (AsyncTraceRecord) into a single-producer/single-consumer ring
+  buffer, the writer thread formats them like the synchronous trace, writes
+  them to file and starts a new file after maxlines lines like
+  SystemConsoleHandler::TraceNextLine does. If the file name ends with ".gz",
+  the output is compressed by zlib.
+
+  Other trace output, for instance of IO hardware, is written into this
+  stream buffer and put as text records between the events. Text longer than
+  one record is split, ATREC_CONTINUED marks a record, which is continued by
+  the next one.
+
+  New records are published at end of line. The writer thread is woken up
+  only, if a quarter of the ring is filled, otherwise it polls every 10ms. So
+  the simulation thread doesn't need a system call per line. If the ring is
+  full, the simulation waits on a condition variable, until the writer thread
+  has made room. */
+class AsyncTraceWriter: public std::streambuf {
+
+    public:
+        //! Opens file name, aborts, if this isn't possible, and starts the writer thread
+        /*! ringSize (in byte) is rounded up to a power of 2, at least 64KiB */
+        /*! If dropOnFull is set, a line is dropped and counted, if the ring
+          has no room for it on begin of line, otherwise the simulation waits
+          for the writer thread. */
+        AsyncTraceWriter(const std::string &name, unsigned long long maxlines,
+                         unsigned int ringSize, bool dropOnFull);
+        //! Calls Finish
+        ~AsyncTraceWriter();
+
+        //! Writes all pending lines, stops the writer thread and closes file
+        void Finish(void);
+        //! Waits, until all records of core are formatted, and forgets its decoded instructions
+        /*! Records refer to the core, so this must be called before a core is deleted. */
+        void ReleaseDevice(AvrDevice *core);
+
+        //! Starts a trace line for instruction at pc (word address)
+        void BeginLine(AvrDevice *core, unsigned int pc, SystemClockOffset cycle);
+        //! Instruction opcode at pc, next is the 2nd opcode word, z is Z with RAMPZ in bits 16-23
+        void Instruction(AvrDevice *core, unsigned int pc, word opcode, word next, unsigned int z);
+        //! Event without values or with a address (ATREC_IRQ, ATREC_IRQ_PREPARED, ATREC_HOLD, ATREC_WAIT)
+        void Event(unsigned char type, unsigned int addr = 0);
+        //! New stack pointer and, if val >= 0, the byte pushed or popped
+        void Stack(unsigned int sp, int val);
+        //! Ends a trace line, sreg is SREG after the instruction
+        void EndLine(unsigned char sreg);
+
+        //! Count of lines dropped because of full ring buffer
+        unsigned long long GetDropped(void) const { return dropped; }
+        //! Name of last file, which couldn't be opened by writer thread or empty string
+        const std::string &GetFailedFile(void) const { return failedFile; }
+
+    protected:
+        int overflow(int c);
+
+    private:
+        // used by simulation thread
+        char text[240];                   //!< put area for text of 10 records
+        bool dropOnFull;
+        bool dropping;                    //!< current line is dropped
+        unsigned long long dropped;
+        AsyncTraceRecord scratch;         //!< target for records of a dropped line
+        size_t produced;                  //!< records written, published by head
+        size_t cachedTail;                //!< last read value of tail
+
+        // ring buffer, head is written by producer, tail by writer thread
+        std::vector<AsyncTraceRecord> ring;
+        size_t mask;
+        std::atomic<size_t> head;
+        char headPad[64];                 //!< keeps head and tail on different cache lines
+        std::atomic<size_t> tail;
+        std::atomic<bool> stopping;
+        std::atomic<bool> sleeping;       //!< writer thread waits for data
+        std::atomic<bool> waiting;        //!< simulation waits for room or for the writer thread
+        std::mutex lock;
+        std::condition_variable wakeup;   //!< wakes up writer thread
+        std::condition_variable space;    //!< wakes up simulation, tail has moved
+
+        // used by writer thread
+        std::string filename;
+        bool compress;
+        FILE *out;                        //!< file, if compress isn't set
+        gzFile_s *zout;                   //!< zlib file, if compress is set
+        unsigned long long maxLines;
+        unsigned long long lines;         //!< lines on current file
+        int fileCount;
+        std::string failedFile;
+        std::ostringstream formatted;     //!< formatted output, not yet written
+        bool showSreg;                    //!< instruction of current line shows SREG
+        std::map<AvrDevice *, std::vector<DecodedInstruction *> > decoded; //!< instructions by opcode
+        std::thread writer;
+
+        //! Returns record to fill, waits for room, if ring is full
+        AsyncTraceRecord *Next(void);
+        //! Puts collected text into text records, more is set, if the text isn't complete
+        void PushText(bool more = false);
+        //! Makes records visible to writer thread
+        void Publish(void);
+        //! Wakes up writer thread, if it waits for data
+        void Wake(void);
+        //! Waits, until writer thread has taken all records up to the given count
+        void WaitTail(size_t until);
+        //! Opens file number fileCount, returns false on error
+        bool Open(void);
+        void Write(const std::string &data);
+        void Close(void);
+        //! Formats a record into formatted
+        void Format(const AsyncTraceRecord &r);
+        //! Instruction for opcode on core, decoded on first use
+        DecodedInstruction *Decode(AvrDevice *core, word opcode);
+        //! Main loop of writer thread
+        void Run(void);
+};
+
+#endif
@@ -56,11 +56,11 @@ class TraceControl: public ExternalType
       {
          if ( s == "1" )
          {
-            dev->trace_on = 1;
+            dev->SetTraceOn(1);
          }
          else
          {
-            dev->trace_on = 0;
+            dev->SetTraceOn(0);
          }
       }
 };
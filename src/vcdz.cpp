@@ -0,0 +1,466 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <map>
+
+#include "vcdz.h"
+#include "avrerror.h"
+#include "helper.h"
+
+using namespace std;
+
+static const char magic[8] = { 'S', 'A', 'V', 'C', 'D', 'Z', '0', '1' };
+static const char indexMagic[8] = { 'S', 'A', 'V', 'C', 'D', 'I', 'D', 'X' };
+
+static const int hashBits = 14;
+static const size_t minMatch = 4;
+static const size_t maxOffset = 65535;
+
+static void PutLength(string &dst, size_t len) {
+    for(; len >= 255; len -= 255)
+        dst += (char)255;
+    dst += (char)len;
+}
+
+static unsigned int Read32(const char *p) {
+    unsigned int v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+void VcdzCompress(const char *src, size_t len, string &dst) {
+    vector<size_t> table(1 << hashBits, 0); // position + 1, 0 is empty
+    size_t anchor = 0;
+    size_t i = 0;
+
+    // last bytes are always literals, so matching can read 4 bytes without check
+    while((len >= minMatch + 4) && (i <= len - minMatch - 4)) {
+        unsigned int seq = Read32(src + i);
+        unsigned int h = (seq * 2654435761u) >> (32 - hashBits);
+        size_t cand = table[h];
+        table[h] = i + 1;
+        if((cand == 0) || (i - (cand - 1) > maxOffset) || (Read32(src + cand - 1) != seq)) {
+            i++;
+            continue;
+        }
+        cand--;
+        size_t match = minMatch;
+        while((i + match < len) && (src[cand + match] == src[i + match]))
+            match++;
+
+        size_t lit = i - anchor;
+        dst += (char)(((lit < 15 ? lit : 15) << 4) | ((match - minMatch) < 15 ? (match - minMatch) : 15));
+        if(lit >= 15)
+            PutLength(dst, lit - 15);
+        dst.append(src + anchor, lit);
+        size_t off = i - cand;
+        dst += (char)(off & 0xff);
+        dst += (char)(off >> 8);
+        if(match - minMatch >= 15)
+            PutLength(dst, match - minMatch - 15);
+
+        i += match;
+        anchor = i;
+    }
+
+    // last literals
+    size_t lit = len - anchor;
+    dst += (char)((lit < 15 ? lit : 15) << 4);
+    if(lit >= 15)
+        PutLength(dst, lit - 15);
+    dst.append(src + anchor, lit);
+}
+
+bool VcdzDecompress(const char *src, size_t len, char *dst, size_t dstLen) {
+    const unsigned char *ip = (const unsigned char *)src;
+    const unsigned char *iend = ip + len;
+    size_t op = 0;
+    bool last = false;
+
+    while(ip < iend) {
+        unsigned int token = *ip++;
+        size_t lit = token >> 4;
+        if(lit == 15) {
+            unsigned int b;
+            do {
+                if(ip >= iend)
+                    return false;
+                b = *ip++;
+                lit += b;
+            } while(b == 255);
+        }
+        if(((size_t)(iend - ip) < lit) || (dstLen - op < lit))
+            return false;
+        memcpy(dst + op, ip, lit);
+        ip += lit;
+        op += lit;
+        if(ip == iend) {
+            last = true; // last token has only literals
+            break;
+        }
+
+        if(iend - ip < 2)
+            return false;
+        size_t off = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t match = (token & 0xf) + minMatch;
+        if((token & 0xf) == 15) {
+            unsigned int b;
+            do {
+                if(ip >= iend)
+                    return false;
+                b = *ip++;
+                match += b;
+            } while(b == 255);
+        }
+        if((off == 0) || (off > op) || (dstLen - op < match))
+            return false;
+        // byte by byte, source and destination may overlap
+        for(size_t j = 0; j < match; j++, op++)
+            dst[op] = dst[op - off];
+    }
+    return last && (op == dstLen);
+}
+
+static void Put32(string &s, unsigned int v) {
+    for(int i = 0; i < 4; i++)
+        s += (char)((v >> (8 * i)) & 0xff);
+}
+
+static void Put64(string &s, unsigned long long v) {
+    for(int i = 0; i < 8; i++)
+        s += (char)((v >> (8 * i)) & 0xff);
+}
+
+static unsigned long long Get64(const unsigned char *p, int bytes) {
+    unsigned long long v = 0;
+    for(int i = bytes - 1; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+DumpVCDZ::DumpVCDZ(const string &_name,
+                   const string &_tscale,
+                   const bool rstrobes,
+                   const bool wstrobes):
+    DumpVCD(new ofstream(_name.c_str(), ios::out | ios::binary | ios::trunc), _tscale, rstrobes, wstrobes),
+    name(_name),
+    blockTime(0),
+    headerWritten(false),
+    offset(0)
+{
+    if(!((ofstream *)os)->is_open())
+        avr_error("can't open VCD file '%s'", name.c_str());
+    // smaller blocks, so that a reader has less to decompress to reach a time
+    flushSize = 256 * 1024;
+}
+
+void DumpVCDZ::start() {
+    DumpVCD::start();
+    // buffer is empty after start, use it to format the values
+    initial.resize(tv.size());
+    for(size_t n = 0; n < tv.size(); n++) {
+        valchange(tv[n], n * (1 + rs + ws));
+        initial[n] = buffer;
+        buffer.clear();
+    }
+}
+
+void DumpVCDZ::startBlock(SystemClockOffset time) {
+    blockTime = time;
+    // buffer is empty here, use it to format the values. Only values, which
+    // differ from the header, are needed: a reader applies $dumpvars first
+    for(size_t n = 0; n < tv.size(); n++) {
+        size_t pos = buffer.size();
+        valchange(tv[n], n * (1 + rs + ws));
+        if(buffer.compare(pos, string::npos, initial[n]) == 0)
+            buffer.resize(pos);
+    }
+    for(size_t i = 0; i < marked.size(); i++) {
+        // strobes from last cycle, they are reset by this cycle
+        buffer += '1';
+        buffer += codes[marked[i]];
+        buffer += '\n';
+    }
+    snapshot.swap(buffer);
+    buffer.clear();
+}
+
+void DumpVCDZ::output(const char *data, size_t len) {
+    if(!headerWritten) {
+        os->write(magic, sizeof(magic));
+        offset = sizeof(magic);
+        raw.assign(data, len);
+        snapshot.clear();
+        headerWritten = true;
+    } else {
+        // cycles without changes are dropped, so the block text starts with
+        // the first cycle, which has changes. A reader without index sees the same
+        SystemClockOffset time = blockTime;
+        if((len > 0) && (data[0] == '#'))
+            time = strtoll(data + 1, NULL, 10);
+        index.push_back(make_pair(time, offset));
+        raw = snapshot;
+        raw.append(data, len);
+    }
+    packed.clear();
+    Put32(packed, raw.size());
+    Put32(packed, snapshot.size());
+    Put32(packed, 0); // compressed size, set below
+    VcdzCompress(raw.data(), raw.size(), packed);
+    unsigned int clen = packed.size() - 12;
+    for(int i = 0; i < 4; i++)
+        packed[8 + i] = (char)((clen >> (8 * i)) & 0xff);
+    os->write(packed.data(), packed.size());
+    offset += packed.size();
+    snapshot.clear();
+}
+
+void DumpVCDZ::stop() {
+    DumpVCD::stop();
+    string idx;
+    for(size_t i = 0; i < index.size(); i++) {
+        Put64(idx, index[i].first);
+        Put64(idx, index[i].second);
+    }
+    Put64(idx, offset);
+    Put64(idx, index.size());
+    idx.append(indexMagic, sizeof(indexMagic));
+    os->write(idx.data(), idx.size());
+    os->flush();
+}
+
+VcdzReader::VcdzReader(const string &n):
+    in(n.c_str(), ios::in | ios::binary),
+    name(n)
+{
+    if(!in.is_open())
+        avr_error("can't open VCD file '%s'", name.c_str());
+    char m[sizeof(magic)];
+    in.read(m, sizeof(m));
+    if((in.gcount() != sizeof(m)) || (memcmp(m, magic, sizeof(m)) != 0))
+        avr_error("'%s' isn't a compressed VCD file", name.c_str());
+
+    size_t snapLen;
+    unsigned long long next;
+    if(!ReadBlockAt(sizeof(magic), header, snapLen, next))
+        avr_error("compressed VCD file '%s' is truncated", name.c_str());
+
+    // read index from trailer
+    unsigned char trailer[24];
+    in.seekg(0, ios::end);
+    unsigned long long size = in.tellg();
+    if(size >= next + sizeof(trailer)) {
+        in.seekg(size - sizeof(trailer));
+        in.read((char *)trailer, sizeof(trailer));
+        unsigned long long idxOffset = Get64(trailer, 8);
+        unsigned long long cnt = Get64(trailer + 8, 8);
+        if((memcmp(trailer + 16, indexMagic, sizeof(indexMagic)) == 0) &&
+           (idxOffset + cnt * 16 + sizeof(trailer) == size)) {
+            vector<unsigned char> buf(cnt * 16);
+            in.seekg(idxOffset);
+            in.read((char *)&buf[0], buf.size());
+            for(unsigned long long i = 0; i < cnt; i++)
+                index.push_back(make_pair(Get64(&buf[i * 16], 8), Get64(&buf[i * 16 + 8], 8)));
+            return;
+        }
+    }
+
+    // no index, simulation didn't finish: scan all blocks, time is in first time marker
+    avr_warning("compressed VCD file '%s' has no index, reading all blocks", name.c_str());
+    string data;
+    unsigned long long pos = next;
+    in.clear();
+    while(ReadBlockAt(pos, data, snapLen, next)) {
+        if((snapLen < data.size()) && (data[snapLen] == '#'))
+            index.push_back(make_pair(strtoull(data.c_str() + snapLen + 1, NULL, 10), pos));
+        pos = next;
+    }
+}
+
+bool VcdzReader::ReadBlockAt(unsigned long long pos, string &data, size_t &snapLen,
+                             unsigned long long &next) {
+    unsigned char hdr[12];
+    in.clear();
+    in.seekg(pos);
+    in.read((char *)hdr, sizeof(hdr));
+    if(in.gcount() != sizeof(hdr))
+        return false;
+    size_t rawLen = Get64(hdr, 4);
+    snapLen = Get64(hdr + 4, 4);
+    size_t compLen = Get64(hdr + 8, 4);
+    vector<char> comp(compLen);
+    in.read(&comp[0], compLen);
+    if((size_t)in.gcount() != compLen)
+        return false;
+    data.resize(rawLen);
+    if(!VcdzDecompress(&comp[0], compLen, &data[0], rawLen) || (snapLen > rawLen))
+        avr_error("compressed VCD file '%s' is corrupt at offset %llu", name.c_str(), pos);
+    next = pos + sizeof(hdr) + compLen;
+    return true;
+}
+
+int VcdzReader::FindBlock(SystemClockOffset time) const {
+    int lo = 0, hi = index.size();
+    while(lo < hi) {
+        int mid = (lo + hi) / 2;
+        if(index[mid].first <= time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo - 1;
+}
+
+void VcdzReader::ReadBlock(size_t i, string &snapshot, string &text) {
+    string data;
+    size_t snapLen;
+    unsigned long long next;
+    if(!ReadBlockAt(index[i].second, data, snapLen, next))
+        avr_error("compressed VCD file '%s' is truncated", name.c_str());
+    snapshot.assign(data, 0, snapLen);
+    text.assign(data, snapLen, string::npos);
+}
+
+//! Values of all VCD variables, in order of definition
+class VcdState {
+
+    public:
+        //! Reads identifier codes from $var definitions
+        void Define(const string &definitions) {
+            size_t pos = 0;
+            while((pos = definitions.find("$var ", pos)) != string::npos) {
+                vector<string> v = split(definitions.substr(pos, definitions.find('\n', pos) - pos), " ");
+                if(v.size() >= 4) {
+                    ids[v[3]] = values.size();
+                    values.push_back("x" + v[3]);
+                }
+                pos++;
+            }
+        }
+
+        //! Applies a value change line
+        void Change(const char *line, size_t len) {
+            size_t idStart;
+            if((line[0] == 'b') || (line[0] == 'r')) {
+                const char *sp = (const char *)memchr(line, ' ', len);
+                if(sp == NULL)
+                    return;
+                idStart = sp - line + 1;
+            } else
+                idStart = 1;
+            map<string, size_t>::iterator i = ids.find(string(line + idStart, len - idStart));
+            if(i != ids.end())
+                values[i->second].assign(line, len);
+        }
+
+        //! Applies all value changes in text, time markers and commands are skipped
+        void ChangeAll(const string &text) {
+            size_t pos = 0;
+            while(pos < text.size()) {
+                size_t end = text.find('\n', pos);
+                if(end == string::npos)
+                    end = text.size();
+                if((end > pos) && (text[pos] != '#') && (text[pos] != '$'))
+                    Change(text.data() + pos, end - pos);
+                pos = end + 1;
+            }
+        }
+
+        //! Writes all values as $dumpvars at time
+        void Write(ostream &os, SystemClockOffset time) {
+            os << "#" << time << "\n$dumpvars\n";
+            for(size_t i = 0; i < values.size(); i++)
+                os << values[i] << "\n";
+            os << "$end\n";
+        }
+
+    private:
+        map<string, size_t> ids;
+        vector<string> values;
+};
+
+void VcdzReader::Convert(ostream &os) {
+    string snapshot, text;
+    os << header;
+    for(size_t b = 0; b < index.size(); b++) {
+        ReadBlock(b, snapshot, text);
+        os << text;
+    }
+}
+
+void VcdzReader::ConvertWindow(ostream &os, SystemClockOffset start, SystemClockOffset end) {
+    // definitions, then values at window start
+    static const char endDefs[] = "$enddefinitions $end\n";
+    size_t defsEnd = header.find(endDefs);
+    if(defsEnd == string::npos)
+        avr_error("compressed VCD file '%s' has no $enddefinitions", name.c_str());
+    defsEnd += strlen(endDefs);
+    os.write(header.data(), defsEnd);
+    VcdState state;
+    state.Define(header.substr(0, defsEnd));
+    state.ChangeAll(header.substr(defsEnd));
+
+    int b = FindBlock(start);
+    if(b < 0)
+        b = 0;
+    string snapshot, text;
+    bool started = false;
+    for(; (size_t)b < index.size(); b++) {
+        ReadBlock(b, snapshot, text);
+        if(!started)
+            state.ChangeAll(snapshot);
+        // process text cycle by cycle
+        size_t pos = 0;
+        while(pos < text.size()) {
+            size_t next = text.find("\n#", pos);
+            next = (next == string::npos) ? text.size() : next + 1;
+            SystemClockOffset t = strtoll(text.c_str() + pos + 1, NULL, 10);
+            if((end >= 0) && (t > end)) {
+                if(!started)
+                    state.Write(os, start);
+                os << "#" << end << "\n";
+                return;
+            }
+            if(started)
+                os.write(text.data() + pos, next - pos);
+            else if(t < start)
+                state.ChangeAll(text.substr(pos, next - pos));
+            else {
+                if(t == start)
+                    state.ChangeAll(text.substr(pos, next - pos));
+                state.Write(os, start);
+                started = true;
+                if(t > start)
+                    os.write(text.data() + pos, next - pos);
+            }
+            pos = next;
+        }
+    }
+    if(!started)
+        state.Write(os, start);
+}
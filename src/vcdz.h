@@ -0,0 +1,131 @@
+ /*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef VCDZ
+#define VCDZ
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <ostream>
+
+#include "traceval.h"
+#include "systemclocktypes.h"
+
+//! Compresses len bytes from src with a byte oriented LZ77 and appends it to dst
+/*! The format is a sequence of tokens. The high nibble of the token byte is
+  the count of literals, the low nibble the match length - 4. A nibble of 15
+  is continued by bytes, which are added, until a byte is less than 255. The
+  literals follow the token, then the match offset (2 bytes, little endian)
+  and the continuation of the match length. The last token has only
+  literals. */
+void VcdzCompress(const char *src, size_t len, std::string &dst);
+
+//! Decompresses data from VcdzCompress, returns false, if data is corrupt
+bool VcdzDecompress(const char *src, size_t len, char *dst, size_t dstLen);
+
+//! Produces a block compressed VCD file with a time index
+/*! The VCD text is the same as from DumpVCD. It's split into blocks of
+  whole cycles, each is compressed with VcdzCompress. A block starts with a
+  snapshot of all values, which differ from the initial $dumpvars in header
+  block, so a reader can start at every block. The file layout (all numbers little endian):
+
+  - magic "SAVCDZ01"
+  - header block: VCD definitions and initial $dumpvars
+  - data blocks
+  - index: for each data block time of first cycle with changes and file offset (8 bytes each)
+  - trailer: file offset of index, count of index entries (8 bytes each), magic "SAVCDIDX"
+
+  A block is raw size, snapshot size and compressed size (4 bytes each),
+  followed by the compressed data, which is the snapshot followed by the
+  VCD text. Use simulavr-vcd to convert it to VCD. */
+class DumpVCDZ: public DumpVCD {
+    
+    public:
+        //! Create tracer with time scale tscale for output file name
+        DumpVCDZ(const std::string &name, const std::string &tscale = "ns",
+                 const bool rstrobes = false, const bool wstrobes = false);
+        
+        //! Writes header block and remembers the initial values
+        void start();
+        
+        //! Writes last block and the index
+        void stop();
+        
+    protected:
+        void startBlock(SystemClockOffset time);
+        void output(const char *data, size_t len);
+        
+    private:
+        std::string name;
+        std::string snapshot;      //!< values at begin of current block
+        std::vector<std::string> initial; //!< value lines of $dumpvars in header
+        SystemClockOffset blockTime; //!< time of first cycle in current block
+        bool headerWritten;
+        unsigned long long offset; //!< file offset of next block
+        std::vector<std::pair<SystemClockOffset, unsigned long long> > index;
+        std::string raw;           //!< buffer for snapshot and VCD text
+        std::string packed;        //!< buffer for compressed block
+};
+
+//! Reads a file written by DumpVCDZ
+class VcdzReader {
+    
+    public:
+        //! Opens file name and reads header and index, aborts on errors
+        /*! If the file has no index, because simulation was aborted, all
+          blocks are scanned to build it. */
+        VcdzReader(const std::string &name);
+        
+        //! VCD header, definitions and initial $dumpvars
+        const std::string &GetHeader(void) const { return header; }
+        //! Count of data blocks
+        size_t GetBlockCount(void) const { return index.size(); }
+        //! Time of first cycle in data block i
+        SystemClockOffset GetBlockTime(size_t i) const { return index[i].first; }
+        //! Index of last data block, which starts at or before time, -1 if there is none
+        int FindBlock(SystemClockOffset time) const;
+        //! Reads data block i, the snapshot of values at begin and the VCD text
+        void ReadBlock(size_t i, std::string &snapshot, std::string &text);
+        //! Writes the whole VCD file to os
+        void Convert(std::ostream &os);
+        //! Writes the VCD file for the time window start to end (-1 for open end) to os
+        /*! The values at start are written as $dumpvars at time start, then
+          the cycles after start up to end follow. Only the blocks from the
+          one, which contains start, are read. */
+        void ConvertWindow(std::ostream &os, SystemClockOffset start, SystemClockOffset end);
+        
+    private:
+        std::ifstream in;
+        std::string name;
+        std::string header;
+        std::vector<std::pair<SystemClockOffset, unsigned long long> > index;
+        
+        //! Reads block at file offset, returns false at end of file
+        bool ReadBlockAt(unsigned long long offset, std::string &data, size_t &snapLen,
+                         unsigned long long &next);
+};
+
+#endif